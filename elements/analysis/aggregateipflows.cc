@@ -175,6 +175,24 @@ AggregateIPFlows::cleanup(CleanupStage)
 #endif
 }
 
+void
+AggregateIPFlows::take_state(Element *e, ErrorHandler *)
+{
+    AggregateIPFlows *o = (AggregateIPFlows *) e->cast("AggregateIPFlows");
+    if (!o)
+	return;
+#if CLICK_USERLEVEL
+    // TRACEINFO flows are StatFlowInfos, which carry per-file state
+    if (stats() || o->stats())
+	return;
+#endif
+    _tcp_map.swap(o->_tcp_map);
+    _udp_map.swap(o->_udp_map);
+    _next = o->_next;
+    _active_sec = o->_active_sec;
+    _gc_sec = o->_gc_sec;
+}
+
 inline void
 AggregateIPFlows::delete_flowinfo(const HostPair &hp, FlowInfo *finfo, bool really_delete)
 {
@@ -592,11 +610,11 @@ AggregateIPFlows::pull(int)
 void
 AggregateIPFlows::push_batch(int, PacketBatch *batch)
 {
-    CLASSIFY_EACH_PACKET(3,handle_packet,batch,[this](int action,PacketBatch* batch){
+    CLASSIFY_EACH_PACKET_PREFETCH(3,handle_packet,batch,[this](int action,PacketBatch* batch){
         if (likely(action != ACT_NONE)) {
             checked_output_push_batch(action, batch);
         }
-    });
+    }, batch_prefetch_distance());
     if (_active_sec >= _gc_sec)
     reap();
 }
@@ -612,7 +630,7 @@ AggregateIPFlows::pull_batch(int, int max)
             else if (action == 1)
                 checked_output_push_batch(1,subbatch);
         };
-        CLASSIFY_EACH_PACKET(3,handle_packet,batch,on_finish);
+        CLASSIFY_EACH_PACKET_PREFETCH(3,handle_packet,batch,on_finish,batch_prefetch_distance());
     }
 
     // GC if necessary
@@ -115,6 +115,11 @@ Default is true in a push context and false in a pull context.
 AggregateIPFlows is an AggregateNotifier, so AggregateListeners can request
 notifications when new aggregates are created and old ones are deleted.
 
+When hot-swapped in, AggregateIPFlows takes over the flows of the old
+AggregateIPFlows with the same name, so existing flows keep their aggregate
+annotations.  Flows are not taken over if either element has a TRACEINFO
+file.
+
 =h clear write-only
 
 Clears all flow information. Future packets will get new aggregate annotation
@@ -157,6 +162,7 @@ class AggregateIPFlows : public BatchElement, public AggregateNotifier { public:
     int initialize(ErrorHandler *) CLICK_COLD;
     void add_handlers() CLICK_COLD;
     void cleanup(CleanupStage) CLICK_COLD;
+    void take_state(Element *old, ErrorHandler *errh) CLICK_COLD;
 
 #if CLICK_USERLEVEL
     bool stats() const			{ return _traceinfo_file; }
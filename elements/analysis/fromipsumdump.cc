@@ -665,11 +665,15 @@ bool
 FromIPSummaryDump::check_timing(Packet *p)
 {
     assert(!_work_packet || _work_packet == p);
-    Timestamp now_s = Timestamp::now_steady();
     if (!_have_timing) {
-    _timing_offset = now_s - p->timestamp_anno();
+#if TIMESTAMP_WARPABLE
+    _timing_offset = Timestamp::warp_trace_offset(p->timestamp_anno());
+#else
+    _timing_offset = Timestamp::now_steady() - p->timestamp_anno();
+#endif
     _have_timing = true;
     }
+    Timestamp now_s = Timestamp::now_steady();
     Timestamp t = p->timestamp_anno() + _timing_offset;
     if (now_s < t) {
     t -= Timer::adjustment();
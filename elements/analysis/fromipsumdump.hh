@@ -46,6 +46,9 @@ is done reading. Default is false.
 Boolean. If true, then FromIPSummaryDump tries to maintain the timing of the
 original packet stream. The first packet is emitted immediately; thereafter,
 FromIPSummaryDump maintains the delays between packets. Default is false.
+Under the userlevel driver's B<--trace-time> option, timing is kept in
+simulated time, so Timestamp::now() and timers follow the trace while
+FromIPSummaryDump runs as fast as possible.
 
 =item ACTIVE
 
@@ -0,0 +1,581 @@
+// -*- c-basic-offset: 4 -*-
+/*
+ * ipfixexporter.{cc,hh} -- exports IP flow records as IPFIX or NetFlow v9
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Click LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Click LICENSE file; the license in that file is
+ * legally binding.
+ */
+
+#include <click/config.h>
+#include "ipfixexporter.hh"
+#include <click/args.hh>
+#include <click/error.hh>
+#include <click/straccum.hh>
+#include <clicknet/ip.h>
+#include <clicknet/tcp.h>
+#include <clicknet/ipfix.h>
+CLICK_DECLS
+
+// Record layout, in template order. The last two fields differ between
+// IPFIX (absolute milliseconds) and NetFlow v9 (milliseconds of uptime).
+static const uint16_t record_fields[][2] = {
+    { IPFIX_IE_SOURCE_IPV4_ADDRESS, 4 },
+    { IPFIX_IE_DESTINATION_IPV4_ADDRESS, 4 },
+    { IPFIX_IE_SOURCE_TRANSPORT_PORT, 2 },
+    { IPFIX_IE_DESTINATION_TRANSPORT_PORT, 2 },
+    { IPFIX_IE_PROTOCOL_IDENTIFIER, 1 },
+    { IPFIX_IE_TCP_CONTROL_BITS, 1 },
+    { IPFIX_IE_PACKET_DELTA_COUNT, 8 },
+    { IPFIX_IE_OCTET_DELTA_COUNT, 8 },
+    { IPFIX_IE_FLOW_START_MILLISECONDS, 8 },
+    { IPFIX_IE_FLOW_END_MILLISECONDS, 8 }
+};
+static const uint16_t nfv9_time_fields[][2] = {
+    { IPFIX_IE_FLOW_START_SYS_UP_TIME, 4 },
+    { IPFIX_IE_FLOW_END_SYS_UP_TIME, 4 }
+};
+enum { NFIELDS = sizeof(record_fields) / sizeof(record_fields[0]),
+       TEMPLATE_SET_SIZE = sizeof(click_ipfix_set) + 4 + 4 * NFIELDS };
+
+static inline unsigned char *
+put16(unsigned char *x, uint16_t v)
+{
+    v = htons(v);
+    memcpy(x, &v, 2);
+    return x + 2;
+}
+
+static inline unsigned char *
+put32(unsigned char *x, uint32_t v)
+{
+    v = htonl(v);
+    memcpy(x, &v, 4);
+    return x + 4;
+}
+
+static inline unsigned char *
+put64(unsigned char *x, uint64_t v)
+{
+    x = put32(x, v >> 32);
+    return put32(x, v);
+}
+
+IPFIXExporter::IPFIXExporter()
+    : _max_flows(65536), _thread_flows(65536), _active(1800000),
+      _inactive(15000), _template_interval(60000), _boot(0), _sample(1),
+      _mtu(1400), _export_delay(1000), _domain(0),
+      _template_id(IPFIX_TEMPLATE_ID_MIN),
+      _version(IPFIX_VERSION), _record_size(0)
+{
+    _seq = 0;
+}
+
+IPFIXExporter::~IPFIXExporter()
+{
+}
+
+int
+IPFIXExporter::configure(Vector<String> &conf, ErrorHandler *errh)
+{
+    uint32_t version = IPFIX_VERSION, max_flows = 65536, sample = 1;
+    uint32_t active = 1800, inactive = 15, template_interval = 60;
+    uint32_t mtu = 1400, domain = 0, export_delay = 1000;
+    uint16_t template_id = IPFIX_TEMPLATE_ID_MIN;
+    if (Args(conf, this, errh)
+	.read("VERSION", version)
+	.read("ACTIVE_TIMEOUT", SecondsArg(), active)
+	.read("INACTIVE_TIMEOUT", SecondsArg(), inactive)
+	.read("MAX_FLOWS", max_flows)
+	.read("SAMPLE", sample)
+	.read("MTU", mtu)
+	.read("EXPORT_DELAY", SecondsArg(3), export_delay)
+	.read("DOMAIN", domain)
+	.read("TEMPLATE_ID", template_id)
+	.read("TEMPLATE_INTERVAL", SecondsArg(), template_interval)
+	.complete() < 0)
+	return -1;
+
+    if (version != IPFIX_VERSION && version != NFV9_VERSION)
+	return errh->error("VERSION must be 9 or 10");
+    if (active == 0 || inactive == 0)
+	return errh->error("timeouts must be positive");
+    if (max_flows == 0 || sample == 0)
+	return errh->error("MAX_FLOWS and SAMPLE must be positive");
+    if (export_delay == 0)
+	return errh->error("EXPORT_DELAY must be positive");
+    if (template_id < IPFIX_TEMPLATE_ID_MIN)
+	return errh->error("TEMPLATE_ID must be at least %d", IPFIX_TEMPLATE_ID_MIN);
+
+    _version = version;
+    _record_size = 0;
+    for (int i = 0; i < NFIELDS; ++i)
+	_record_size += record_fields[i][1];
+    if (_version == NFV9_VERSION)
+	_record_size -= 8;
+    uint32_t min_mtu = (_version == IPFIX_VERSION ? sizeof(click_ipfix_header) : sizeof(click_nfv9_header))
+	+ TEMPLATE_SET_SIZE + sizeof(click_ipfix_set) + _record_size + 3;
+    if (mtu < min_mtu || mtu > 0xFFFF)
+	return errh->error("MTU must be between %u and 65535", min_mtu);
+
+    _max_flows = max_flows;
+    _active = (uint64_t) active * 1000;
+    _inactive = (uint64_t) inactive * 1000;
+    _template_interval = (uint64_t) template_interval * 1000;
+    _sample = sample;
+    _mtu = mtu;
+    _export_delay = export_delay;
+    _domain = domain;
+    _template_id = template_id;
+    return 0;
+}
+
+int
+IPFIXExporter::initialize(ErrorHandler *)
+{
+    unsigned nthreads = get_passing_threads().weight();
+    if (nthreads == 0)
+	nthreads = 1;
+    _thread_flows = _max_flows / nthreads;
+    if (_thread_flows == 0)
+	_thread_flows = 1;
+    for (unsigned i = 0; i < _timer.weight(); ++i) {
+	Timer &t = _timer.get_value(i);
+	new(&t) Timer(this);
+	t.initialize(this);
+	t.move_thread(_timer.get_mapping(i));
+	_state.get_value(i).timer = &t;
+    }
+    return 0;
+}
+
+void
+IPFIXExporter::alloc_state(State &s)
+{
+    s.pool = new Flow[_thread_flows];
+    s.free = 0;
+    for (uint32_t i = _thread_flows; i > 0; --i) {
+	s.pool[i - 1].lru_next = s.free;
+	s.free = &s.pool[i - 1];
+    }
+}
+
+void
+IPFIXExporter::cleanup(CleanupStage)
+{
+    for (unsigned t = 0; t < _state.weight(); ++t) {
+	State &s = _state.get_value(t);
+	s.timer = 0;
+	if (s.msg)
+	    s.msg->kill();
+	s.msg = 0;
+	s.map.clear();
+	delete[] s.pool;
+	s.pool = s.free = 0;
+	s.lru.lru_prev = s.lru.lru_next = &s.lru;
+	s.age.age_prev = s.age.age_next = &s.age;
+    }
+}
+
+inline IPFIXExporter::State &
+IPFIXExporter::state()
+{
+    State &s = *_state;
+    if (unlikely(!s.pool))
+	alloc_state(s);
+    return s;
+}
+
+IPFIXExporter::Flow *
+IPFIXExporter::new_flow(State &s, const FlowKey &key, uint64_t now,
+			PacketList &out)
+{
+    if (!s.free) {
+	Flow *old = s.lru.lru_next;
+	export_flow(s, old, now, out);
+	remove_flow(s, old);
+	++s.stats.evicted;
+    }
+    Flow *f = s.free;
+    s.free = f->lru_next;
+
+    f->key = key;
+    f->packets = f->bytes = 0;
+    f->first = f->last = now;
+    f->tcp_flags = 0;
+    f->lru_prev = s.lru.lru_prev;
+    f->lru_next = &s.lru;
+    s.lru.lru_prev->lru_next = f;
+    s.lru.lru_prev = f;
+    f->age_prev = s.age.age_prev;
+    f->age_next = &s.age;
+    s.age.age_prev->age_next = f;
+    s.age.age_prev = f;
+
+    s.map.set(key, f);
+    ++s.stats.created;
+    return f;
+}
+
+void
+IPFIXExporter::remove_flow(State &s, Flow *f)
+{
+    s.map.erase(f->key);
+    f->lru_prev->lru_next = f->lru_next;
+    f->lru_next->lru_prev = f->lru_prev;
+    f->age_prev->age_next = f->age_next;
+    f->age_next->age_prev = f->age_prev;
+    f->lru_next = s.free;
+    s.free = f;
+}
+
+void
+IPFIXExporter::expire(State &s, uint64_t now, PacketList &out)
+{
+    Flow *f;
+    while ((f = s.lru.lru_next) != &s.lru
+	   && (int64_t) (now - f->last) >= (int64_t) _inactive) {
+	export_flow(s, f, now, out);
+	remove_flow(s, f);
+    }
+    while ((f = s.age.age_next) != &s.age
+	   && (int64_t) (now - f->first) >= (int64_t) _active) {
+	export_flow(s, f, now, out);
+	f->packets = f->bytes = 0;
+	f->tcp_flags = 0;
+	f->first = now;
+	f->age_prev->age_next = f->age_next;
+	f->age_next->age_prev = f->age_prev;
+	f->age_prev = s.age.age_prev;
+	f->age_next = &s.age;
+	s.age.age_prev->age_next = f;
+	s.age.age_prev = f;
+    }
+}
+
+void
+IPFIXExporter::start_message(State &s, uint64_t now)
+{
+    s.msg = Packet::make(Packet::default_headroom, 0, _mtu, 0);
+    if (!s.msg)
+	return;
+    s.msg_len = (_version == IPFIX_VERSION ? sizeof(click_ipfix_header) : sizeof(click_nfv9_header));
+    s.msg_records = s.msg_templates = 0;
+
+    if (!s.template_sent || now - s.template_sent >= _template_interval) {
+	unsigned char *x = s.msg->data() + s.msg_len;
+	x = put16(x, _version == IPFIX_VERSION ? IPFIX_SET_TEMPLATE : NFV9_SET_TEMPLATE);
+	x = put16(x, TEMPLATE_SET_SIZE);
+	x = put16(x, _template_id);
+	x = put16(x, NFIELDS);
+	for (int i = 0; i < NFIELDS; ++i) {
+	    const uint16_t *field = record_fields[i];
+	    if (_version == NFV9_VERSION && i >= NFIELDS - 2)
+		field = nfv9_time_fields[i - (NFIELDS - 2)];
+	    x = put16(x, field[0]);
+	    x = put16(x, field[1]);
+	}
+	s.msg_len += TEMPLATE_SET_SIZE;
+	s.msg_templates = 1;
+	s.template_sent = now;
+    }
+
+    s.set_offset = s.msg_len;
+    s.msg_len += sizeof(click_ipfix_set);
+
+    s.msg_started = Timestamp::recent_steady();
+}
+
+void
+IPFIXExporter::finish_message(State &s, uint64_t now, PacketList &out)
+{
+    if (!s.msg)
+	return;
+    unsigned char *data = s.msg->data();
+    if (_version == NFV9_VERSION)
+	while ((s.msg_len - s.set_offset) & 3)
+	    data[s.msg_len++] = 0;
+    put16(put16(data + s.set_offset, _template_id), s.msg_len - s.set_offset);
+
+    unsigned char *x = data;
+    if (_version == IPFIX_VERSION) {
+	x = put16(x, IPFIX_VERSION);
+	x = put16(x, s.msg_len);
+	x = put32(x, now / 1000);
+	x = put32(x, _seq.fetch_and_add(s.msg_records));
+	put32(x, _domain);
+    } else {
+	x = put16(x, NFV9_VERSION);
+	x = put16(x, s.msg_records + s.msg_templates);
+	x = put32(x, now - _boot);
+	x = put32(x, now / 1000);
+	x = put32(x, _seq.fetch_and_add(1));
+	put32(x, _domain);
+    }
+
+    s.msg->take(_mtu - s.msg_len);
+    s.msg->set_timestamp_anno(Timestamp::make_msec(now));
+    out.append(s.msg);
+    s.msg = 0;
+    ++s.stats.messages;
+}
+
+void
+IPFIXExporter::export_flow(State &s, Flow *f, uint64_t now, PacketList &out)
+{
+    if (!f->packets)
+	return;
+    if (s.msg && s.msg_len + _record_size > _mtu)
+	finish_message(s, now, out);
+    if (!s.msg) {
+	start_message(s, now);
+	if (!s.msg)
+	    return;
+    }
+
+    unsigned char *x = s.msg->data() + s.msg_len;
+    uint32_t addr = f->key.flow.saddr().addr();
+    memcpy(x, &addr, 4);
+    addr = f->key.flow.daddr().addr();
+    memcpy(x + 4, &addr, 4);
+    uint16_t port = f->key.flow.sport();
+    memcpy(x + 8, &port, 2);
+    port = f->key.flow.dport();
+    memcpy(x + 10, &port, 2);
+    x[12] = f->key.proto;
+    x[13] = f->tcp_flags;
+    x = put64(put64(x + 14, f->packets), f->bytes);
+    if (_version == IPFIX_VERSION)
+	put64(put64(x, f->first), f->last);
+    else
+	put32(put32(x, f->first - _boot), f->last - _boot);
+
+    s.msg_len += _record_size;
+    ++s.msg_records;
+    ++s.stats.records;
+}
+
+inline void
+IPFIXExporter::account(State &s, Packet *p, PacketList &out)
+{
+    if (!p->has_network_header())
+	return;
+    const click_ip *iph = p->ip_header();
+    if (iph->ip_v != 4)
+	return;
+    if (_sample > 1 && ++s.sample_count < _sample)
+	return;
+    s.sample_count = 0;
+
+    if (!p->timestamp_anno().sec())
+	p->timestamp_anno().assign_now();
+    uint64_t now = p->timestamp_anno().msecval();
+    if (unlikely(!_boot))
+	_boot = now;
+    s.now = now;
+    s.now_steady = Timestamp::recent_steady();
+    expire(s, now, out);
+
+    FlowKey key;
+    key.proto = iph->ip_p;
+    bool ports = IP_FIRSTFRAG(iph) && p->transport_length() >= 4
+	&& (key.proto == IP_PROTO_TCP || key.proto == IP_PROTO_UDP
+	    || key.proto == IP_PROTO_SCTP || key.proto == IP_PROTO_DCCP);
+    if (ports)
+	key.flow = IPFlowID(p);
+    else
+	key.flow = IPFlowID(iph->ip_src, 0, iph->ip_dst, 0);
+
+    Flow *f = s.map.get(key);
+    if (!f)
+	f = new_flow(s, key, now, out);
+    else {
+	f->lru_prev->lru_next = f->lru_next;
+	f->lru_next->lru_prev = f->lru_prev;
+	f->lru_prev = s.lru.lru_prev;
+	f->lru_next = &s.lru;
+	s.lru.lru_prev->lru_next = f;
+	s.lru.lru_prev = f;
+    }
+
+    if (!f->packets)
+	f->first = now;
+    f->last = now;
+    ++f->packets;
+    f->bytes += ntohs(iph->ip_len);
+    if (ports && key.proto == IP_PROTO_TCP
+	&& p->transport_length() >= (int) sizeof(click_tcp))
+	f->tcp_flags |= p->tcp_header()->th_flags;
+    ++s.stats.packets;
+}
+
+void
+IPFIXExporter::push_messages(PacketList &out)
+{
+    for (Packet *q = out.head, *next; q; q = next) {
+	next = q->next();
+	q->set_next(0);
+	checked_output_push(1, q);
+    }
+}
+
+Timestamp
+IPFIXExporter::next_due(const State &s) const
+{
+    Timestamp due;
+    if (s.msg)
+	due = s.msg_started + Timestamp::make_msec(_export_delay);
+    const Flow *f = s.lru.lru_next;
+    if (f != &s.lru) {
+	uint64_t when = f->last + _inactive;
+	f = s.age.age_next;
+	if ((int64_t) (f->first + _active - when) < 0)
+	    when = f->first + _active;
+	Timestamp flow_due = s.now_steady;
+	if ((int64_t) (when - s.now) > 0)
+	    flow_due += Timestamp::make_msec(when - s.now);
+	if (!due || flow_due < due)
+	    due = flow_due;
+    }
+    return due;
+}
+
+inline void
+IPFIXExporter::arm(State &s, const Timestamp &due)
+{
+    // Called without s.lock: the timer code runs run_timer with its own
+    // lock held, and run_timer takes s.lock.
+    if (due && s.timer
+	&& (!s.timer->scheduled() || due < s.timer->expiry_steady()))
+	s.timer->schedule_at_steady(due);
+}
+
+void
+IPFIXExporter::push(int, Packet *p)
+{
+    State &s = state();
+    PacketList out;
+    s.lock.acquire();
+    account(s, p, out);
+    Timestamp due = next_due(s);
+    s.lock.release();
+    arm(s, due);
+    output(0).push(p);
+    push_messages(out);
+}
+
+#if HAVE_BATCH
+void
+IPFIXExporter::push_batch(int, PacketBatch *batch)
+{
+    State &s = state();
+    PacketList out;
+    s.lock.acquire();
+    FOR_EACH_PACKET(batch, p)
+	account(s, p, out);
+    Timestamp due = next_due(s);
+    s.lock.release();
+    arm(s, due);
+    output_push_batch(0, batch);
+    if (out.head)
+	output_push_batch(1, PacketBatch::make_from_simple_list(out.head, out.tail, out.count));
+}
+#endif
+
+void
+IPFIXExporter::flush(State &s, PacketList &out)
+{
+    Flow *f;
+    while ((f = s.lru.lru_next) != &s.lru) {
+	export_flow(s, f, s.now, out);
+	remove_flow(s, f);
+    }
+    finish_message(s, s.now, out);
+}
+
+void
+IPFIXExporter::run_timer(Timer *t)
+{
+    for (unsigned i = 0; i < _timer.weight(); ++i)
+	if (&_timer.get_value(i) == t) {
+	    State &s = _state.get_value(i);
+	    PacketList out;
+	    Timestamp now_steady = Timestamp::recent_steady(), due;
+	    s.lock.acquire();
+	    if (s.lru.lru_next != &s.lru) {
+		// No packet may have come for a while: advance the flow clock
+		// by the time elapsed since the latest one.
+		s.now += (now_steady - s.now_steady).msecval();
+		s.now_steady = now_steady;
+		expire(s, s.now, out);
+	    }
+	    if (s.msg && s.msg_started + Timestamp::make_msec(_export_delay) <= now_steady)
+		finish_message(s, s.now, out);
+	    due = next_due(s);
+	    s.lock.release();
+	    if (due)
+		t->schedule_at_steady(due);
+	    push_messages(out);
+	    return;
+	}
+}
+
+String
+IPFIXExporter::read_handler(Element *e, void *)
+{
+    IPFIXExporter *ex = static_cast<IPFIXExporter *>(e);
+    Stats st;
+    uint32_t flows = 0;
+    memset(&st, 0, sizeof(st));
+    for (unsigned t = 0; t < ex->_state.weight(); ++t) {
+	const State &s = ex->_state.get_value(t);
+	flows += s.map.size();
+	st.created += s.stats.created;
+	st.records += s.stats.records;
+	st.evicted += s.stats.evicted;
+	st.messages += s.stats.messages;
+	st.packets += s.stats.packets;
+    }
+
+    StringAccum sa;
+    sa << "flows:               " << flows << "\n"
+       << "flows created:       " << st.created << "\n"
+       << "records exported:    " << st.records << "\n"
+       << "flows evicted:       " << st.evicted << "\n"
+       << "messages sent:       " << st.messages << "\n"
+       << "packets counted:     " << st.packets << "\n";
+    return sa.take_string();
+}
+
+int
+IPFIXExporter::write_handler(const String &, Element *e, void *, ErrorHandler *)
+{
+    IPFIXExporter *ex = static_cast<IPFIXExporter *>(e);
+    for (unsigned t = 0; t < ex->_state.weight(); ++t) {
+	State &s = ex->_state.get_value(t);
+	PacketList out;
+	s.lock.acquire();
+	if (s.pool)
+	    ex->flush(s, out);
+	s.lock.release();
+	ex->push_messages(out);
+    }
+    return 0;
+}
+
+void
+IPFIXExporter::add_handlers()
+{
+    add_read_handler("stats", read_handler, 0);
+    add_write_handler("flush", write_handler, 0, Handler::BUTTON);
+}
+
+CLICK_ENDDECLS
+EXPORT_ELEMENT(IPFIXExporter)
+ELEMENT_MT_SAFE(IPFIXExporter)
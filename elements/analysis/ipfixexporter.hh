@@ -0,0 +1,264 @@
+// -*- c-basic-offset: 4 -*-
+#ifndef CLICK_IPFIXEXPORTER_HH
+#define CLICK_IPFIXEXPORTER_HH
+#include <click/batchelement.hh>
+#include <click/atomic.hh>
+#include <click/hashtable.hh>
+#include <click/ipflowid.hh>
+#include <click/sync.hh>
+#include <click/timer.hh>
+CLICK_DECLS
+
+/*
+=c
+
+IPFIXExporter([I<keywords> VERSION, ACTIVE_TIMEOUT, INACTIVE_TIMEOUT,
+MAX_FLOWS, SAMPLE, MTU, EXPORT_DELAY, DOMAIN, TEMPLATE_ID,
+TEMPLATE_INTERVAL])
+
+=s ipmeasure
+
+exports IP flow records as IPFIX or NetFlow v9
+
+=d
+
+Expects IP packets with IP header annotations as input. IPFIXExporter counts
+packets and bytes per flow, where a flow is identified by source and
+destination addresses, protocol, and, for TCP, UDP, SCTP, and DCCP, ports.
+All input packets are emitted unchanged on output 0.
+
+Flow records leave in IPFIX (RFC 7011) or NetFlow v9 (RFC 3954) messages on
+output 1, as UDP payloads ready for a Socket element or for UDPIPEncap. A
+record is exported when its flow has been idle for INACTIVE_TIMEOUT seconds,
+and every ACTIVE_TIMEOUT seconds while the flow stays busy. Records are
+packed into messages of at most MTU bytes; a message leaves when it is full,
+or EXPORT_DELAY after its first record, whichever comes first. The template
+leads the first message and is repeated every TEMPLATE_INTERVAL seconds.
+
+Each record has source and destination IPv4 addresses, ports, protocol, the
+OR of TCP flags, packet and byte counts, and first and last packet times
+(milliseconds since the epoch for IPFIX, since the first packet seen for
+NetFlow v9).
+
+Each thread passing packets through IPFIXExporter keeps its own flow cache,
+and MAX_FLOWS is split evenly between those threads. A flow seen by two
+threads yields two sets of records. Timeouts are checked as packets arrive,
+and by a per-thread timer while the thread has flows, so the flows of a
+thread that stops receiving packets still expire: their idle time counts from
+the latest packet's timestamp plus the real time elapsed since.
+
+Keyword arguments are:
+
+=over 8
+
+=item VERSION
+
+10 for IPFIX or 9 for NetFlow v9. Default is 10.
+
+=item ACTIVE_TIMEOUT
+
+Seconds. A busy flow is exported at least this often. Default is 1800.
+
+=item INACTIVE_TIMEOUT
+
+Seconds. A flow is exported and forgotten once it has been idle this long.
+Default is 15.
+
+=item MAX_FLOWS
+
+Maximum number of flows in the cache. When the cache is full, the least
+recently active flow is exported early. Default is 65536.
+
+=item SAMPLE
+
+Integer. Count only one packet of every SAMPLE; counts in the records are of
+sampled packets. Default is 1.
+
+=item MTU
+
+Maximum size of an export message in bytes. Default is 1400.
+
+=item EXPORT_DELAY
+
+Seconds, with millisecond precision. Longest time, in real time, that a record
+waits in a partly filled message. Default is 1.
+
+=item DOMAIN
+
+Observation domain ID (IPFIX) or source ID (NetFlow v9). Default is 0.
+
+=item TEMPLATE_ID
+
+Template ID used for the records. Default is 256.
+
+=item TEMPLATE_INTERVAL
+
+Seconds between template retransmissions. Default is 60.
+
+=back
+
+Times are taken from packet timestamp annotations; packets without one are
+stamped with the current time.
+
+=h stats read-only
+
+Returns counters summed over all threads: flows in the cache, flows created,
+records exported, flows evicted early, messages sent, and packets counted.
+
+=h flush write-only
+
+Exports every flow in the cache and sends all pending messages, for example
+at the end of a trace.
+
+=e
+
+  FromDevice(eth0) -> CheckIPHeader(14)
+      -> ex :: IPFIXExporter(INACTIVE_TIMEOUT 10)
+      -> Discard;
+  ex[1] -> Socket(UDP, 192.168.1.2, 4739, CLIENT true);
+
+=a AggregateIPFlows, ToIPFlowDumps, Socket, UDPIPEncap */
+
+class IPFIXExporter : public BatchElement { public:
+
+    IPFIXExporter() CLICK_COLD;
+    ~IPFIXExporter() CLICK_COLD;
+
+    const char *class_name() const	{ return "IPFIXExporter"; }
+    const char *port_count() const	{ return "1/2"; }
+    const char *processing() const	{ return PUSH; }
+
+    int configure(Vector<String> &, ErrorHandler *) CLICK_COLD;
+    int initialize(ErrorHandler *) CLICK_COLD;
+    void cleanup(CleanupStage) CLICK_COLD;
+    void add_handlers() CLICK_COLD;
+
+    void push(int, Packet *);
+#if HAVE_BATCH
+    void push_batch(int, PacketBatch *);
+#endif
+    void run_timer(Timer *);
+
+  private:
+
+    struct FlowKey {
+	IPFlowID flow;
+	uint8_t proto;
+	inline hashcode_t hashcode() const {
+	    return flow.hashcode() ^ proto;
+	}
+	inline bool operator==(const FlowKey &x) const {
+	    return flow == x.flow && proto == x.proto;
+	}
+    };
+
+    struct Flow {
+	FlowKey key;
+	Flow *lru_prev;		// ordered by last packet
+	Flow *lru_next;
+	Flow *age_prev;		// ordered by start of the current record
+	Flow *age_next;
+	uint64_t packets;
+	uint64_t bytes;
+	uint64_t first;		// milliseconds
+	uint64_t last;
+	uint8_t tcp_flags;
+    };
+
+    struct Stats {
+	uint32_t created;
+	uint32_t records;
+	uint32_t evicted;
+	uint32_t messages;
+	uint64_t packets;
+    };
+
+    struct PacketList {
+	Packet *head;
+	Packet *tail;
+	unsigned count;
+	PacketList()
+	    : head(0), tail(0), count(0) {
+	}
+	inline void append(Packet *p) {
+	    p->set_next(0);
+	    if (tail)
+		tail->set_next(p);
+	    else
+		head = p;
+	    tail = p;
+	    ++count;
+	}
+    };
+
+    // A thread's state is used by that thread, and by the flush handler and
+    // the timer under the lock. Nothing schedules the timer with the lock
+    // held.
+    struct State {
+	Spinlock lock;
+	HashTable<FlowKey, Flow *> map;
+	Flow *pool;
+	Flow *free;
+	Flow lru;		// list heads
+	Flow age;
+	WritablePacket *msg;	// message being filled
+	Timestamp msg_started;	// steady time of msg's first record
+	Timer *timer;		// finishes msg, expires flows
+	uint32_t msg_len;
+	uint32_t set_offset;	// offset of the data set header in msg
+	uint16_t msg_records;	// data records in msg
+	uint16_t msg_templates;	// template records in msg
+	uint64_t template_sent;	// milliseconds; 0 means never
+	uint64_t now;		// time of the latest packet
+	Timestamp now_steady;	// steady time when now was taken
+	uint32_t sample_count;
+	Stats stats;
+	State()
+	    : pool(0), free(0), msg(0), timer(0), msg_len(0), set_offset(0),
+	      msg_records(0), msg_templates(0), template_sent(0), now(0),
+	      sample_count(0) {
+	    lru.lru_prev = lru.lru_next = &lru;
+	    age.age_prev = age.age_next = &age;
+	    memset(&stats, 0, sizeof(stats));
+	}
+    };
+
+    per_thread<State> _state;
+    per_thread<Timer> _timer;
+    uint32_t _max_flows;
+    uint32_t _thread_flows;
+    uint64_t _active;		// milliseconds
+    uint64_t _inactive;
+    uint64_t _template_interval;
+    uint64_t _boot;		// first packet time, for NetFlow v9 uptime
+    uint32_t _sample;
+    uint32_t _mtu;
+    uint32_t _export_delay;	// milliseconds
+    uint32_t _domain;
+    uint16_t _template_id;
+    uint8_t _version;
+    uint16_t _record_size;
+    atomic_uint32_t _seq;
+
+    inline State &state();
+    void alloc_state(State &) CLICK_COLD;
+    inline void account(State &, Packet *, PacketList &);
+    Flow *new_flow(State &, const FlowKey &, uint64_t, PacketList &);
+    void remove_flow(State &, Flow *);
+    void expire(State &, uint64_t, PacketList &);
+    void export_flow(State &, Flow *, uint64_t, PacketList &);
+    void start_message(State &, uint64_t);
+    void finish_message(State &, uint64_t, PacketList &);
+    void flush(State &, PacketList &) CLICK_COLD;
+    void push_messages(PacketList &);
+    Timestamp next_due(const State &) const;
+    inline void arm(State &, const Timestamp &);
+
+    static String read_handler(Element *, void *) CLICK_COLD;
+    static int write_handler(const String &, Element *, void *,
+			     ErrorHandler *) CLICK_COLD;
+
+};
+
+CLICK_ENDDECLS
+#endif
@@ -29,6 +29,7 @@
 #include <click/error.hh>
 #include <click/glue.hh>
 #include <click/packet_anno.hh>
+#include <click/batchview.hh>
 CLICK_DECLS
 
 ARPQuerier::ARPQuerier()
@@ -54,10 +55,10 @@ ARPQuerier::cast(const char *name)
 int
 ARPQuerier::configure(Vector<String> &conf, ErrorHandler *errh)
 {
-    uint32_t capacity, entry_capacity, entry_packet_capacity, capacity_slim_factor;
+    uint32_t capacity, entry_capacity, entry_packet_capacity, capacity_slim_factor, cache_capacity;
     Timestamp timeout, poll_timeout(60);
     bool have_capacity, have_entry_capacity, have_entry_packet_capacity, have_capacity_slim_factor, have_timeout, have_broadcast,
-	broadcast_poll = false;
+	have_cache_capacity, broadcast_poll = false;
     _arpt = 0;
     if (Args(this, errh).bind(conf)
 	.read("CAPACITY", capacity).read_status(have_capacity)
@@ -65,6 +66,7 @@ ARPQuerier::configure(Vector<String> &conf, ErrorHandler *errh)
 	.read("ENTRY_PACKET_CAPACITY", entry_packet_capacity).read_status(have_entry_packet_capacity)
 	.read("CAPACITY_SLIM_FACTOR", capacity_slim_factor).read_status(have_capacity_slim_factor)
 	.read("TIMEOUT", timeout).read_status(have_timeout)
+	.read("CACHE_CAPACITY", cache_capacity).read_status(have_cache_capacity)
 	.read("BROADCAST", _my_bcast_ip).read_status(have_broadcast)
 	.read("TABLE", ElementCastArg("ARPTable"), _arpt)
 	.read("POLL_TIMEOUT", poll_timeout)
@@ -84,6 +86,8 @@ ARPQuerier::configure(Vector<String> &conf, ErrorHandler *errh)
 	    subconf.push_back("CAPACITY_SLIM_FACTOR " + String(capacity_slim_factor));
 	if (have_timeout)
 	    subconf.push_back("TIMEOUT " + timeout.unparse());
+	if (have_cache_capacity)
+	    subconf.push_back("CACHE_CAPACITY " + String(cache_capacity));
 	_arpt = new ARPTable;
 	_arpt->attach_router(router(), -1);
 	_arpt->configure(subconf, errh);
@@ -131,6 +135,7 @@ ARPQuerier::live_reconfigure(Vector<String> &conf, ErrorHandler *errh)
 	.read("TIMEOUT", timeout).read_status(have_timeout)
 	.read("BROADCAST", my_bcast_ip).read_status(have_broadcast)
 	.read_with("TABLE", AnyArg())
+	.read_with("CACHE_CAPACITY", AnyArg())
 	.read("POLL_TIMEOUT", poll_timeout)
 	.read("BROADCAST_POLL", broadcast_poll)
 	.consume() < 0)
@@ -414,9 +419,39 @@ void
 ARPQuerier::push_batch(int port, PacketBatch *batch)
 {
     if (port == 0) {
-        EXECUTE_FOR_EACH_PACKET_DROPPABLE(handle_ip,batch,[](Packet*p){});
-        if (batch)
-            output(0).push_batch(batch);
+        BatchView v;
+        EtherAddress eth[BatchView::CAPACITY];
+        int r[BatchView::CAPACITY];
+        PacketBatch *outs[1] = {0};
+        Packet *next = batch;
+        while (next) {
+            // Resolve the whole view in one pass over the table; packets
+            // whose address is not known take the per-packet path.
+            next = v.gather(next, BatchView::F_DST_ANNO);
+            unsigned n = v.size();
+            _arpt->lookup_batch(v.dst_anno, eth, r, n, _poll_timeout_j);
+            for (unsigned i = 0; i < n; ++i) {
+                Packet *p = v.packet[i];
+                if (r[i] < 0 || !_my_ip) {
+                    v.packet[i] = handle_ip(p, false);
+                    continue;
+                }
+                WritablePacket *q = p->push_mac_header(sizeof(click_ether));
+                v.packet[i] = q;
+                if (!q) {
+                    ++_drops;
+                    continue;
+                }
+                click_ether *ethh = q->ether_header();
+                ethh->ether_type = htons(ETHERTYPE_IP);
+                memcpy(ethh->ether_dhost, eth[i].data(), 6);
+                memcpy(ethh->ether_shost, _my_en.data(), 6);
+                if (r[i] > 0)
+                    send_query_for(q, true);
+            }
+            v.scatter(outs, 1);
+        }
+        BatchView::push(this, outs, 1);
     } else {
         FOR_EACH_PACKET_SAFE(batch,p) {
             handle_response(p);
@@ -35,6 +35,13 @@ an ARP query is sent instead. If an ARP response arrives
 on input 1 for an IP address that we need, the mapping is
 recorded and any saved IP packets are sent.
 
+Forwarding known destinations takes no lock.  ARPQuerier looks up the
+destinations of a whole batch at once in the ARP table's lock-free cache.
+Destinations whose entry is older than POLL_TIMEOUT miss the cache and are
+looked up under the table's read lock instead; there one packet marks the
+entry as polled, and ARPQuerier sends the refresh query as it forwards that
+packet.
+
 The ARP reply packets on input 1 should include the Ethernet header.
 
 ARPQuerier may have one or two outputs. If it has two, then ARP queries
@@ -56,7 +63,7 @@ Keyword arguments are:
 Element.  Names an ARPTable element that holds this element's corresponding
 ARP state.  By default ARPQuerier creates its own internal ARPTable and uses
 that.  If TABLE is specified, CAPACITY, ENTRY_CAPACITY, ENTRY_PACKET_CAPACITY,
-and TIMEOUT are ignored.
+TIMEOUT, and CACHE_CAPACITY are ignored.
 
 =item CAPACITY
 
@@ -77,6 +84,11 @@ for any given ARP entry at a time.  Default is 0, which means unlimited.
 
 Amount of time before an ARP entry expires.  Defaults to 5 minutes.
 
+=item CACHE_CAPACITY
+
+Unsigned integer.  The number of known entries the table keeps in its
+lock-free lookup cache; see ARPTable.  Default is 4096.
+
 =item POLL_TIMEOUT
 
 Amount of time after which ARPQuerier will start polling for renewal.  0 means
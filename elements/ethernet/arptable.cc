@@ -44,19 +44,24 @@ int
 ARPTable::configure(Vector<String> &conf, ErrorHandler *errh)
 {
     Timestamp timeout(300);
+    uint32_t cache_capacity = 4096;
     if (Args(conf, this, errh)
 	.read("CAPACITY", _packet_capacity)
 	.read("ENTRY_CAPACITY", _entry_capacity)
 	.read("ENTRY_PACKET_CAPACITY", _entry_packet_capacity)
 	.read("CAPACITY_SLIM_FACTOR", _capacity_slim_factor)
 	.read("TIMEOUT", timeout)
+	.read("CACHE_CAPACITY", cache_capacity)
 	.complete() < 0)
 	return -1;
     if (_capacity_slim_factor == 0)
 	return errh->error("CAPACITY_SLIM_FACTOR cannot be zero");
+    if (_cache.initialize(cache_capacity) < 0)
+	return errh->error("out of memory");
     set_timeout(timeout);
     if (_timeout_j) {
 	_expire_timer.initialize(this);
+	_expire_timer.set_coarse();
 	_expire_timer.schedule_after_sec(_timeout_j / CLICK_HZ);
     }
     return 0;
@@ -83,6 +88,21 @@ ARPTable::clear()
     }
     _entry_count = _packet_count = 0;
     _age.__clear();
+    cache_fill();
+}
+
+// The cache writers must hold _lock for writing, or otherwise exclude each
+// other; readers may run concurrently.
+
+void
+ARPTable::cache_fill()
+{
+    if (!_cache.enabled())
+	return;
+    _cache.clear();
+    for (Table::iterator it = _table.begin(); it; ++it)
+	if (it->_known)
+	    _cache.set(it->_ip, it->_eth, it->_live_at_j);
 }
 
 void
@@ -105,6 +125,8 @@ ARPTable::take_state(Element *e, ErrorHandler *errh)
 
     arpt->_entry_count = 0;
     arpt->_packet_count = 0;
+    cache_fill();
+    arpt->cache_fill();
 }
 
 void
@@ -118,6 +140,7 @@ ARPTable::slim(click_jiffies_t now)
 	       || (_entry_capacity && _entry_count > _entry_capacity))) {
 	_table.erase(ae->_ip);
 	_age.pop_front();
+	_cache.erase(ae->_ip);
 
 	while (Packet *p = ae->_head) {
 	    ae->_head = p->next();
@@ -208,6 +231,11 @@ ARPTable::insert(IPAddress ip, const EtherAddress &eth, Packet **head)
 	_age.push_back(ae);
     }
 
+    if (ae->_known)
+	_cache.set(ae->_ip, ae->_eth, ae->_live_at_j);
+    else
+	_cache.erase(ip);
+
     if (head) {
 	*head = ae->_head;
 	ae->_head = ae->_tail = 0;
@@ -283,6 +311,19 @@ ARPTable::append_query(IPAddress ip, Packet *p)
     return r;
 }
 
+void
+ARPTable::lookup_batch(const uint32_t *ip, EtherAddress *eth, int *r,
+		       unsigned n, uint32_t poll_timeout_j)
+{
+    // Prefetch the cache sets of the whole batch before reading any.
+    if (_cache.enabled())
+	for (unsigned i = 0; i < n; ++i)
+	    _cache.prefetch(IPAddress(ip[i]));
+    for (unsigned i = 0; i < n; ++i)
+	if (!cache_lookup(IPAddress(ip[i]), &eth[i], poll_timeout_j, r[i]))
+	    r[i] = locked_lookup(IPAddress(ip[i]), &eth[i], poll_timeout_j);
+}
+
 IPAddress
 ARPTable::reverse_lookup(const EtherAddress &eth)
 {
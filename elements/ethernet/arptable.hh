@@ -7,6 +7,8 @@
 #include <click/sync.hh>
 #include <click/timer.hh>
 #include <click/list.hh>
+#include <click/atomic.hh>
+#include <click/neighborcache.hh>
 CLICK_DECLS
 
 /*
@@ -57,6 +59,24 @@ service attack.
 Time value.  The amount of time after which an ARP entry will expire.  Default
 is 5 minutes.  Zero means ARP entries never expire.
 
+=item CACHE_CAPACITY
+
+Unsigned integer.  The number of known entries mirrored in the lock-free
+lookup cache (see below).  Rounded up to a power of two times three.  Default
+is 4096; zero disables the cache.  Cannot be changed by reconfiguration.
+
+=back
+
+Lookups of known entries do not take a lock.  ARPTable mirrors its known
+entries in a cache of cache-line-sized sets of three entries, each guarded by
+a sequence counter: table updates write the cache under the table's lock,
+and lookups read a set and retry if its counter changed meanwhile, so readers
+never write shared memory.  Only lookups that miss the cache, because the
+address is unknown or its set is full, take the table's read lock.  So do
+lookups of an entry older than the caller's poll timeout, since the poll
+state is kept in the table only; the reply refreshes the entry and its cache
+copy.
+
 =h table r
 
 Return a table of the ARP entries.  The returned string has four
@@ -108,6 +128,8 @@ class ARPTable : public Element { public:
 
     int lookup(IPAddress ip, EtherAddress *eth, uint32_t poll_timeout_j);
     EtherAddress lookup(IPAddress ip);
+    void lookup_batch(const uint32_t *ip, EtherAddress *eth, int *r,
+		      unsigned n, uint32_t poll_timeout_j);
     IPAddress reverse_lookup(const EtherAddress &eth);
     int insert(IPAddress ip, const EtherAddress &en, Packet **head = 0);
     int append_query(IPAddress ip, Packet *p);
@@ -225,13 +247,43 @@ class ARPTable : public Element { public:
     SizedHashAllocator<sizeof(ARPEntry)> _alloc;
     Timer _expire_timer;
 
+    // known entries; stamps are the low bits of _live_at_j
+    NeighborCache<IPAddress, 3> _cache;
+
     ARPEntry *ensure(IPAddress ip, click_jiffies_t now);
     void slim(click_jiffies_t now);
+    inline int locked_lookup(IPAddress ip, EtherAddress *eth, uint32_t poll_timeout_j);
+
+    static inline bool jiffies32_less(uint32_t a, uint32_t b) {
+	return (int32_t) (a - b) < 0;
+    }
+    inline bool cache_lookup(IPAddress ip, EtherAddress *eth,
+			     uint32_t poll_timeout_j, int &r);
+    void cache_fill();
 
 };
 
+inline bool
+ARPTable::cache_lookup(IPAddress ip, EtherAddress *eth, uint32_t poll_timeout_j,
+		       int &r)
+{
+    uint32_t live_at_j;
+    if (!_cache.lookup(ip, eth, &live_at_j))
+	return false;
+
+    // Expired entries are left to the locked path, which agrees, and so are
+    // entries due for a poll, whose poll state lives in the table.
+    uint32_t now = click_jiffies();
+    if (_timeout_j && jiffies32_less(live_at_j + _timeout_j, now))
+	return false;
+    if (poll_timeout_j && !jiffies32_less(now, live_at_j + poll_timeout_j))
+	return false;
+    r = 0;
+    return true;
+}
+
 inline int
-ARPTable::lookup(IPAddress ip, EtherAddress *eth, uint32_t poll_timeout_j)
+ARPTable::locked_lookup(IPAddress ip, EtherAddress *eth, uint32_t poll_timeout_j)
 {
     _lock.acquire_read();
     int r = -1;
@@ -252,6 +304,15 @@ ARPTable::lookup(IPAddress ip, EtherAddress *eth, uint32_t poll_timeout_j)
     return r;
 }
 
+inline int
+ARPTable::lookup(IPAddress ip, EtherAddress *eth, uint32_t poll_timeout_j)
+{
+    int r;
+    if (cache_lookup(ip, eth, poll_timeout_j, r))
+	return r;
+    return locked_lookup(ip, eth, poll_timeout_j);
+}
+
 inline EtherAddress
 ARPTable::lookup(IPAddress ip)
 {
@@ -46,8 +46,8 @@ EtherEncap::configure(Vector<String> &conf, ErrorHandler *errh)
     return 0;
 }
 
-inline Packet *
-EtherEncap::smaction(Packet *p)
+Packet *
+EtherEncap::simple_action(Packet *p)
 {
     if (WritablePacket *q = p->push_mac_header(14)) {
         memcpy(q->data(), &_ethh, 14);
@@ -56,13 +56,6 @@ EtherEncap::smaction(Packet *p)
     return 0;
 }
 
-inline void
-EtherEncap::push(int, Packet *p)
-{
-    if (Packet *q = smaction(p))
-        output(0).push(q);
-}
-
 #if HAVE_BATCH
 void
 EtherEncap::push_batch(int, PacketBatch *batch) {
@@ -74,7 +67,7 @@ EtherEncap::push_batch(int, PacketBatch *batch) {
     while (current != NULL) {
         Packet *next = current->next();
 
-        current = smaction(current);
+        current = EtherEncap::simple_action(current);
         if (current == NULL) {
             click_chatter("%s : could not set ethernet header !",name().c_str());
             current = next;
@@ -102,14 +95,6 @@ EtherEncap::push_batch(int, PacketBatch *batch) {
 }
 #endif
 
-Packet *
-EtherEncap::pull(int)
-{
-    if (Packet *p = input(0).pull())
-        return smaction(p);
-    return 0;
-}
-
 void
 EtherEncap::add_handlers()
 {
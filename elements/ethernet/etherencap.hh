@@ -56,16 +56,13 @@ class EtherEncap : public BatchElement {
 
         const char *class_name() const    { return "EtherEncap"; }
         const char *port_count() const    { return PORTS_1_1; }
+        const char *flags() const         { return "F"; }
 
         int configure(Vector<String> &, ErrorHandler *) CLICK_COLD;
         bool can_live_reconfigure() const    { return true; }
         void add_handlers() CLICK_COLD;
 
-        inline Packet *smaction(Packet *);
-
-        Packet *pull(int);
-
-        void push      (int, Packet*);
+        Packet *simple_action(Packet *);
     #if HAVE_BATCH
         void push_batch(int, PacketBatch*);
     #endif
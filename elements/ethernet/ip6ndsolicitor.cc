@@ -44,10 +44,32 @@ IP6NDSolicitor::~IP6NDSolicitor()
 int
 IP6NDSolicitor::configure(Vector<String> &conf, ErrorHandler *errh)
 {
-    return Args(conf, this, errh)
+    uint32_t cache_capacity = 512;
+    if (Args(conf, this, errh)
 	.read_mp("IP", _my_ip6)
 	.read_mp("ETH", _my_en)
-	.complete();
+	.read("CACHE_CAPACITY", cache_capacity)
+	.complete() < 0)
+	return -1;
+    if (_cache.initialize(cache_capacity) < 0)
+	return errh->error("out of memory");
+    return 0;
+}
+
+// The cache writers must hold _lock for writing, or otherwise exclude each
+// other; readers may run concurrently.  Only entries that are known and not
+// polling are cached, so the poll state lives in the table only.
+
+void
+IP6NDSolicitor::cache_fill()
+{
+  if (!_cache.enabled())
+    return;
+  _cache.clear();
+  for (int i = 0; i < NMAP; i++)
+    for (NDEntry *ae = _map[i]; ae; ae = ae->next)
+      if (ae->ok && !ae->polling)
+	cache_set(ae);
 }
 
 int
@@ -73,6 +95,7 @@ IP6NDSolicitor::cleanup(CleanupStage)
     }
     _map[i] = 0;
   }
+  cache_fill();
 }
 
 void
@@ -86,6 +109,8 @@ IP6NDSolicitor::take_state(Element *e, ErrorHandler *)
   memcpy(save, _map, sizeof(NDEntry *) * NMAP);
   memcpy(_map, arpq->_map, sizeof(NDEntry *) * NMAP);
   memcpy(arpq->_map, save, sizeof(NDEntry *) * NMAP);
+  cache_fill();
+  arpq->cache_fill();
 }
 
 void
@@ -93,6 +118,7 @@ IP6NDSolicitor::expire_hook(Timer *, void *thunk)
 {
   IP6NDSolicitor *arpq = (IP6NDSolicitor *)thunk;
   click_jiffies_t jiff = click_jiffies();
+  arpq->_lock.acquire_write();
   for (int i = 0; i < NMAP; i++) {
     NDEntry *prev = 0;
     while (1) {
@@ -105,16 +131,20 @@ IP6NDSolicitor::expire_hook(Timer *, void *thunk)
 	  // delete entry from map
 	  if (prev) prev->next = e->next;
 	  else arpq->_map[i] = e->next;
+	  arpq->_cache.erase(e->ip6);
 	  if (e->p)
 	    e->p->kill();
 	  delete e;
 	  continue;		// don't change prev
-	} else if (gap > 60*CLICK_HZ)
+	} else if (gap > 60*CLICK_HZ && !e->polling) {
 	  e->polling = 1;
+	  arpq->_cache.erase(e->ip6);
+	}
       }
       prev = e;
     }
   }
+  arpq->_lock.release_write();
   arpq->_expire_timer.schedule_after_msec(EXPIRE_TIMEOUT_MS);
 }
 
@@ -184,6 +214,19 @@ IP6NDSolicitor::send_query_for(const u_char want_ip6[16])
   output(noutputs()-1).push(q);
 }
 
+void
+IP6NDSolicitor::send_ip6(Packet *p, const EtherAddress &en)
+{
+  WritablePacket *q = p->push(sizeof(click_ether));
+  if (!q)
+    return;
+  click_ether *e = (click_ether *)q->data();
+  memcpy(e->ether_shost, _my_en.data(), 6);
+  memcpy(e->ether_dhost, en.data(), 6);
+  e->ether_type = htons(ETHERTYPE_IP6);
+  output(0).push(q);
+}
+
 /*
  * If the packet's IP6 address is in the table, add an ethernet header
  * and push it out.
@@ -195,43 +238,58 @@ void
 IP6NDSolicitor::handle_ip6(Packet *p)
 {
   IP6Address ipa = DST_IP6_ANNO(p);
-  int bucket = (ipa.data()[0] + ipa.data()[15]) % NMAP;
-  NDEntry *ae = _map[bucket];
+  EtherAddress en;
+  uint32_t stamp;
+  if (_cache.lookup(ipa, &en, &stamp)) {
+    send_ip6(p, en);
+    return;
+  }
+
+  // Packets are pushed only after the lock is released.
+  bool query = false, ok = false;
+  Packet *killed = 0;
+  _lock.acquire_write();
+  int b = bucket(ipa);
+  NDEntry *ae = _map[b];
   while (ae && ae->ip6 != ipa)
     ae = ae->next;
 
   if (ae) {
     if (ae->polling) {
-      send_query_for(ae->ip6.data());
+      query = true;
       ae->polling = 0;
+      if (ae->ok)
+	cache_set(ae);
     }
     //find the match IP address, send to output 0
     if (ae->ok) {
-      Packet *q = p->push(sizeof(click_ether));
-      click_ether *e = (click_ether *)q->data();
-      memcpy(e->ether_shost, _my_en.data(), 6);
-      memcpy(e->ether_dhost, ae->en.data(), 6);
-      e->ether_type = htons(ETHERTYPE_IP6);
-      output(0).push(q);
+      en = ae->en;
+      ok = true;
     } else {
-      if (ae->p) {
-        ae->p->kill();
-	_pkts_killed++;
-      }
+      killed = ae->p;
       ae->p = p;
-      send_query_for(DST_IP6_ANNO(p).data());
+      query = true;
     }
 
-  } else {
-    NDEntry *ae = new NDEntry;
+  } else if ((ae = new NDEntry)) {
     ae->ip6 = ipa;
     ae->ok = ae->polling = 0;
     ae->p = p;
-    ae->next = _map[bucket];
-    _map[bucket] = ae;
+    ae->next = _map[b];
+    _map[b] = ae;
+    query = true;
+  } else
+    killed = p;
+  _lock.release_write();
 
-    send_query_for(DST_IP6_ANNO(p).data());
+  if (killed) {
+    killed->kill();
+    _pkts_killed++;
   }
+  if (query)
+    send_query_for(ipa.data());
+  if (ok)
+    send_ip6(p, en);
 }
 
 /*
@@ -254,22 +312,27 @@ IP6NDSolicitor::handle_response(Packet *p)
     if (ntohs(ethh->ether_type) == ETHERTYPE_IP6
 	&& eah->type == ND_ADV) {
 //        && !ena.is_group()) {
-     int bucket = (ipa.data()[0] + ipa.data()[15]) % NMAP;
-      NDEntry *ae = _map[bucket];
+      _lock.acquire_write();
+      NDEntry *ae = _map[bucket(ipa)];
       while (ae && ae->ip6 != ipa)
         ae = ae->next;
-      if (!ae)
+      if (!ae) {
+	_lock.release_write();
         return;
+      }
 
-      if (ae->ok && ae->en != ena)
-        click_chatter("IP6NDSolicitor overwriting an entry");
+      bool overwrite = (ae->ok && ae->en != ena);
       ae->en = ena;
       ae->ok = 1;
       ae->polling = 0;
       ae->last_response_jiffies = click_jiffies();
       Packet *cached_packet = ae->p;
       ae->p = 0;
+      cache_set(ae);
+      _lock.release_write();
 
+      if (overwrite)
+        click_chatter("IP6NDSolicitor overwriting an entry");
       if (cached_packet){
         handle_ip6(cached_packet);}
     }
@@ -291,9 +354,11 @@ IP6NDSolicitor::read_table(Element *e, void *)
 {
     IP6NDSolicitor *q = (IP6NDSolicitor *)e;
     StringAccum sa;
+    q->_lock.acquire_read();
     for (int i = 0; i < NMAP; i++)
 	for (NDEntry *e = q->_map[i]; e; e = e->next)
 	    sa << e->ip6 << ' ' << (e->ok ? 1 : 0) << ' ' << e->en << '\n';
+    q->_lock.release_read();
     return sa.take_string();
 }
 
@@ -302,8 +367,8 @@ IP6NDSolicitor_read_stats(Element *e, void *)
 {
   IP6NDSolicitor *q = (IP6NDSolicitor *)e;
   return
-    String(q->_pkts_killed) + " packets killed\n" +
-    String(q->_arp_queries) + " ND Solicitation Message sent\n";
+    String(q->_pkts_killed.value()) + " packets killed\n" +
+    String(q->_arp_queries.value()) + " ND Solicitation Message sent\n";
 }
 
 void
@@ -316,3 +381,4 @@ IP6NDSolicitor::add_handlers()
 CLICK_ENDDECLS
 ELEMENT_REQUIRES(ip6)
 EXPORT_ELEMENT(IP6NDSolicitor)
+ELEMENT_MT_SAFE(IP6NDSolicitor)
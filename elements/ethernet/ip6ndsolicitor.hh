@@ -4,11 +4,14 @@
 #include <click/etheraddress.hh>
 #include <click/ip6address.hh>
 #include <click/timer.hh>
+#include <click/sync.hh>
+#include <click/atomic.hh>
+#include <click/neighborcache.hh>
 CLICK_DECLS
 
 /*
  * =c
- * IP6NDSolicitor(IP, ETH)
+ * IP6NDSolicitor(IP, ETH [, CACHE_CAPACITY])
  * =s ip6
  *
  * =d
@@ -33,6 +36,25 @@ CLICK_DECLS
  * IP6NDSolicitor may have one or two outputs. If it has two, then ARP queries
  * are sent to the second output.
  *
+ * Lookups of known neighbors do not take a lock: like ARPTable,
+ * IP6NDSolicitor mirrors the entries it knows and is not polling in a cache of
+ * cache-line-sized sets of two entries, each guarded by a sequence counter.
+ * Table updates write the cache under the table's lock; lookups read a set
+ * and retry if its counter changed meanwhile.  Other packets, and
+ * advertisements, take the table's lock.
+ *
+ * Keyword arguments are:
+ *
+ * =over 8
+ *
+ * =item CACHE_CAPACITY
+ *
+ * Unsigned integer.  The number of known entries mirrored in the lock-free
+ * lookup cache, rounded up to a power of two times two.  Default is 512; zero
+ * disables the cache.
+ *
+ * =back
+ *
  * =e
  *    c :: Classifier(12/86dd 20/3aff 54/87,
  *		      12/86dd 20/3aff 54/88,
@@ -83,18 +105,31 @@ class IP6NDSolicitor : public Element {
   };
 
   // statistics
-  int _arp_queries;
-  int _pkts_killed;
+  atomic_uint32_t _arp_queries;
+  atomic_uint32_t _pkts_killed;
 
  private:
 
   enum { NMAP = 256 };
+
+  ReadWriteLock _lock;
   NDEntry *_map[NMAP];
   EtherAddress _my_en;
   IP6Address _my_ip6;
   Timer _expire_timer;
 
+  NeighborCache<IP6Address, 2> _cache;
+
+  static inline int bucket(const IP6Address &ipa) {
+    return (ipa.data()[0] + ipa.data()[15]) % NMAP;
+  }
+  inline void cache_set(const NDEntry *ae) {
+    _cache.set(ae->ip6, ae->en, ae->last_response_jiffies);
+  }
+  void cache_fill();
+
   void send_query_for(const u_char want_ip6[16]);
+  void send_ip6(Packet *, const EtherAddress &);
 
   void handle_ip6(Packet *);
   void handle_response(Packet *);
@@ -0,0 +1,431 @@
+// -*- c-basic-offset: 4 -*-
+/*
+ * etherbridge.{cc,hh} -- multi-threaded, VLAN-aware learning Ethernet bridge
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Click LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Click LICENSE file; the license in that file is
+ * legally binding.
+ */
+
+#include <click/config.h>
+#include "etherbridge.hh"
+#include <click/args.hh>
+#include <click/error.hh>
+#include <click/straccum.hh>
+#include <click/packet_anno.hh>
+#include <click/batchview.hh>
+#include <clicknet/ether.h>
+CLICK_DECLS
+
+EtherBridge::EtherBridge()
+    : _table(0), _table_mem(0), _bucket_mask(0), _cache_mask(0),
+      _timeout(300), _timeout_j(300 * CLICK_HZ), _sweep(0), _timer(this)
+{
+}
+
+EtherBridge::~EtherBridge()
+{
+}
+
+int
+EtherBridge::configure(Vector<String> &conf, ErrorHandler *errh)
+{
+    uint32_t timeout = 300, capacity = 65536, cache = 4096;
+    if (Args(conf, this, errh)
+	.read("TIMEOUT", SecondsArg(), timeout)
+	.read("CAPACITY", capacity)
+	.read("CACHE", cache)
+	.complete() < 0)
+	return -1;
+    if (capacity == 0)
+	return errh->error("CAPACITY must be positive");
+    if (capacity > (1U << 28) || cache > (1U << 24))
+	return errh->error("CAPACITY or CACHE too large");
+
+    uint32_t nbuckets = 1;
+    while (nbuckets * WAYS < capacity)
+	nbuckets <<= 1;
+    _bucket_mask = nbuckets - 1;
+    uint32_t ncache = 1;
+    while (ncache < cache)
+	ncache <<= 1;
+    _cache_mask = ncache - 1;
+    _timeout = timeout;
+    return 0;
+}
+
+int
+EtherBridge::initialize(ErrorHandler *errh)
+{
+    uint32_t nbuckets = _bucket_mask + 1;
+    if (!(_table_mem = new char[nbuckets * sizeof(Bucket) + CLICK_CACHE_LINE_SIZE]))
+	return errh->error("out of memory");
+    uintptr_t x = (uintptr_t) _table_mem;
+    x = (x + CLICK_CACHE_LINE_SIZE - 1) & ~(uintptr_t) (CLICK_CACHE_LINE_SIZE - 1);
+    _table = (Bucket *) x;
+    memset(_table, 0, nbuckets * sizeof(Bucket));
+
+    for (unsigned i = 0; i < _state.weight(); ++i) {
+	State &s = _state.get_value(i);
+	if (!(s.cache = new Learned[_cache_mask + 1]))
+	    return errh->error("out of memory");
+	memset(s.cache, 0, (_cache_mask + 1) * sizeof(Learned));
+    }
+
+    _forwarded.initialize(this, "forwarded");
+    _flooded.initialize(this, "flooded");
+    _filtered.initialize(this, "filtered");
+    _learned.initialize(this, "learned");
+    _moved.initialize(this, "moved");
+    _evicted.initialize(this, "evicted");
+
+    _timer.initialize(this);
+    set_timeout(_timeout);
+    return 0;
+}
+
+void
+EtherBridge::cleanup(CleanupStage)
+{
+    delete[] _table_mem;
+    _table_mem = 0;
+    _table = 0;
+    for (unsigned i = 0; i < _state.weight(); ++i) {
+	State &s = _state.get_value(i);
+	delete[] s.cache;
+	s.cache = 0;
+    }
+}
+
+inline uint64_t
+EtherBridge::make_key(const uint8_t *addr, uint16_t vlan)
+{
+    return (1ULL << 63) | ((uint64_t) vlan << 48)
+	| ((uint64_t) addr[0] << 40) | ((uint64_t) addr[1] << 32)
+	| ((uint32_t) addr[2] << 24) | ((uint32_t) addr[3] << 16)
+	| ((uint32_t) addr[4] << 8) | addr[5];
+}
+
+inline uint32_t
+EtherBridge::hash(uint64_t key)
+{
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    return key;
+}
+
+inline bool
+EtherBridge::expired(const Entry &e, uint32_t now) const
+{
+    return jiffies32_less(e.stamp + _timeout_j, now);
+}
+
+// A writer makes the sequence counter odd with a compare-and-swap, which
+// excludes other writers and sends readers around again.
+inline uint32_t
+EtherBridge::lock(Bucket *b)
+{
+    volatile uint32_t *seqp = &b->seq;
+    while (1) {
+	uint32_t seq = *seqp;
+	if (!(seq & 1) && atomic_uint32_t::compare_swap(b->seq, seq, seq + 1) == seq)
+	    return seq;
+	click_relax_fence();
+    }
+}
+
+inline void
+EtherBridge::unlock(Bucket *b, uint32_t seq)
+{
+    click_write_fence();
+    b->seq = seq + 2;
+}
+
+inline uint16_t
+EtherBridge::vlan_id(const Packet *p)
+{
+    const click_ether_vlan *vh = reinterpret_cast<const click_ether_vlan *>(p->data());
+    if (p->length() >= sizeof(click_ether_vlan)
+	&& vh->ether_vlan_proto == htons(ETHERTYPE_8021Q))
+	return ntohs(vh->ether_vlan_tci) & 0xFFF;
+    return ntohs(VLAN_TCI_ANNO(p)) & 0xFFF;
+}
+
+inline int
+EtherBridge::lookup(uint64_t key, uint32_t now) const
+{
+    const Bucket *b = &_table[hash(key) & _bucket_mask];
+    const volatile uint32_t *seqp = &b->seq;
+    Entry e;
+    int w;
+    while (1) {
+	uint32_t seq = *seqp;
+	click_read_fence();
+	if (seq & 1) {
+	    click_relax_fence();
+	    continue;
+	}
+	for (w = 0; w < WAYS; ++w)
+	    if (b->e[w].key == key)
+		break;
+	if (w == WAYS)
+	    return -1;
+	e = b->e[w];
+	click_read_fence();
+	if (*seqp == seq)
+	    break;
+    }
+    return expired(e, now) ? -1 : e.port;
+}
+
+void
+EtherBridge::learn_shared(uint64_t key, int port, uint32_t now)
+{
+    Bucket *b = &_table[hash(key) & _bucket_mask];
+    uint32_t seq = lock(b);
+    int w, victim = -1;
+    for (w = 0; w < WAYS; ++w)
+	if (b->e[w].key == key)
+	    break;
+    if (w < WAYS) {
+	if (b->e[w].port != port && !expired(b->e[w], now))
+	    _moved.inc();
+    } else {
+	for (w = 0; w < WAYS; ++w) {
+	    if (!b->e[w].key || expired(b->e[w], now))
+		break;
+	    if (victim < 0 || jiffies32_less(b->e[w].stamp, b->e[victim].stamp))
+		victim = w;
+	}
+	if (w == WAYS) {
+	    w = victim;
+	    _evicted.inc();
+	}
+	_learned.inc();
+	b->e[w].key = key;
+    }
+    b->e[w].port = port;
+    b->e[w].stamp = now;
+    unlock(b, seq);
+}
+
+inline void
+EtherBridge::learn(State &s, uint64_t key, int port, uint32_t now)
+{
+    // Refresh the shared entry at most once a second per thread.
+    Learned &l = s.cache[hash(key) & _cache_mask];
+    if (l.key == key && l.port == port && jiffies32_less(now, l.stamp + CLICK_HZ))
+	return;
+    learn_shared(key, port, now);
+    l.key = key;
+    l.port = port;
+    l.stamp = now;
+}
+
+// Returns the output port, noutputs() to flood, or -1 to drop.
+inline int
+EtherBridge::classify(State &s, int source, Packet *p, uint32_t now)
+{
+    if (p->length() < sizeof(click_ether))
+	return -1;
+    const click_ether *eh = reinterpret_cast<const click_ether *>(p->data());
+    if (_timeout) {
+	uint16_t vlan = vlan_id(p);
+	if (!(eh->ether_shost[0] & 1))
+	    learn(s, make_key(eh->ether_shost, vlan), source, now);
+	if (!(eh->ether_dhost[0] & 1)) {
+	    int port = lookup(make_key(eh->ether_dhost, vlan), now);
+	    if (port == source) {
+		_filtered.inc();
+		return -1;
+	    } else if (port >= 0) {
+		_forwarded.inc();
+		return port;
+	    }
+	}
+    }
+    _flooded.inc();
+    return noutputs();
+}
+
+void
+EtherBridge::push(int source, Packet *p)
+{
+    int o = classify(*_state, source, p, click_jiffies());
+    if (o < 0)
+	p->kill();
+    else if (o < noutputs())
+	output(o).push(p);
+    else {
+	int n = noutputs(), last = (source == n - 1 ? n - 2 : n - 1);
+	for (int i = 0; i < n; ++i)
+	    if (i != source) {
+		Packet *q = (i == last ? p : p->clone());
+		if (q)
+		    output(i).push(q);
+	    }
+    }
+}
+
+#if HAVE_BATCH
+void
+EtherBridge::push_batch(int source, PacketBatch *batch)
+{
+    State &s = *_state;
+    uint32_t now = click_jiffies();
+    int n = noutputs();
+    BatchView v;
+    PacketBatch *outs[n + 1];
+    memset(outs, 0, sizeof(outs));
+
+    Packet *next = batch;
+    while (next) {
+	next = v.gather(next, 0);
+	for (unsigned i = 0; i < v.size(); ++i)
+	    v.out[i] = classify(s, source, v.packet[i], now);
+	v.scatter(outs, n + 1);
+    }
+    BatchView::push(this, outs, n);
+
+    // Flooded packets travel as one batch: clones to every port but the
+    // last, which gets the originals.
+    if (PacketBatch *flood = outs[n]) {
+	flood->tail()->set_next(0);
+	int last = (source == n - 1 ? n - 2 : n - 1);
+	for (int i = 0; i < n; ++i)
+	    if (i != source)
+		output_push_batch(i, i == last ? flood : flood->clone_batch());
+    }
+}
+#endif
+
+void
+EtherBridge::flush()
+{
+    for (uint32_t i = 0; i <= _bucket_mask; ++i) {
+	Bucket *b = &_table[i];
+	uint32_t seq = lock(b);
+	memset(b->e, 0, sizeof(b->e));
+	unlock(b, seq);
+    }
+    // Threads' caches only suppress refreshes, and expire within a second.
+}
+
+void
+EtherBridge::run_timer(Timer *)
+{
+    uint32_t nbuckets = _bucket_mask + 1;
+    uint32_t begin = (uint64_t) _sweep * nbuckets / SLICES;
+    uint32_t end = (uint64_t) (_sweep + 1) * nbuckets / SLICES;
+    uint32_t now = click_jiffies();
+    for (uint32_t i = begin; i < end; ++i) {
+	Bucket *b = &_table[i];
+	bool stale = false;
+	for (int w = 0; w < WAYS; ++w)
+	    stale |= b->e[w].key && expired(b->e[w], now);
+	if (stale) {
+	    uint32_t seq = lock(b);
+	    for (int w = 0; w < WAYS; ++w)
+		if (b->e[w].key && expired(b->e[w], now))
+		    b->e[w].key = 0;
+	    unlock(b, seq);
+	}
+    }
+    _sweep = (_sweep + 1) % SLICES;
+    if (_timeout)
+	_timer.schedule_after_msec(_timeout * 1000 / SLICES + 1);
+}
+
+void
+EtherBridge::set_timeout(uint32_t timeout)
+{
+    if (timeout > 0x7FFFFFFFU / CLICK_HZ)
+	timeout = 0x7FFFFFFFU / CLICK_HZ;
+    _timeout = timeout;
+    _timeout_j = timeout * CLICK_HZ;
+    if (!timeout)
+	_timer.unschedule();
+    else if (!_timer.scheduled())
+	_timer.schedule_after_msec(_timeout * 1000 / SLICES + 1);
+}
+
+String
+EtherBridge::read_handler(Element *e, void *thunk)
+{
+    EtherBridge *br = static_cast<EtherBridge *>(e);
+    StringAccum sa;
+    uint32_t now = click_jiffies();
+    switch ((intptr_t) thunk) {
+    case 0:
+    case 1: {
+	uint32_t count = 0;
+	for (uint32_t i = 0; i <= br->_bucket_mask; ++i)
+	    for (int w = 0; w < WAYS; ++w) {
+		Entry en = br->_table[i].e[w];
+		if (!en.key || br->expired(en, now))
+		    continue;
+		++count;
+		if ((intptr_t) thunk == 0) {
+		    uint8_t addr[6];
+		    for (int j = 0; j < 6; ++j)
+			addr[j] = en.key >> (40 - 8 * j);
+		    sa << EtherAddress(addr) << ' ' << ((en.key >> 48) & 0xFFF)
+		       << ' ' << en.port << ' '
+		       << Timestamp::make_jiffies((click_jiffies_t) (now - en.stamp)) << '\n';
+		}
+	    }
+	if ((intptr_t) thunk == 1)
+	    return String(count);
+	return sa.take_string();
+    }
+    case 2:
+	sa << "forwarded:           " << br->_forwarded.value() << "\n"
+	   << "flooded:             " << br->_flooded.value() << "\n"
+	   << "filtered:            " << br->_filtered.value() << "\n"
+	   << "learned:             " << br->_learned.value() << "\n"
+	   << "moved:               " << br->_moved.value() << "\n"
+	   << "evicted:             " << br->_evicted.value() << "\n";
+	return sa.take_string();
+    case 3:
+	return String(br->_timeout);
+    default:
+	return String();
+    }
+}
+
+int
+EtherBridge::write_handler(const String &str, Element *e, void *thunk,
+			   ErrorHandler *errh)
+{
+    EtherBridge *br = static_cast<EtherBridge *>(e);
+    if ((intptr_t) thunk == 0) {
+	uint32_t timeout;
+	if (!SecondsArg().parse_saturating(str, timeout))
+	    return errh->error("expected timeout (integer)");
+	br->set_timeout(timeout);
+    } else
+	br->flush();
+    return 0;
+}
+
+void
+EtherBridge::add_handlers()
+{
+    add_read_handler("table", read_handler, 0);
+    add_read_handler("count", read_handler, 1);
+    add_read_handler("stats", read_handler, 2);
+    add_read_handler("timeout", read_handler, 3);
+    add_write_handler("timeout", write_handler, 0);
+    add_write_handler("flush", write_handler, 1, Handler::BUTTON);
+}
+
+CLICK_ENDDECLS
+EXPORT_ELEMENT(EtherBridge)
+ELEMENT_MT_SAFE(EtherBridge)
@@ -0,0 +1,202 @@
+// -*- c-basic-offset: 4 -*-
+#ifndef CLICK_ETHERBRIDGE_HH
+#define CLICK_ETHERBRIDGE_HH
+#include <click/batchelement.hh>
+#include <click/multithread.hh>
+#include <click/statscounter.hh>
+#include <click/etheraddress.hh>
+#include <click/timer.hh>
+CLICK_DECLS
+
+/*
+=c
+
+EtherBridge([I<keywords> TIMEOUT, CAPACITY, CACHE])
+
+=s ethernet
+
+multi-threaded, VLAN-aware learning Ethernet bridge
+
+=d
+
+Expects and produces Ethernet packets. Like EtherSwitch, each pair of
+corresponding ports corresponds to a LAN, and EtherBridge acts as a learning,
+forwarding Ethernet switch among those LANs: it associates the source address
+of each packet with its input port, sends packets for a known unicast address
+to that address's port (or drops them if that is the input port), and floods
+the others to every output but the input port's.
+
+Addresses are learned separately in each VLAN, so the same address may live
+on different ports in different VLANs. The VLAN of a packet is the VLAN ID of
+its 802.1Q tag, or, for untagged packets, the VLAN ID in its VLAN TCI
+annotation, as set by VLANDecap.
+
+Unlike EtherSwitch, EtherBridge may be used by many threads at once. All
+threads share one address table of cache-line-sized buckets of three entries,
+read without locks under per-bucket sequence counters. A thread that learns
+an address takes the bucket's counter as a lock, but each thread remembers in
+a private cache the addresses it learned in the last second and does not
+write them again, so busy stations cost no shared writes. When a bucket is
+full, its oldest entry is replaced. Batches are switched whole: packets are
+sorted by output port, and flooded packets leave as one batch per port.
+
+Entries older than TIMEOUT are ignored by lookups. A timer visits the table
+in 64 slices, one per TIMEOUT/64 seconds, and frees the expired entries it
+finds.
+
+EtherBridge can take the place of EtherSwitch with EtherSpanTree.
+
+Keyword arguments are:
+
+=over 8
+
+=item TIMEOUT
+
+Seconds of inactivity after which an address is forgotten. If 0, EtherBridge
+learns nothing and acts like a hub. Default is 300.
+
+=item CAPACITY
+
+Number of addresses the shared table holds, rounded up to a power of two
+times three. Default is 65536.
+
+=item CACHE
+
+Number of entries of each thread's cache of recently learned addresses,
+rounded up to a power of two. Default is 4096.
+
+=back
+
+=h table read-only
+
+Returns one line per address: the address, its VLAN, its port, and the time
+since it was last seen.
+
+=h count read-only
+
+Returns the number of addresses in the table.
+
+=h stats read-only
+
+Returns counters: packets forwarded, flooded, and filtered because their
+destination is on their input port, addresses learned, addresses that moved
+to another port, and live entries replaced in a full bucket.
+
+=h timeout read/write
+
+Returns or sets the TIMEOUT argument.
+
+=h flush write-only
+
+Forgets every address.
+
+=e
+
+  bridge :: EtherBridge;
+  FromDPDKDevice(0) -> [0]bridge[0] -> ToDPDKDevice(0);
+  FromDPDKDevice(1) -> [1]bridge[1] -> ToDPDKDevice(1);
+  FromDPDKDevice(2) -> [2]bridge[2] -> ToDPDKDevice(2);
+
+=a
+
+EtherSwitch, EtherSpanTree, VLANDecap
+*/
+
+class EtherBridge : public BatchElement { public:
+
+    EtherBridge() CLICK_COLD;
+    ~EtherBridge() CLICK_COLD;
+
+    const char *class_name() const	{ return "EtherBridge"; }
+    const char *port_count() const	{ return "2-/="; }
+    const char *processing() const	{ return PUSH; }
+    const char *flow_code() const	{ return "#/[^#]"; }
+
+    int configure(Vector<String> &, ErrorHandler *) CLICK_COLD;
+    int initialize(ErrorHandler *) CLICK_COLD;
+    void cleanup(CleanupStage) CLICK_COLD;
+    void add_handlers() CLICK_COLD;
+
+    void push(int, Packet *);
+#if HAVE_BATCH
+    void push_batch(int, PacketBatch *);
+#endif
+
+    void run_timer(Timer *);
+
+  private:
+
+    enum { WAYS = 3, SLICES = 64 };
+
+    // key: VLAN ID in bits 48-59, bit 63 set, address in bits 0-47, so a
+    // used entry never has key 0
+    struct Entry {
+	uint64_t key;
+	uint32_t stamp;		// low bits of click_jiffies()
+	uint16_t port;
+	uint16_t pad;
+    };
+
+    // seq is odd while a thread changes the entries.
+    struct Bucket {
+	uint32_t seq;
+	uint32_t pad;
+	Entry e[WAYS];
+	uint8_t pad2[8];
+    };
+
+    struct Learned {
+	uint64_t key;
+	uint32_t stamp;
+	uint16_t port;
+    };
+
+    struct State {
+	Learned *cache;
+	State()
+	    : cache(0) {
+	}
+    };
+
+    Bucket *_table;		// cache-aligned inside _table_mem
+    char *_table_mem;
+    uint32_t _bucket_mask;
+    uint32_t _cache_mask;
+    uint32_t _timeout;		// seconds
+    uint32_t _timeout_j;
+    uint32_t _sweep;		// next slice
+
+    per_thread<State> _state;
+    Timer _timer;
+
+    StatsCounter _forwarded;
+    StatsCounter _flooded;
+    StatsCounter _filtered;
+    StatsCounter _learned;
+    StatsCounter _moved;
+    StatsCounter _evicted;
+
+    static inline bool jiffies32_less(uint32_t a, uint32_t b) {
+	return (int32_t) (a - b) < 0;
+    }
+    static inline uint64_t make_key(const uint8_t *addr, uint16_t vlan);
+    static inline uint32_t hash(uint64_t key);
+    inline bool expired(const Entry &e, uint32_t now) const;
+    static inline uint32_t lock(Bucket *);
+    static inline void unlock(Bucket *, uint32_t seq);
+
+    static inline uint16_t vlan_id(const Packet *);
+    inline int lookup(uint64_t key, uint32_t now) const;
+    void learn_shared(uint64_t key, int port, uint32_t now);
+    inline void learn(State &, uint64_t key, int port, uint32_t now);
+    inline int classify(State &, int source, Packet *, uint32_t now);
+    void flush();
+    void set_timeout(uint32_t timeout);
+
+    static String read_handler(Element *, void *) CLICK_COLD;
+    static int write_handler(const String &, Element *, void *, ErrorHandler *) CLICK_COLD;
+
+};
+
+CLICK_ENDDECLS
+#endif
@@ -45,9 +45,11 @@ EtherSpanTree::configure(Vector<String> &conf, ErrorHandler *errh)
 	.read_mp("ADDR", EtherAddressArg(), _addr)
 	.read_mp("INPUT_SUPPRESSOR", ElementCastArg("Suppressor"), _input_sup)
 	.read_mp("OUTPUT_SUPPRESSOR", ElementCastArg("Suppressor"), _output_sup)
-	.read_mp("SWITCH", ElementCastArg("EtherSwitch"), _switch)
+	.read_mp("SWITCH", ElementArg(), _switch)
 	.complete() < 0)
 	return -1;
+    if (!_switch->cast("EtherSwitch") && !_switch->cast("EtherBridge"))
+	return errh->error("SWITCH must be an EtherSwitch or EtherBridge");
 
     memcpy(&_bridge_id, _addr, 6);
     return 0;
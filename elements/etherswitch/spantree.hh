@@ -5,7 +5,6 @@
 #include <click/timer.hh>
 CLICK_DECLS
 class Suppressor;
-class EtherSwitch;
 
 /**
 =c
@@ -23,7 +22,7 @@ Expects 802.1d control packets on its inputs and reacts by selectively
 suppressing forwarding on an associated EtherSwitch.
 
 ADDR is the address of this Ethernet switch.  SWITCH is the name of an
-EtherSwitch element that actually switches packets.  INPUT_SUPPRESSOR and
+EtherSwitch or EtherBridge element that actually switches packets.  INPUT_SUPPRESSOR and
 OUTPUT_SUPPRESSOR are two Suppressor elements; they should be placed upstream
 and downstream of the SWITCH.  The EtherSpanTree, Suppressor, and EtherSwitch
 elements should all have the same numbers of inputs and outputs, equal to the
@@ -52,7 +51,7 @@ number of ports in the switch.
 
 =a
 
-EtherSwitch, Suppressor
+EtherSwitch, EtherBridge, Suppressor
 */
 class EtherSpanTree : public Element {
 
@@ -83,7 +82,7 @@ public:
 private:
   Suppressor* _input_sup;
   Suppressor* _output_sup;
-  EtherSwitch* _switch;
+  Element* _switch;
   Timestamp* _topology_change;	// If set, tc should be sent with messages.
   bool _send_tc_msg;		// If true, tcm should be sent to root port.
 
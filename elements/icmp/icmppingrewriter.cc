@@ -160,6 +160,17 @@ ICMPPingRewriter::add_flow(int, const IPFlowID &flowid,
     return store_flow(flow, input, _map[click_current_cpu_id()]);
 }
 
+IPRewriterEntry *
+ICMPPingRewriter::take_flow(IPRewriterFlow *flow, int input, unsigned cpu)
+{
+    void *data = _allocator[cpu].allocate();
+    if (!data)
+	return 0;
+
+    ICMPPingFlow *copy = new(data) ICMPPingFlow(*static_cast<ICMPPingFlow *>(flow));
+    return adopt_flow(copy, input, _map[cpu], 0, cpu);
+}
+
 int
 ICMPPingRewriter::process(int port, Packet *p_in)
 {
@@ -230,7 +241,7 @@ void
 ICMPPingRewriter::push_batch(int port, PacketBatch *batch)
 {
     auto fnt = [this,port](Packet*p){return process(port,p);};
-    CLASSIFY_EACH_PACKET(noutputs() + 1,fnt,batch,checked_output_push_batch);
+    CLASSIFY_EACH_PACKET_PREFETCH(noutputs() + 1,fnt,batch,checked_output_push_batch,batch_prefetch_distance());
 }
 #endif
 
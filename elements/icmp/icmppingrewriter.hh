@@ -117,6 +117,9 @@ class ICMPPingRewriter : public IPRewriterBase { public:
 
     void add_handlers() CLICK_COLD;
 
+  protected:
+    IPRewriterEntry *take_flow(IPRewriterFlow *flow, int input, unsigned cpu);
+
   private:
     int process(int, Packet *);
 #if HAVE_USER_MULTITHREAD
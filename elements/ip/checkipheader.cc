@@ -25,6 +25,7 @@
 #include <click/straccum.hh>
 #include <click/error.hh>
 #include <click/standard/alignmentinfo.hh>
+#include <click/batchview.hh>
 CLICK_DECLS
 
 const char * const CheckIPHeader::reason_texts[NREASONS] = {
@@ -168,25 +169,24 @@ CheckIPHeader::drop(Reason reason, Packet *p, bool batch)
     return 0;
 }
 
-inline CheckIPHeader::Reason CheckIPHeader::valid(Packet* p) {
-  const click_ip *ip = reinterpret_cast<const click_ip *>(p->data() + _offset);
-  unsigned plen = p->length() - _offset;
-  unsigned hlen, len;
-
+inline CheckIPHeader::Reason
+CheckIPHeader::check_header(unsigned plen, unsigned vhl, unsigned len)
+{
+  unsigned hlen = (vhl & 0xF) << 2;
   // cast to int so very large plen is interpreted as negative
-  if ((int)plen < (int)sizeof(click_ip))
-    return MINISCULE_PACKET;
-
-  if (ip->ip_v != 4)
-    return BAD_VERSION;
-    
-  hlen = ip->ip_hl << 2;
-  if (hlen < sizeof(click_ip))
-    return BAD_HLEN;
+  return (int)plen < (int)sizeof(click_ip) ? MINISCULE_PACKET
+    : (vhl >> 4) != 4 ? BAD_VERSION
+    : hlen < sizeof(click_ip) ? BAD_HLEN
+    : len > plen || len < hlen ? BAD_IP_LEN
+    : NREASONS;
+}
 
-  len = ntohs(ip->ip_len);
-  if (len > plen || len < hlen)
-    return BAD_IP_LEN;
+inline CheckIPHeader::Reason
+CheckIPHeader::check_rest(Packet *p, unsigned plen)
+{
+  const click_ip *ip = reinterpret_cast<const click_ip *>(p->data() + _offset);
+  unsigned hlen = ip->ip_hl << 2;
+  unsigned len = ntohs(ip->ip_len);
 
   if (_checksum) {
     int val;
@@ -233,42 +233,65 @@ inline CheckIPHeader::Reason CheckIPHeader::valid(Packet* p) {
   return NREASONS;
 }
 
+inline CheckIPHeader::Reason
+CheckIPHeader::valid(Packet *p)
+{
+  const click_ip *ip = reinterpret_cast<const click_ip *>(p->data() + _offset);
+  unsigned plen = p->length() - _offset;
+
+  if ((int)plen < (int)sizeof(click_ip))
+    return MINISCULE_PACKET;
+  Reason r = check_header(plen, p->data()[_offset], ntohs(ip->ip_len));
+  if (r != NREASONS)
+    return r;
+  return check_rest(p, plen);
+}
+
 #if HAVE_BATCH
 PacketBatch *
-CheckIPHeader::simple_action_batch(PacketBatch* head) {
-	Packet* current = head;
-	Packet* last = head;
-	int c = head->count();
-	Reason r;
-	int dropped = 0;
-	while (current != NULL) {
-		if ((r = valid(current)) == NREASONS) {
-			last = current;
-			current = current->next();
-		} else {
-			dropped++;
-			if (current == head) {
-				head = PacketBatch::start_head(current->next());
-				current->set_next(NULL);
-				drop(r,current,true);
-				current = head;
-				last = head;
-			} else {
-				Packet* todrop = current;
-				current = current->next();
-				todrop->set_next(NULL);
-				drop(r,todrop,true);
-				last->set_next(current);
-			}
-		}
-	}
-	if (dropped && head) {
-		head->set_count(c - dropped);
-		head->set_tail(last);
-	}
-	return head;
+CheckIPHeader::simple_action_batch(PacketBatch *head)
+{
+  BatchView v;
+  PacketBatch *outs[1] = {0};
+  uint8_t vhl[BatchView::CAPACITY];
+  uint16_t len[BatchView::CAPACITY];
+  uint8_t reason[BatchView::CAPACITY];
+
+  Packet *next = head;
+  while (next) {
+    next = v.gather(next, BatchView::F_LENGTH);
+    unsigned n = v.size();
+
+    // Load the version and length fields of the whole view, then check them
+    // in one branch-free pass; only headers that pass are checksummed.
+    for (unsigned i = 0; i < n; ++i) {
+      const unsigned char *ip = v.packet[i]->data() + _offset;
+      bool whole = (int)(v.length[i] - _offset) >= (int)sizeof(click_ip);
+      vhl[i] = whole ? ip[0] : 0;
+      len[i] = whole ? (ip[2] << 8) | ip[3] : 0;
+    }
+    for (unsigned i = 0; i < n; ++i)
+      reason[i] = check_header(v.length[i] - _offset, vhl[i], len[i]);
+
+    for (unsigned i = 0; i < n; ++i) {
+      Packet *p = v.packet[i];
+      Reason r = (Reason) reason[i];
+      if (r == NREASONS)
+	r = check_rest(p, v.length[i] - _offset);
+      if (r != NREASONS) {
+	v.packet[i] = 0;
+	p->set_next(0);
+	drop(r, p, true);
+      }
+    }
+    v.scatter(outs, 1);
+  }
+
+  BatchView::finish(outs, 1);
+  return outs[0];
 }
 #endif
+
 Packet *
 CheckIPHeader::simple_action(Packet *p)
 {
@@ -276,7 +299,11 @@ CheckIPHeader::simple_action(Packet *p)
   if ((r = valid(p)) == NREASONS)
 	  return p;
   else {
-	  drop(r, p,false);
+#if HAVE_BATCH
+	  drop(r, p, in_batch_mode == BATCH_MODE_YES);
+#else
+	  drop(r, p, false);
+#endif
 	  return NULL;
   }
 }
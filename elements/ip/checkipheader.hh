@@ -112,7 +112,7 @@ class CheckIPHeader : public BatchElement { public:
   const char *class_name() const		{ return "CheckIPHeader"; }
   const char *port_count() const		{ return PORTS_1_1X2; }
   const char *processing() const		{ return PROCESSING_A_AH; }
-  const char *flags() const			{ return Element::AGNOSTIC; }
+  const char *flags() const			{ return "F"; }
 
   int configure(Vector<String> &, ErrorHandler *) CLICK_COLD;
   void add_handlers() CLICK_COLD;
@@ -161,7 +161,9 @@ class CheckIPHeader : public BatchElement { public:
   };
   static const char * const reason_texts[NREASONS];
 
-  inline Reason valid(Packet* p);
+  static inline Reason check_header(unsigned plen, unsigned vhl, unsigned len);
+  inline Reason check_rest(Packet *p, unsigned plen);
+  inline Reason valid(Packet *p);
   Packet *drop(Reason, Packet *, bool batch);
   static String read_handler(Element *, void *) CLICK_COLD;
 
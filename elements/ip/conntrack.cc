@@ -0,0 +1,717 @@
+// -*- c-basic-offset: 4 -*-
+/*
+ * conntrack.{cc,hh} -- stateful connection tracker
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Click LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Click LICENSE file; the license in that file is
+ * legally binding.
+ */
+
+#include <click/config.h>
+#include "conntrack.hh"
+#include <click/args.hh>
+#include <click/error.hh>
+#include <click/straccum.hh>
+#include <click/timestamp.hh>
+#include <clicknet/ip.h>
+#include <clicknet/tcp.h>
+#include <clicknet/udp.h>
+#include <clicknet/icmp.h>
+CLICK_DECLS
+
+static inline uint64_t
+mix64(uint64_t x)
+{
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return x;
+}
+
+static inline bool
+icmp_query(uint8_t type)
+{
+    return type == ICMP_ECHO || type == ICMP_TSTAMP || type == ICMP_IREQ
+	|| type == ICMP_MASKREQ;
+}
+
+static inline bool
+icmp_reply(uint8_t type)
+{
+    return type == ICMP_ECHOREPLY || type == ICMP_TSTAMPREPLY
+	|| type == ICMP_IREQREPLY || type == ICMP_MASKREQREPLY;
+}
+
+static inline bool
+icmp_error(uint8_t type)
+{
+    return type == ICMP_UNREACH || type == ICMP_SOURCEQUENCH
+	|| type == ICMP_REDIRECT || type == ICMP_TIMXCEED
+	|| type == ICMP_PARAMPROB;
+}
+
+ConnTrack::ConnTrack()
+    : _max_conns(65536), _thread_conns(0), _bucket_mask(0), _zone_anno(-1),
+      _loose(false), _window_check(true), _anno(-1), _tcp_timeout(432000),
+      _tcp_trans_timeout(120), _tcp_close_timeout(10), _udp_timeout(30),
+      _udp_stream_timeout(180), _icmp_timeout(30)
+{
+}
+
+ConnTrack::~ConnTrack()
+{
+}
+
+int
+ConnTrack::configure(Vector<String> &conf, ErrorHandler *errh)
+{
+    Vector<String> zones;
+    uint32_t max_conns = 65536, zone_limit = 0;
+    int zone_anno = -1, anno = -1;
+    bool loose = false, window_check = true;
+    uint32_t tcp_timeout = 432000, tcp_trans_timeout = 120, tcp_close_timeout = 10;
+    uint32_t udp_timeout = 30, udp_stream_timeout = 180, icmp_timeout = 30;
+    if (Args(conf, this, errh)
+	.read("MAX_CONNS", max_conns)
+	.read("ZONE_ANNO", AnnoArg(1), zone_anno)
+	.read("ZONE_LIMIT", zone_limit)
+	.read_all("ZONE", AnyArg(), zones)
+	.read("LOOSE", loose)
+	.read("WINDOW_CHECK", window_check)
+	.read("ANNO", AnnoArg(1), anno)
+	.read("TCP_TIMEOUT", SecondsArg(), tcp_timeout)
+	.read("TCP_TRANS_TIMEOUT", SecondsArg(), tcp_trans_timeout)
+	.read("TCP_CLOSE_TIMEOUT", SecondsArg(), tcp_close_timeout)
+	.read("UDP_TIMEOUT", SecondsArg(), udp_timeout)
+	.read("UDP_STREAM_TIMEOUT", SecondsArg(), udp_stream_timeout)
+	.read("ICMP_TIMEOUT", SecondsArg(), icmp_timeout)
+	.complete() < 0)
+	return -1;
+
+    if (max_conns == 0)
+	return errh->error("MAX_CONNS must be positive");
+    if (tcp_timeout == 0 || tcp_trans_timeout == 0 || tcp_close_timeout == 0
+	|| udp_timeout == 0 || udp_stream_timeout == 0 || icmp_timeout == 0)
+	return errh->error("timeouts must be positive");
+
+    for (int z = 0; z < NZONES; ++z)
+	_zone_limit[z] = zone_limit;
+    for (int i = 0; i < zones.size(); ++i) {
+	uint32_t zone, limit;
+	PrefixErrorHandler perrh(errh, "ZONE: ");
+	if (Args(this, &perrh).push_back_words(cp_unquote(zones[i]))
+	    .read_mp("ZONE", zone)
+	    .read_mp("LIMIT", limit)
+	    .complete() < 0)
+	    return -1;
+	if (zone >= NZONES)
+	    return errh->error("ZONE %u out of range", zone);
+	_zone_limit[zone] = limit;
+    }
+
+    _max_conns = max_conns;
+    _zone_anno = zone_anno;
+    _loose = loose;
+    _window_check = window_check;
+    _anno = anno;
+    _tcp_timeout = tcp_timeout;
+    _tcp_trans_timeout = tcp_trans_timeout;
+    _tcp_close_timeout = tcp_close_timeout;
+    _udp_timeout = udp_timeout;
+    _udp_stream_timeout = udp_stream_timeout;
+    _icmp_timeout = icmp_timeout;
+    return 0;
+}
+
+int
+ConnTrack::initialize(ErrorHandler *)
+{
+    unsigned nthreads = get_passing_threads().weight();
+    if (nthreads == 0)
+	nthreads = 1;
+    _thread_conns = _max_conns / nthreads;
+    if (_thread_conns == 0)
+	_thread_conns = 1;
+    uint32_t nbuckets = 1;
+    while (nbuckets < _thread_conns)
+	nbuckets <<= 1;
+    _bucket_mask = nbuckets - 1;
+    for (int z = 0; z < NZONES; ++z)
+	_thread_zone_limit[z] = (_zone_limit[z] + nthreads - 1) / nthreads;
+    return 0;
+}
+
+void
+ConnTrack::alloc_state(State &s)
+{
+    s.buckets = new Conn *[_bucket_mask + 1];
+    memset(s.buckets, 0, sizeof(Conn *) * (_bucket_mask + 1));
+    s.pool = new Conn[_thread_conns];
+    s.free = 0;
+    for (uint32_t i = _thread_conns; i > 0; --i) {
+	s.pool[i - 1].hnext = s.free;
+	s.free = &s.pool[i - 1];
+    }
+}
+
+void
+ConnTrack::cleanup(CleanupStage)
+{
+    for (unsigned t = 0; t < _state.weight(); ++t) {
+	State &s = _state.get_value(t);
+	delete[] s.buckets;
+	delete[] s.pool;
+	s.buckets = 0;
+	s.pool = s.free = 0;
+    }
+}
+
+inline ConnTrack::State &
+ConnTrack::state()
+{
+    State &s = *_state;
+    if (unlikely(!s.pool))
+	alloc_state(s);
+    return s;
+}
+
+inline uint32_t
+ConnTrack::packet_time(Packet *p)
+{
+    if (!p->timestamp_anno().sec())
+	p->timestamp_anno().assign_now();
+    return p->timestamp_anno().sec();
+}
+
+inline uint32_t
+ConnTrack::timeout(const Conn *c) const
+{
+    if (c->key.proto == IP_PROTO_TCP) {
+	if (c->state == TCP_ESTABLISHED)
+	    return _tcp_timeout;
+	else if (c->state == TCP_CLOSE)
+	    return _tcp_close_timeout;
+	else
+	    return _tcp_trans_timeout;
+    } else if (c->key.proto == IP_PROTO_ICMP)
+	return _icmp_timeout;
+    else
+	return c->flags & CF_REPLIED ? _udp_stream_timeout : _udp_timeout;
+}
+
+// Connections live in the wheel slot of their expiry time, or, if that is
+// too far off, of the farthest slot; there they are checked again and moved
+// on. Refreshing a connection only moves it when its expiry gets earlier.
+
+void
+ConnTrack::wheel_link(State &s, Conn *c)
+{
+    uint32_t t = c->expires;
+    if ((int32_t) (t - s.clock) <= 0)
+	t = s.clock + 1;
+    else if (t - s.clock >= WHEEL_SIZE)
+	t = s.clock + WHEEL_SIZE - 1;
+    c->wheel_time = t;
+    Conn **slot = &s.wheel[t % WHEEL_SIZE];
+    c->wheel_next = *slot;
+    if (*slot)
+	(*slot)->wheel_pprev = &c->wheel_next;
+    c->wheel_pprev = slot;
+    *slot = c;
+}
+
+inline void
+ConnTrack::wheel_unlink(Conn *c)
+{
+    *c->wheel_pprev = c->wheel_next;
+    if (c->wheel_next)
+	c->wheel_next->wheel_pprev = c->wheel_pprev;
+}
+
+inline void
+ConnTrack::touch(State &s, Conn *c, uint32_t now)
+{
+    c->expires = now + timeout(c);
+    if ((int32_t) (c->expires - c->wheel_time) < 0) {
+	wheel_unlink(c);
+	wheel_link(s, c);
+    }
+}
+
+void
+ConnTrack::expire(State &s, uint32_t now)
+{
+    if (unlikely(!s.clock))
+	s.clock = now;
+    if ((int32_t) (now - s.clock) <= 0)
+	return;
+    uint32_t start = s.clock, n = now - start;
+    if (n > WHEEL_SIZE)
+	n = WHEEL_SIZE;
+    s.clock = now;
+    for (uint32_t i = 1; i <= n; ++i) {
+	Conn **slot = &s.wheel[(start + i) % WHEEL_SIZE];
+	Conn *c = *slot;
+	*slot = 0;
+	while (c) {
+	    Conn *next = c->wheel_next;
+	    if ((int32_t) (c->expires - now) <= 0)
+		remove_conn(s, c);
+	    else
+		wheel_link(s, c);
+	    c = next;
+	}
+    }
+}
+
+inline void
+ConnTrack::parse(Packet *p, Flow &f) const
+{
+    f.kind = K_BAD;
+    if (!p->has_network_header())
+	return;
+    const click_ip *iph = p->ip_header();
+    if (IP_ISFRAG(iph))
+	return;
+    const uint8_t *th = p->transport_header();
+    int tlen = p->end_data() - th;
+    uint32_t saddr = iph->ip_src.s_addr, daddr = iph->ip_dst.s_addr;
+    uint16_t sport = 0, dport = 0;
+    uint8_t proto = iph->ip_p;
+
+    switch (proto) {
+    case IP_PROTO_TCP: {
+	const click_tcp *tcph = reinterpret_cast<const click_tcp *>(th);
+	if (tlen < (int) sizeof(click_tcp) || tlen < (tcph->th_off << 2))
+	    return;
+	f.kind = K_TCP;
+	sport = tcph->th_sport;
+	dport = tcph->th_dport;
+	break;
+    }
+    case IP_PROTO_UDP: {
+	if (tlen < (int) sizeof(click_udp))
+	    return;
+	const click_udp *udph = reinterpret_cast<const click_udp *>(th);
+	f.kind = K_UDP;
+	sport = udph->uh_sport;
+	dport = udph->uh_dport;
+	break;
+    }
+    case IP_PROTO_ICMP: {
+	if (tlen < (int) sizeof(click_icmp))
+	    return;
+	const click_icmp_sequenced *icmph = reinterpret_cast<const click_icmp_sequenced *>(th);
+	f.icmp_type = icmph->icmp_type;
+	if (icmp_query(icmph->icmp_type) || icmp_reply(icmph->icmp_type)) {
+	    f.kind = icmp_query(icmph->icmp_type) ? K_ICMP_QUERY : K_ICMP_REPLY;
+	    sport = dport = icmph->icmp_identifier;
+	} else if (icmp_error(icmph->icmp_type)) {
+	    // the connection is that of the packet the error is about
+	    const click_ip *in = reinterpret_cast<const click_ip *>(th + sizeof(click_icmp));
+	    int inlen = tlen - sizeof(click_icmp);
+	    if (inlen < (int) sizeof(click_ip) || inlen < (in->ip_hl << 2) + 8
+		|| IP_ISFRAG(in))
+		return;
+	    const uint8_t *inth = reinterpret_cast<const uint8_t *>(in) + (in->ip_hl << 2);
+	    saddr = in->ip_src.s_addr;
+	    daddr = in->ip_dst.s_addr;
+	    proto = in->ip_p;
+	    if (proto == IP_PROTO_TCP || proto == IP_PROTO_UDP) {
+		sport = reinterpret_cast<const click_udp *>(inth)->uh_sport;
+		dport = reinterpret_cast<const click_udp *>(inth)->uh_dport;
+	    } else if (proto == IP_PROTO_ICMP) {
+		const click_icmp_sequenced *inicmp = reinterpret_cast<const click_icmp_sequenced *>(inth);
+		if (!icmp_query(inicmp->icmp_type) && !icmp_reply(inicmp->icmp_type))
+		    return;
+		sport = dport = inicmp->icmp_identifier;
+	    }
+	    f.kind = K_ICMP_ERROR;
+	}
+	break;
+    }
+    default:
+	f.kind = K_UDP;
+	break;
+    }
+    if (f.kind == K_BAD)
+	return;
+
+    uint64_t s = ((uint64_t) ntohl(saddr) << 16) | ntohs(sport);
+    uint64_t d = ((uint64_t) ntohl(daddr) << 16) | ntohs(dport);
+    f.src_end = (s > d);
+    f.key.addr[f.src_end] = saddr;
+    f.key.port[f.src_end] = sport;
+    f.key.addr[!f.src_end] = daddr;
+    f.key.port[!f.src_end] = dport;
+    f.key.proto = proto;
+    f.key.zone = (_zone_anno >= 0 ? p->anno_u8(_zone_anno) : 0);
+    f.hash = mix64(((((uint64_t) f.key.addr[0] << 32) | f.key.addr[1])
+		    ^ ((((uint64_t) f.key.port[0] << 48) | ((uint64_t) f.key.port[1] << 32)
+			| (f.key.proto << 8) | f.key.zone) * 0x9e3779b97f4a7c15ULL)));
+}
+
+inline ConnTrack::Conn *
+ConnTrack::find(State &s, const Flow &f) const
+{
+    for (Conn *c = s.buckets[f.hash & _bucket_mask]; c; c = c->hnext)
+	if (c->hash == f.hash && c->key == f.key)
+	    return c;
+    return 0;
+}
+
+ConnTrack::Conn *
+ConnTrack::new_conn(State &s, const Flow &f, uint32_t now)
+{
+    uint32_t limit = _thread_zone_limit[f.key.zone];
+    if (limit && s.zone_count[f.key.zone] >= limit) {
+	++s.stats.zone_full;
+	return 0;
+    }
+    Conn *c = s.free;
+    if (!c) {
+	++s.stats.table_full;
+	return 0;
+    }
+    s.free = c->hnext;
+
+    c->key = f.key;
+    c->hash = f.hash;
+    Conn **bucket = &s.buckets[f.hash & _bucket_mask];
+    c->hnext = *bucket;
+    if (*bucket)
+	(*bucket)->hpprev = &c->hnext;
+    c->hpprev = bucket;
+    *bucket = c;
+    c->orig_end = f.src_end;
+    c->state = TCP_NONE;
+    c->flags = 0;
+    memset(c->tcp, 0, sizeof(c->tcp));
+    c->expires = now + timeout(c);
+    wheel_link(s, c);
+
+    ++s.zone_count[f.key.zone];
+    ++s.nconns;
+    ++s.stats.created;
+    return c;
+}
+
+// Called by expire(), which has taken the connection off the wheel.
+void
+ConnTrack::remove_conn(State &s, Conn *c)
+{
+    *c->hpprev = c->hnext;
+    if (c->hnext)
+	c->hnext->hpprev = c->hpprev;
+    --s.zone_count[c->key.zone];
+    --s.nconns;
+    ++s.stats.expired;
+    c->hnext = s.free;
+    s.free = c;
+}
+
+void
+ConnTrack::tcp_options(const click_tcp *th, TcpDir &d)
+{
+    const uint8_t *o = reinterpret_cast<const uint8_t *>(th + 1);
+    const uint8_t *end = reinterpret_cast<const uint8_t *>(th) + (th->th_off << 2);
+    while (o < end) {
+	if (*o == TCPOPT_EOL)
+	    break;
+	else if (*o == TCPOPT_NOP) {
+	    ++o;
+	    continue;
+	} else if (o + 1 >= end || o[1] < 2 || o + o[1] > end)
+	    break;
+	if (o[0] == TCPOPT_WSCALE && o[1] == TCPOLEN_WSCALE) {
+	    d.scale = (o[2] > 14 ? 14 : o[2]);
+	    d.flags |= TD_WSCALE;
+	}
+	o += o[1];
+    }
+}
+
+// Sequence and acknowledgement checks after Rooij, "Real Stateful TCP
+// Packet Filtering in IP Filter", as Linux conntrack does them. Each side's
+// end, maxend, and maxwin are learned from its first segment, then kept up
+// to date by valid segments. With check false, only updates them.
+bool
+ConnTrack::tcp_window(Conn *c, int dir, Packet *p, bool check) const
+{
+    const click_ip *iph = p->ip_header();
+    const click_tcp *th = p->tcp_header();
+    TcpDir &s = c->tcp[dir], &r = c->tcp[!dir];
+    uint8_t flags = th->th_flags;
+    uint32_t datalen = ntohs(iph->ip_len) - (iph->ip_hl << 2) - (th->th_off << 2);
+    uint32_t seq = ntohl(th->th_seq);
+    uint32_t end = seq + datalen + (flags & TH_SYN ? 1 : 0) + (flags & TH_FIN ? 1 : 0);
+    uint32_t ack = ntohl(th->th_ack);
+    uint32_t win = ntohs(th->th_win);
+
+    if (s.maxwin == 0) {
+	if (flags & TH_SYN) {
+	    tcp_options(th, s);
+	    s.end = s.maxend = end;
+	    s.maxwin = (win ? win : 1);
+	} else {
+	    // picked up mid-stream
+	    s.end = end;
+	    s.maxwin = (win ? win : 1);
+	    s.maxend = end + s.maxwin;
+	    if (r.maxwin == 0)
+		r.end = r.maxend = ack;
+	}
+    }
+
+    if (!(flags & TH_ACK) || ((flags & TH_RST) && ack == 0))
+	ack = r.end;
+    if (!(flags & TH_SYN) && (s.flags & r.flags & TD_WSCALE))
+	win <<= s.scale;
+    uint32_t maxack = (s.maxwin > 66000 ? s.maxwin : 66000);
+
+    if (check
+	&& !(SEQ_LEQ(seq, s.maxend)
+	     && SEQ_GEQ(end, s.end - r.maxwin)
+	     && SEQ_LEQ(ack, r.end)
+	     && SEQ_GEQ(ack, r.end - maxack)))
+	return false;
+
+    if (s.maxwin < win)
+	s.maxwin = win;
+    if (SEQ_GT(end, s.end))
+	s.end = end;
+    if ((flags & TH_ACK) && SEQ_GT(ack + win, r.maxend))
+	r.maxend = ack + win;
+    return true;
+}
+
+int
+ConnTrack::process_tcp(State &s, Conn *c, const Flow &f, Packet *p, uint32_t now)
+{
+    const click_tcp *th = p->tcp_header();
+    uint8_t flags = th->th_flags & (TH_SYN | TH_ACK | TH_FIN | TH_RST);
+    bool opening = (flags == TH_SYN);
+
+    if (!c) {
+	if (!opening && (!_loose || (flags & (TH_SYN | TH_RST))))
+	    return CT_INVALID;
+	if (!(c = new_conn(s, f, now)))
+	    return CT_INVALID;
+	if (!opening) {
+	    c->state = TCP_ESTABLISHED;
+	    c->flags |= CF_LIBERAL;
+	}
+    } else if (opening && (c->state == TCP_TIME_WAIT || c->state == TCP_CLOSE)) {
+	// a new connection on the same ports
+	c->orig_end = f.src_end;
+	c->state = TCP_NONE;
+	c->flags = 0;
+	memset(c->tcp, 0, sizeof(c->tcp));
+	++s.stats.created;
+    }
+
+    int dir = (f.src_end == c->orig_end ? DIR_ORIG : DIR_REPLY);
+    int state = c->state;
+    if (flags & TH_RST)
+	state = TCP_CLOSE;
+    else if (opening) {
+	if (dir != DIR_ORIG || (state != TCP_NONE && state != TCP_SYN_SENT))
+	    return CT_INVALID;
+	state = TCP_SYN_SENT;
+    } else if (flags & TH_SYN) {
+	// SYN-ACK, or a retransmission of it after the handshake
+	if (!(flags & TH_ACK) || dir != DIR_REPLY
+	    || (state != TCP_SYN_SENT && state != TCP_SYN_RECV
+		&& state != TCP_ESTABLISHED))
+	    return CT_INVALID;
+	if (state != TCP_ESTABLISHED)
+	    state = TCP_SYN_RECV;
+    } else if (state == TCP_SYN_SENT)
+	return CT_INVALID;
+    else if (state == TCP_SYN_RECV) {
+	if (dir != DIR_ORIG || !(flags & TH_ACK))
+	    return CT_INVALID;
+	state = TCP_ESTABLISHED;
+    }
+
+    if (!tcp_window(c, dir, p, _window_check && !(c->flags & CF_LIBERAL)))
+	return CT_INVALID;
+
+    // closing: TIME_WAIT once both FINs are acknowledged
+    if (state == TCP_ESTABLISHED || state == TCP_FIN_WAIT) {
+	TcpDir &sd = c->tcp[dir], &rd = c->tcp[!dir];
+	if (flags & TH_FIN) {
+	    sd.flags |= TD_FIN;
+	    state = TCP_FIN_WAIT;
+	}
+	if ((flags & TH_ACK) && (rd.flags & TD_FIN) && ntohl(th->th_ack) == rd.end)
+	    rd.flags |= TD_FIN_ACKED;
+	if (sd.flags & rd.flags & TD_FIN_ACKED)
+	    state = TCP_TIME_WAIT;
+    }
+
+    c->state = state;
+    if (dir == DIR_REPLY)
+	c->flags |= CF_REPLIED;
+    touch(s, c, now);
+    return c->flags & CF_REPLIED ? CT_ESTABLISHED : CT_NEW;
+}
+
+inline int
+ConnTrack::process(State &s, Conn *c, const Flow &f, Packet *p, uint32_t now)
+{
+    switch (f.kind) {
+    case K_TCP:
+	return process_tcp(s, c, f, p, now);
+    case K_UDP:
+    case K_ICMP_QUERY:
+	if (!c)
+	    return new_conn(s, f, now) ? CT_NEW : CT_INVALID;
+	break;
+    case K_ICMP_REPLY:
+	if (!c)
+	    return CT_INVALID;
+	break;
+    case K_ICMP_ERROR:
+	return c ? CT_RELATED : CT_INVALID;
+    default:
+	return CT_INVALID;
+    }
+
+    int dir = (f.src_end == c->orig_end ? DIR_ORIG : DIR_REPLY);
+    if (f.kind == K_ICMP_REPLY && dir == DIR_ORIG)
+	return CT_INVALID;
+    if (dir == DIR_REPLY)
+	c->flags |= CF_REPLIED;
+    touch(s, c, now);
+    return c->flags & CF_REPLIED ? CT_ESTABLISHED : CT_NEW;
+}
+
+void
+ConnTrack::push(int, Packet *p)
+{
+    State &s = state();
+    uint32_t now = packet_time(p);
+    expire(s, now);
+    Flow f;
+    parse(p, f);
+    int ct = (f.kind == K_BAD ? CT_INVALID : process(s, find(s, f), f, p, now));
+    ++s.stats.packets[ct];
+    if (_anno >= 0)
+	p->set_anno_u8(_anno, ct);
+    checked_output_push(ct, p);
+}
+
+void
+ConnTrack::push_list(int port, PacketList &l)
+{
+    if (!l.head)
+	return;
+#if HAVE_BATCH
+    if (port < noutputs())
+	output_push_batch(port, PacketBatch::make_from_simple_list(l.head, l.tail, l.count));
+    else
+	PacketBatch::make_from_simple_list(l.head, l.tail, l.count)->kill();
+#else
+    for (Packet *p = l.head, *next; p; p = next) {
+	next = p->next();
+	p->set_next(0);
+	checked_output_push(port, p);
+    }
+#endif
+}
+
+#if HAVE_BATCH
+void
+ConnTrack::push_batch(int, PacketBatch *batch)
+{
+    State &s = state();
+    uint32_t now = packet_time(batch);
+    expire(s, now);
+    PacketList out[CT_NSTATES];
+    Packet *pkts[BULK];
+    Flow flows[BULK];
+
+    // Parse and hash BULK packets, prefetch their buckets, then their first
+    // connections, and only then look them up, so the cache misses of a
+    // group overlap.
+    Packet *next = batch;
+    while (next) {
+	int n = 0;
+	for (; next && n < BULK; next = next->next())
+	    pkts[n++] = next;
+	for (int i = 0; i < n; ++i) {
+	    parse(pkts[i], flows[i]);
+	    if (flows[i].kind != K_BAD)
+		__builtin_prefetch(&s.buckets[flows[i].hash & _bucket_mask]);
+	}
+	for (int i = 0; i < n; ++i)
+	    if (flows[i].kind != K_BAD)
+		if (Conn *c = s.buckets[flows[i].hash & _bucket_mask])
+		    __builtin_prefetch(c);
+	for (int i = 0; i < n; ++i) {
+	    int ct = (flows[i].kind == K_BAD ? CT_INVALID
+		      : process(s, find(s, flows[i]), flows[i], pkts[i], now));
+	    ++s.stats.packets[ct];
+	    if (_anno >= 0)
+		pkts[i]->set_anno_u8(_anno, ct);
+	    out[ct].append(pkts[i]);
+	}
+    }
+
+    for (int i = 0; i < CT_NSTATES; ++i)
+	push_list(i, out[i]);
+}
+#endif
+
+String
+ConnTrack::read_handler(Element *e, void *thunk)
+{
+    ConnTrack *ct = static_cast<ConnTrack *>(e);
+    Stats st;
+    uint32_t conns = 0;
+    memset(&st, 0, sizeof(st));
+    for (unsigned t = 0; t < ct->_state.weight(); ++t) {
+	const State &s = ct->_state.get_value(t);
+	conns += s.nconns;
+	st.created += s.stats.created;
+	st.expired += s.stats.expired;
+	for (int i = 0; i < CT_NSTATES; ++i)
+	    st.packets[i] += s.stats.packets[i];
+	st.zone_full += s.stats.zone_full;
+	st.table_full += s.stats.table_full;
+    }
+    if (thunk)
+	return String(conns);
+
+    StringAccum sa;
+    sa << "connections:         " << conns << "\n"
+       << "created:             " << st.created << "\n"
+       << "expired:             " << st.expired << "\n"
+       << "new:                 " << st.packets[CT_NEW] << "\n"
+       << "established:         " << st.packets[CT_ESTABLISHED] << "\n"
+       << "related:             " << st.packets[CT_RELATED] << "\n"
+       << "invalid:             " << st.packets[CT_INVALID] << "\n"
+       << "zone full:           " << st.zone_full << "\n"
+       << "table full:          " << st.table_full << "\n";
+    return sa.take_string();
+}
+
+void
+ConnTrack::add_handlers()
+{
+    add_read_handler("stats", read_handler, 0);
+    add_read_handler("count", read_handler, 1);
+}
+
+CLICK_ENDDECLS
+EXPORT_ELEMENT(ConnTrack)
+ELEMENT_MT_SAFE(ConnTrack)
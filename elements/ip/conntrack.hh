@@ -0,0 +1,344 @@
+// -*- c-basic-offset: 4 -*-
+#ifndef CLICK_CONNTRACK_HH
+#define CLICK_CONNTRACK_HH
+#include <click/batchelement.hh>
+#include <click/multithread.hh>
+#include <clicknet/tcp.h>
+CLICK_DECLS
+
+/*
+=c
+
+ConnTrack([I<keywords> MAX_CONNS, ZONE_ANNO, ZONE_LIMIT, ZONE, LOOSE,
+WINDOW_CHECK, ANNO, TCP_TIMEOUT, TCP_TRANS_TIMEOUT, TCP_CLOSE_TIMEOUT,
+UDP_TIMEOUT, UDP_STREAM_TIMEOUT, ICMP_TIMEOUT])
+
+=s ip
+
+stateful connection tracker for firewalls
+
+=d
+
+Tracks the connections of the IP packets passing through it, in both
+directions, and sorts packets by connection state, so that firewall rules
+need only be applied to new connections. Packets arrive with IP header
+annotations and leave on one of four outputs:
+
+=over 5
+
+=item 0
+
+NEW: a packet that opens a connection, or a packet in the opening direction
+of a connection that has not seen a reply yet.
+
+=item 1
+
+ESTABLISHED: a packet of a connection that has seen packets in both
+directions.
+
+=item 2
+
+RELATED: an ICMP error about a packet of a tracked connection.
+
+=item 3
+
+INVALID: a packet that fits no connection or breaks its connection's rules,
+such as a TCP segment outside the window.
+
+=back
+
+Packets for missing outputs are dropped. A typical firewall sends output 0
+through an IPFilter with the policy for new connections, and outputs 1 and 2
+straight through. Since a connection becomes ESTABLISHED only when its first
+reply passes, a connection whose first packet is dropped by the policy never
+becomes ESTABLISHED: its later packets are NEW again and meet the policy
+again.
+
+TCP connections follow the TCP state machine, from SYN through the handshake,
+the FIN exchange, and TIME_WAIT, or RST. Unless WINDOW_CHECK is false, every
+segment must also fall within the sequence and acknowledgement windows the
+endpoints have advertised, as in Linux conntrack. A TCP connection is opened
+only by a SYN, unless LOOSE is true. UDP and other protocols are tracked by
+addresses and ports, and ICMP echo, timestamp, information, and address mask
+queries by addresses and identifier; a query reply with no query is INVALID.
+Fragments are INVALID, so reassemble packets first if fragments may arrive.
+
+Each thread keeps its own connection table, and MAX_CONNS is split evenly
+between the threads passing packets. Both directions of a connection must
+therefore be handled by the same thread, for instance with symmetric RSS.
+Batches are looked up in bulk: ConnTrack parses and hashes a group of packets
+and prefetches their hash buckets and connections before handling any of
+them. After its first packet, a connection costs one table hit per packet.
+Connections expire through a per-thread timing wheel with one-second slots,
+checked as packets arrive.
+
+Connections may be put in zones, given by the one-byte annotation at
+ZONE_ANNO. Zones are separate connection spaces: the same addresses and ports
+in two zones are two connections. A zone may hold at most its limit of
+connections, split between threads like MAX_CONNS. A packet that would open
+a connection in a full zone or a full table is INVALID.
+
+Keyword arguments are:
+
+=over 8
+
+=item MAX_CONNS
+
+Maximum number of connections. Default is 65536.
+
+=item ZONE_ANNO
+
+Annotation offset holding the zone of a packet. By default all packets are in
+zone 0.
+
+=item ZONE_LIMIT
+
+Maximum number of connections in each zone. Zero means no limit other than
+MAX_CONNS. Default is 0.
+
+=item ZONE
+
+'I<ZONE> I<LIMIT>': the limit for one zone, overriding ZONE_LIMIT. May be
+given more than once.
+
+=item LOOSE
+
+Boolean. If true, TCP segments other than SYNs may open connections, which
+picks up connections that were open before ConnTrack started; their windows
+are not checked. Default is false.
+
+=item WINDOW_CHECK
+
+Boolean. If false, do not check TCP sequence and acknowledgement numbers.
+Default is true.
+
+=item ANNO
+
+Annotation offset. If given, the state of each packet, from 0 for NEW to 3
+for INVALID, is also stored in the one-byte annotation there.
+
+=item TCP_TIMEOUT
+
+Seconds. Idle established TCP connections expire after this long. Default is
+432000 (5 days).
+
+=item TCP_TRANS_TIMEOUT
+
+Seconds. Idle TCP connections in the handshake, closing, or TIME_WAIT expire
+after this long. Default is 120.
+
+=item TCP_CLOSE_TIMEOUT
+
+Seconds. TCP connections expire this long after a RST. Default is 10.
+
+=item UDP_TIMEOUT
+
+Seconds. Idle UDP connections, and connections of other protocols, that have
+not seen a reply expire after this long. Default is 30.
+
+=item UDP_STREAM_TIMEOUT
+
+Seconds. Idle UDP connections, and connections of other protocols, that have
+seen a reply expire after this long. Default is 180.
+
+=item ICMP_TIMEOUT
+
+Seconds. Default is 30.
+
+=back
+
+Times are taken from packet timestamp annotations; packets without one are
+stamped with the current time.
+
+=h stats read-only
+
+Returns counters summed over all threads: connections, connections created
+and expired, packets in each state, and connections refused because their
+zone or the table was full.
+
+=h count read-only
+
+Returns the number of connections.
+
+=e
+
+  ct :: ConnTrack;
+  FromDevice(eth0) -> Strip(14) -> CheckIPHeader -> ct;
+  ct[0] -> IPFilter(allow dst port 22 or dst port 443, deny all) -> out;
+  ct[1] -> out;
+  ct[2] -> out;
+  ct[3] -> Discard;
+  out :: Unstrip(14) -> Queue -> ToDevice(eth1);
+
+=a IPFilter, IPClassifier, IPRewriter, IPReassembler */
+
+class ConnTrack : public BatchElement { public:
+
+    ConnTrack() CLICK_COLD;
+    ~ConnTrack() CLICK_COLD;
+
+    const char *class_name() const	{ return "ConnTrack"; }
+    const char *port_count() const	{ return "1/1-4"; }
+    const char *processing() const	{ return PUSH; }
+
+    int configure(Vector<String> &, ErrorHandler *) CLICK_COLD;
+    int initialize(ErrorHandler *) CLICK_COLD;
+    void cleanup(CleanupStage) CLICK_COLD;
+    void add_handlers() CLICK_COLD;
+
+    void push(int, Packet *);
+#if HAVE_BATCH
+    void push_batch(int, PacketBatch *);
+#endif
+
+    enum { CT_NEW, CT_ESTABLISHED, CT_RELATED, CT_INVALID, CT_NSTATES };
+
+  private:
+
+    enum { WHEEL_SIZE = 256, BULK = 32, NZONES = 256 };
+
+    enum { TCP_NONE, TCP_SYN_SENT, TCP_SYN_RECV, TCP_ESTABLISHED,
+	   TCP_FIN_WAIT, TCP_TIME_WAIT, TCP_CLOSE };
+
+    enum { K_BAD, K_TCP, K_UDP, K_ICMP_QUERY, K_ICMP_REPLY, K_ICMP_ERROR };
+
+    enum { DIR_ORIG, DIR_REPLY };
+
+    // Both directions of a connection share a key: endpoint 0 is the lower
+    // of the two (address, port) pairs.
+    struct Key {
+	uint32_t addr[2];
+	uint16_t port[2];
+	uint8_t proto;
+	uint8_t zone;
+	inline bool operator==(const Key &x) const {
+	    return addr[0] == x.addr[0] && addr[1] == x.addr[1]
+		&& port[0] == x.port[0] && port[1] == x.port[1]
+		&& proto == x.proto && zone == x.zone;
+	}
+    };
+
+    struct Flow {
+	Key key;
+	uint32_t hash;
+	uint8_t kind;
+	uint8_t src_end;	// endpoint the packet comes from
+	uint8_t icmp_type;
+    };
+
+    struct TcpDir {
+	uint32_t end;		// highest sequence number sent, plus one
+	uint32_t maxend;	// highest sequence number the peer allows
+	uint32_t maxwin;	// largest window advertised
+	uint8_t scale;
+	uint8_t flags;
+    };
+
+    enum { TD_WSCALE = 1, TD_FIN = 2, TD_FIN_ACKED = 4 };
+
+    struct Conn {
+	Key key;
+	uint32_t hash;
+	Conn *hnext;
+	Conn **hpprev;
+	Conn *wheel_next;
+	Conn **wheel_pprev;
+	uint32_t expires;	// seconds
+	uint32_t wheel_time;	// when its wheel slot comes up
+	uint8_t orig_end;	// endpoint that opened the connection
+	uint8_t state;		// TCP state
+	uint8_t flags;
+	TcpDir tcp[2];
+    };
+
+    enum { CF_REPLIED = 1, CF_LIBERAL = 2 };
+
+    struct Stats {
+	uint64_t created;
+	uint64_t expired;
+	uint64_t packets[CT_NSTATES];
+	uint64_t zone_full;
+	uint64_t table_full;
+    };
+
+    struct PacketList {
+	Packet *head;
+	Packet *tail;
+	unsigned count;
+	PacketList()
+	    : head(0), tail(0), count(0) {
+	}
+	inline void append(Packet *p) {
+	    p->set_next(0);
+	    if (tail)
+		tail->set_next(p);
+	    else
+		head = p;
+	    tail = p;
+	    ++count;
+	}
+    };
+
+    struct State {
+	Conn **buckets;
+	Conn *pool;
+	Conn *free;
+	uint32_t nconns;
+	uint32_t clock;
+	Conn *wheel[WHEEL_SIZE];
+	uint32_t zone_count[NZONES];
+	Stats stats;
+	State()
+	    : buckets(0), pool(0), free(0), nconns(0), clock(0) {
+	    memset(wheel, 0, sizeof(wheel));
+	    memset(zone_count, 0, sizeof(zone_count));
+	    memset(&stats, 0, sizeof(stats));
+	}
+    };
+
+    uint32_t _max_conns;
+    uint32_t _thread_conns;
+    uint32_t _bucket_mask;
+    int _zone_anno;
+    uint32_t _zone_limit[NZONES];
+    uint32_t _thread_zone_limit[NZONES];
+    bool _loose;
+    bool _window_check;
+    int _anno;
+    uint32_t _tcp_timeout;
+    uint32_t _tcp_trans_timeout;
+    uint32_t _tcp_close_timeout;
+    uint32_t _udp_timeout;
+    uint32_t _udp_stream_timeout;
+    uint32_t _icmp_timeout;
+
+    per_thread<State> _state;
+
+    void alloc_state(State &);
+    inline State &state();
+    static inline uint32_t packet_time(Packet *);
+    inline uint32_t timeout(const Conn *) const;
+
+    void wheel_link(State &, Conn *);
+    static inline void wheel_unlink(Conn *);
+    inline void touch(State &, Conn *, uint32_t now);
+    void expire(State &, uint32_t now);
+
+    inline void parse(Packet *, Flow &) const;
+    inline Conn *find(State &, const Flow &) const;
+    Conn *new_conn(State &, const Flow &, uint32_t now);
+    void remove_conn(State &, Conn *);
+
+    static void tcp_options(const click_tcp *, TcpDir &);
+    bool tcp_window(Conn *, int dir, Packet *, bool check) const;
+    int process_tcp(State &, Conn *, const Flow &, Packet *, uint32_t now);
+    inline int process(State &, Conn *, const Flow &, Packet *, uint32_t now);
+
+    void push_list(int, PacketList &);
+
+    static String read_handler(Element *, void *) CLICK_COLD;
+
+};
+
+CLICK_ENDDECLS
+#endif
@@ -84,7 +84,7 @@ DecIPTTL::simple_action(Packet *p)
 PacketBatch *
 DecIPTTL::simple_action_batch(PacketBatch *batch)
 {
-    EXECUTE_FOR_EACH_PACKET_DROPPABLE(DecIPTTL::simple_action, batch, [](Packet *){});
+    EXECUTE_FOR_EACH_PACKET_DROPPABLE_PREFETCH(DecIPTTL::simple_action, batch, [](Packet *){}, batch_prefetch_distance());
     return batch;
 }
 #endif
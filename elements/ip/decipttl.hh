@@ -50,6 +50,7 @@ class DecIPTTL : public BatchElement { public:
     const char *class_name() const		{ return "DecIPTTL"; }
     const char *port_count() const		{ return PORTS_1_1X2; }
     const char *processing() const		{ return PROCESSING_A_AH; }
+    const char *flags() const			{ return "F"; }
 
     int configure(Vector<String> &conf, ErrorHandler *errh) CLICK_COLD;
     void add_handlers() CLICK_COLD;
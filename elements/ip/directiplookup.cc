@@ -24,6 +24,12 @@
 #include <click/straccum.hh>
 #include <click/router.hh>
 #include <click/error.hh>
+#include <click/bitvector.hh>
+#include <click/hashmap.hh>
+#include <click/batchview.hh>
+#if CLICK_USERLEVEL && HAVE_USER_MULTITHREAD
+# include <pthread.h>
+#endif
 CLICK_DECLS
 
 
@@ -33,14 +39,16 @@ CLICK_DECLS
 // kernel, because it's too large to be allocated all at once.
 
 int
-DirectIPLookup::Table::initialize()
+DirectIPLookup::Table::initialize(uint32_t rtable_capacity,
+				  uint32_t tbl_24_31_capacity,
+				  uint32_t vport_capacity)
 {
     assert(!_tbl_0_23 && !_tbl_24_31 && !_vport && !_rtable && !_rt_hashtbl
 	   && !_tbl_0_23_plen && !_tbl_24_31_plen);
 
-    _tbl_24_31_capacity = 4096;
-    _vport_capacity = 1024;
-    _rtable_capacity = 2048;
+    _tbl_24_31_capacity = tbl_24_31_capacity;
+    _vport_capacity = vport_capacity;
+    _rtable_capacity = rtable_capacity;
 
     if ((_tbl_0_23 = (uint16_t *) CLICK_LALLOC((sizeof(uint16_t) + sizeof(uint8_t)) * (1 << 24)))
 	&& (_tbl_24_31 = (uint16_t *) CLICK_LALLOC((sizeof(uint16_t) + sizeof(uint8_t)) * _tbl_24_31_capacity))
@@ -69,6 +77,17 @@ DirectIPLookup::Table::cleanup()
     _rt_hashtbl = 0;
 }
 
+void
+DirectIPLookup::Table::swap(Table &x)
+{
+    // Table holds only pointers and integers; its destructor must not run
+    // on a temporary copy.
+    char tmp[sizeof(Table)];
+    memcpy(tmp, (void *) this, sizeof(Table));
+    memcpy((void *) this, (void *) &x, sizeof(Table));
+    memcpy((void *) &x, tmp, sizeof(Table));
+}
+
 
 inline uint32_t
 DirectIPLookup::Table::prefix_hash(uint32_t prefix, uint32_t len)
@@ -484,15 +503,199 @@ DirectIPLookup::Table::remove_route(const IPRoute& route, IPRoute* old_route, Er
     return 0;
 }
 
+static uint32_t
+round_capacity(uint32_t want, uint32_t min)
+{
+    uint32_t c = min;
+    while (c < want)
+	c *= 2;
+    return c;
+}
+
+void
+DirectIPLookup::Table::fill_tbl_0_23(const Vector<IPRoute> &routes,
+				     const uint16_t *vports, int begin, int end,
+				     uint32_t lo, uint32_t hi)
+{
+    // Routes are sorted by prefix length, so a more specific route always
+    // overwrites the routes that cover it.
+    for (int r = begin; r < end; ++r) {
+	uint32_t plen = routes[r].extra;
+	uint32_t start = ntohl(routes[r].addr.addr()) >> 8;
+	uint32_t stop = start + (1U << (24 - plen));
+	if (start < lo)
+	    start = lo;
+	if (stop > hi)
+	    stop = hi;
+	for (uint32_t i = start; i < stop; ++i) {
+	    _tbl_0_23[i] = vports[r];
+	    _tbl_0_23_plen[i] = plen;
+	}
+    }
+}
+
+#if CLICK_USERLEVEL && HAVE_USER_MULTITHREAD
+namespace {
+struct FillStripe {
+    DirectIPLookup::Table *t;
+    const Vector<IPRoute> *routes;
+    const uint16_t *vports;
+    int begin, end;
+    uint32_t lo, hi;
+    pthread_t thread;
+};
+
+extern "C" void *
+fill_stripe_thread(void *arg)
+{
+    FillStripe *fs = static_cast<FillStripe *>(arg);
+    fs->t->fill_tbl_0_23(*fs->routes, fs->vports, fs->begin, fs->end, fs->lo, fs->hi);
+    return 0;
+}
+}
+#endif
+
+int
+DirectIPLookup::Table::build(const Vector<IPRoute> &routes, int nthreads, ErrorHandler *errh)
+{
+    // The table must be empty.  ROUTES must be sorted by
+    // IPRouteTable::sort_routes().
+    int n = routes.size();
+    Vector<uint16_t> vports(n, 0);
+    Vector<IPRoute> vport_routes;
+    HashMap<uint64_t, int> vport_map(-1);
+    Bitvector extended(1 << 24);
+    uint32_t nextended = 0;
+
+    // assign virtual ports and count the /24s that need a _tbl_24_31[] entry
+    for (int r = 0; r < n; ++r) {
+	const IPRoute &route = routes[r];
+	if (route.extra == 0)
+	    continue;		// the default route uses _vport[0]
+	uint64_t key = ((uint64_t) route.gw.addr() << 32) | (uint32_t) route.port;
+	int &vp = vport_map.find_force(key);
+	if (vp < 0) {
+	    if (vport_routes.size() + 1 >= vport_capacity_limit)
+		return errh->error("too many distinct gateways and ports");
+	    vport_routes.push_back(route);
+	    vp = vport_routes.size();
+	}
+	vports[r] = vp;
+	if (route.extra > 24) {
+	    uint32_t i = ntohl(route.addr.addr()) >> 8;
+	    if (!extended[i]) {
+		extended[i] = true;
+		++nextended;
+	    }
+	}
+    }
+    if (nextended * 256 > tbl_24_31_capacity_limit)
+	return errh->error("too many /24 networks with more specific routes");
+
+    if (initialize(round_capacity(n + 1, 2048),
+		   round_capacity(nextended * 256, 4096),
+		   round_capacity(vport_routes.size() + 1, 1024)) < 0)
+	return errh->error("out of memory");
+    flush();
+
+    // virtual ports: _vport[0] is the default route, others follow in order
+    for (int vp = 1; vp <= vport_routes.size(); ++vp) {
+	_vport[vp].ll_prev = vp - 1;
+	_vport[vp].ll_next = (vp < vport_routes.size() ? vp + 1 : -1);
+	_vport[vp].refcount = 0;
+	_vport[vp].gw = vport_routes[vp - 1].gw;
+	_vport[vp].port = vport_routes[vp - 1].port;
+	_vport[vp].padding = 0;
+    }
+    if (vport_routes.size())
+	_vport[0].ll_next = 1;
+    _vport_size = vport_routes.size() + 1;
+
+    // cleartext entries and their hash table
+    int begin24 = 0, end24 = 0;
+    for (int r = 0; r < n; ++r) {
+	const IPRoute &route = routes[r];
+	uint32_t plen = route.extra;
+	if (plen == 0) {
+	    _vport[0].gw = route.gw;
+	    _vport[0].port = route.port;
+	    begin24 = end24 = r + 1;
+	    continue;
+	}
+	if (plen <= 24)
+	    end24 = r + 1;
+	uint32_t prefix = ntohl(route.addr.addr());
+	int rt_i = _rtable_size++;
+	_rtable[rt_i].prefix = prefix;
+	_rtable[rt_i].plen = plen;
+	_rtable[rt_i].vport = vports[r];
+	++_vport[vports[r]].refcount;
+	uint32_t hash = prefix_hash(prefix, plen);
+	_rtable[rt_i].ll_prev = -1;
+	_rtable[rt_i].ll_next = _rt_hashtbl[hash];
+	if (_rt_hashtbl[hash] >= 0)
+	    _rtable[_rt_hashtbl[hash]].ll_prev = rt_i;
+	_rt_hashtbl[hash] = rt_i;
+    }
+
+    // /1 to /24 routes, in stripes of _tbl_0_23[]
+#if CLICK_USERLEVEL && HAVE_USER_MULTITHREAD
+    if (nthreads > 8)
+	nthreads = 8;
+    if (nthreads > 1 && end24 - begin24 > 1024) {
+	FillStripe fs[8];
+	uint32_t stripe = (1U << 24) / nthreads;
+	for (int i = 0; i < nthreads; ++i) {
+	    fs[i].t = this;
+	    fs[i].routes = &routes;
+	    fs[i].vports = vports.begin();
+	    fs[i].begin = begin24;
+	    fs[i].end = end24;
+	    fs[i].lo = i * stripe;
+	    fs[i].hi = (i == nthreads - 1 ? 1U << 24 : (i + 1) * stripe);
+	    if (i > 0 && pthread_create(&fs[i].thread, 0, fill_stripe_thread, &fs[i]) != 0)
+		fs[i].thread = pthread_self(); // fill it ourselves
+	}
+	fill_tbl_0_23(routes, vports.begin(), begin24, end24, fs[0].lo, fs[0].hi);
+	for (int i = 1; i < nthreads; ++i)
+	    if (pthread_equal(fs[i].thread, pthread_self()))
+		fill_tbl_0_23(routes, vports.begin(), begin24, end24, fs[i].lo, fs[i].hi);
+	    else
+		pthread_join(fs[i].thread, 0);
+    } else
+#endif
+	fill_tbl_0_23(routes, vports.begin(), begin24, end24, 0, 1U << 24);
+
+    // /25 to /32 routes
+    for (int r = end24; r < n; ++r) {
+	uint32_t plen = routes[r].extra;
+	uint32_t prefix = ntohl(routes[r].addr.addr());
+	uint32_t i = prefix >> 8;
+	if (!(_tbl_0_23[i] & 0x8000)) {
+	    uint32_t sec_i = _tbl_24_31_size;
+	    for (int j = 0; j < 256; ++j) {
+		_tbl_24_31[sec_i + j] = _tbl_0_23[i];
+		_tbl_24_31_plen[sec_i + j] = _tbl_0_23_plen[i];
+	    }
+	    _tbl_0_23[i] = (sec_i >> 8) | 0x8000;
+	    _tbl_24_31_size += 256;
+	}
+	uint32_t sec_i = (_tbl_0_23[i] & 0x7fff) << 8;
+	uint32_t sec_start = prefix & 0xFF;
+	uint32_t sec_end = sec_start + (1 << (32 - plen));
+	for (uint32_t j = sec_i + sec_start; j < sec_i + sec_end; ++j) {
+	    _tbl_24_31[j] = vports[r];
+	    _tbl_24_31_plen[j] = plen;
+	}
+    }
+    return 0;
+}
+
 
 // DIRECTIPLOOKUP
 
 DirectIPLookup::DirectIPLookup()
 {
-#if HAVE_BATCH
-	// TODO: Remove this when push_batch() will actually be implemented
-	in_batch_mode = BATCH_MODE_NO;
-#endif
 }
 
 DirectIPLookup::~DirectIPLookup()
@@ -506,6 +709,7 @@ DirectIPLookup::configure(Vector<String> &conf, ErrorHandler *errh)
     if ((r = _t.initialize()) < 0)
 	return r;
     _t.flush();
+    publish();
     return IPRouteTable::configure(conf, errh);
 }
 
@@ -513,6 +717,28 @@ void
 DirectIPLookup::cleanup(CleanupStage)
 {
     _t.cleanup();
+    _retired.cleanup();
+}
+
+void
+DirectIPLookup::take_state(Element *e, ErrorHandler *)
+{
+    DirectIPLookup *o = (DirectIPLookup *) e->cast("DirectIPLookup");
+    if (o && router()->hotswap_unchanged(this)) {
+	_t.swap(o->_t);
+	publish();
+    }
+}
+
+void
+DirectIPLookup::publish()
+{
+    int local;
+    Lookup &l = _lookup.write_begin(local);
+    l.tbl_0_23 = _t._tbl_0_23;
+    l.tbl_24_31 = _t._tbl_24_31;
+    l.vport = _t._vport;
+    _lookup.write_commit(local);
 }
 
 void
@@ -533,25 +759,82 @@ int
 DirectIPLookup::lookup_route(IPAddress dest, IPAddress &gw) const
 {
     uint32_t ip_addr = ntohl(dest.addr());
-    uint16_t vport_i = _t._tbl_0_23[ip_addr >> 8];
+    int flags;
+    const Lookup &l = _lookup.read_begin(flags);
+    uint16_t vport_i = l.tbl_0_23[ip_addr >> 8];
 
     if (vport_i & 0x8000)
-        vport_i = _t._tbl_24_31[((vport_i & 0x7fff) << 8) | (ip_addr & 0xff)];
+        vport_i = l.tbl_24_31[((vport_i & 0x7fff) << 8) | (ip_addr & 0xff)];
 
-    gw = _t._vport[vport_i].gw;
-    return _t._vport[vport_i].port;
+    gw = l.vport[vport_i].gw;
+    int port = l.vport[vport_i].port;
+    _lookup.read_end(flags);
+    return port;
+}
+
+void
+DirectIPLookup::lookup_route_batch(const uint32_t *dst, int *port, uint32_t *gw, unsigned n) const
+{
+    // Level by level over the whole batch, so the table loads of different
+    // addresses are independent and overlap.
+    uint16_t vport_i[BatchView::CAPACITY];
+    int flags;
+    const Lookup &l = _lookup.read_begin(flags);
+    for (unsigned i = 0; i < n; ++i)
+	vport_i[i] = l.tbl_0_23[ntohl(dst[i]) >> 8];
+    for (unsigned i = 0; i < n; ++i)
+	if (vport_i[i] & 0x8000)
+	    vport_i[i] = l.tbl_24_31[((vport_i[i] & 0x7fff) << 8) | (ntohl(dst[i]) & 0xff)];
+    for (unsigned i = 0; i < n; ++i) {
+	const VirtualPort &vp = l.vport[vport_i[i]];
+	port[i] = vp.port;
+	gw[i] = vp.gw.addr();
+    }
+    _lookup.read_end(flags);
 }
 
 int
 DirectIPLookup::add_route(const IPRoute& route, bool allow_replace, IPRoute* old_route, ErrorHandler *errh)
 {
-    return _t.add_route(route, allow_replace, old_route, errh);
+    int r = _t.add_route(route, allow_replace, old_route, errh);
+    publish();
+    return r;
 }
 
 int
 DirectIPLookup::remove_route(const IPRoute& route, IPRoute* old_route, ErrorHandler *errh)
 {
-    return _t.remove_route(route, old_route, errh);
+    int r = _t.remove_route(route, old_route, errh);
+    publish();
+    return r;
+}
+
+int
+DirectIPLookup::bulk_load(Vector<IPRoute> &routes, ErrorHandler *errh)
+{
+    int dups = sort_routes(routes);
+    Table t;
+    if (t.build(routes, _load_threads, errh) < 0)
+	return -ENOMEM;
+
+    // Lookups read the tables through _lookup. The tables replaced here are
+    // freed by the next load, once write_begin has waited out the lookups
+    // that may still use them.
+    int local;
+    Lookup &l = _lookup.write_begin(local);
+    _retired.cleanup();
+    _t.swap(t);
+    _retired.swap(t);
+    l.tbl_0_23 = _t._tbl_0_23;
+    l.tbl_24_31 = _t._tbl_24_31;
+    l.vport = _t._vport;
+    _lookup.write_commit(local);
+    if (!router()->initialized())
+	_retired.cleanup();
+
+    if (dups)
+	errh->warning("%d %s replaced by later versions", dups, dups > 1 ? "routes" : "route");
+    return 0;
 }
 
 int
@@ -560,6 +843,7 @@ DirectIPLookup::flush_handler(const String &, Element *e, void *,
 {
     DirectIPLookup *t = static_cast<DirectIPLookup *>(e);
     t->_t.flush();
+    t->publish();
     return 0;
 }
 
@@ -1,13 +1,14 @@
 // -*- c-basic-offset: 4 -*-
 #ifndef CLICK_DIRECTIPLOOKUP_HH
 #define CLICK_DIRECTIPLOOKUP_HH
+#include <click/multithread.hh>
 #include "iproutetable.hh"
 CLICK_DECLS
 
 /*
 =c
 
-DirectIPLookup(ADDR1/MASK1 [GW1] OUT1, ADDR2/MASK2 [GW2] OUT2, ...)
+DirectIPLookup(ADDR1/MASK1 [GW1] OUT1, ADDR2/MASK2 [GW2] OUT2, ..., I<keywords>)
 
 =s iproute
 
@@ -28,11 +29,31 @@ DirectIPLookup is optimized for lookup speed at the expense of extensive RAM
 usage. Each longest-prefix lookup is accomplished in one to maximum two DRAM
 accesses, regardless on the number of routing table entries. Individual
 entries can be dynamically added to or removed from the routing table with
-relatively low CPU overhead, allowing for high update rates.
+relatively low CPU overhead, allowing for high update rates. Batches are
+looked up one table level at a time, so the DRAM accesses of different
+packets overlap.
 
 DirectIPLookup implements the I<DIR-24-8-BASIC> lookup scheme described by
 Gupta, Lin, and McKeown in the paper cited below.
 
+Keyword arguments are:
+
+=over 8
+
+=item FILE
+
+Filename.  Load routes from this binary route file, as written by
+L<click-mkroutes(1)>, before adding the routes given as arguments.  A route
+file is mapped into memory and built into the lookup tables in one pass,
+which is much faster than parsing the same routes as text.
+
+=item LOAD_THREADS
+
+Integer.  Number of threads used to fill the lookup tables when loading a
+route file.  Default is the number of Click threads.
+
+=back
+
 =h table read-only
 
 Outputs a human-readable version of the current routing table.
@@ -65,6 +86,14 @@ operation.
 
 Clears the entire routing table in a single atomic operation.
 
+=h load write-only
+
+Replaces the entire routing table with the routes in the named binary route
+file.  The new tables are built on the side and swapped in at once; if
+loading fails, the old table stays in place.  The old tables are freed at the
+next load, once no thread can still be looking up in them, or when the router
+is cleaned up.
+
 =n
 
 See IPRouteTable for a performance comparison of the various IP routing
@@ -95,6 +124,7 @@ class DirectIPLookup : public IPRouteTable { public:
 
     int configure(Vector<String> &conf, ErrorHandler *errh) CLICK_COLD;
     void cleanup(CleanupStage stage) CLICK_COLD;
+    void take_state(Element *old, ErrorHandler *errh) CLICK_COLD;
     void add_handlers() CLICK_COLD;
 
     void push(int port, Packet* p);
@@ -102,7 +132,9 @@ class DirectIPLookup : public IPRouteTable { public:
     int add_route(const IPRoute&, bool, IPRoute*, ErrorHandler *);
     int remove_route(const IPRoute&, IPRoute*, ErrorHandler *);
     int lookup_route(IPAddress, IPAddress&) const;
+    void lookup_route_batch(const uint32_t *dst, int *port, uint32_t *gw, unsigned n) const;
     String dump_routes();
+    int bulk_load(Vector<IPRoute> &routes, ErrorHandler *errh);
 
     static int flush_handler(const String &, Element *, void *, ErrorHandler *);
 
@@ -164,8 +196,11 @@ class DirectIPLookup : public IPRouteTable { public:
 	    cleanup();
 	}
 
-	int initialize();
+	int initialize(uint32_t rtable_capacity = 2048,
+		       uint32_t tbl_24_31_capacity = 4096,
+		       uint32_t vport_capacity = 1024);
 	void cleanup();
+	void swap(Table &x);
 
 	static inline uint32_t prefix_hash(uint32_t, uint32_t);
 
@@ -179,11 +214,26 @@ class DirectIPLookup : public IPRouteTable { public:
 	int remove_route(const IPRoute&, IPRoute*, ErrorHandler *);
 	void flush();
 
+	int build(const Vector<IPRoute> &routes, int nthreads, ErrorHandler *errh);
+	void fill_tbl_0_23(const Vector<IPRoute> &routes, const uint16_t *vports,
+			   int begin, int end, uint32_t lo, uint32_t hi);
+
     };
 
   protected:
 
+    // the lookup structures of _t, as seen by lookups
+    struct Lookup {
+	const uint16_t *tbl_0_23;
+	const uint16_t *tbl_24_31;
+	const VirtualPort *vport;
+    };
+
     Table _t;
+    Table _retired;
+    mutable fast_rcu<Lookup> _lookup;
+
+    void publish();
 
     friend class RangeIPLookup;
 
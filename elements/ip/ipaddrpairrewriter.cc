@@ -148,6 +148,17 @@ IPAddrPairRewriter::add_flow(int, const IPFlowID &flowid,
     return store_flow(flow, input, _map[click_current_cpu_id()]);
 }
 
+IPRewriterEntry *
+IPAddrPairRewriter::take_flow(IPRewriterFlow *flow, int input, unsigned cpu)
+{
+    void *data = _allocator[cpu].allocate();
+    if (!data)
+	return 0;
+
+    IPAddrPairFlow *copy = new(data) IPAddrPairFlow(*static_cast<IPAddrPairFlow *>(flow));
+    return adopt_flow(copy, input, _map[cpu], 0, cpu);
+}
+
 int
 IPAddrPairRewriter::process(int port, Packet *p_in)
 {
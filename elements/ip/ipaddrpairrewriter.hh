@@ -138,7 +138,6 @@ class IPAddrPairRewriter : public IPRewriterBase { public:
     void *cast(const char *);
 
     int configure(Vector<String> &conf, ErrorHandler *errh) CLICK_COLD;
-    //void take_state(Element *, ErrorHandler *);
 
     IPRewriterEntry *get_entry(int ip_p, const IPFlowID &xflowid, int input);
     IPRewriterEntry *add_flow(int ip_p, const IPFlowID &flowid,
@@ -152,6 +151,9 @@ class IPAddrPairRewriter : public IPRewriterBase { public:
 
     void add_handlers() CLICK_COLD;
 
+  protected:
+    IPRewriterEntry *take_flow(IPRewriterFlow *flow, int input, unsigned cpu);
+
   private:
 #if HAVE_USER_MULTITHREAD
     unsigned _maps_no;
@@ -153,6 +153,17 @@ IPAddrRewriter::add_flow(int, const IPFlowID &flowid,
     return store_flow(flow, input, _map[click_current_cpu_id()]);
 }
 
+IPRewriterEntry *
+IPAddrRewriter::take_flow(IPRewriterFlow *flow, int input, unsigned cpu)
+{
+    void *data = _allocator[cpu].allocate();
+    if (!data)
+	return 0;
+
+    IPAddrFlow *copy = new(data) IPAddrFlow(*static_cast<IPAddrFlow *>(flow));
+    return adopt_flow(copy, input, _map[cpu], 0, cpu);
+}
+
 int
 IPAddrRewriter::process(int port, Packet *p_in)
 {
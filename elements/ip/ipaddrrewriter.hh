@@ -137,7 +137,6 @@ class IPAddrRewriter : public IPRewriterBase { public:
     void *cast(const char *);
 
     int configure(Vector<String> &conf, ErrorHandler *errh) CLICK_COLD;
-    //void take_state(Element *, ErrorHandler *);
 
     inline IPRewriterEntry *get_entry(int ip_p, const IPFlowID &flowid, int input);
     IPRewriterEntry *add_flow(int ip_p, const IPFlowID &flowid,
@@ -153,6 +152,8 @@ class IPAddrRewriter : public IPRewriterBase { public:
 
   protected:
 
+    IPRewriterEntry *take_flow(IPRewriterFlow *flow, int input, unsigned cpu);
+
 #if HAVE_USER_MULTITHREAD
     unsigned _maps_no;
     SizedHashAllocator<sizeof(IPAddrFlow)> *_allocator;
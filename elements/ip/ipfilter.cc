@@ -29,6 +29,7 @@
 #include <click/integers.hh>
 #include <click/etheraddress.hh>
 #include <click/nameinfo.hh>
+#include <click/batchview.hh>
 CLICK_DECLS
 
 static const StaticNameDB::Entry type_entries[] = {
@@ -1390,10 +1391,17 @@ IPFilter::length_checked_match(const IPFilterProgram &zprog, const Packet *p,
 void
 IPFilter::push_batch(int, PacketBatch *batch)
 {
-	CLASSIFY_EACH_PACKET(	(noutputs() + 1),
-							match,
-							batch,
-							checked_output_push_batch);
+    BatchView v;
+    PacketBatch *outs[noutputs()];
+    memset(outs, 0, sizeof(outs));
+    Packet *next = batch;
+    while (next) {
+	next = v.gather(next, BatchView::F_PREFETCH);
+	for (unsigned i = 0; i < v.size(); ++i)
+	    v.out[i] = match(_zprog, v.packet[i]);
+	v.scatter(outs, noutputs());
+    }
+    BatchView::push(this, outs, noutputs());
 
 }
 #endif
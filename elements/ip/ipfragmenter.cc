@@ -186,10 +186,10 @@ IPFragmenter::push(int, Packet *p)
 void
 IPFragmenter::push_batch(int, PacketBatch *batch)
 {
-    EXECUTE_FOR_EACH_PACKET_SPLITTABLE([this](Packet*p){return (p->network_length() <= (int) _mtu)?p:0;}, //Return p if _mtu is ok, 0 if not
+    EXECUTE_FOR_EACH_PACKET_SPLITTABLE_PREFETCH([this](Packet*p){return (p->network_length() <= (int) _mtu)?p:0;}, //Return p if _mtu is ok, 0 if not
                                         batch, //The batch
                                         fragment, //Call fragment on the packet that is not _mtu sized
-                                        [this](PacketBatch*batch){output_push_batch(0,batch);}); //Flush the batch before calling fragment
+                                        [this](PacketBatch*batch){output_push_batch(0,batch);}, batch_prefetch_distance()); //Flush the batch before calling fragment
 }
 #endif
 
@@ -209,7 +209,7 @@ void IPOutputCombo::push_batch(int, PacketBatch * head) {
     auto on_finish = [this](int n, PacketBatch* batch) {
         if (unlikely(n == 1)) {
             output(1).push_batch(batch->clone_batch());
-            CLASSIFY_EACH_PACKET(6,[this](Packet* p){return action(p,false);},batch,checked_output_push_batch);
+            CLASSIFY_EACH_PACKET_PREFETCH(6,[this](Packet* p){return action(p,false);},batch,checked_output_push_batch,batch_prefetch_distance());
             return;
         } else if (unlikely(n == 5)) {
             batch->fast_kill();
@@ -217,7 +217,7 @@ void IPOutputCombo::push_batch(int, PacketBatch * head) {
         }
         output_push_batch(n,batch);
     };
-    CLASSIFY_EACH_PACKET(6,action,head,on_finish);
+    CLASSIFY_EACH_PACKET_PREFETCH(6,action,head,on_finish,batch_prefetch_distance());
 }
 #endif
 inline void
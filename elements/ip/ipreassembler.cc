@@ -36,10 +36,9 @@ CLICK_DECLS
 #define IP_BYTE_OFF(iph)	((ntohs((iph)->ip_off) & IP_OFFMASK) << 3)
 
 IPReassembler::IPReassembler()
-    : _stat_frags_seen(0), _stat_good_assem(0), _stat_failed_assem(0), _stat_bad_pkts(0)
+    : _nbuckets(1024), _npool(0), _timeout(DEFAULT_TIMEOUT),
+      _evict(EVICT_OLDEST)
 {
-    for (int i = 0; i < NMAP; i++)
-	_map[i] = 0;
     static_assert(IPREASSEMBLER_ANNO_OFFSET + IPREASSEMBLER_ANNO_SIZE <= Packet::anno_size, "anno too big");
     static_assert(sizeof(ChunkLink) == IPREASSEMBLER_ANNO_SIZE, "sizeof(ChunkLink) is expected to equal IPREASSEMBLER_ANNO_SIZE.");
 }
@@ -53,33 +52,97 @@ IPReassembler::configure(Vector<String> &conf, ErrorHandler *errh)
 {
     _mem_high_thresh = 256 * 1024;
     int mtu_anno = -1;
+    int timeout = DEFAULT_TIMEOUT;
+    uint32_t nbuckets = 1024;
+    String evict = "OLDEST";
     if (Args(conf, this, errh)
 	.read("HIMEM", _mem_high_thresh)
+	.read("TIMEOUT", timeout)
+	.read("EVICT", WordArg(), evict)
+	.read("BUCKETS", nbuckets)
 	.read("MAX_MTU_ANNO", AnnoArg(2), mtu_anno)
 	.complete() < 0)
 	return -1;
+    if (timeout <= 0 || timeout >= WHEEL_SIZE)
+	return errh->error("TIMEOUT must be between 1 and %d", WHEEL_SIZE - 1);
+    evict = evict.upper();
+    if (evict == "OLDEST")
+	_evict = EVICT_OLDEST;
+    else if (evict == "NEW")
+	_evict = EVICT_NEW;
+    else
+	return errh->error("EVICT must be OLDEST or NEW");
+    if (nbuckets == 0 || nbuckets > 0x1000000)
+	return errh->error("BUCKETS out of range");
+    for (_nbuckets = 1; _nbuckets < nbuckets; _nbuckets <<= 1)
+	/* nada */;
+    _timeout = timeout;
     _mtu_anno = mtu_anno;
-    _mem_low_thresh = (_mem_high_thresh >> 2) * 3;
     return 0;
 }
 
 int
 IPReassembler::initialize(ErrorHandler *)
 {
-    _mem_used = 0;
-    _reap_time = 0;
+    unsigned nthreads = get_passing_threads().weight();
+    if (nthreads == 0)
+	nthreads = 1;
+    _mem_thread_high = _mem_high_thresh / nthreads;
+    _mem_thread_low = (_mem_thread_high >> 2) * 3;
+    // Every datagram accounts for at least IPH_MEM_USED + 8 bytes, so the
+    // memory bound also bounds the number of datagrams.
+    _npool = _mem_thread_high / (IPH_MEM_USED + 8) + 1;
     return 0;
 }
 
+void
+IPReassembler::alloc_state(State &s)
+{
+    s.map = new Datagram *[_nbuckets];
+    memset(s.map, 0, sizeof(Datagram *) * _nbuckets);
+    s.pool = new Datagram[_npool];
+    s.free = 0;
+    for (uint32_t i = _npool; i > 0; --i) {
+	s.pool[i - 1].hnext = s.free;
+	s.free = &s.pool[i - 1];
+    }
+    s.wheel = new Datagram[WHEEL_SIZE];
+    for (int i = 0; i < WHEEL_SIZE; ++i)
+	s.wheel[i].wnext = s.wheel[i].wprev = &s.wheel[i];
+    s.wheel_now = 0;
+    s.mem_used = 0;
+}
+
+void
+IPReassembler::free_state(State &s)
+{
+    if (!s.map)
+	return;
+    for (uint32_t b = 0; b < _nbuckets; ++b)
+	for (Datagram *d = s.map[b]; d; d = d->hnext)
+	    d->q->kill();
+    delete[] s.map;
+    delete[] s.pool;
+    delete[] s.wheel;
+    s.map = 0;
+    s.pool = s.free = s.wheel = 0;
+    s.mem_used = 0;
+}
+
+inline IPReassembler::State &
+IPReassembler::state()
+{
+    State &s = *_state;
+    if (unlikely(!s.map))
+	alloc_state(s);
+    return s;
+}
+
 void
 IPReassembler::cleanup(CleanupStage)
 {
-    for (int i = 0; i < NMAP; i++)
-	while (_map[i]) {
-	    WritablePacket *next = (WritablePacket *)(_map[i]->next());
-	    _map[i]->kill();
-	    _map[i] = next;
-	}
+    for (unsigned i = 0; i < _state.weight(); ++i)
+	free_state(_state.get_value(i));
 }
 
 void
@@ -103,97 +166,174 @@ IPReassembler::check(ErrorHandler *errh)
 {
     if (!errh)
 	errh = ErrorHandler::default_handler();
-    uint32_t mem_used = 0;
-    for (int b = 0; b < NMAP; b++)
-	for (WritablePacket *q = _map[b]; q; q = (WritablePacket *)(q->next()))
-	    if (q->has_network_header()) {
-		const click_ip *qip = q->ip_header();
-		if (bucketno(qip) != b)
-		    check_error(errh, b, q, "in wrong bucket");
-		mem_used += IPH_MEM_USED + q->transport_length();
-		ChunkLink *chunk = &PACKET_CHUNK(q);
-		int off = 0;
+    for (unsigned t = 0; t < _state.weight(); ++t) {
+	State &s = _state.get_value(t);
+	if (!s.map)
+	    continue;
+	s.lock.acquire();
+	uint32_t mem_used = 0;
+	for (uint32_t b = 0; b < _nbuckets; b++)
+	    for (Datagram *d = s.map[b]; d; d = d->hnext) {
+		WritablePacket *q = d->q;
+		if (q->has_network_header()) {
+		    const click_ip *qip = q->ip_header();
+		    if (d->hash != hashcode(qip) || (d->hash & (_nbuckets - 1)) != b)
+			check_error(errh, b, q, "in wrong bucket");
+		    mem_used += IPH_MEM_USED + q->transport_length();
+		    ChunkLink *chunk = &PACKET_CHUNK(q);
+		    int off = 0;
 #if VERBOSE_DEBUG
-		check_error(errh, b, q, "");
-		StringAccum sa;
-		while (chunk && (!off || off < q->transport_length())) {
-		    sa << " (" << chunk->off << ',' << chunk->lastoff << ')';
-		    off = chunk->lastoff;
-		    chunk = next_chunk(q, chunk);
-		}
-		errh->message("  %s", sa.c_str());
-		chunk = &PACKET_CHUNK(q);
-		off = 0;
+		    check_error(errh, b, q, "");
+		    StringAccum sa;
+		    while (chunk && (!off || off < q->transport_length())) {
+			sa << " (" << chunk->off << ',' << chunk->lastoff << ')';
+			off = chunk->lastoff;
+			chunk = next_chunk(q, chunk);
+		    }
+		    errh->message("  %s", sa.c_str());
+		    chunk = &PACKET_CHUNK(q);
+		    off = 0;
 #endif
-		while (chunk) {
-		    if (chunk->off >= chunk->lastoff
-			|| chunk->lastoff > q->transport_length()
-			|| (off != 0 && chunk->off < off + 8)) {
-			check_error(errh, b, q, "bad chunk (%d, %d) at %d", chunk->off, chunk->lastoff, off);
-			break;
+		    while (chunk) {
+			if (chunk->off >= chunk->lastoff
+			    || chunk->lastoff > q->transport_length()
+			    || (off != 0 && chunk->off < off + 8)) {
+			    check_error(errh, b, q, "bad chunk (%d, %d) at %d", chunk->off, chunk->lastoff, off);
+			    break;
+			}
+			off = chunk->lastoff;
+			chunk = next_chunk(q, chunk);
 		    }
-		    off = chunk->lastoff;
-		    chunk = next_chunk(q, chunk);
-		}
-	    } else
-		errh->error("buck %d: missing IP header", b);
-    if (mem_used != _mem_used)
-	errh->error("bad mem_used: have %u, claim %u", mem_used, _mem_used);
+		} else
+		    errh->error("buck %d: missing IP header", b);
+	    }
+	if (mem_used != s.mem_used)
+	    errh->error("thread %u: bad mem_used: have %u, claim %u", t, mem_used, s.mem_used);
+	s.lock.release();
+    }
     return 0;
 }
 
 String
-IPReassembler::debug_dump(Element *e, void *)
+IPReassembler::read_handler(Element *e, void *thunk)
 {
     IPReassembler *r = (IPReassembler *) e;
-    r->check();
+    Stats st;
+    uint32_t mem_used = 0;
+    memset(&st, 0, sizeof(st));
+    for (unsigned t = 0; t < r->_state.weight(); ++t) {
+	const State &s = r->_state.get_value(t);
+	st.frags_seen += s.stats.frags_seen;
+	st.good_assem += s.stats.good_assem;
+	st.failed_assem += s.stats.failed_assem;
+	st.evicted += s.stats.evicted;
+	st.refused += s.stats.refused;
+	st.bad_pkts += s.stats.bad_pkts;
+	mem_used += s.mem_used;
+    }
+
     StringAccum sa;
     sa <<
-	"frags seen total:    " << r->_stat_frags_seen << "\n"
-	"good reassemblies:   " << r->_stat_good_assem << "\n"
-	"failed reassemblies: " << r->_stat_failed_assem << "\n"
-	"bad fragments seen:  " << r->_stat_bad_pkts << "\n"
-	"cached chunk data:\n";
-    for (int b = 0; b < NMAP; b++)
-	for (WritablePacket *q = r->_map[b]; q; q = (WritablePacket *)(q->next()))
-	    if (const click_ip *qip = q->ip_header()) {
-		sa << ' ' << IPFlowID(qip) << ' ' << ntohs(qip->ip_id);
-		ChunkLink *chunk = &PACKET_CHUNK(q);
-		while (chunk &&
-		       (chunk->lastoff > chunk->off) &&
-		       (chunk->lastoff <= q->transport_length())) {
-		    sa << " (" << chunk->off << ',' << chunk->lastoff << ')';
-		    chunk = next_chunk(q, chunk);
+	"frags seen total:    " << st.frags_seen << "\n"
+	"good reassemblies:   " << st.good_assem << "\n"
+	"failed reassemblies: " << st.failed_assem << "\n"
+	"evicted datagrams:   " << st.evicted << "\n"
+	"refused fragments:   " << st.refused << "\n"
+	"bad fragments seen:  " << st.bad_pkts << "\n"
+	"memory used:         " << mem_used << "\n";
+    if (thunk == 0)
+	return sa.take_string();
+
+    r->check();
+    sa << "cached chunk data:\n";
+    for (unsigned t = 0; t < r->_state.weight(); ++t) {
+	State &s = r->_state.get_value(t);
+	if (!s.map)
+	    continue;
+	// other threads keep reassembling: hold off the owner of this table
+	s.lock.acquire();
+	for (uint32_t b = 0; b < r->_nbuckets; b++)
+	    for (Datagram *d = s.map[b]; d; d = d->hnext)
+		if (const click_ip *qip = d->q->ip_header()) {
+		    WritablePacket *q = d->q;
+		    sa << ' ' << IPFlowID(qip) << ' ' << ntohs(qip->ip_id);
+		    ChunkLink *chunk = &PACKET_CHUNK(q);
+		    while (chunk &&
+			   (chunk->lastoff > chunk->off) &&
+			   (chunk->lastoff <= q->transport_length())) {
+			sa << " (" << chunk->off << ',' << chunk->lastoff << ')';
+			chunk = next_chunk(q, chunk);
+		    }
+		    sa << '\n';
 		}
-		sa << '\n';
-	    }
+	s.lock.release();
+    }
     return sa.take_string();
 }
 
-WritablePacket *
-IPReassembler::find_queue(Packet *p, WritablePacket ***store_pprev)
+IPReassembler::Datagram *
+IPReassembler::find_queue(State &s, Packet *p, uint32_t hash, Datagram ***store_pprev)
 {
     const click_ip *iph = p->ip_header();
-    int bucket = bucketno(iph);
-    WritablePacket **pprev = &_map[bucket];
-    WritablePacket *q;
-    for (q = *pprev; q; pprev = (WritablePacket **)&q->next(), q = *pprev) {
-	const click_ip *qiph = q->ip_header();
-	if (same_segment(iph, qiph)) {
+    Datagram **pprev = &s.map[hash & (_nbuckets - 1)];
+    *store_pprev = pprev;
+    for (Datagram *d = *pprev; d; pprev = &d->hnext, d = *pprev)
+	if (d->hash == hash && same_segment(iph, d->q->ip_header())) {
 	    *store_pprev = pprev;
-	    return q;
+	    return d;
 	}
-    }
-    *store_pprev = &_map[bucket];
     return 0;
 }
 
+/* Remove @a d from its hash bucket and timing wheel slot and return it to
+   the free list.  The caller accounts for d->q. */
+void
+IPReassembler::release(State &s, Datagram *d)
+{
+    Datagram **pprev = &s.map[d->hash & (_nbuckets - 1)];
+    while (*pprev != d)
+	pprev = &(*pprev)->hnext;
+    *pprev = d->hnext;
+    d->wprev->wnext = d->wnext;
+    d->wnext->wprev = d->wprev;
+    d->q = 0;
+    d->hnext = s.free;
+    s.free = d;
+}
+
+/* Give up on @a d, queueing what was collected for output 1.  The caller
+   pushes it with push_failed() once the state's lock is released. */
+void
+IPReassembler::fail(State &s, Datagram *d)
+{
+    WritablePacket *q = d->q;
+    s.mem_used -= IPH_MEM_USED + q->transport_length();
+    release(s, d);
+    q->set_next(0);
+    if (s.failed_tail)
+	s.failed_tail->set_next(q);
+    else
+	s.failed = q;
+    s.failed_tail = q;
+}
+
+void
+IPReassembler::push_failed(Packet *q)
+{
+    while (q) {
+	Packet *next = q->next();
+	q->set_next(0);
+	checked_output_push(1, q);
+	q = next;
+    }
+}
+
 Packet *
-IPReassembler::emit_whole_packet(WritablePacket *q, WritablePacket **q_pprev,
-				 Packet *p_in)
+IPReassembler::emit_whole_packet(State &s, Datagram *d, Packet *p_in)
 {
-    ++_stat_good_assem;
-    *q_pprev = (WritablePacket *)q->next();
+    WritablePacket *q = d->q;
+    ++s.stats.good_assem;
+    release(s, d);
 
     click_ip *q_iph = q->ip_header();
     q_iph->ip_len = htons(q->network_length());
@@ -206,12 +346,13 @@ IPReassembler::emit_whole_packet(WritablePacket *q, WritablePacket **q_pprev,
     q->set_next(0);
 
     p_in->kill();
-    _mem_used -= IPH_MEM_USED + q->transport_length();
+    s.mem_used -= IPH_MEM_USED + q->transport_length();
     return q;
 }
 
 void
-IPReassembler::make_queue(Packet *p, WritablePacket **q_pprev)
+IPReassembler::make_queue(State &s, Packet *p, uint32_t hash,
+			  Datagram **d_pprev, int now)
 {
     int p_off = IP_BYTE_OFF(p->ip_header());
     int p_lastoff = p_off + PACKET_DLEN(p);
@@ -234,10 +375,11 @@ IPReassembler::make_queue(Packet *p, WritablePacket **q_pprev)
 	memcpy(q->ip_header(), p->ip_header(), 20);
 	// copy data
 	memcpy(q->transport_header() + p_off, p->transport_header(), PACKET_DLEN(p));
+	q->set_timestamp_anno(p->timestamp_anno());
 	p->kill();
     }
 
-    _mem_used += IPH_MEM_USED + p_lastoff;
+    s.mem_used += IPH_MEM_USED + p_lastoff;
 
     click_ip *q_iph = q->ip_header();
     q_iph->ip_off = (q_iph->ip_off & ~htons(IP_OFFMASK)); // leave MF, DF, RF
@@ -247,12 +389,21 @@ IPReassembler::make_queue(Packet *p, WritablePacket **q_pprev)
 
     PACKET_CHUNK(q).off = p_off;
     PACKET_CHUNK(q).lastoff = p_lastoff;
+    q->set_next(0);
 
     // link it up
-    q->set_next(*q_pprev);
-    *q_pprev = q;
-
-    check();
+    Datagram *d = s.free;
+    s.free = d->hnext;
+    d->q = q;
+    d->hash = hash;
+    d->expiry = now + _timeout;
+    d->hnext = *d_pprev;
+    *d_pprev = d;
+    Datagram *slot = &s.wheel[d->expiry & (WHEEL_SIZE - 1)];
+    d->wnext = slot;
+    d->wprev = slot->wprev;
+    slot->wprev->wnext = d;
+    slot->wprev = d;
 }
 
 IPReassembler::ChunkLink *
@@ -264,25 +415,21 @@ IPReassembler::next_chunk(WritablePacket *q, ChunkLink *chunk)
 	return (ChunkLink *)(q->transport_header() + chunk->lastoff);
 }
 
-Packet *
-IPReassembler::simple_action(Packet *p)
+inline Packet *
+IPReassembler::handle(State &s, Packet *p)
 {
-    // check common case: not a fragment
-    assert(p->has_network_header());
     const click_ip *iph = p->ip_header();
-    if (!IP_ISFRAG(iph))
-	return p;
-
-    ++_stat_frags_seen;
+    assert(IP_ISFRAG(iph));
+    ++s.stats.frags_seen;
 
-    // reap if necessary
+    // expire old datagrams
     int now = p->timestamp_anno().sec();
     if (!now) {
 	p->timestamp_anno().assign_now();
 	now = p->timestamp_anno().sec();
     }
-    if (now >= _reap_time)
-	reap(now);
+    if (now > s.wheel_now)
+	reap(s, now);
 
     // calculate packet edges
     int p_off = IP_BYTE_OFF(iph);
@@ -294,7 +441,7 @@ IPReassembler::simple_action(Packet *p)
 	|| ((p_lastoff & 7) != 0 && (iph->ip_off & htons(IP_MF)) != 0)
 	|| PACKET_DLEN(p) < p_lastoff - p_off) {
 	p->kill();
-	++_stat_bad_pkts;
+	++s.stats.bad_pkts;
 	return 0;
     }
     p->take(PACKET_DLEN(p) - (p_lastoff - p_off));
@@ -302,17 +449,22 @@ IPReassembler::simple_action(Packet *p)
     // otherwise, we need to keep the packet
 
     // clean up memory if necessary
-    if (_mem_used > _mem_high_thresh)
-	reap_overfull(now);
+    if (s.mem_used > _mem_thread_high && _evict == EVICT_OLDEST)
+	reap_overfull(s);
 
     // get its Packet queue
-    WritablePacket **q_pprev;
-    WritablePacket *q = find_queue(p, &q_pprev);
-    if (!q) {			// make a new queue
-	make_queue(p, q_pprev);
+    uint32_t hash = hashcode(iph);
+    Datagram **d_pprev;
+    Datagram *d = find_queue(s, p, hash, &d_pprev);
+    if (!d) {			// make a new queue
+	if (s.mem_used > _mem_thread_high || !s.free) {
+	    ++s.stats.refused;
+	    p->kill();
+	} else
+	    make_queue(s, p, hash, d_pprev, now);
 	return 0;
     }
-    WritablePacket *q_bucket_next = (WritablePacket *)(q->next());
+    WritablePacket *q = d->q;
 
     if (_mtu_anno >= 0 && q->anno_u16(_mtu_anno) < p->network_length())
 	q->set_anno_u16(_mtu_anno, p->network_length());
@@ -324,6 +476,12 @@ IPReassembler::simple_action(Packet *p)
 	    p->kill();
 	    return 0;
 	}
+	// under EVICT NEW, datagrams may not grow past the memory bound
+	if (s.mem_used > _mem_thread_high) {
+	    ++s.stats.refused;
+	    p->kill();
+	    return 0;
+	}
 	// Figure out how much space to request. Add 8 extra bytes to ensure
 	// room for a ChunkLink, and request extra space if this packet has MF
 	// set. XXX This algorithm could result in a number of intermediate
@@ -336,18 +494,18 @@ IPReassembler::simple_action(Packet *p)
 	// request space
 	if (!(q = q->put(want_space))) {
 	    click_chatter("out of memory");
-	    *q_pprev = q_bucket_next;
-	    _mem_used -= IPH_MEM_USED + old_transport_length;
+	    s.mem_used -= IPH_MEM_USED + old_transport_length;
+	    release(s, d);
 	    p->kill();
 	    return 0;
 	}
 	// get rid of extra space
 	q->take(q->transport_length() - p_lastoff);
 	// hook up packet, and add final chunk
-	*q_pprev = q;
+	d->q = q;
 	ChunkLink *last_chunk = (ChunkLink *)(q->transport_header() + old_transport_length);
 	last_chunk->off = last_chunk->lastoff = p_lastoff;
-	_mem_used += p_lastoff - old_transport_length;
+	s.mem_used += p_lastoff - old_transport_length;
     }
 
     // find chunks before and after p
@@ -380,6 +538,7 @@ IPReassembler::simple_action(Packet *p)
 	    q = q->push(header_delta);
 	else if (header_delta < 0)
 	    q->pull(-header_delta);
+	d->q = q;
 	q->set_ip_header((click_ip *)(q->data() + p->ip_header_offset()), p->ip_header_length());
         if (p->has_mac_header())
 	    q->set_mac_header((q->data() + p->mac_header_offset()), p->mac_header_length());
@@ -404,68 +563,111 @@ IPReassembler::simple_action(Packet *p)
     if ((q->ip_header()->ip_off & htons(IP_MF)) == 0
 	&& PACKET_CHUNK(q).off == 0
 	&& PACKET_CHUNK(q).lastoff == q->transport_length())
-	return emit_whole_packet(q, q_pprev, p);
+	return emit_whole_packet(s, d, p);
 
     // Otherwise, done for now
-    //check();
     p->kill();
     return 0;
 }
 
+inline Packet *
+IPReassembler::take_failed(State &s)
+{
+    Packet *q = s.failed;
+    s.failed = s.failed_tail = 0;
+    return q;
+}
+
+Packet *
+IPReassembler::simple_action(Packet *p)
+{
+    // check common case: not a fragment
+    assert(p->has_network_header());
+    if (!IP_ISFRAG(p->ip_header()))
+	return p;
+
+    State &s = state();
+    s.lock.acquire();
+    p = handle(s, p);
+    Packet *failed = take_failed(s);
+    s.lock.release();
+    push_failed(failed);
+    return p;
+}
+
+#if HAVE_BATCH
+PacketBatch *
+IPReassembler::simple_action_batch(PacketBatch *batch)
+{
+    // The lock is taken at the batch's first fragment, if any.
+    State &s = state();
+    bool locked = false;
+    auto fnt = [this, &s, &locked](Packet *p) -> Packet * {
+	assert(p->has_network_header());
+	if (!IP_ISFRAG(p->ip_header()))
+	    return p;
+	if (!locked) {
+	    s.lock.acquire();
+	    locked = true;
+	}
+	return handle(s, p);
+    };
+    auto on_drop = [](Packet *) {};
+    EXECUTE_FOR_EACH_PACKET_DROPPABLE(fnt, batch, on_drop);
+    if (locked) {
+	Packet *failed = take_failed(s);
+	s.lock.release();
+	push_failed(failed);
+    }
+    return batch;
+}
+#endif
+
 void
-IPReassembler::reap_overfull(int now)
+IPReassembler::reap_overfull(State &s)
 {
-    check();
-
-    // First throw away fragments at least 10 seconds old, then at least 5
-    // seconds old, then any fragments.
-    for (int delta = 10; delta >= 0; delta -= 5)
-	for (int bucket = 0; bucket < NMAP; bucket++) {
-	    WritablePacket **pprev = &_map[bucket];
-	    for (WritablePacket *q = *pprev; q; q = *pprev)
-		if (!delta || q->timestamp_anno().sec() < now - delta) {
-		    *pprev = (WritablePacket *)q->next();
-		    _mem_used -= IPH_MEM_USED + q->transport_length();
-		    q->set_next(0);
-		    checked_output_push(1, q);
-		    ++_stat_failed_assem;
-		    if (_mem_used <= _mem_low_thresh)
-			return;
-		} else
-		    pprev = (WritablePacket **)&q->next();
+    // Throw away the oldest datagrams first.  Datagrams all live for the
+    // same TIMEOUT, so walking the wheel from the current second visits
+    // them in order of arrival.
+    for (int i = 0; i < WHEEL_SIZE; ++i) {
+	Datagram *slot = &s.wheel[(s.wheel_now + i) & (WHEEL_SIZE - 1)];
+	while (slot->wnext != slot) {
+	    fail(s, slot->wnext);
+	    ++s.stats.evicted;
+	    if (s.mem_used <= _mem_thread_low)
+		return;
 	}
+    }
 
     click_chatter("IPReassembler: cannot free enough memory!");
 }
 
 void
-IPReassembler::reap(int now)
+IPReassembler::reap(State &s, int now)
 {
-    // look at all queues. If no activity for 30 seconds, kill that queue
-
-    int kill_time = now - REAP_TIMEOUT;
-
-    for (int i = 0; i < NMAP; i++) {
-	WritablePacket **q_pprev = &_map[i];
-	for (WritablePacket *q = *q_pprev; q; ) {
-	    if (q->timestamp_anno().sec() < kill_time) {
-		*q_pprev = (WritablePacket *)q->next();
-		q->set_next(0);
-		_mem_used -= IPH_MEM_USED + q->transport_length();
-		checked_output_push(1, q);
-	    } else
-		q_pprev = (WritablePacket **)&q->next();
-	    q = *q_pprev;
+    // expire datagrams whose TIMEOUT has passed, one wheel slot per second
+    int from = s.wheel_now;
+    if (now - from > WHEEL_SIZE)
+	from = now - WHEEL_SIZE;
+    for (int t = from; t < now; ++t) {
+	Datagram *slot = &s.wheel[t & (WHEEL_SIZE - 1)];
+	for (Datagram *d = slot->wnext; d != slot; ) {
+	    Datagram *next = d->wnext;
+	    if (d->expiry < now) {
+		fail(s, d);
+		++s.stats.failed_assem;
+	    }
+	    d = next;
 	}
     }
-
-    _reap_time = now + REAP_INTERVAL;
+    s.wheel_now = now;
 }
 
 void
 IPReassembler::add_handlers()
 {
-    add_read_handler("dump", debug_dump);
+    add_read_handler("stats", read_handler, 0);
+    add_read_handler("dump", read_handler, 1);
 }
 
 CLICK_ENDDECLS
@@ -1,8 +1,9 @@
 // -*- c-basic-offset: 4 -*-
 #ifndef CLICK_IPREASSEMBLER_HH
 #define CLICK_IPREASSEMBLER_HH
-#include <click/element.hh>
+#include <click/batchelement.hh>
 #include <click/glue.hh>
+#include <click/sync.hh>
 #include <clicknet/ip.h>
 #include <click/timer.hh>
 CLICK_DECLS
@@ -21,14 +22,24 @@ Reassembles fragmented IP packets
 Expects IP packets as input to port 0. If input packets are fragments,
 IPReassembler holds them until it has enough fragments to recreate a complete
 packet. When a complete packet is constructed, it is emitted onto output 0. If
-a set of fragments making a single packet is incomplete and dormant for 30
-seconds, the fragments are generally dropped. If IPReassembler has two
-outputs, however, a single packet containing all the received fragments at
-their proper offsets is pushed onto output 1.
-
-IPReassembler's memory usage is bounded. When memory consumption rises above
-HIMEM bytes, IPReassembler throws away old fragments until memory consumption
-drops below 3/4*HIMEM bytes. Default HIMEM is 256K.
+a set of fragments making a single packet is incomplete TIMEOUT seconds after
+its first fragment arrived, the fragments are generally dropped. If
+IPReassembler has two outputs, however, a single packet containing all the
+received fragments at their proper offsets is pushed onto output 1.
+
+Each thread passing packets through IPReassembler has its own reassembly
+table, so threads never contend and fragments are handled in parallel.  All
+fragments of a datagram must therefore reach IPReassembler on the same thread;
+this holds when packets are spread over threads by a hash of their IP
+addresses, as NIC RSS does.  Within a table, datagrams are found through a
+hash of their source, destination, protocol, and IP ID, and expire through a
+timing wheel, so the cost per fragment does not grow with the number of
+pending datagrams.
+
+IPReassembler's memory usage is bounded. HIMEM bytes are split evenly between
+the threads passing packets through the element.  When a thread's memory
+consumption rises above its share, the EVICT policy applies.  Default HIMEM is
+256K.
 
 Output packets have the same MAC header as the fragment that contains
 offset 0.  Other than that, input MAC headers are ignored.
@@ -45,6 +56,24 @@ Keyword arguments are:
 
 The upper bound for memory consumption, in bytes. Default is 256K.
 
+=item TIMEOUT
+
+Seconds after which an incomplete datagram is dropped. At most 255. Default
+is 30.
+
+=item EVICT
+
+Eviction policy when a thread's memory is exhausted.  If OLDEST, the oldest
+incomplete datagrams are thrown away until memory consumption drops below
+3/4 of the thread's share.  If NEW, fragments that would start a new
+datagram are dropped instead, so that a fragment flood cannot push out
+datagrams already in progress.  Default is OLDEST.
+
+=item BUCKETS
+
+Number of hash buckets in each thread's table, rounded up to a power of two.
+Default is 1024.
+
 =item MAX_MTU_ANNO
 
 Optional. A 2 byte annotation that will be filled with the maximum size of any
@@ -53,6 +82,18 @@ is unchanged.
 
 =back
 
+=h stats read-only
+
+Returns counters summed over all threads: fragments seen, good and failed
+(timed out) reassemblies, datagrams evicted, fragments refused under the NEW
+policy, bad fragments, and memory in use.
+
+=h dump read-only
+
+Returns the statistics followed by the datagrams currently being reassembled.
+Each thread's datagram table is locked while it is listed, holding up that
+thread's fragments; packets that are not fragments never wait for the lock.
+
 =n
 
 You may want to attach an C<ICMPError(ADDR, timeexceeded, reassembly)> to the
@@ -60,9 +101,13 @@ second output.
 
 IPReassembler destroys its input packets' "next packet" annotations.
 
+Click packets are contiguous buffers, so fragments are copied into the buffer
+of the datagram being reassembled; when the fragment at offset 0 arrives
+first, its buffer is reused and extended in place.
+
 =a IPFragmenter */
 
-class IPReassembler : public Element { public:
+class IPReassembler : public BatchElement { public:
 
     IPReassembler() CLICK_COLD;
     ~IPReassembler() CLICK_COLD;
@@ -78,6 +123,9 @@ class IPReassembler : public Element { public:
     int check(ErrorHandler * = 0);
 
     Packet *simple_action(Packet *);
+#if HAVE_BATCH
+    PacketBatch *simple_action_batch(PacketBatch *);
+#endif
 
     void add_handlers() CLICK_COLD;
 
@@ -88,44 +136,91 @@ class IPReassembler : public Element { public:
 
   private:
 
-    enum { REAP_TIMEOUT = 30, // seconds
-	   REAP_INTERVAL = 10, // seconds
+    enum { DEFAULT_TIMEOUT = 30, // seconds
+	   WHEEL_SIZE = 256,	// must exceed the largest TIMEOUT
 	   IPH_MEM_USED = 40 };
 
-    enum { NMAP = 256 };
-    WritablePacket *_map[NMAP];
+    enum { EVICT_OLDEST, EVICT_NEW };
+
+    // A datagram being reassembled.  It is linked into a hash bucket and
+    // into the timing wheel slot for the second at which it expires.
+    struct Datagram {
+	WritablePacket *q;
+	Datagram *hnext;
+	Datagram *wnext;
+	Datagram *wprev;
+	uint32_t hash;
+	int expiry;
+    };
 
-    int _reap_time;
+    struct Stats {
+	uint32_t frags_seen;
+	uint32_t good_assem;
+	uint32_t failed_assem;
+	uint32_t evicted;
+	uint32_t refused;
+	uint32_t bad_pkts;
+    };
+
+    struct State {
+	Datagram **map;
+	Datagram *pool;
+	Datagram *free;
+	Datagram *wheel;	// WHEEL_SIZE list heads
+	int wheel_now;		// wheel slots before this second are empty
+	uint32_t mem_used;
+	Stats stats;
+	Packet *failed;		// for output 1, pushed after unlocking
+	Packet *failed_tail;
+	Spinlock lock;		// held by the owning thread and by dump
+	State()
+	    : map(0), pool(0), free(0), wheel(0), wheel_now(0), mem_used(0),
+	      failed(0), failed_tail(0) {
+	    memset(&stats, 0, sizeof(stats));
+	}
+    };
 
-    uint32_t _stat_frags_seen;
-    uint32_t _stat_good_assem;
-    uint32_t _stat_failed_assem;
-    uint32_t _stat_bad_pkts;
+    per_thread<State> _state;
+    uint32_t _nbuckets;
+    uint32_t _npool;
+    int _timeout;
+    int _evict;
 
-    uint32_t _mem_used;
     uint32_t _mem_high_thresh;	// defaults to 256K
-    uint32_t _mem_low_thresh;	// defaults to 3/4 * _mem_high_thresh
+    uint32_t _mem_thread_high;	// _mem_high_thresh split between threads
+    uint32_t _mem_thread_low;	// 3/4 * _mem_thread_high
     int8_t _mtu_anno;
 
-    static inline int bucketno(const click_ip *);
+    static inline uint32_t hashcode(const click_ip *);
     static inline bool same_segment(const click_ip *, const click_ip *);
-    static String debug_dump(Element *e, void *);
-
-    WritablePacket *find_queue(Packet *, WritablePacket ***);
-    void make_queue(Packet *, WritablePacket **);
+    static String read_handler(Element *e, void *);
+
+    inline State &state();
+    void alloc_state(State &) CLICK_COLD;
+    void free_state(State &) CLICK_COLD;
+    inline Packet *handle(State &, Packet *);
+    Datagram *find_queue(State &, Packet *, uint32_t, Datagram ***);
+    void make_queue(State &, Packet *, uint32_t, Datagram **, int);
     static ChunkLink *next_chunk(WritablePacket *, ChunkLink *);
-    Packet *emit_whole_packet(WritablePacket *, WritablePacket **, Packet *);
-    void reap_overfull(int);
-    void reap(int);
+    Packet *emit_whole_packet(State &, Datagram *, Packet *);
+    void release(State &, Datagram *);
+    void fail(State &, Datagram *);
+    inline Packet *take_failed(State &);
+    void push_failed(Packet *);
+    void reap_overfull(State &);
+    void reap(State &, int);
     static void check_error(ErrorHandler *, int, const Packet *, const char *, ...);
 
 };
 
 
-inline int
-IPReassembler::bucketno(const click_ip *h)
+inline uint32_t
+IPReassembler::hashcode(const click_ip *h)
 {
-    return (h->ip_id % NMAP);
+    uint32_t x = h->ip_src.s_addr ^ (h->ip_dst.s_addr * 0x9E3779B1U)
+	^ ((uint32_t) h->ip_id << 8) ^ h->ip_p;
+    x *= 0x85EBCA6BU;
+    return x ^ (x >> 16);
 }
 
 inline bool
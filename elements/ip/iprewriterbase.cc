@@ -253,6 +253,7 @@ IPRewriterBase::initialize(ErrorHandler *errh)
         Timer& gc_timer = _gc_timer.get_value(i);
         new(&gc_timer) Timer(gc_timer_hook, this); //Reconstruct as Timer does not allow assignment
         gc_timer.initialize(this);
+        gc_timer.set_coarse();
         gc_timer.move_thread(_gc_timer.get_mapping(i));
         if (_gc_interval_sec)
             gc_timer.schedule_after_sec(_gc_interval_sec);
@@ -270,6 +271,75 @@ IPRewriterBase::cleanup(CleanupStage)
     _input_specs.clear();
 }
 
+void
+IPRewriterBase::take_state(Element *e, ErrorHandler *)
+{
+    IPRewriterBase *rw = (IPRewriterBase *) e->cast("IPRewriterBase");
+    if (!rw || strcmp(rw->class_name(), class_name()) != 0
+	|| rw->_mem_units_no != _mem_units_no)
+	return;
+
+    // A flow follows its input port if that port still rewrites the same
+    // way: same kind of spec, same outputs, same reply element.
+    Vector<int> compatible(rw->_input_specs.size(), 0);
+    for (int i = 0; i < rw->_input_specs.size() && i < _input_specs.size(); ++i) {
+	IPRewriterInput &is = _input_specs[i], &ois = rw->_input_specs[i];
+	if (is.kind == ois.kind && is.foutput == ois.foutput
+	    && is.routput == ois.routput
+	    && is.reply_element->name() == ois.reply_element->name()) {
+	    compatible[i] = 1;
+	    is.count = ois.count;
+	    is.failures = ois.failures;
+	}
+    }
+
+    click_jiffies_t now_j = click_jiffies();
+    for (unsigned cpu = 0; cpu < _mem_units_no; ++cpu)
+	for (int which = 0; which < 2; ++which) {
+	    Vector<IPRewriterFlow *> &oheap = rw->_heap[cpu]->_heaps[which];
+	    for (int i = 0; i < oheap.size(); ++i) {
+		IPRewriterFlow *flow = oheap[i];
+		int input = flow->owner() - rw->_input_specs.begin();
+		if (flow->owner()->owner == rw && compatible[input]
+		    && !flow->expired(now_j)
+		    && _heap[cpu]->size() < _heap[cpu]->capacity())
+		    take_flow(flow, input, cpu);
+	    }
+	}
+}
+
+IPRewriterEntry *
+IPRewriterBase::take_flow(IPRewriterFlow *, int, unsigned)
+{
+    return 0;
+}
+
+IPRewriterEntry *
+IPRewriterBase::adopt_flow(IPRewriterFlow *flow, int input, Map &map,
+			   Map *reply_map_ptr, unsigned cpu)
+{
+    IPRewriterInput *is = &_input_specs[input];
+    flow->_owner = is;
+    for (int d = 0; d < 2; ++d)
+	flow->_e[d].initialize(flow->_e[d].flowid(), flow->_e[d].output(), d);
+
+    if (!reply_map_ptr)
+	reply_map_ptr = &is->reply_element->_map[cpu];
+    map.set(&flow->_e[0]);
+    reply_map_ptr->set(&flow->_e[1]);
+
+    Vector<IPRewriterFlow *> &myheap = _heap[cpu]->_heaps[flow->guaranteed()];
+    myheap.push_back(flow);
+    push_heap(myheap.begin(), myheap.end(),
+	      IPRewriterFlow::heap_less(), IPRewriterFlow::heap_place());
+
+    if (map.unbalanced())
+	map.rehash(map.bucket_count() + 1);
+    if (reply_map_ptr != &map && reply_map_ptr->unbalanced())
+	reply_map_ptr->rehash(reply_map_ptr->bucket_count() + 1);
+    return &flow->_e[0];
+}
+
 IPRewriterEntry *
 IPRewriterBase::get_entry(int ip_p, const IPFlowID &flowid, int input)
 {
@@ -105,6 +105,7 @@ class IPRewriterBase : public BatchElement { public:
     int initialize(ErrorHandler *errh) CLICK_COLD;
     void add_rewriter_handlers(bool writable_patterns);
     void cleanup(CleanupStage) CLICK_COLD;
+    void take_state(Element *old, ErrorHandler *errh) CLICK_COLD;
 
     const IPRewriterHeap *flow_heap() const {
 	return _heap[click_current_cpu_id()];
@@ -163,6 +164,17 @@ class IPRewriterBase : public BatchElement { public:
     inline void unmap_flow(IPRewriterFlow *flow,
 			   Map &map, Map *reply_map_ptr = 0);
 
+    /** @brief Copy @a flow, a flow of a hotswapped-out rewriter, into this
+     * rewriter's tables for CPU @a cpu, owned by @a input.
+     *
+     * Subclasses that support hotswap allocate and copy the flow, then call
+     * adopt_flow().  Return null if the flow cannot be taken; the default
+     * takes no flows. */
+    virtual IPRewriterEntry *take_flow(IPRewriterFlow *flow, int input,
+				       unsigned cpu);
+    IPRewriterEntry *adopt_flow(IPRewriterFlow *flow, int input, Map &map,
+				Map *reply_map_ptr, unsigned cpu);
+
     static void gc_timer_hook(Timer *t, void *user_data);
 
     int parse_input_spec(const String &str, IPRewriterInput &is,
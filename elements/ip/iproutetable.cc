@@ -29,7 +29,17 @@
 #include <click/glue.hh>
 #include <click/straccum.hh>
 #include <click/router.hh>
+#include <click/master.hh>
+#include <click/iproutefile.h>
+#include <click/batchview.hh>
 #include "iproutetable.hh"
+#if CLICK_USERLEVEL
+# include <sys/types.h>
+# include <sys/stat.h>
+# include <sys/mman.h>
+# include <fcntl.h>
+# include <unistd.h>
+#endif
 CLICK_DECLS
 
 bool
@@ -102,6 +112,18 @@ IPRouteTable::cast(const char *name)
 int
 IPRouteTable::configure(Vector<String> &conf, ErrorHandler *errh)
 {
+    String file;
+    _load_threads = router()->master()->nthreads();
+    if (Args(this, errh).bind(conf)
+	.read("FILE", FilenameArg(), file)
+	.read("LOAD_THREADS", _load_threads)
+	.consume() < 0)
+	return -EINVAL;
+    if (_load_threads < 1)
+	_load_threads = 1;
+    if (file && load_route_file(file, errh) < 0)
+	return -EINVAL;
+
     int r = 0, r1, eexist = 0;
     IPRoute route;
     for (int i = 0; i < conf.size(); i++) {
@@ -143,12 +165,154 @@ IPRouteTable::lookup_route(IPAddress, IPAddress&) const
     return -1;			// by default, route lookups fail
 }
 
+int
+IPRouteTable::bulk_load(Vector<IPRoute> &, ErrorHandler *errh)
+{
+    return errh->error("%s does not support loading route files", class_name());
+}
+
+static int
+route_compar(const void *va, const void *vb, void *)
+{
+    const IPRoute *a = static_cast<const IPRoute *>(va);
+    const IPRoute *b = static_cast<const IPRoute *>(vb);
+    uint32_t am = ntohl(a->mask.addr()), bm = ntohl(b->mask.addr());
+    if (am != bm)
+	return am < bm ? -1 : 1;
+    uint32_t aa = ntohl(a->addr.addr()), ba = ntohl(b->addr.addr());
+    if (aa != ba)
+	return aa < ba ? -1 : 1;
+    return a->extra - b->extra;
+}
+
+int
+IPRouteTable::sort_routes(Vector<IPRoute> &routes)
+{
+    // Sort by prefix length, then address.  A shorter prefix is always
+    // installed before the longer prefixes it covers.  If a prefix occurs
+    // more than once, the last occurrence wins, as with "set".
+    for (int i = 0; i < routes.size(); ++i)
+	routes[i].extra = i;
+    if (routes.size())
+	click_qsort(routes.begin(), routes.size(), sizeof(IPRoute), route_compar);
+    int j = 0;
+    for (int i = 0; i < routes.size(); ++i) {
+	if (i + 1 < routes.size() && routes[i].addr == routes[i + 1].addr
+	    && routes[i].mask == routes[i + 1].mask)
+	    continue;
+	routes[j] = routes[i];
+	routes[j].extra = routes[j].prefix_len();
+	++j;
+    }
+    int dups = routes.size() - j;
+    routes.resize(j);
+    return dups;
+}
+
+int
+IPRouteTable::read_route_file(const String &filename, Vector<IPRoute> &routes, ErrorHandler *errh)
+{
+#if CLICK_USERLEVEL
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+	return errh->error("%s: %s", filename.c_str(), strerror(errno));
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+	close(fd);
+	return errh->error("%s: %s", filename.c_str(), strerror(errno));
+    }
+    size_t len = st.st_size;
+    if (len < sizeof(click_iproute_file_header)) {
+	close(fd);
+	return errh->error("%s: not a route file", filename.c_str());
+    }
+    void *mmap_data = mmap(0, len, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mmap_data == MAP_FAILED)
+	return errh->error("%s: %s", filename.c_str(), strerror(errno));
+# ifdef MADV_SEQUENTIAL
+    (void) madvise(mmap_data, len, MADV_SEQUENTIAL);
+# endif
+
+    const click_iproute_file_header *h = static_cast<const click_iproute_file_header *>(mmap_data);
+    const click_iproute_file_entry *e = reinterpret_cast<const click_iproute_file_entry *>(h + 1);
+    uint32_t count = ntohl(h->count);
+    int r = 0;
+    if (ntohl(h->magic) != CLICK_IPROUTE_FILE_MAGIC)
+	r = errh->error("%s: not a route file", filename.c_str());
+    else if (ntohs(h->version) != CLICK_IPROUTE_FILE_VERSION
+	     || ntohs(h->entry_size) != sizeof(click_iproute_file_entry))
+	r = errh->error("%s: unsupported route file version %d", filename.c_str(), ntohs(h->version));
+    else if ((len - sizeof(*h)) / sizeof(*e) < count)
+	r = errh->error("%s: truncated route file", filename.c_str());
+    else {
+	routes.resize(count);
+	IPRoute *rt = routes.begin();
+	for (uint32_t i = 0; i < count; ++i, ++e, ++rt) {
+	    if (e->prefix_len > 32) {
+		r = errh->error("%s: entry %u: bad prefix length %d", filename.c_str(), i, e->prefix_len);
+		break;
+	    }
+	    rt->mask = IPAddress::make_prefix(e->prefix_len);
+	    rt->addr = IPAddress(e->addr) & rt->mask;
+	    rt->gw = IPAddress(e->gw);
+	    rt->port = ntohs(e->port);
+	}
+    }
+    munmap(mmap_data, len);
+    return r;
+#else
+    (void) filename, (void) routes;
+    return errh->error("route files are not supported in this driver");
+#endif
+}
+
+int
+IPRouteTable::load_route_file(const String &filename, ErrorHandler *errh)
+{
+    Vector<IPRoute> routes;
+    if (read_route_file(filename, routes, errh) < 0)
+	return -EINVAL;
+    for (int i = 0; i < routes.size(); ++i)
+	if (routes[i].port >= noutputs())
+	    return errh->error("%s: route %<%s%>: bad OUTPUT", filename.c_str(), routes[i].unparse().c_str());
+    return bulk_load(routes, errh);
+}
+
+int
+IPRouteTable::load_handler(const String &str, Element *e, void *, ErrorHandler *errh)
+{
+    IPRouteTable *table = static_cast<IPRouteTable *>(e);
+    String filename;
+    if (!FilenameArg().parse(cp_uncomment(str), filename))
+	return errh->error("expected filename");
+    return table->load_route_file(filename, errh);
+}
+
 String
 IPRouteTable::dump_routes()
 {
     return String();
 }
 
+void
+IPRouteTable::lookup_route_batch(const uint32_t *dst, int *port, uint32_t *gw, unsigned n) const
+{
+    for (unsigned i = 0; i < n; ++i) {
+	IPAddress g;
+	port[i] = lookup_route(IPAddress(dst[i]), g);
+	gw[i] = g.addr();
+    }
+}
+
+void
+IPRouteTable::no_route(IPAddress dst)
+{
+    static int complained = 0;
+    if (++complained <= 5)
+	click_chatter("IPRouteTable: no route for %s", dst.unparse().c_str());
+}
+
 int
 IPRouteTable::process(int, Packet *p)
 {
@@ -161,9 +325,7 @@ IPRouteTable::process(int, Packet *p)
 		return port;
     }
     else {
-		static int complained = 0;
-		if (++complained <= 5)
-		    click_chatter("IPRouteTable: no route for %s", p->dst_ip_anno().unparse().c_str());
+		no_route(p->dst_ip_anno());
 		return -1;
     }
 }
@@ -182,64 +344,27 @@ IPRouteTable::push(int port, Packet *p)
 
 #if HAVE_BATCH
 void
-IPRouteTable::push_batch(int port, PacketBatch *batch)
+IPRouteTable::push_batch(int, PacketBatch *batch)
 {
-	unsigned short outports = noutputs();
-	PacketBatch* out[outports];
-	bzero(out,sizeof(PacketBatch*)*outports);
-	PacketBatch* next = ((batch != NULL)? static_cast<PacketBatch*>(batch->next()) : NULL );
-	PacketBatch* p = batch;
-	PacketBatch* last = NULL;
-	int last_o = -1;
-	int passed = 0;
-	int count  = 0;
-
-	for ( ;p != NULL; p=next,next=(p==0?0:static_cast<PacketBatch*>(p->next())) ) {
-		// The actual job of this element
-		int o = process(port, p);
-
-		if (o < 0 || o>=(outports)) o = (outports - 1);
-
-		if (o == last_o) {
-			passed ++;
-		}
-		else {
-			if ( !last ) {
-				out[o] = p;
-				p->set_count(1);
-				p->set_tail(p);
-			}
-			else {
-				out[last_o]->set_tail(last);
-				out[last_o]->set_count(out[last_o]->count() + passed);
-				if (!out[o]) {
-					out[o] = p;
-					out[o]->set_count(1);
-					out[o]->set_tail(p);
-				}
-				else {
-					out[o]->append_packet(p);
-				}
-				passed = 0;
-			}
-		}
-		last = p;
-		last_o = o;
-		count++;
-	}
-
-	if (passed) {
-		out[last_o]->set_tail(last);
-		out[last_o]->set_count(out[last_o]->count() + passed);
-	}
-
-	int i = 0;
-	for (; i < outports; i++) {
-		if (out[i]) {
-			out[i]->tail()->set_next(NULL);
-			checked_output_push_batch(i, out[i]);
-		}
-	}
+    BatchView v;
+    uint32_t gw[BatchView::CAPACITY];
+    PacketBatch *outs[noutputs()];
+    memset(outs, 0, sizeof(outs));
+
+    Packet *next = batch;
+    while (next) {
+	next = v.gather(next, BatchView::F_DST_ANNO);
+	unsigned n = v.size();
+	lookup_route_batch(v.dst_anno, v.out, gw, n);
+	for (unsigned i = 0; i < n; ++i)
+	    if (v.out[i] < 0)
+		no_route(IPAddress(v.dst_anno[i]));
+	    else if (gw[i])
+		v.packet[i]->set_dst_ip_anno(IPAddress(gw[i]));
+	// packets with no route are out of range, and are killed as in push()
+	v.scatter(outs, noutputs());
+    }
+    BatchView::push(this, outs, noutputs());
 }
 #endif
 
@@ -377,6 +502,7 @@ IPRouteTable::add_handlers()
     add_write_handler("set", add_route_handler, 1);
     add_write_handler("remove", remove_route_handler);
     add_write_handler("ctrl", ctrl_handler);
+    add_write_handler("load", load_handler);
     add_read_handler("table", table_handler, 0, Handler::f_expensive);
     set_handler("lookup", Handler::f_read | Handler::f_read_param, lookup_handler);
 }
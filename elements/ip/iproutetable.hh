@@ -60,6 +60,10 @@ StaticIPLookup, and SortedIPLookup elements; they are simple, but their O(N)
 lookup speed is orders of magnitude slower.  RadixIPLookup or DirectIPLookup
 should be preferred for almost all purposes.
 
+When a configuration is hot-swapped in, a RadixIPLookup, DirectIPLookup, or
+RangeIPLookup whose name, configuration, and connections are unchanged takes
+over the old element's table, including routes added or removed at run time.
+
            1500-entry fraction of the ICSI BGP dump
 
          Method     | cycles  | lookups | setup | lookup
@@ -108,11 +112,29 @@ Looks up the route associated with address C<dst>. Should set C<gw_return> to
 the resulting gateway and return the relevant output port (or negative if
 there is no route). The default implementation returns -1.
 
+=item C<void B<lookup_route_batch>(const uint32_t *dst, int *port, uint32_t *gw, unsigned n) const>
+
+Looks up the routes of the C<n> addresses in C<dst>, in network byte order,
+as if by B<lookup_route>: sets C<port[i]> to the output port for C<dst[i]>, or
+negative if there is none, and C<gw[i]> to its gateway. C<n> is at most
+BatchView::CAPACITY. The default implementation calls B<lookup_route> for
+each address. Tables whose lookups are independent memory loads should
+override it to issue the loads of all addresses together.
+
 =item C<String B<dump_routes>()>
 
 Returns a textual description of the current routing table. The default
 implementation returns an empty string.
 
+=item C<int B<bulk_load>(VectorE<lt>IPRouteE<gt> &routes, ErrorHandler *errh)>
+
+Replaces the whole routing table with C<routes>, which the function may
+reorder.  Should build the new table without disturbing the current one and
+then install it in a single step, so that packets never see a half-loaded
+table and a failed load leaves the old table in place.  Should return 0 on
+success and negative on failure.  The default implementation reports an error
+"does not support loading route files".
+
 =back
 
 The following functions, overridden by IPRouteTable, are available for use by
@@ -125,6 +147,21 @@ subclasses.
 The default implementation of B<configure> parses C<conf> as a list of routes,
 where each route is the space-separated list `C<address/mask [gateway]
 output>'. The routes are successively added to the element with B<add_route>.
+It also understands two keywords.  FILE names a binary route file, as written
+by L<click-mkroutes(1)>, that is passed to B<bulk_load> before any other routes
+are added.  LOAD_THREADS is the number of threads B<bulk_load> may use to
+build tables; it defaults to the number of Click threads.
+
+=item C<static int B<read_route_file>(const String &filename, VectorE<lt>IPRouteE<gt> &routes, ErrorHandler *errh)>
+
+Maps the binary route file C<filename> into memory and stores its routes in
+C<routes>.  Available at user level only.
+
+=item C<static int B<sort_routes>(VectorE<lt>IPRouteE<gt> &routes)>
+
+Sorts C<routes> by prefix length, then address, and removes all but the last
+route for each prefix.  Sets each route's C<extra> field to its prefix length.
+Returns the number of routes removed.  Useful for B<bulk_load>.
 
 =item C<void B<push>(int port, Packet *p)>
 
@@ -155,6 +192,12 @@ up to the `C<ctrl>' handler.
 This read handler callback function returns the element's routing table via
 the B<dump_routes> function. Normally hooked up to the `C<table>' handler.
 
+=item C<static int B<load_handler>(const String &, Element *, void *, ErrorHandler *)>
+
+This write handler callback reads the binary route file named by its input
+and installs it with B<bulk_load>. Normally hooked up to the `C<load>'
+handler.
+
 =back
 
 =a RadixIPLookup, DirectIPLookup, RangeIPLookup, StaticIPLookup,
@@ -187,6 +230,8 @@ struct IPRoute {
 
 class IPRouteTable : public BatchElement { public:
 
+    IPRouteTable()		: _load_threads(1) { }
+
     void* cast(const char*);
     int configure(Vector<String>&, ErrorHandler*) CLICK_COLD;
     void add_handlers() CLICK_COLD;
@@ -194,7 +239,9 @@ class IPRouteTable : public BatchElement { public:
     virtual int add_route(const IPRoute& route, bool allow_replace, IPRoute* replaced_route, ErrorHandler* errh);
     virtual int remove_route(const IPRoute& route, IPRoute* removed_route, ErrorHandler* errh);
     virtual int lookup_route(IPAddress addr, IPAddress& gw) const = 0;
+    virtual void lookup_route_batch(const uint32_t *dst, int *port, uint32_t *gw, unsigned n) const;
     virtual String dump_routes();
+    virtual int bulk_load(Vector<IPRoute> &routes, ErrorHandler *errh);
 
     void push(int, Packet      *p);
 #if HAVE_BATCH
@@ -206,6 +253,15 @@ class IPRouteTable : public BatchElement { public:
     static int ctrl_handler(const String&, Element*, void*, ErrorHandler*);
     static int lookup_handler(int operation, String&, Element*, const Handler*, ErrorHandler*);
     static String table_handler(Element*, void*);
+    static int load_handler(const String&, Element*, void*, ErrorHandler*);
+
+    static int read_route_file(const String &filename, Vector<IPRoute> &routes, ErrorHandler *errh);
+    static int sort_routes(Vector<IPRoute> &routes);
+    int load_route_file(const String &filename, ErrorHandler *errh);
+
+  protected:
+
+    int _load_threads;
 
   private:
 
@@ -215,6 +271,7 @@ class IPRouteTable : public BatchElement { public:
     // The actual processing of this element is abstracted from the push operation.
     // This allows both push and push_batch to exploit the same processing.
     int process(int port, Packet *p);
+    static void no_route(IPAddress dst);
 };
 
 inline StringAccum&
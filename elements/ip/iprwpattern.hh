@@ -33,9 +33,24 @@ class IPRewriterPattern { public:
     operator bool() const {
 	return _saddr || _sport || _daddr || _dport;
     }
+    IPAddress saddr() const {
+	return _saddr;
+    }
+    int sport() const {
+	return _sport;
+    }
     IPAddress daddr() const {
 	return _daddr;
     }
+    int dport() const {
+	return _dport;
+    }
+    bool is_napt() const {
+	return _is_napt;
+    }
+    uint32_t variation_top() const {
+	return _variation_top;
+    }
 
     int rewrite_flowid(const IPFlowID &flowid, IPFlowID &rewritten_flowid,
 		       const HashContainer<IPRewriterEntry> &reply_map);
@@ -255,7 +255,7 @@ LinearIPLookup::push(int, Packet *p)
 
 #if HAVE_BATCH
 void LinearIPLookup::push_batch(int, PacketBatch *batch) {
-    CLASSIFY_EACH_PACKET(noutputs() + 1,smaction,batch,checked_output_push_batch);
+    CLASSIFY_EACH_PACKET_PREFETCH(noutputs() + 1,smaction,batch,checked_output_push_batch,batch_prefetch_distance());
 }
 #endif
 
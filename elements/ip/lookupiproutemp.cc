@@ -146,7 +146,7 @@ LookupIPRouteMP::push_batch(int, PacketBatch *batch)
 		if (o == -1) o = max;
 		return o;
 	};
-	CLASSIFY_EACH_PACKET((max + 1),fnt,batch,checked_output_push_batch);
+	CLASSIFY_EACH_PACKET_PREFETCH((max + 1),fnt,batch,checked_output_push_batch,batch_prefetch_distance());
 	delete[] out_gw;
 }
 #endif //HAVE_BATCH
@@ -0,0 +1,520 @@
+// -*- c-basic-offset: 4 -*-
+/*
+ * maglevlb.{cc,hh} -- consistent-hashing layer-4 load balancer
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Click LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Click LICENSE file; the license in that file is
+ * legally binding.
+ */
+
+#include <click/config.h>
+#include "maglevlb.hh"
+#include <click/args.hh>
+#include <click/error.hh>
+#include <click/straccum.hh>
+#include <click/timestamp.hh>
+#include <clicknet/ip.h>
+#include <clicknet/ether.h>
+CLICK_DECLS
+
+#define GRE_HEADER_LEN	4
+
+static inline uint64_t
+mix64(uint64_t x)
+{
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return x;
+}
+
+// Fixed hashes, so that every MaglevLB agrees on where a flow goes.
+static inline uint64_t
+flow_hash(uint32_t saddr, uint32_t daddr, uint32_t ports, uint8_t proto)
+{
+    return mix64((((uint64_t) saddr << 32) | daddr)
+		 ^ mix64((((uint64_t) ports << 8) | proto) + 0x9e3779b97f4a7c15ULL));
+}
+
+static bool
+is_prime(uint32_t n)
+{
+    if (n < 2)
+	return false;
+    for (uint32_t d = 2; (uint64_t) d * d <= n; ++d)
+	if (n % d == 0)
+	    return false;
+    return true;
+}
+
+MaglevLB::MaglevLB()
+    : _table_size(65537), _nbuckets(0), _timeout(60), _encap(ENCAP_NONE),
+      _retired(0)
+{
+    _table.initialize(0);
+}
+
+MaglevLB::~MaglevLB()
+{
+}
+
+int
+MaglevLB::configure(Vector<String> &conf, ErrorHandler *errh)
+{
+    Vector<String> backends;
+    String encap = "none";
+    uint32_t conns = 65536;
+    bool has_src;
+    if (Args(conf, this, errh)
+	.read_all("BACKEND", AnyArg(), backends)
+	.read("TABLE_SIZE", _table_size)
+	.read("CONNS", conns)
+	.read("TIMEOUT", SecondsArg(), _timeout)
+	.read("ENCAP", WordArg(), encap)
+	.read("ENCAP_SRC", _encap_src).read_status(has_src)
+	.complete() < 0)
+	return -1;
+
+    if (!is_prime(_table_size) || _table_size > 0x7FFFFFFF)
+	return errh->error("TABLE_SIZE must be a prime number");
+    if (encap == "none")
+	_encap = ENCAP_NONE;
+    else if (encap == "ipip")
+	_encap = ENCAP_IPIP;
+    else if (encap == "gre")
+	_encap = ENCAP_GRE;
+    else
+	return errh->error("bad ENCAP");
+    if (_encap != ENCAP_NONE && !has_src)
+	return errh->error("ENCAP %s requires ENCAP_SRC", encap.c_str());
+
+    _nbuckets = 0;
+    if (conns) {
+	_nbuckets = 1;
+	while (_nbuckets * WAYS < conns)
+	    _nbuckets <<= 1;
+    }
+
+    Table *t = new Table;
+    for (int i = 0; i < backends.size(); ++i) {
+	IPAddress addr;
+	uint32_t weight = 1;
+	PrefixErrorHandler perrh(errh, "BACKEND: ");
+	if (Args(this, &perrh).push_back_words(cp_unquote(backends[i]))
+	    .read_mp("ADDR", addr)
+	    .read_p("WEIGHT", weight)
+	    .complete() < 0
+	    || change(t, OP_ADD, addr, weight, &perrh) < 0) {
+	    delete t;
+	    return -1;
+	}
+    }
+    populate(t);
+    _table.initialize(t);
+    return 0;
+}
+
+int
+MaglevLB::initialize(ErrorHandler *)
+{
+    _count.initialize(this, "count");
+    _new_conns.initialize(this, "connections");
+    _rehashed.initialize(this, "rehashed");
+    _evicted.initialize(this, "evicted");
+    _unbalanced.initialize(this, "unbalanced");
+    return 0;
+}
+
+void
+MaglevLB::cleanup(CleanupStage)
+{
+    delete _table.read();
+    _table.initialize(0);
+    delete _retired;
+    _retired = 0;
+    for (unsigned i = 0; i < _state.weight(); ++i) {
+	State &s = _state.get_value(i);
+	delete[] s.mem;
+	s.mem = 0;
+	s.conns = 0;
+    }
+}
+
+int
+MaglevLB::find_backend(const Table *t, IPAddress addr)
+{
+    for (int i = 0; i < t->backends.size(); ++i)
+	if (t->backends[i].state != B_FREE && t->backends[i].addr == addr)
+	    return i;
+    return -1;
+}
+
+int
+MaglevLB::change(Table *t, int op, IPAddress addr, uint32_t weight,
+		 ErrorHandler *errh)
+{
+    int i = find_backend(t, addr);
+    if (op == OP_ADD) {
+	if (weight == 0)
+	    return errh->error("WEIGHT must be positive");
+	if (i < 0) {
+	    for (i = 0; i < t->backends.size(); ++i)
+		if (t->backends[i].state == B_FREE)
+		    break;
+	    if (i == t->backends.size()) {
+		if (i == MAX_BACKENDS)
+		    return errh->error("too many backends");
+		Backend b;
+		b.gen = 0;
+		t->backends.push_back(b);
+	    }
+	    t->backends[i].addr = addr;
+	}
+	t->backends[i].weight = weight;
+	t->backends[i].state = B_ACTIVE;
+	return 0;
+    }
+
+    if (i < 0)
+	return errh->error("no backend %s", addr.unparse().c_str());
+    if (op == OP_DRAIN)
+	t->backends[i].state = B_DRAINING;
+    else {
+	t->backends[i].state = B_FREE;
+	++t->backends[i].gen;
+    }
+    return 0;
+}
+
+// Maglev's table population: each active backend walks its own
+// permutation of the entries and claims the next free one on its turn.
+// Backends earn turns in proportion to their weights.
+void
+MaglevLB::populate(Table *t) const
+{
+    const uint32_t m = _table_size;
+    Vector<int> active;
+    uint32_t max_weight = 0;
+    for (int i = 0; i < t->backends.size(); ++i)
+	if (t->backends[i].state == B_ACTIVE) {
+	    active.push_back(i);
+	    if (t->backends[i].weight > max_weight)
+		max_weight = t->backends[i].weight;
+	}
+
+    t->lookup.clear();
+    if (!active.size())
+	return;
+
+    int n = active.size();
+    Vector<uint32_t> offset(n, 0), skip(n, 0), next(n, 0);
+    Vector<uint64_t> credit(n, 0);
+    for (int k = 0; k < n; ++k) {
+	uint32_t a = t->backends[active[k]].addr.addr();
+	offset[k] = mix64(a ^ 0x5bd1e995) % m;
+	skip[k] = mix64(a ^ 0x1b873593) % (m - 1) + 1;
+    }
+
+    t->lookup.assign(m, EMPTY);
+    uint32_t filled = 0;
+    while (1)
+	for (int k = 0; k < n; ++k) {
+	    credit[k] += t->backends[active[k]].weight;
+	    if (credit[k] < max_weight)
+		continue;
+	    credit[k] -= max_weight;
+	    uint32_t c;
+	    do {
+		c = (offset[k] + (uint64_t) next[k] * skip[k]) % m;
+		++next[k];
+	    } while (t->lookup[c] != EMPTY);
+	    t->lookup[c] = active[k];
+	    if (++filled == m)
+		return;
+	}
+}
+
+void
+MaglevLB::allocate_conns(State &s)
+{
+    size_t size = (size_t) _nbuckets * sizeof(Bucket);
+    if (!(s.mem = new char[size + CLICK_CACHE_LINE_SIZE]))
+	return;
+    uintptr_t p = reinterpret_cast<uintptr_t>(s.mem);
+    p = (p + CLICK_CACHE_LINE_SIZE - 1) & ~(uintptr_t) (CLICK_CACHE_LINE_SIZE - 1);
+    s.conns = reinterpret_cast<Bucket *>(p);
+    memset(s.conns, 0, size);
+}
+
+inline int
+MaglevLB::pick(State &s, const Table *t, Packet *p, uint32_t now)
+{
+    const click_ip *iph = p->ip_header();
+    uint32_t ports = 0;
+    if (!IP_ISFRAG(iph)
+	&& (iph->ip_p == IP_PROTO_TCP || iph->ip_p == IP_PROTO_UDP
+	    || iph->ip_p == IP_PROTO_SCTP)
+	&& p->transport_header() + 4 <= p->end_data())
+	ports = *reinterpret_cast<const uint32_t *>(p->transport_header());
+    uint32_t saddr = iph->ip_src.s_addr;
+    uint32_t daddr = iph->ip_dst.s_addr;
+    uint64_t h = flow_hash(saddr, daddr, ports, iph->ip_p);
+
+    Conn *slot = 0;
+    if (_nbuckets) {
+	if (unlikely(!s.conns)) {
+	    allocate_conns(s);
+	    if (!s.conns)
+		goto lookup;
+	}
+	Bucket &b = s.conns[h & (_nbuckets - 1)];
+	for (int w = 0; w < WAYS; ++w) {
+	    Conn &c = b.c[w];
+	    if (c.saddr == saddr && c.daddr == daddr && c.ports == ports
+		&& c.proto == iph->ip_p && c.last && now - c.last <= _timeout) {
+		if (c.backend < t->backends.size()
+		    && t->backends[c.backend].state != B_FREE
+		    && t->backends[c.backend].gen == c.gen) {
+		    c.last = now;
+		    return c.backend;
+		}
+		// its backend was removed
+		_rehashed.inc();
+		slot = &c;
+		break;
+	    }
+	}
+	if (!slot) {
+	    slot = &b.c[0];
+	    for (int w = 1; w < WAYS && slot->last; ++w)
+		if (!b.c[w].last || b.c[w].last < slot->last)
+		    slot = &b.c[w];
+	    if (slot->last && now - slot->last <= _timeout)
+		_evicted.inc();
+	}
+    }
+
+  lookup:
+    if (!t->lookup.size())
+	return -1;
+    int backend = t->lookup[((h >> 32) * _table_size) >> 32];
+    if (slot) {
+	slot->saddr = saddr;
+	slot->daddr = daddr;
+	slot->ports = ports;
+	slot->proto = iph->ip_p;
+	slot->backend = backend;
+	slot->gen = t->backends[backend].gen;
+	slot->last = now;
+	_new_conns.inc();
+    }
+    return backend;
+}
+
+inline Packet *
+MaglevLB::encapsulate(State &s, Packet *p_in, IPAddress dst)
+{
+    unsigned hlen = sizeof(click_ip) + (_encap == ENCAP_GRE ? GRE_HEADER_LEN : 0);
+    const click_ip *inner = p_in->ip_header();
+    uint8_t tos = inner->ip_tos;
+    uint16_t off = inner->ip_off & htons(IP_DF);
+    WritablePacket *p = p_in->push(hlen);
+    if (!p)
+	return 0;
+
+    click_ip *ip = reinterpret_cast<click_ip *>(p->data());
+    ip->ip_v = 4;
+    ip->ip_hl = sizeof(click_ip) >> 2;
+    ip->ip_tos = tos;
+    ip->ip_len = htons(p->length());
+    ip->ip_id = htons(s.ip_id++);
+    ip->ip_off = off;
+    ip->ip_ttl = 64;
+    ip->ip_src = _encap_src.in_addr();
+    ip->ip_dst = dst.in_addr();
+    ip->ip_sum = 0;
+    if (_encap == ENCAP_GRE) {
+	ip->ip_p = IP_PROTO_GRE;
+	uint16_t *gre = reinterpret_cast<uint16_t *>(ip + 1);
+	gre[0] = 0;
+	gre[1] = htons(ETHERTYPE_IP);
+    } else
+	ip->ip_p = IP_PROTO_IPIP;
+#if HAVE_FAST_CHECKSUM
+    ip->ip_sum = ip_fast_csum(reinterpret_cast<unsigned char *>(ip), sizeof(click_ip) >> 2);
+#else
+    ip->ip_sum = click_in_cksum(reinterpret_cast<unsigned char *>(ip), sizeof(click_ip));
+#endif
+    p->set_ip_header(ip, sizeof(click_ip));
+    return p;
+}
+
+inline int
+MaglevLB::process(State &s, const Table *t, Packet *&p, uint32_t now)
+{
+    if (!p->has_network_header()) {
+	_unbalanced.inc();
+	return 1;
+    }
+    int backend = pick(s, t, p, now);
+    if (backend < 0) {
+	_unbalanced.inc();
+	return 1;
+    }
+    IPAddress dst = t->backends[backend].addr;
+    p->set_dst_ip_anno(dst);
+    if (_encap != ENCAP_NONE && !(p = encapsulate(s, p, dst)))
+	return -1;
+    return 0;
+}
+
+void
+MaglevLB::push(int, Packet *p)
+{
+    State &s = *_state;
+    uint32_t now = Timestamp::recent_steady().sec();
+    int flags;
+    const Table *t = _table.read_begin(flags);
+    int o = process(s, t, p, now);
+    _table.read_end(flags);
+    if (o == 0)
+	_count.inc();
+    if (o >= 0)
+	checked_output_push(o, p);
+}
+
+void
+MaglevLB::push_list(int port, PacketList &l)
+{
+    if (!l.head)
+	return;
+#if HAVE_BATCH
+    if (port < noutputs())
+	output_push_batch(port, PacketBatch::make_from_simple_list(l.head, l.tail, l.count));
+    else
+	PacketBatch::make_from_simple_list(l.head, l.tail, l.count)->kill();
+#else
+    for (Packet *p = l.head, *next; p; p = next) {
+	next = p->next();
+	p->set_next(0);
+	checked_output_push(port, p);
+    }
+#endif
+}
+
+#if HAVE_BATCH
+void
+MaglevLB::push_batch(int, PacketBatch *batch)
+{
+    State &s = *_state;
+    uint32_t now = Timestamp::recent_steady().sec();
+    PacketList out, rejected;
+
+    // one table for the whole batch
+    int flags;
+    const Table *t = _table.read_begin(flags);
+    FOR_EACH_PACKET_SAFE(batch, p) {
+	Packet *q = p;
+	int o = process(s, t, q, now);
+	if (o == 0)
+	    out.append(q);
+	else if (o == 1)
+	    rejected.append(q);
+    }
+    _table.read_end(flags);
+
+    _count.add(out.count);
+    push_list(0, out);
+    push_list(1, rejected);
+}
+#endif
+
+String
+MaglevLB::read_handler(Element *e, void *thunk)
+{
+    MaglevLB *lb = static_cast<MaglevLB *>(e);
+    StringAccum sa;
+    if ((intptr_t) thunk == 2)
+	return String(lb->_count.value());
+    if (thunk) {
+	sa << "balanced:            " << lb->_count.value() << "\n"
+	   << "new connections:     " << lb->_new_conns.value() << "\n"
+	   << "rehashed:            " << lb->_rehashed.value() << "\n"
+	   << "evicted:             " << lb->_evicted.value() << "\n"
+	   << "unbalanced:          " << lb->_unbalanced.value() << "\n";
+	return sa.take_string();
+    }
+
+    int flags;
+    const Table *t = lb->_table.read_begin(flags);
+    Vector<uint32_t> entries(t->backends.size(), 0);
+    for (int i = 0; i < t->lookup.size(); ++i)
+	++entries[t->lookup[i]];
+    for (int i = 0; i < t->backends.size(); ++i) {
+	const Backend &b = t->backends[i];
+	if (b.state != B_FREE)
+	    sa << b.addr << ' ' << b.weight << ' '
+	       << (b.state == B_ACTIVE ? "active" : "draining") << ' '
+	       << entries[i] << '\n';
+    }
+    lb->_table.read_end(flags);
+    return sa.take_string();
+}
+
+int
+MaglevLB::write_handler(const String &str, Element *e, void *thunk,
+			ErrorHandler *errh)
+{
+    MaglevLB *lb = static_cast<MaglevLB *>(e);
+    int op = (intptr_t) thunk;
+    IPAddress addr;
+    uint32_t weight = 1;
+    Args args(lb, errh);
+    args.push_back_words(str).read_mp("ADDR", addr);
+    if (op == OP_ADD)
+	args.read_p("WEIGHT", weight);
+    if (args.complete() < 0)
+	return -1;
+
+    // Build the new table beside the current one, then swap it in. Readers
+    // hold the table of their batch, so the one replaced here is freed by
+    // the next change, once write_begin has waited them out.
+    int local;
+    Table *&current = lb->_table.write_begin(local);
+    delete lb->_retired;
+    lb->_retired = 0;
+    Table *t = new Table(*current);
+    if (lb->change(t, op, addr, weight, errh) < 0) {
+	delete t;
+	lb->_table.write_commit(local);
+	return -1;
+    }
+    lb->populate(t);
+    lb->_retired = current;
+    current = t;
+    lb->_table.write_commit(local);
+    return 0;
+}
+
+void
+MaglevLB::add_handlers()
+{
+    add_read_handler("backends", read_handler, 0);
+    add_read_handler("stats", read_handler, 1);
+    add_read_handler("count", read_handler, 2);
+    add_write_handler("add", write_handler, OP_ADD);
+    add_write_handler("drain", write_handler, OP_DRAIN);
+    add_write_handler("remove", write_handler, OP_REMOVE);
+}
+
+CLICK_ENDDECLS
+EXPORT_ELEMENT(MaglevLB)
+ELEMENT_MT_SAFE(MaglevLB)
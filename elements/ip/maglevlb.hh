@@ -0,0 +1,252 @@
+// -*- c-basic-offset: 4 -*-
+#ifndef CLICK_MAGLEVLB_HH
+#define CLICK_MAGLEVLB_HH
+#include <click/batchelement.hh>
+#include <click/multithread.hh>
+#include <click/statscounter.hh>
+#include <click/ipaddress.hh>
+CLICK_DECLS
+
+/*
+=c
+
+MaglevLB([I<keywords> BACKEND, TABLE_SIZE, CONNS, TIMEOUT, ENCAP, ENCAP_SRC])
+
+=s ip
+
+consistent-hashing layer-4 load balancer
+
+=d
+
+Spreads IP flows over a set of backend servers, the way Google's Maglev does.
+Packets arrive on the input with IP header annotations. Each flow is mapped to
+a backend by its 5-tuple; the packet's destination IP address annotation is
+set to that backend, it is encapsulated as ENCAP says, and it leaves on output
+0. Packets that are not IP, or that arrive while no backend accepts new
+flows, leave on output 1 if it exists and are dropped otherwise.
+
+New flows are mapped through a lookup table of TABLE_SIZE entries, filled by
+Maglev's consistent-hashing algorithm so that each backend owns a share of
+the entries proportional to its weight. When a backend comes or goes, only
+about its share of the entries change owner, so most flows keep their
+backend even without connection state, and every MaglevLB with the same
+backends and TABLE_SIZE picks the same backend for a flow.
+
+Each thread also keeps its own connection table of CONNS entries,
+remembering the backend of every flow it saw within the last TIMEOUT
+seconds. Flows found there stick to their backend when the lookup table
+changes, as long as that backend is not removed. The table is a fixed array
+of cache-line-sized buckets of three entries; when a bucket is full, its
+least recently seen entry is replaced. Threads share no connection state, so
+the NIC should steer each flow to a single thread.
+
+Backends are added, drained, and removed at run time through handlers. A
+change builds a new lookup table off the data path and publishes it with an
+RCU pointer swap: each batch reads the table once, threads never lock, and
+the old table is freed once no thread can still be using it. Draining a
+backend gives its lookup table entries to the other backends while its
+existing connections stay with it; removing it also moves its connections.
+
+The ports of non-first fragments are unknown, so all fragments of a packet,
+and packets of protocols other than TCP, UDP, and SCTP, are mapped on their
+addresses and protocol only.
+
+Keyword arguments are:
+
+=over 8
+
+=item BACKEND
+
+'I<ADDR> [I<WEIGHT>]': a backend server address with a positive integer
+weight, 1 by default. May be given more than once.
+
+=item TABLE_SIZE
+
+Prime number of lookup table entries. It should be at least 100 times the
+number of backends, so that the shares are close to the weights. Default is
+65537.
+
+=item CONNS
+
+Number of connection table entries per thread. Zero disables connection
+tracking. Default is 65536.
+
+=item TIMEOUT
+
+Seconds after which an idle connection is forgotten. Default is 60.
+
+=item ENCAP
+
+How packets are sent to backends: C<none>, C<ipip>, or C<gre>. With
+C<none>, packets are only annotated, ready for a routing table or a rewriter.
+C<ipip> and C<gre> push an outer IP header, and for C<gre> a GRE header,
+addressed from ENCAP_SRC to the backend, so backends can answer clients
+directly (direct server return). Packets must start with their IP header.
+Default is C<none>.
+
+=item ENCAP_SRC
+
+Source address of outer IP headers. Required with ENCAP C<ipip> or C<gre>.
+
+=back
+
+=h backends read-only
+
+Returns one line per backend: its address, weight, state (C<active> or
+C<draining>), and number of lookup table entries.
+
+=h add write-only
+
+Takes 'I<ADDR> [I<WEIGHT>]'. Adds a backend, or changes its weight and makes
+it active again if it was draining.
+
+=h drain write-only
+
+Takes a backend address. The backend stops receiving new flows but keeps its
+connections.
+
+=h remove write-only
+
+Takes a backend address. The backend gets no more packets.
+
+=h stats read-only
+
+Returns packet counts: balanced, new connections, connections moved from a
+removed backend, live connections replaced in a full bucket, and packets that
+could not be balanced.
+
+=h count read-only
+
+Returns the number of packets balanced.
+
+=e
+
+  FromDPDKDevice(0)
+    -> Strip(14) -> CheckIPHeader
+    -> lb :: MaglevLB(BACKEND 10.1.0.1, BACKEND 10.1.0.2, BACKEND 10.1.0.3 2,
+                      ENCAP gre, ENCAP_SRC 10.0.0.1)
+    -> EtherEncap(0x0800, 0:0:0:0:0:1, 0:0:0:0:0:2)
+    -> ToDPDKDevice(0);
+
+Then, to take 10.1.0.2 out of service once its connections have ended:
+
+  write lb.drain 10.1.0.2
+
+=a HashSwitch, RoundRobinIPMapper, IPEncap */
+
+class MaglevLB : public BatchElement { public:
+
+    MaglevLB() CLICK_COLD;
+    ~MaglevLB() CLICK_COLD;
+
+    const char *class_name() const	{ return "MaglevLB"; }
+    const char *port_count() const	{ return "1/1-2"; }
+    const char *processing() const	{ return PUSH; }
+
+    int configure(Vector<String> &, ErrorHandler *) CLICK_COLD;
+    int initialize(ErrorHandler *) CLICK_COLD;
+    void cleanup(CleanupStage) CLICK_COLD;
+    void add_handlers() CLICK_COLD;
+
+    void push(int, Packet *);
+#if HAVE_BATCH
+    void push_batch(int, PacketBatch *);
+#endif
+
+  private:
+
+    enum { ENCAP_NONE, ENCAP_IPIP, ENCAP_GRE };
+    enum { B_FREE, B_ACTIVE, B_DRAINING };
+    enum { OP_ADD, OP_DRAIN, OP_REMOVE };
+
+    enum { EMPTY = 0xFFFF, MAX_BACKENDS = 0xFFFF };
+
+    struct Backend {
+	IPAddress addr;
+	uint32_t weight;
+	uint8_t state;
+	uint8_t gen;		// bumped when the slot is freed
+    };
+
+    // Immutable once published. Slots of removed backends are kept free
+    // so connection entries can name backends by slot.
+    struct Table {
+	Vector<Backend> backends;
+	Vector<uint16_t> lookup;	// empty if no backend is active
+    };
+
+    struct Conn {
+	uint32_t saddr;
+	uint32_t daddr;
+	uint32_t ports;
+	uint16_t backend;
+	uint8_t proto;
+	uint8_t gen;
+	uint32_t last;		// seconds
+    };
+
+    enum { WAYS = 3 };
+    struct Bucket {
+	Conn c[WAYS];
+	uint32_t pad;
+    };
+
+    struct State {
+	Bucket *conns;		// cache-aligned inside mem
+	char *mem;
+	uint16_t ip_id;
+	State()
+	    : conns(0), mem(0), ip_id(0) {
+	}
+    };
+
+    struct PacketList {
+	Packet *head;
+	Packet *tail;
+	unsigned count;
+	PacketList()
+	    : head(0), tail(0), count(0) {
+	}
+	inline void append(Packet *p) {
+	    p->set_next(0);
+	    if (tail)
+		tail->set_next(p);
+	    else
+		head = p;
+	    tail = p;
+	    ++count;
+	}
+    };
+
+    uint32_t _table_size;
+    uint32_t _nbuckets;		// power of two, or 0 without tracking
+    uint32_t _timeout;
+    int _encap;
+    IPAddress _encap_src;
+
+    fast_rcu<Table *> _table;
+    Table *_retired;		// freed by the next change
+    per_thread<State> _state;
+
+    StatsCounter _count;
+    StatsCounter _new_conns;
+    StatsCounter _rehashed;
+    StatsCounter _evicted;
+    StatsCounter _unbalanced;
+
+    static int find_backend(const Table *, IPAddress);
+    int change(Table *, int op, IPAddress, uint32_t weight, ErrorHandler *);
+    void populate(Table *) const;
+    void allocate_conns(State &);
+    inline int pick(State &, const Table *, Packet *, uint32_t now);
+    inline Packet *encapsulate(State &, Packet *, IPAddress);
+    inline int process(State &, const Table *, Packet *&, uint32_t now);
+    void push_list(int, PacketList &);
+
+    static String read_handler(Element *, void *) CLICK_COLD;
+    static int write_handler(const String &, Element *, void *, ErrorHandler *) CLICK_COLD;
+
+};
+
+CLICK_ENDDECLS
+#endif
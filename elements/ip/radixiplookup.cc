@@ -25,6 +25,9 @@
 #include <click/error.hh>
 #include <click/glue.hh>
 #include <click/straccum.hh>
+#include <click/hashmap.hh>
+#include <click/algorithm.hh>
+#include <click/router.hh>
 #include "radixiplookup.hh"
 CLICK_DECLS
 
@@ -86,9 +89,10 @@ const int RadixIPLookup::Radix::_nbuckets [5] = {65536, 16, 16, 16, 16};
     
 int
 RadixIPLookup::find_lookup_key(IPAddress gw, int32_t port) {
-    for(int i=0; i  < _lookup.size(); i++) {
-	if(_lookup[i].gw == gw  &&
-	   _lookup[i].port == port) 
+    const Vector<GWPort> &lookup = _state.read()->lookup;
+    for(int i=0; i  < lookup.size(); i++) {
+	if(lookup[i].gw == gw  &&
+	   lookup[i].port == port) 
 	    return (i + 1);
     }
     return 0;
@@ -160,9 +164,22 @@ RadixIPLookup::Radix::change(uint32_t addr, uint32_t mask, int key, bool set, in
 }
 
 
+RadixIPLookup::State::State()
+    : radix(Radix::make_radix(0)), default_key(0)
+{
+}
+
+RadixIPLookup::State::~State()
+{
+    if (radix)
+	Radix::free_radix(radix, 0);
+}
+
+
 RadixIPLookup::RadixIPLookup()
-    : _vfree(-1), _default_key(0), _radix(Radix::make_radix(0))
+    : _vfree(-1), _retired(0)
 {
+    _state.initialize(new State);
 }
 
 RadixIPLookup::~RadixIPLookup()
@@ -173,10 +190,24 @@ RadixIPLookup::~RadixIPLookup()
 void
 RadixIPLookup::cleanup(CleanupStage)
 {
-    int level = 0;
     _v.clear();
-    Radix::free_radix(_radix, level);
-    _radix = 0;
+    delete _state.read();
+    _state.initialize(0);
+    delete _retired;
+    _retired = 0;
+}
+
+void
+RadixIPLookup::take_state(Element *e, ErrorHandler *)
+{
+    RadixIPLookup *o = (RadixIPLookup *) e->cast("RadixIPLookup");
+    if (!o || !router()->hotswap_unchanged(this))
+	return;
+    State *s = _state.read();
+    _state.initialize(o->_state.read());
+    o->_state.initialize(s);
+    _v.swap(o->_v);
+    click_swap(_vfree, o->_vfree);
 }
 
 void
@@ -202,22 +233,23 @@ RadixIPLookup::dump_routes()
 int
 RadixIPLookup::add_route(const IPRoute &route, bool set, IPRoute *old_route, ErrorHandler *)
 {
+    State *s = _state.read();
     int found = (_vfree < 0 ? _v.size() : _vfree), last_key;
     int lookup_key = find_lookup_key(route.gw, route.port);
     if(!lookup_key) 
-	lookup_key = _lookup.size() + 1;
+	lookup_key = s->lookup.size() + 1;
 		    
     if (route.mask) {
 	uint32_t addr = ntohl(route.addr.addr());
 	uint32_t mask = ntohl(route.mask.addr());
 	int level = 0;
-	last_key = _radix->change(addr, mask, combine_key(found + 1, lookup_key), set, level);
+	last_key = s->radix->change(addr, mask, combine_key(found + 1, lookup_key), set, level);
 	// The key returned by change is the combined key, we need only the _v key.
 	last_key = get_key(last_key);
     } else {
-	last_key = get_key(_default_key);
+	last_key = get_key(s->default_key);
 	if (!last_key || set)
-	    _default_key = combine_key(found + 1, lookup_key);
+	    s->default_key = combine_key(found + 1, lookup_key);
     }
 
     if (last_key && old_route)
@@ -225,9 +257,9 @@ RadixIPLookup::add_route(const IPRoute &route, bool set, IPRoute *old_route, Err
     if (last_key && !set)
 	return -EEXIST;
 
-    if (lookup_key == (_lookup.size() + 1)) {
+    if (lookup_key == (s->lookup.size() + 1)) {
 	GWPort gw_port = {route.gw, route.port};
-	_lookup.push_back(gw_port);
+	s->lookup.push_back(gw_port);
     }
 
     if (found == _v.size())
@@ -249,15 +281,16 @@ RadixIPLookup::add_route(const IPRoute &route, bool set, IPRoute *old_route, Err
 int
 RadixIPLookup::remove_route(const IPRoute& route, IPRoute* old_route, ErrorHandler*)
 {
+    State *s = _state.read();
     int last_key;
     if (route.mask) {
 	uint32_t addr = ntohl(route.addr.addr());
 	uint32_t mask = ntohl(route.mask.addr());
 	int level = 0;
 	// NB: this will never actually make changes
-	last_key = get_key(_radix->change(addr, mask, 0, false, level));
+	last_key = get_key(s->radix->change(addr, mask, 0, false, level));
     } else
-	last_key = get_key(_default_key);
+	last_key = get_key(s->default_key);
 
     if (last_key && old_route)
 	*old_route = _v[last_key - 1];
@@ -270,36 +303,98 @@ RadixIPLookup::remove_route(const IPRoute& route, IPRoute* old_route, ErrorHandl
 	uint32_t addr = ntohl(route.addr.addr());
 	uint32_t mask = ntohl(route.mask.addr());
 	int level = 0;
-	(void) _radix->change(addr, mask, 0, true, level);
+	(void) s->radix->change(addr, mask, 0, true, level);
     } else
-	_default_key = 0;
+	s->default_key = 0;
     return 0;
 }
 
 int
 RadixIPLookup::lookup_route(IPAddress addr, IPAddress &gw) const
 {
-    int level = 0;    
-    int key = Radix::lookup(_radix, _default_key, ntohl(addr.addr()), level);
+    int level = 0, flags, port;
+    const State *s = _state.read_begin(flags);
+    int key = Radix::lookup(s->radix, s->default_key, ntohl(addr.addr()), level);
     int lookup_key = get_lookup_key(key);
     if (lookup_key) {
-	gw = _lookup[lookup_key - 1].gw;
-	return _lookup[lookup_key - 1].port;
+	gw = s->lookup[lookup_key - 1].gw;
+	port = s->lookup[lookup_key - 1].port;
     } else {
 	gw = 0;
-	return -1;
+	port = -1;
+    }
+    _state.read_end(flags);
+    return port;
+}
+
+int
+RadixIPLookup::bulk_load(Vector<IPRoute> &routes, ErrorHandler *errh)
+{
+    int dups = sort_routes(routes);
+    State *s = new State;
+    if (!s->radix) {
+	delete s;
+	return errh->error("out of memory");
+    }
+    HashMap<uint64_t, int> lookup_map(0);
+
+    // shorter prefixes first, so each route only overwrites the keys of
+    // the routes it is more specific than
+    for (int i = 0; i < routes.size(); i++) {
+	IPRoute &route = routes[i];
+	uint64_t gw_port_key = ((uint64_t) route.gw.addr() << 32) | (uint32_t) route.port;
+	int &lookup_key = lookup_map.find_force(gw_port_key);
+	if (!lookup_key) {
+	    if (s->lookup.size() == 0xff) {
+		delete s;
+		return errh->error("too many distinct gateways and ports");
+	    }
+	    GWPort gw_port = {route.gw, route.port};
+	    s->lookup.push_back(gw_port);
+	    lookup_key = s->lookup.size();
+	}
+	int key = combine_key(i + 1, lookup_key);
+	if (route.mask) {
+	    int level = 0;
+	    s->radix->change(ntohl(route.addr.addr()), ntohl(route.mask.addr()), key, true, level);
+	} else
+	    s->default_key = key;
+	route.extra = -1;
+    }
+
+    replace(s);
+    _v.swap(routes);
+    _vfree = -1;
+
+    if (dups)
+	errh->warning("%d %s replaced by later versions", dups, dups > 1 ? "routes" : "route");
+    return 0;
+}
+
+void
+RadixIPLookup::replace(State *s)
+{
+    // Lookups read the trie through _state. The state replaced here is
+    // freed by the next replacement, once write_begin has waited out the
+    // lookups that may still use it.
+    int local;
+    State *&current = _state.write_begin(local);
+    delete _retired;
+    _retired = current;
+    current = s;
+    _state.write_commit(local);
+    if (!router()->initialized()) {
+	delete _retired;
+	_retired = 0;
     }
 }
 
 void
 RadixIPLookup::flush_table()
 {
-    int level = 0;
+    replace(new State);
     _v.clear();
-    Radix::free_radix(_radix, level);
-    _radix = Radix::make_radix(0);
     _vfree = -1;
-    _default_key = 0;
 }
 
 int
@@ -3,13 +3,14 @@
 #define CLICK_RADIXIPLOOKUP_HH
 #include <click/glue.hh>
 #include <click/element.hh>
+#include <click/multithread.hh>
 #include "iproutetable.hh"
 CLICK_DECLS
 
 /*
 =c
 
-RadixIPLookup(ADDR1/MASK1 [GW1] OUT1, ADDR2/MASK2 [GW2] OUT2, ...)
+RadixIPLookup(ADDR1/MASK1 [GW1] OUT1, ADDR2/MASK2 [GW2] OUT2, ..., I<keywords>)
 
 =s iproute
 
@@ -31,6 +32,17 @@ gateway IP address, and an output port.
 
 Uses the IPRouteTable interface; see IPRouteTable for description.
 
+Keyword arguments are:
+
+=over 8
+
+=item FILE
+
+Filename.  Load routes from this binary route file, as written by
+L<click-mkroutes(1)>, before adding the routes given as arguments.
+
+=back
+
 =h table read-only
 
 Outputs a human-readable version of the current routing table.
@@ -59,6 +71,16 @@ add a route, and `C<remove ADDR/MASK>' to remove a route. You can supply
 multiple commands, one per line; all commands are executed as one atomic
 operation.
 
+=h flush write-only
+
+Clears the entire routing table.
+
+=h load write-only
+
+Replaces the entire routing table with the routes in the named binary route
+file.  The new trie is built on the side and swapped in at once; if loading
+fails, the old table stays in place.
+
 =n
 
 See IPRouteTable for a performance comparison of the various IP routing
@@ -80,6 +102,7 @@ class RadixIPLookup : public IPRouteTable { public:
 
 
     void cleanup(CleanupStage) CLICK_COLD;
+    void take_state(Element *old, ErrorHandler *errh) CLICK_COLD;
     void add_handlers() CLICK_COLD;
 
     int add_route(const IPRoute&, bool, IPRoute*, ErrorHandler *);
@@ -87,6 +110,7 @@ class RadixIPLookup : public IPRouteTable { public:
     int lookup_route(IPAddress, IPAddress&) const;
     int find_lookup_key(IPAddress gw, int port);
     String dump_routes();
+    int bulk_load(Vector<IPRoute> &routes, ErrorHandler *errh);
 
   private:
 	struct GWPort {
@@ -118,12 +142,22 @@ class RadixIPLookup : public IPRouteTable { public:
     // Simple routing table
     Vector<IPRoute> _v;
     int _vfree;
-    
-    // Compressed routing table holding unique values of (gw, port).
-    Vector<GWPort> _lookup;
 
-    int _default_key;
-    Radix *_radix;
+    // the trie and what its keys refer to, as seen by lookups
+    struct State {
+	Radix *radix;
+	// Compressed routing table holding unique values of (gw, port).
+	Vector<GWPort> lookup;
+	int default_key;
+
+	State();
+	~State();
+    };
+
+    mutable fast_rcu<State *> _state;
+    State *_retired;		// freed by the next replace()
+
+    void replace(State *s);
 
 };
 
@@ -24,25 +24,24 @@
 #include <click/straccum.hh>
 #include <click/router.hh>
 #include <click/error.hh>
+#include <click/algorithm.hh>
 CLICK_DECLS
 
 RangeIPLookup::RangeIPLookup()
     : _range_base((uint32_t *) CLICK_LALLOC((1 << KICKSTART_BITS) * sizeof(uint32_t))),
       _range_len((uint32_t *) CLICK_LALLOC((1 << KICKSTART_BITS) * sizeof(uint32_t))),
       _range_t((uint32_t *) CLICK_LALLOC(RANGES_MAX * sizeof(uint32_t))),
-      _active(false)
+      _range_capacity(RANGES_MAX), _active(false),
+      _retired_base(0), _retired_len(0), _retired_t(0), _retired_capacity(0)
 {
-#if HAVE_BATCH
-    // TODO: Remove this when push_batch() will actually be implemented
-    in_batch_mode = BATCH_MODE_NO;
-#endif
 }
 
 RangeIPLookup::~RangeIPLookup()
 {
     CLICK_LFREE(_range_base, (1 << KICKSTART_BITS) * sizeof(uint32_t));
     CLICK_LFREE(_range_len, (1 << KICKSTART_BITS) * sizeof(uint32_t));
-    CLICK_LFREE(_range_t, RANGES_MAX * sizeof(uint32_t));
+    CLICK_LFREE(_range_t, _range_capacity * sizeof(uint32_t));
+    free_retired();
 }
 
 int
@@ -67,6 +66,21 @@ void
 RangeIPLookup::cleanup(CleanupStage)
 {
     _helper.cleanup();
+    free_retired();
+}
+
+void
+RangeIPLookup::take_state(Element *e, ErrorHandler *)
+{
+    RangeIPLookup *o = (RangeIPLookup *) e->cast("RangeIPLookup");
+    if (!o || !router()->hotswap_unchanged(this))
+	return;
+    click_swap(_range_base, o->_range_base);
+    click_swap(_range_len, o->_range_len);
+    click_swap(_range_t, o->_range_t);
+    click_swap(_range_capacity, o->_range_capacity);
+    _helper.swap(o->_helper);
+    publish();
 }
 
 void
@@ -99,16 +113,18 @@ RangeIPLookup::lookup_route(IPAddress dest, IPAddress &gw) const
     uint32_t i = ip_addr >> RANGE_SHIFT; // kickstart table index = MS bits
     uint16_t vport_i;
 
-    lowerbound = _range_base[i];
-    upperbound = lowerbound + _range_len[i];
+    int flags;
+    const Lookup &l = _lookup.read_begin(flags);
+    lowerbound = l.range_base[i];
+    upperbound = lowerbound + l.range_len[i];
     i = ip_addr & RANGE_MASK;		// Compare only masked LS bits
 
     // Binary search for a matching range
     while (upperbound > lowerbound) {
 	middle = (upperbound + lowerbound) >> 1;
-	if (i < (_range_t[middle] & RANGE_MASK))
+	if (i < (l.range_t[middle] & RANGE_MASK))
 	    upperbound = middle;
-	else if (i < (_range_t[middle + 1] & RANGE_MASK)) {
+	else if (i < (l.range_t[middle + 1] & RANGE_MASK)) {
 	    lowerbound = middle;
 	    break;
 	} else
@@ -116,9 +132,11 @@ RangeIPLookup::lookup_route(IPAddress dest, IPAddress &gw) const
     }
 
     // MS bits of the found range contain an index into the output port table
-    vport_i = _range_t[lowerbound] >> RANGE_SHIFT;
-    gw = _helper._vport[vport_i].gw;
-    return _helper._vport[vport_i].port;
+    vport_i = l.range_t[lowerbound] >> RANGE_SHIFT;
+    gw = l.vport[vport_i].gw;
+    int port = l.vport[vport_i].port;
+    _lookup.read_end(flags);
+    return port;
 }
 
 void
@@ -146,40 +164,37 @@ RangeIPLookup::remove_route(const IPRoute& route, IPRoute* old_route, ErrorHandl
     return error;
 }
 
-/*
- * On each routing table update, we distill the address range based lookup
- * table from the structures provided by the DirectIPLookup class.
- * The main cost of this operation is associated with traversing through
- * 32 + 16 = 48 MBytes of directiplookup tables.  We should implement a
- * more efficient method for updating range-based lookup structures in
- * the future, which would not depend on huge directiplookup tables.
- */
-void
-RangeIPLookup::expand()
+uint32_t
+RangeIPLookup::expand(const DirectIPLookup::Table &t, uint32_t *range_base_t,
+		      uint32_t *range_len_t, uint32_t *range_t,
+		      uint32_t range_capacity)
 {
     uint32_t range_t_index = 0;
     uint32_t tbl_0_23_index = 0;
     uint32_t range_base;
     uint32_t range_len;
 
+    // Count ranges past RANGE_CAPACITY without storing them, so the caller
+    // can retry with a bigger table.
     for (range_base = 0; range_base < (1 << KICKSTART_BITS); range_base++) {
 	uint16_t vport_i, vport_i1;
 
 	vport_i = 0xffff;       // Duh!
-	_range_base[range_base] = range_t_index;
+	range_base_t[range_base] = range_t_index;
 
 	for (range_len = 0;
 	  tbl_0_23_index < ((range_base + 1) << (24 - KICKSTART_BITS));
 	  tbl_0_23_index++) {
-	    if (_helper._tbl_0_23[tbl_0_23_index] & 0x8000) {
+	    if (t._tbl_0_23[tbl_0_23_index] & 0x8000) {
 		uint32_t tbl_24_31_index, j;
 		tbl_24_31_index =
-			(_helper._tbl_0_23[tbl_0_23_index] & 0x7fff) << 8;
+			(t._tbl_0_23[tbl_0_23_index] & 0x7fff) << 8;
 		for (j = 0; j < 256; j++) {
-		    vport_i1 = _helper._tbl_24_31[tbl_24_31_index + j];
+		    vport_i1 = t._tbl_24_31[tbl_24_31_index + j];
 		    if (vport_i != vport_i1) {
 			vport_i = vport_i1;
-			_range_t[range_t_index] =
+			if (range_t_index < range_capacity)
+			    range_t[range_t_index] =
 					vport_i << (32 - KICKSTART_BITS) |
 					(((tbl_0_23_index << 8) + j) &
 					(0xffffffff >> KICKSTART_BITS));
@@ -188,10 +203,11 @@ RangeIPLookup::expand()
 		    }
 		}
 	    } else {
-		vport_i1 = _helper._tbl_0_23[tbl_0_23_index];
+		vport_i1 = t._tbl_0_23[tbl_0_23_index];
 		if (vport_i != vport_i1) {
 		    vport_i = vport_i1;
-		    _range_t[range_t_index] =
+		    if (range_t_index < range_capacity)
+			range_t[range_t_index] =
 					vport_i << (32 - KICKSTART_BITS) |
 					((tbl_0_23_index << 8) &
 					(0xffffffff >> KICKSTART_BITS));
@@ -200,23 +216,134 @@ RangeIPLookup::expand()
 		}
 	    }
 	}
-	_range_len[range_base] = range_len - 1;
+	range_len_t[range_base] = range_len - 1;
+    }
+
+    return range_t_index;
+}
+
+/*
+ * On each routing table update, we distill the address range based lookup
+ * table from the structures provided by the DirectIPLookup class.
+ * The main cost of this operation is associated with traversing through
+ * 32 + 16 = 48 MBytes of directiplookup tables.  We should implement a
+ * more efficient method for updating range-based lookup structures in
+ * the future, which would not depend on huge directiplookup tables.
+ */
+void
+RangeIPLookup::expand()
+{
+    uint32_t n = expand(_helper, _range_base, _range_len, _range_t, _range_capacity);
+    if (n > _range_capacity) {
+	uint32_t capacity = _range_capacity;
+	while (capacity < n)
+	    capacity *= 2;
+	uint32_t *range_t = (uint32_t *) CLICK_LALLOC(capacity * sizeof(uint32_t));
+	if (!range_t) {
+	    click_chatter("%p{element}: out of memory for %u ranges", this, n);
+	    return;
+	}
+	memset(range_t, 0, capacity * sizeof(uint32_t));
+	n = expand(_helper, _range_base, _range_len, range_t, capacity);
+	CLICK_LFREE(_range_t, _range_capacity * sizeof(uint32_t));
+	_range_t = range_t;
+	_range_capacity = capacity;
     }
+    publish();
 
 #ifdef RANGEIPLOOKUP_VERBOSE
     click_chatter("Range expansion done: %d ranges using %d + %d bytes",
-		  range_t_index, sizeof(_range_base) + sizeof(_range_len),
-		  range_t_index * sizeof(uint32_t));
+		  n, 2 * (1 << KICKSTART_BITS) * sizeof(uint32_t),
+		  n * sizeof(uint32_t));
 #endif
 }
 
+int
+RangeIPLookup::bulk_load(Vector<IPRoute> &routes, ErrorHandler *errh)
+{
+    int dups = sort_routes(routes);
+    DirectIPLookup::Table helper;
+    if (helper.build(routes, _load_threads, errh) < 0)
+	return -ENOMEM;
+
+    uint32_t *range_base = (uint32_t *) CLICK_LALLOC((1 << KICKSTART_BITS) * sizeof(uint32_t));
+    uint32_t *range_len = (uint32_t *) CLICK_LALLOC((1 << KICKSTART_BITS) * sizeof(uint32_t));
+    uint32_t n = 0, capacity = 0;
+    uint32_t *range_t = 0;
+    if (range_base && range_len) {
+	n = expand(helper, range_base, range_len, 0, 0);
+	capacity = (n > RANGES_MAX ? n : (uint32_t) RANGES_MAX);
+	range_t = (uint32_t *) CLICK_LALLOC(capacity * sizeof(uint32_t));
+    }
+    if (!range_t) {
+	CLICK_LFREE(range_base, (1 << KICKSTART_BITS) * sizeof(uint32_t));
+	CLICK_LFREE(range_len, (1 << KICKSTART_BITS) * sizeof(uint32_t));
+	return errh->error("out of memory");
+    }
+    memset(range_t, 0, capacity * sizeof(uint32_t));
+    expand(helper, range_base, range_len, range_t, capacity);
+
+    // Lookups read the tables through _lookup. The tables replaced here are
+    // freed by the next load, once write_begin has waited out the lookups
+    // that may still use them.
+    int local;
+    Lookup &l = _lookup.write_begin(local);
+    free_retired();
+    _retired_base = _range_base;
+    _retired_len = _range_len;
+    _retired_t = _range_t;
+    _retired_capacity = _range_capacity;
+    _range_base = range_base;
+    _range_len = range_len;
+    _range_t = range_t;
+    _range_capacity = capacity;
+    _helper.swap(helper);
+    _retired_helper.swap(helper);
+    l.range_base = _range_base;
+    l.range_len = _range_len;
+    l.range_t = _range_t;
+    l.vport = _helper._vport;
+    _lookup.write_commit(local);
+    if (!router()->initialized())
+	free_retired();
+
+    if (dups)
+	errh->warning("%d %s replaced by later versions", dups, dups > 1 ? "routes" : "route");
+    return 0;
+}
+
+void
+RangeIPLookup::free_retired()
+{
+    if (_retired_t) {
+	CLICK_LFREE(_retired_base, (1 << KICKSTART_BITS) * sizeof(uint32_t));
+	CLICK_LFREE(_retired_len, (1 << KICKSTART_BITS) * sizeof(uint32_t));
+	CLICK_LFREE(_retired_t, _retired_capacity * sizeof(uint32_t));
+	_retired_base = _retired_len = _retired_t = 0;
+    }
+    _retired_helper.cleanup();
+}
+
 void
 RangeIPLookup::flush_table()
 {
     _helper.flush();
     memset(_range_base, 0, (1 << KICKSTART_BITS) * sizeof(*_range_base));
     memset(_range_len, 0, (1 << KICKSTART_BITS) * sizeof(*_range_len));
-    memset(_range_t, 0, RANGES_MAX * sizeof(*_range_t));
+    memset(_range_t, 0, _range_capacity * sizeof(*_range_t));
+    publish();
+}
+
+void
+RangeIPLookup::publish()
+{
+    int local;
+    Lookup &l = _lookup.write_begin(local);
+    l.range_base = _range_base;
+    l.range_len = _range_len;
+    l.range_t = _range_t;
+    l.vport = _helper._vport;
+    _lookup.write_commit(local);
 }
 
 int
@@ -8,7 +8,7 @@ CLICK_DECLS
 /*
 =c
 
-RangeIPLookup(ADDR1/MASK1 [GW1] OUT1, ADDR2/MASK2 [GW2] OUT2, ...)
+RangeIPLookup(ADDR1/MASK1 [GW1] OUT1, ADDR2/MASK2 [GW2] OUT2, ..., I<keywords>)
 
 =s iproute
 
@@ -38,6 +38,22 @@ RangeIPLookup maintains a large DirectIPLookup table as well as its own
 tables.  Although this subsidiary table is only accessed during route updates,
 it significantly adds to RangeIPLookup's total memory footprint.
 
+Keyword arguments are:
+
+=over 8
+
+=item FILE
+
+Filename.  Load routes from this binary route file, as written by
+L<click-mkroutes(1)>, before adding the routes given as arguments.
+
+=item LOAD_THREADS
+
+Integer.  Number of threads used to fill the subsidiary DirectIPLookup table
+when loading a route file.  Default is the number of Click threads.
+
+=back
+
 =h table read-only
 
 Outputs a human-readable version of the current routing table.
@@ -70,6 +86,13 @@ operation.
 
 Clears the entire routing table in a single atomic operation.
 
+=h load write-only
+
+Replaces the entire routing table with the routes in the named binary route
+file.  Both tables are built on the side and swapped in at once; if loading
+fails, the old table stays in place.  The old tables are freed at the next
+load, once no thread can still be looking up in them.
+
 =n
 
 See IPRouteTable for a performance comparison of the various IP routing
@@ -92,6 +115,7 @@ class RangeIPLookup : public IPRouteTable { public:
     int configure(Vector<String> &conf, ErrorHandler *errh) CLICK_COLD;
     int initialize(ErrorHandler *errh) CLICK_COLD;
     void cleanup(CleanupStage) CLICK_COLD;
+    void take_state(Element *old, ErrorHandler *errh) CLICK_COLD;
     void add_handlers() CLICK_COLD;
     void push(int port, Packet* p);
 
@@ -99,6 +123,7 @@ class RangeIPLookup : public IPRouteTable { public:
     int remove_route(const IPRoute&, IPRoute*, ErrorHandler *);
     int lookup_route(IPAddress, IPAddress&) const;
     String dump_routes();
+    int bulk_load(Vector<IPRoute> &routes, ErrorHandler *errh);
 
     static int flush_handler(const String &, Element *, void *, ErrorHandler *);
 
@@ -106,6 +131,11 @@ class RangeIPLookup : public IPRouteTable { public:
 
     void flush_table();
     void expand();
+    static uint32_t expand(const DirectIPLookup::Table &t, uint32_t *range_base,
+			   uint32_t *range_len, uint32_t *range_t,
+			   uint32_t range_capacity);
+    void free_retired();
+    void publish();
 
     enum { KICKSTART_BITS = 12 };
     enum { RANGES_MAX = 256 * 1024 };
@@ -115,10 +145,28 @@ class RangeIPLookup : public IPRouteTable { public:
     uint32_t *_range_base;
     uint32_t *_range_len;
     uint32_t *_range_t;
+    uint32_t _range_capacity;
     bool _active;
 
     DirectIPLookup::Table _helper;
 
+    // the range tables and _helper's ports, as seen by lookups
+    struct Lookup {
+	const uint32_t *range_base;
+	const uint32_t *range_len;
+	const uint32_t *range_t;
+	const DirectIPLookup::VirtualPort *vport;
+    };
+    mutable fast_rcu<Lookup> _lookup;
+
+    // replaced by the last bulk_load(), freed by the next one once
+    // _lookup.write_begin() has waited out the lookups using them
+    uint32_t *_retired_base;
+    uint32_t *_retired_len;
+    uint32_t *_retired_t;
+    uint32_t _retired_capacity;
+    DirectIPLookup::Table _retired_helper;
+
 };
 
 CLICK_ENDDECLS
@@ -61,7 +61,7 @@ SetIPChecksum::simple_action(Packet *p_in)
 PacketBatch *
 SetIPChecksum::simple_action_batch(PacketBatch *batch)
 {
-    EXECUTE_FOR_EACH_PACKET_DROPPABLE(SetIPChecksum::simple_action, batch, [](Packet *){});
+    EXECUTE_FOR_EACH_PACKET_DROPPABLE_PREFETCH(SetIPChecksum::simple_action, batch, [](Packet *){}, batch_prefetch_distance());
     return batch;
 }
 #endif
@@ -0,0 +1,395 @@
+// -*- c-basic-offset: 4 -*-
+/*
+ * ip64translator.{cc,hh} -- IPv6/IPv4 header translation for NAT64 and SIIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Click LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Click LICENSE file; the license in that file is
+ * legally binding.
+ */
+
+#include <click/config.h>
+#include "ip64translator.hh"
+#include <click/error.hh>
+#include <click/straccum.hh>
+#include <clicknet/ip.h>
+#include <clicknet/ip6.h>
+#include <clicknet/icmp.h>
+#include <clicknet/icmp6.h>
+#include <clicknet/tcp.h>
+#include <clicknet/udp.h>
+CLICK_DECLS
+
+// Translated packets of at most this many bytes leave without DF, so IPv4
+// routers may fragment them (RFC 7915 section 5.1).
+#define IP64_MAX_UNFRAGMENTED	1260
+
+static inline uint32_t
+sum16(const void *data, int len)
+{
+    const uint16_t *w = reinterpret_cast<const uint16_t *>(data);
+    uint32_t sum = 0;
+    for (; len > 0; len -= 2)
+	sum += *w++;
+    return sum;
+}
+
+static inline uint32_t
+sum32(uint32_t x)
+{
+    return (x & 0xFFFF) + (x >> 16);
+}
+
+// RFC 1624 eqn. 3: HC' = ~(~HC + ~m + m'), where m and m' are the one's
+// complement sums of the old and new words.
+static inline uint16_t
+cksum_adjust(uint16_t cksum, uint32_t sub, uint32_t add)
+{
+    sub = (sub & 0xFFFF) + (sub >> 16);
+    sub = (sub & 0xFFFF) + (sub >> 16);
+    uint32_t sum = (uint16_t) ~cksum + (uint16_t) ~sub + add;
+    sum = (sum & 0xFFFF) + (sum >> 16);
+    sum = (sum & 0xFFFF) + (sum >> 16);
+    return ~sum;
+}
+
+static inline int
+cksum_offset(int proto)
+{
+    if (proto == IP_PROTO_TCP)
+	return 16;
+    else if (proto == IP_PROTO_UDP)
+	return 6;
+    else
+	return 2;
+}
+
+static inline int
+transport_min(int proto)
+{
+    return proto == IP_PROTO_TCP ? sizeof(click_tcp) : 8;
+}
+
+IP64Translator::IP64Translator()
+    : _prefix_len(96)
+{
+    _prefix.data32()[0] = htonl(0x0064FF9BU);	// RFC 6052 well-known prefix
+}
+
+int
+IP64Translator::set_prefix(const IP6Address &prefix, int prefix_len,
+			   ErrorHandler *errh)
+{
+    if (prefix_len != 32 && prefix_len != 40 && prefix_len != 48
+	&& prefix_len != 56 && prefix_len != 64 && prefix_len != 96)
+	return errh->error("prefix length must be 32, 40, 48, 56, 64, or 96");
+    _prefix = prefix;
+    _prefix &= IP6Address::make_prefix(prefix_len);
+    _prefix_len = prefix_len;
+    return 0;
+}
+
+String
+IP64Translator::unparse_prefix() const
+{
+    StringAccum sa;
+    sa << _prefix << '/' << _prefix_len;
+    return sa.take_string();
+}
+
+IP6Address
+IP64Translator::embed(IPAddress a) const
+{
+    IP6Address result = _prefix;
+    const unsigned char *x = a.data();
+    unsigned char *y = result.data();
+    // RFC 6052 section 2.2: bits 64-71 stay zero
+    for (int i = 0, pos = _prefix_len / 8; i < 4; ++i, ++pos) {
+	if (pos == 8)
+	    ++pos;
+	y[pos] = x[i];
+    }
+    return result;
+}
+
+bool
+IP64Translator::extract(const IP6Address &a, IPAddress &result) const
+{
+    const unsigned char *x = a.data();
+    if (memcmp(x, _prefix.data(), _prefix_len / 8) != 0)
+	return false;
+    unsigned char *y = result.data();
+    for (int i = 0, pos = _prefix_len / 8; i < 4; ++i, ++pos) {
+	if (pos == 8)
+	    ++pos;
+	y[i] = x[pos];
+    }
+    return true;
+}
+
+bool
+IP64Translator::inspect6(const Packet *p, Transport &t)
+{
+    if (!p->has_network_header()
+	|| p->network_length() < (int) sizeof(click_ip6))
+	return false;
+    const click_ip6 *ip6h = p->ip6_header();
+    unsigned plen = ntohs(ip6h->ip6_plen);
+    if (ip6h->ip6_v != 6 || ip6h->ip6_hlim <= 1
+	|| plen > p->network_length() - sizeof(click_ip6))
+	return false;
+
+    int proto = ip6h->ip6_nxt;
+    if (proto != IP_PROTO_TCP && proto != IP_PROTO_UDP
+	&& proto != IP_PROTO_ICMP6)
+	return false;
+    if (plen < (unsigned) transport_min(proto))
+	return false;
+
+    const unsigned char *th = reinterpret_cast<const unsigned char *>(ip6h + 1);
+    t.tcp_flags = 0;
+    if (proto == IP_PROTO_ICMP6) {
+	const click_icmp_sequenced *icmph = reinterpret_cast<const click_icmp_sequenced *>(th);
+	if (icmph->icmp_type != ICMP6_ECHO && icmph->icmp_type != ICMP6_ECHOREPLY)
+	    return false;
+	t.proto = IP_PROTO_ICMP;
+	t.sport = icmph->icmp_identifier;
+	t.dport = 0;
+    } else {
+	const click_udp *udph = reinterpret_cast<const click_udp *>(th);
+	// IPv6 requires UDP checksums, and a zero one cannot be adjusted
+	if (proto == IP_PROTO_UDP && udph->uh_sum == 0)
+	    return false;
+	if (proto == IP_PROTO_TCP) {
+	    const click_tcp *tcph = reinterpret_cast<const click_tcp *>(th);
+	    if (plen < (unsigned) (tcph->th_off << 2))
+		return false;
+	    t.tcp_flags = tcph->th_flags;
+	}
+	t.proto = proto;
+	t.sport = udph->uh_sport;
+	t.dport = udph->uh_dport;
+    }
+    return true;
+}
+
+bool
+IP64Translator::inspect4(const Packet *p, Transport &t)
+{
+    if (!p->has_network_header()
+	|| p->network_length() < (int) sizeof(click_ip))
+	return false;
+    const click_ip *iph = p->ip_header();
+    unsigned hl = iph->ip_hl << 2, len = ntohs(iph->ip_len);
+    if (iph->ip_v != 4 || hl < sizeof(click_ip) || iph->ip_ttl <= 1
+	|| IP_ISFRAG(iph) || len < hl
+	|| len > (unsigned) p->network_length())
+	return false;
+
+    int proto = iph->ip_p;
+    if (proto != IP_PROTO_TCP && proto != IP_PROTO_UDP
+	&& proto != IP_PROTO_ICMP)
+	return false;
+    if (len - hl < (unsigned) transport_min(proto))
+	return false;
+
+    const unsigned char *th = reinterpret_cast<const unsigned char *>(iph) + hl;
+    t.proto = proto;
+    t.tcp_flags = 0;
+    if (proto == IP_PROTO_ICMP) {
+	const click_icmp_sequenced *icmph = reinterpret_cast<const click_icmp_sequenced *>(th);
+	if (icmph->icmp_type != ICMP_ECHO && icmph->icmp_type != ICMP_ECHOREPLY)
+	    return false;
+	t.sport = 0;
+	t.dport = icmph->icmp_identifier;
+    } else {
+	if (proto == IP_PROTO_TCP) {
+	    const click_tcp *tcph = reinterpret_cast<const click_tcp *>(th);
+	    if (len - hl < (unsigned) (tcph->th_off << 2))
+		return false;
+	    t.tcp_flags = tcph->th_flags;
+	}
+	const click_udp *udph = reinterpret_cast<const click_udp *>(th);
+	t.sport = udph->uh_sport;
+	t.dport = udph->uh_dport;
+    }
+    return true;
+}
+
+WritablePacket *
+IP64Translator::translate64(Packet *p_in, IPAddress src, IPAddress dst,
+			    uint16_t sport, uint16_t dport, uint16_t ip_id)
+{
+    WritablePacket *p = p_in->uniqueify();
+    if (!p)
+	return 0;
+
+    click_ip6 *ip6h = p->ip6_header();
+    unsigned plen = ntohs(ip6h->ip6_plen);
+    unsigned end = p->network_header_offset() + sizeof(click_ip6) + plen;
+    if (p->length() > end)
+	p->take(p->length() - end);
+
+    // fix the transport checksum while the IPv6 header is intact
+    unsigned char *th = reinterpret_cast<unsigned char *>(ip6h + 1);
+    uint16_t *w = reinterpret_cast<uint16_t *>(th);
+    int proto = ip6h->ip6_nxt;
+    uint32_t oldsum = sum16(&ip6h->ip6_src, 32);
+    uint32_t newsum;
+    if (proto == IP_PROTO_ICMP6) {
+	// ICMPv6 covers a pseudo-header; ICMP does not
+	oldsum += sum32(htonl(plen)) + htons(IP_PROTO_ICMP6) + w[0];
+	th[0] = (th[0] == ICMP6_ECHO ? ICMP_ECHO : ICMP_ECHOREPLY);
+	newsum = w[0];
+	if (sport) {
+	    oldsum += w[2];
+	    newsum += sport;
+	    w[2] = sport;
+	}
+	proto = IP_PROTO_ICMP;
+    } else {
+	newsum = sum32(src.addr()) + sum32(dst.addr());
+	if (sport) {
+	    oldsum += w[0];
+	    newsum += sport;
+	    w[0] = sport;
+	}
+	if (dport) {
+	    oldsum += w[1];
+	    newsum += dport;
+	    w[1] = dport;
+	}
+    }
+    uint16_t *cksum = reinterpret_cast<uint16_t *>(th + cksum_offset(proto));
+    *cksum = cksum_adjust(*cksum, oldsum, newsum);
+    if (proto == IP_PROTO_UDP && *cksum == 0)
+	*cksum = 0xFFFF;
+
+    // the IPv4 header overlaps the end of the IPv6 header
+    uint32_t flow = ntohl(ip6h->ip6_flow);
+    uint8_t hlim = ip6h->ip6_hlim;
+    click_ip *iph = reinterpret_cast<click_ip *>(th) - 1;
+    iph->ip_v = 4;
+    iph->ip_hl = sizeof(click_ip) >> 2;
+    iph->ip_tos = (flow & IP6_CLASS_MASK) >> IP6_CLASS_SHIFT;
+    iph->ip_len = htons(plen + sizeof(click_ip));
+    if (plen + sizeof(click_ip) <= IP64_MAX_UNFRAGMENTED) {
+	iph->ip_id = htons(ip_id);
+	iph->ip_off = 0;
+    } else {
+	iph->ip_id = 0;
+	iph->ip_off = htons(IP_DF);
+    }
+    iph->ip_ttl = hlim - 1;
+    iph->ip_p = proto;
+    iph->ip_src = src.in_addr();
+    iph->ip_dst = dst.in_addr();
+    iph->ip_sum = 0;
+    iph->ip_sum = click_in_cksum(reinterpret_cast<unsigned char *>(iph), sizeof(click_ip));
+
+    const int delta = sizeof(click_ip6) - sizeof(click_ip);
+    if (int before = p->network_header_offset()) {
+	memmove(p->data() + delta, p->data(), before);
+	if (p->has_mac_header())
+	    p->set_mac_header(p->mac_header() + delta);
+    }
+    p->pull(delta);
+    p->set_ip_header(iph, sizeof(click_ip));
+    p->set_dst_ip_anno(dst);
+    return p;
+}
+
+WritablePacket *
+IP64Translator::translate46(Packet *p_in, const IP6Address &src,
+			    const IP6Address &dst, uint16_t sport,
+			    uint16_t dport)
+{
+    unsigned hl = p_in->ip_header()->ip_hl << 2;
+    unsigned len = ntohs(p_in->ip_header()->ip_len);
+    unsigned end = p_in->network_header_offset() + len;
+    if (p_in->length() > end)
+	p_in->take(p_in->length() - end);
+
+    // options are dropped, so the headers grow by 20 bytes or less
+    int delta = sizeof(click_ip6) - hl;
+    WritablePacket *p;
+    if (delta > 0)
+	p = p_in->push(delta);
+    else
+	p = p_in->uniqueify();
+    if (!p)
+	return 0;
+
+    click_ip *iph = p->ip_header();
+    unsigned char *th = reinterpret_cast<unsigned char *>(iph) + hl;
+    uint16_t *w = reinterpret_cast<uint16_t *>(th);
+    unsigned tlen = len - hl;
+    int proto = iph->ip_p;
+    uint32_t addrsum = sum16(src.data(), 16) + sum16(dst.data(), 16);
+    uint32_t oldsum, newsum;
+    if (proto == IP_PROTO_ICMP) {
+	oldsum = w[0];
+	th[0] = (th[0] == ICMP_ECHO ? ICMP6_ECHO : ICMP6_ECHOREPLY);
+	newsum = w[0] + addrsum + sum32(htonl(tlen)) + htons(IP_PROTO_ICMP6);
+	if (dport) {
+	    oldsum += w[2];
+	    newsum += dport;
+	    w[2] = dport;
+	}
+    } else {
+	oldsum = sum32(iph->ip_src.s_addr) + sum32(iph->ip_dst.s_addr);
+	newsum = addrsum;
+	if (sport) {
+	    oldsum += w[0];
+	    newsum += sport;
+	    w[0] = sport;
+	}
+	if (dport) {
+	    oldsum += w[1];
+	    newsum += dport;
+	    w[1] = dport;
+	}
+    }
+    uint16_t *cksum = reinterpret_cast<uint16_t *>(th + cksum_offset(proto));
+    if (proto == IP_PROTO_UDP && *cksum == 0) {
+	// IPv6 requires a UDP checksum (RFC 7915 section 4.5)
+	*cksum = cksum_adjust(click_in_cksum(th, tlen), 0,
+			      addrsum + sum32(htonl(tlen)) + htons(IP_PROTO_UDP));
+	if (*cksum == 0)
+	    *cksum = 0xFFFF;
+    } else {
+	*cksum = cksum_adjust(*cksum, oldsum, newsum);
+	if (proto == IP_PROTO_UDP && *cksum == 0)
+	    *cksum = 0xFFFF;
+    }
+
+    uint8_t tos = iph->ip_tos, ttl = iph->ip_ttl;
+    click_ip6 *ip6h = reinterpret_cast<click_ip6 *>(th) - 1;
+    if (int before = p->network_header_offset()) {
+	memmove(reinterpret_cast<unsigned char *>(ip6h) - before,
+		reinterpret_cast<unsigned char *>(iph) - before, before);
+	if (p->has_mac_header())
+	    p->set_mac_header(p->mac_header() - delta);
+    }
+    ip6h->ip6_flow = htonl((6 << IP6_V_SHIFT) | (tos << IP6_CLASS_SHIFT));
+    ip6h->ip6_plen = htons(tlen);
+    ip6h->ip6_nxt = (proto == IP_PROTO_ICMP ? IP_PROTO_ICMP6 : proto);
+    ip6h->ip6_hlim = ttl - 1;
+    ip6h->ip6_src = src.in6_addr();
+    ip6h->ip6_dst = dst.in6_addr();
+
+    if (delta < 0)
+	p->pull(-delta);
+    p->set_ip6_header(ip6h, sizeof(click_ip6));
+    SET_DST_IP6_ANNO(p, dst);
+    return p;
+}
+
+CLICK_ENDDECLS
+ELEMENT_REQUIRES(ip6)
+ELEMENT_PROVIDES(IP64Translator)
@@ -0,0 +1,93 @@
+// -*- c-basic-offset: 4 -*-
+#ifndef CLICK_IP64TRANSLATOR_HH
+#define CLICK_IP64TRANSLATOR_HH
+#include <click/ip6address.hh>
+#include <click/ipaddress.hh>
+#include <click/packet.hh>
+CLICK_DECLS
+class ErrorHandler;
+
+/** @class IP64Translator
+ * @brief Helper class for NAT64 and SIIT: IPv6/IPv4 header translation.
+ *
+ * Translates TCP, UDP, and ICMP echo packets between IPv6 and IPv4 as in
+ * RFC 7915, and maps IPv4 addresses into an IPv6 prefix as in RFC 6052.
+ * Packets are rewritten in place: the IPv6-to-IPv4 direction pulls 20 bytes
+ * off the front of the packet, and the IPv4-to-IPv6 direction pushes 20
+ * bytes into the headroom, copying the packet only when it is shared or has
+ * no headroom left. Transport checksums are adjusted incrementally, never
+ * recomputed, except for IPv4 UDP packets without a checksum. Bytes before
+ * the network header, such as a link-level header, are preserved. */
+class IP64Translator { public:
+
+    IP64Translator();
+
+    /** @brief Set the RFC 6052 prefix.
+     * @return 0 on success, or a negative error after reporting to @a errh
+     *
+     * @a prefix_len must be 32, 40, 48, 56, 64, or 96. */
+    int set_prefix(const IP6Address &prefix, int prefix_len,
+		   ErrorHandler *errh);
+    String unparse_prefix() const;
+
+    /** @brief Return the IPv6 address embedding @a a in the prefix. */
+    IP6Address embed(IPAddress a) const;
+    /** @brief Extract the IPv4 address embedded in @a a.
+     * @return false if @a a is not in the prefix */
+    bool extract(const IP6Address &a, IPAddress &result) const;
+
+    /** @brief Transport identifiers of a translatable packet.
+     *
+     * For ICMP echo messages the identifier stands in for the port of the
+     * IPv6 host: it is @a sport in IPv6 packets and @a dport in IPv4
+     * packets, and the other port is 0. */
+    struct Transport {
+	uint8_t proto;		// IPv4 protocol number
+	uint8_t tcp_flags;
+	uint16_t sport;		// network byte order
+	uint16_t dport;
+    };
+
+    /** @brief Check that @a p, an IPv6 packet with a network header, can be
+     * translated, and return its transport identifiers in @a t.
+     *
+     * Packets with extension headers, ICMPv6 messages other than echo
+     * requests and replies, truncated packets, and packets whose hop limit
+     * would expire are not translatable. */
+    static bool inspect6(const Packet *p, Transport &t);
+    /** @brief Check that @a p, an IPv4 packet with a network header, can be
+     * translated, and return its transport identifiers in @a t.
+     *
+     * Fragments, ICMP messages other than echo requests and replies,
+     * truncated packets, and packets whose TTL would expire are not
+     * translatable. */
+    static bool inspect4(const Packet *p, Transport &t);
+
+    /** @brief Translate @a p, which passed inspect6(), to IPv4.
+     * @param src, dst new addresses
+     * @param sport, dport new ports in network byte order, or 0 to keep
+     * @param ip_id IP ID used when the result may be fragmented
+     * @return the translated packet, or null if memory ran out
+     *
+     * The result has its IP header annotation and destination IP address
+     * annotation set. */
+    static WritablePacket *translate64(Packet *p, IPAddress src, IPAddress dst,
+				       uint16_t sport, uint16_t dport,
+				       uint16_t ip_id);
+    /** @brief Translate @a p, which passed inspect4(), to IPv6.
+     *
+     * Arguments as for translate64(). The result has its IPv6 header
+     * annotation and destination IPv6 address annotation set. */
+    static WritablePacket *translate46(Packet *p, const IP6Address &src,
+				       const IP6Address &dst,
+				       uint16_t sport, uint16_t dport);
+
+  private:
+
+    IP6Address _prefix;
+    int _prefix_len;
+
+};
+
+CLICK_ENDDECLS
+#endif
@@ -0,0 +1,564 @@
+// -*- c-basic-offset: 4 -*-
+/*
+ * nat64.{cc,hh} -- stateful IPv6-to-IPv4 translator
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Click LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Click LICENSE file; the license in that file is
+ * legally binding.
+ */
+
+#include <click/config.h>
+#include "nat64.hh"
+#include "elements/ip/iprwpattern.hh"
+#include <click/args.hh>
+#include <click/error.hh>
+#include <click/straccum.hh>
+#include <click/integers.hh>
+#include <clicknet/ip.h>
+#include <clicknet/ip6.h>
+#include <clicknet/tcp.h>
+CLICK_DECLS
+
+NAT64::NAT64()
+    : _free_blocks(-1), _max_sessions(65536), _thread_sessions(65536),
+      _tcp_timeout(7440), _tcp_trans_timeout(240), _udp_timeout(300),
+      _icmp_timeout(60), _port_block(64)
+{
+}
+
+NAT64::~NAT64()
+{
+}
+
+int
+NAT64::configure(Vector<String> &conf, ErrorHandler *errh)
+{
+    IP6Address prefix;
+    int prefix_len = -1;
+    Vector<String> pools;
+    uint32_t max_sessions = 65536, port_block = 64;
+    uint32_t tcp_timeout = 7440, tcp_trans_timeout = 240;
+    uint32_t udp_timeout = 300, icmp_timeout = 60;
+    if (Args(conf, this, errh)
+	.read("PREFIX", IP6PrefixArg(), prefix, prefix_len)
+	.read_all("POOL", AnyArg(), pools)
+	.read("MAX_SESSIONS", max_sessions)
+	.read("PORT_BLOCK", port_block)
+	.read("TCP_TIMEOUT", SecondsArg(), tcp_timeout)
+	.read("TCP_TRANS_TIMEOUT", SecondsArg(), tcp_trans_timeout)
+	.read("UDP_TIMEOUT", SecondsArg(), udp_timeout)
+	.read("ICMP_TIMEOUT", SecondsArg(), icmp_timeout)
+	.complete() < 0)
+	return -1;
+
+    if (prefix_len >= 0 && _xlate.set_prefix(prefix, prefix_len, errh) < 0)
+	return -1;
+    if (pools.empty())
+	return errh->error("POOL required");
+    if (max_sessions == 0)
+	return errh->error("MAX_SESSIONS must be positive");
+    if (port_block < 1 || port_block > 64)
+	return errh->error("PORT_BLOCK must be between 1 and 64");
+    if (tcp_timeout == 0 || tcp_trans_timeout == 0 || udp_timeout == 0
+	|| icmp_timeout == 0)
+	return errh->error("timeouts must be positive");
+
+    _port_block = port_block;
+    for (int i = 0; i < pools.size(); ++i) {
+	Vector<String> words;
+	cp_spacevec(pools[i], words);
+	IPRewriterPattern *pattern;
+	PrefixErrorHandler perrh(errh, "POOL: ");
+	if (!IPRewriterPattern::parse(words, &pattern, this, &perrh))
+	    return -1;
+	pattern->use();
+	_patterns.push_back(pattern);
+	if (!pattern->is_napt() || !pattern->saddr() || !pattern->sport()
+	    || pattern->daddr() || pattern->dport())
+	    return errh->error("POOL must look like %<SADDR SPORT[-SPORT2] - -%>");
+
+	Pool pool;
+	pool.addr = pattern->saddr();
+	pool.first = ntohs(pattern->sport());
+	pool.last = pool.first + pattern->variation_top();
+	pool.first_block = _blocks.size();
+	for (int j = 0; j < _pools.size(); ++j)
+	    if (_pools[j].addr == pool.addr && _pools[j].first <= pool.last
+		&& pool.first <= _pools[j].last)
+		return errh->error("POOL %d overlaps POOL %d", i + 1, j + 1);
+	_pools.push_back(pool);
+
+	for (uint32_t port = pool.first; port <= pool.last; port += port_block) {
+	    PortBlock b;
+	    b.addr = pool.addr;
+	    b.base = port;
+	    b.size = (pool.last - port + 1 < port_block ? pool.last - port + 1 : port_block);
+	    b.owner = -1;
+	    b.used = 0;
+	    b.map = 0;
+	    b.prev = -1;
+	    b.next = -1;
+	    b.listed = false;
+	    _blocks.push_back(b);
+	}
+    }
+
+    _max_sessions = max_sessions;
+    _tcp_timeout = tcp_timeout;
+    _tcp_trans_timeout = tcp_trans_timeout;
+    _udp_timeout = udp_timeout;
+    _icmp_timeout = icmp_timeout;
+    return 0;
+}
+
+int
+NAT64::initialize(ErrorHandler *)
+{
+    unsigned nthreads = get_passing_threads().weight();
+    if (nthreads == 0)
+	nthreads = 1;
+    _thread_sessions = _max_sessions / nthreads;
+    if (_thread_sessions == 0)
+	_thread_sessions = 1;
+
+    _free_blocks = -1;
+    for (int i = _blocks.size() - 1; i >= 0; --i) {
+	_blocks[i].next = _free_blocks;
+	_free_blocks = i;
+    }
+    return 0;
+}
+
+void
+NAT64::alloc_state(State &s)
+{
+    s.pool = new Session[_thread_sessions];
+    s.free = 0;
+    for (uint32_t i = _thread_sessions; i > 0; --i) {
+	s.pool[i - 1].wheel_next = s.free;
+	s.free = &s.pool[i - 1];
+    }
+}
+
+void
+NAT64::cleanup(CleanupStage)
+{
+    for (unsigned t = 0; t < _state.weight(); ++t) {
+	State &s = _state.get_value(t);
+	s.map6.clear();
+	s.map4.clear();
+	delete[] s.pool;
+	s.pool = s.free = 0;
+    }
+    for (int i = 0; i < _patterns.size(); ++i)
+	_patterns[i]->unuse();
+    _patterns.clear();
+}
+
+inline NAT64::State &
+NAT64::state()
+{
+    State &s = *_state;
+    if (unlikely(!s.pool))
+	alloc_state(s);
+    return s;
+}
+
+inline uint32_t
+NAT64::packet_time(Packet *p)
+{
+    if (!p->timestamp_anno().sec())
+	p->timestamp_anno().assign_now();
+    return p->timestamp_anno().sec();
+}
+
+inline uint32_t
+NAT64::timeout(const Session *x) const
+{
+    if (x->key6.proto == IP_PROTO_TCP)
+	return (x->flags & (SF_REPLIED | SF_DONE)) == SF_REPLIED
+	    ? _tcp_timeout : _tcp_trans_timeout;
+    else if (x->key6.proto == IP_PROTO_UDP)
+	return _udp_timeout;
+    else
+	return _icmp_timeout;
+}
+
+// Sessions live in the wheel slot of their expiry time, or, if that is too
+// far off, of the farthest slot; there they are checked again and moved on.
+// Refreshing a session only moves it when its expiry gets earlier.
+
+void
+NAT64::wheel_link(State &s, Session *x)
+{
+    uint32_t t = x->expires;
+    if ((int32_t) (t - s.clock) <= 0)
+	t = s.clock + 1;
+    else if (t - s.clock >= WHEEL_SIZE)
+	t = s.clock + WHEEL_SIZE - 1;
+    x->wheel_time = t;
+    Session **slot = &s.wheel[t % WHEEL_SIZE];
+    x->wheel_next = *slot;
+    if (*slot)
+	(*slot)->wheel_pprev = &x->wheel_next;
+    x->wheel_pprev = slot;
+    *slot = x;
+}
+
+inline void
+NAT64::wheel_unlink(Session *x)
+{
+    *x->wheel_pprev = x->wheel_next;
+    if (x->wheel_next)
+	x->wheel_next->wheel_pprev = x->wheel_pprev;
+}
+
+inline void
+NAT64::touch(State &s, Session *x, uint32_t now)
+{
+    x->expires = now + timeout(x);
+    if ((int32_t) (x->expires - x->wheel_time) < 0) {
+	wheel_unlink(x);
+	wheel_link(s, x);
+    }
+}
+
+void
+NAT64::expire(State &s, uint32_t now)
+{
+    if (unlikely(!s.clock))
+	s.clock = now;
+    if ((int32_t) (now - s.clock) <= 0)
+	return;
+    uint32_t start = s.clock, n = now - start;
+    if (n > WHEEL_SIZE)
+	n = WHEEL_SIZE;
+    s.clock = now;
+    for (uint32_t i = 1; i <= n; ++i) {
+	Session **slot = &s.wheel[(start + i) % WHEEL_SIZE];
+	Session *x = *slot;
+	*slot = 0;
+	while (x) {
+	    Session *next = x->wheel_next;
+	    if ((int32_t) (x->expires - now) <= 0)
+		remove_session(s, x);
+	    else
+		wheel_link(s, x);
+	    x = next;
+	}
+    }
+}
+
+bool
+NAT64::alloc_port(State &s, IPAddress &addr, uint16_t &port, int &block)
+{
+    int b = s.blocks;
+    if (b < 0) {
+	_block_lock.acquire();
+	if ((b = _free_blocks) >= 0)
+	    _free_blocks = _blocks[b].next;
+	_block_lock.release();
+	if (b < 0)
+	    return false;
+	PortBlock &pb = _blocks[b];
+	pb.owner = click_current_cpu_id();
+	pb.used = 0;
+	pb.map = (pb.size == 64 ? 0 : ~(uint64_t) 0 << pb.size);
+	pb.prev = pb.next = -1;
+	pb.listed = true;
+	s.blocks = b;
+    }
+
+    PortBlock &pb = _blocks[b];
+    int bit = ffs_lsb((unsigned long long) ~pb.map) - 1;
+    pb.map |= (uint64_t) 1 << bit;
+    ++pb.used;
+    if (pb.used == pb.size) {
+	s.blocks = pb.next;
+	if (pb.next >= 0)
+	    _blocks[pb.next].prev = -1;
+	pb.listed = false;
+    }
+    addr = pb.addr;
+    port = htons(pb.base + bit);
+    block = b;
+    return true;
+}
+
+void
+NAT64::free_port(State &s, int b, uint16_t port)
+{
+    PortBlock &pb = _blocks[b];
+    pb.map &= ~((uint64_t) 1 << (ntohs(port) - pb.base));
+    --pb.used;
+    if (!pb.listed) {
+	pb.prev = -1;
+	pb.next = s.blocks;
+	if (s.blocks >= 0)
+	    _blocks[s.blocks].prev = b;
+	s.blocks = b;
+	pb.listed = true;
+    }
+    // keep one block with room; give back other empty ones
+    if (pb.used == 0 && (pb.prev >= 0 || pb.next >= 0)) {
+	if (pb.prev >= 0)
+	    _blocks[pb.prev].next = pb.next;
+	else
+	    s.blocks = pb.next;
+	if (pb.next >= 0)
+	    _blocks[pb.next].prev = pb.prev;
+	pb.listed = false;
+	_block_lock.acquire();
+	pb.owner = -1;
+	pb.next = _free_blocks;
+	_free_blocks = b;
+	_block_lock.release();
+    }
+}
+
+NAT64::Session *
+NAT64::new_session(State &s, const Key6 &key, IPAddress dst, uint32_t now)
+{
+    IPAddress addr;
+    uint16_t port;
+    int block;
+    if (!s.free || !alloc_port(s, addr, port, block)) {
+	++s.stats.exhausted;
+	return 0;
+    }
+    Session *x = s.free;
+    s.free = x->wheel_next;
+
+    x->key6 = key;
+    x->key4.flow = IPFlowID(dst, key.proto == IP_PROTO_ICMP ? 0 : key.dport,
+			    addr, port);
+    x->key4.proto = key.proto;
+    x->block = block;
+    x->flags = 0;
+    x->expires = now + timeout(x);
+    wheel_link(s, x);
+
+    s.map6.set(x->key6, x);
+    s.map4.set(x->key4, x);
+    ++s.stats.created;
+    return x;
+}
+
+void
+NAT64::remove_session(State &s, Session *x)
+{
+    s.map6.erase(x->key6);
+    s.map4.erase(x->key4);
+    free_port(s, x->block, x->key4.flow.dport());
+    x->wheel_next = s.free;
+    s.free = x;
+    ++s.stats.expired;
+}
+
+int
+NAT64::block_owner(IPAddress addr, uint16_t port) const
+{
+    for (int i = 0; i < _pools.size(); ++i) {
+	const Pool &pool = _pools[i];
+	if (pool.addr == addr && port >= pool.first && port <= pool.last) {
+	    int b = pool.first_block + (port - pool.first) / _port_block;
+	    return _blocks[b].owner;
+	}
+    }
+    return -1;
+}
+
+inline int
+NAT64::translate64(State &s, Packet *&p, uint32_t now)
+{
+    IP64Translator::Transport t;
+    IPAddress dst;
+    if (!IP64Translator::inspect6(p, t)
+	|| !_xlate.extract(IP6Address(p->ip6_header()->ip6_dst), dst)) {
+	++s.stats.untranslatable;
+	return 2;
+    }
+
+    Key6 key;
+    key.src = p->ip6_header()->ip6_src;
+    key.dst = p->ip6_header()->ip6_dst;
+    key.sport = t.sport;
+    key.dport = t.dport;
+    key.proto = t.proto;
+    Session *x = s.map6.get(key);
+    if (!x) {
+	if (t.proto == IP_PROTO_TCP && !(t.tcp_flags & TH_SYN)) {
+	    ++s.stats.no_session;
+	    return 2;
+	}
+	if (!(x = new_session(s, key, dst, now)))
+	    return 2;
+    }
+    if (t.tcp_flags & (TH_FIN | TH_RST))
+	x->flags |= SF_DONE;
+    touch(s, x, now);
+
+    const IPFlowID &flow = x->key4.flow;
+    if (!(p = IP64Translator::translate64(p, flow.daddr(), flow.saddr(),
+					  flow.dport(), 0, ++s.ip_id)))
+	return -1;
+    ++s.stats.translated64;
+    return 0;
+}
+
+inline int
+NAT64::translate46(State &s, Packet *&p, State *&locked, uint32_t now)
+{
+    IP64Translator::Transport t;
+    if (!IP64Translator::inspect4(p, t)) {
+	++s.stats.untranslatable;
+	return 2;
+    }
+
+    // the owner of the port block holds the session
+    const click_ip *iph = p->ip_header();
+    int owner = block_owner(iph->ip_dst, ntohs(t.dport));
+    if (owner < 0) {
+	++s.stats.no_session;
+	return 2;
+    }
+    State &os = _state.get_value_for_thread(owner);
+    if (locked != &os) {
+	if (locked)
+	    locked->lock.release();
+	os.lock.acquire();
+	locked = &os;
+    }
+
+    Key4 key;
+    key.flow = IPFlowID(iph->ip_src, t.sport, iph->ip_dst, t.dport);
+    key.proto = t.proto;
+    Session *x = os.map4.get(key);
+    if (!x) {
+	++s.stats.no_session;
+	return 2;
+    }
+    x->flags |= SF_REPLIED;
+    if (t.tcp_flags & (TH_FIN | TH_RST))
+	x->flags |= SF_DONE;
+    touch(os, x, now);
+
+    if (!(p = IP64Translator::translate46(p, x->key6.dst, x->key6.src,
+					  0, x->key6.sport)))
+	return -1;
+    ++s.stats.translated46;
+    return 1;
+}
+
+void
+NAT64::push(int port, Packet *p)
+{
+    State &s = state();
+    uint32_t now = packet_time(p);
+    s.lock.acquire();
+    expire(s, now);
+    State *locked = &s;
+    int o = (port == 0 ? translate64(s, p, now) : translate46(s, p, locked, now));
+    locked->lock.release();
+    if (o >= 0)
+	checked_output_push(o, p);
+}
+
+void
+NAT64::push_list(int port, PacketList &l)
+{
+    if (!l.head)
+	return;
+#if HAVE_BATCH
+    if (port < noutputs())
+	output_push_batch(port, PacketBatch::make_from_simple_list(l.head, l.tail, l.count));
+    else
+	PacketBatch::make_from_simple_list(l.head, l.tail, l.count)->kill();
+#else
+    for (Packet *p = l.head, *next; p; p = next) {
+	next = p->next();
+	p->set_next(0);
+	checked_output_push(port, p);
+    }
+#endif
+}
+
+#if HAVE_BATCH
+void
+NAT64::push_batch(int port, PacketBatch *batch)
+{
+    State &s = state();
+    uint32_t now = packet_time(batch);
+    PacketList out, rejected;
+
+    // one lock for the whole batch while sessions stay local
+    s.lock.acquire();
+    expire(s, now);
+    State *locked = &s;
+    FOR_EACH_PACKET_SAFE(batch, p) {
+	Packet *q = p;
+	int o = (port == 0 ? translate64(s, q, now)
+		 : translate46(s, q, locked, now));
+	if (o == 2)
+	    rejected.append(q);
+	else if (o >= 0)
+	    out.append(q);
+    }
+    locked->lock.release();
+
+    push_list(port, out);
+    push_list(2, rejected);
+}
+#endif
+
+String
+NAT64::read_handler(Element *e, void *thunk)
+{
+    NAT64 *nat = static_cast<NAT64 *>(e);
+    if (thunk)
+	return nat->_xlate.unparse_prefix();
+
+    Stats st;
+    uint32_t sessions = 0;
+    memset(&st, 0, sizeof(st));
+    for (unsigned t = 0; t < nat->_state.weight(); ++t) {
+	const State &s = nat->_state.get_value(t);
+	sessions += s.map6.size();
+	st.created += s.stats.created;
+	st.expired += s.stats.expired;
+	st.translated64 += s.stats.translated64;
+	st.translated46 += s.stats.translated46;
+	st.untranslatable += s.stats.untranslatable;
+	st.no_session += s.stats.no_session;
+	st.exhausted += s.stats.exhausted;
+    }
+
+    StringAccum sa;
+    sa << "sessions:            " << sessions << "\n"
+       << "sessions created:    " << st.created << "\n"
+       << "sessions expired:    " << st.expired << "\n"
+       << "translated 6to4:     " << st.translated64 << "\n"
+       << "translated 4to6:     " << st.translated46 << "\n"
+       << "untranslatable:      " << st.untranslatable << "\n"
+       << "no session:          " << st.no_session << "\n"
+       << "exhausted:           " << st.exhausted << "\n";
+    return sa.take_string();
+}
+
+void
+NAT64::add_handlers()
+{
+    add_read_handler("stats", read_handler, 0);
+    add_read_handler("prefix", read_handler, 1);
+}
+
+CLICK_ENDDECLS
+ELEMENT_REQUIRES(ip6 IP64Translator IPRewriterPattern)
+EXPORT_ELEMENT(NAT64)
+ELEMENT_MT_SAFE(NAT64)
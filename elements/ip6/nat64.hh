@@ -0,0 +1,285 @@
+// -*- c-basic-offset: 4 -*-
+#ifndef CLICK_NAT64_HH
+#define CLICK_NAT64_HH
+#include <click/batchelement.hh>
+#include <click/hashtable.hh>
+#include <click/ipflowid.hh>
+#include <click/sync.hh>
+#include "ip64translator.hh"
+CLICK_DECLS
+class IPRewriterPattern;
+
+/*
+=c
+
+NAT64([I<keywords> PREFIX, POOL, MAX_SESSIONS, PORT_BLOCK, TCP_TIMEOUT,
+TCP_TRANS_TIMEOUT, UDP_TIMEOUT, ICMP_TIMEOUT])
+
+=s ip6
+
+stateful IPv6-to-IPv4 translator
+
+=d
+
+Translates between IPv6 hosts and IPv4 servers as in RFC 6146. IPv6 packets
+arrive on input 0, with IPv6 header annotations, and are addressed to IPv4
+hosts embedded in PREFIX as in RFC 6052. Each new flow gets a session that
+maps its IPv6 source address and port to an address and port from POOL; the
+packet is translated to IPv4 and leaves on output 0. IPv4 packets arriving on
+input 1, with IP header annotations, are matched against the sessions,
+translated to IPv6, and leave on output 1. Packets that cannot be translated,
+that match no session, or for which no session could be created leave on
+output 2 if it exists and are dropped otherwise.
+
+NAT64 translates TCP, UDP, and ICMP echo messages. For ICMP echo the
+identifier plays the role of the port. ICMP error messages, fragments, and
+IPv6 packets with extension headers are not translated. Headers are rewritten
+in place; see IP64Translator in the source for details. Only IPv6 hosts can
+open sessions, and TCP sessions are opened only by SYN packets.
+
+POOL uses IPRewriter's pattern syntax: 'C<SADDR SPORT[-SPORT2] - ->' with a
+single source address and a port range, or the name of a pattern defined by
+IPRewriterPatterns. Give POOL more than once to use several addresses. Ports
+and ICMP identifiers share the pool.
+
+Each thread passing packets through NAT64 keeps its own session table, and
+MAX_SESSIONS is split evenly between those threads. A thread claims blocks of
+PORT_BLOCK consecutive ports from the pool as it needs them and gives a block
+back when its last session expires. Replies are looked up in the table of the
+thread owning their port block; that is cheap when the NIC steers each port
+block to its owner thread, and costs a lock handoff otherwise. Sessions expire
+through a per-thread timing wheel with one-second slots, checked as packets
+arrive.
+
+Keyword arguments are:
+
+=over 8
+
+=item PREFIX
+
+IPv6 prefix of translated IPv4 addresses. Its length must be 32, 40, 48, 56,
+64, or 96. Default is 64:ff9b::/96.
+
+=item POOL
+
+IPv4 address and port range, as above. Required.
+
+=item MAX_SESSIONS
+
+Maximum number of sessions. Default is 65536.
+
+=item PORT_BLOCK
+
+Ports per block, between 1 and 64. Default is 64.
+
+=item TCP_TIMEOUT
+
+Seconds. Idle established TCP sessions expire after this long. Default is
+7440.
+
+=item TCP_TRANS_TIMEOUT
+
+Seconds. Idle TCP sessions that have not seen a reply yet, or that saw a FIN
+or RST, expire after this long. Default is 240.
+
+=item UDP_TIMEOUT
+
+Seconds. Default is 300.
+
+=item ICMP_TIMEOUT
+
+Seconds. Default is 60.
+
+=back
+
+Times are taken from packet timestamp annotations; packets without one are
+stamped with the current time.
+
+=h stats read-only
+
+Returns counters summed over all threads: sessions, sessions created and
+expired, packets translated in each direction, and packets dropped because
+they were untranslatable, matched no session, or found the table or the pool
+exhausted.
+
+=h prefix read-only
+
+Returns the PREFIX.
+
+=e
+
+  FromDevice(eth1) -> Strip(14) -> CheckIP6Header
+      -> nat :: NAT64(POOL 192.0.2.1 1024-65535 - -);
+  FromDevice(eth0) -> Strip(14) -> CheckIPHeader -> [1] nat;
+  nat[0] -> ... IPv4 routing ...;
+  nat[1] -> ... IPv6 routing ...;
+
+=a SIIT, IPRewriter, IPRewriterPatterns, ProtocolTranslator64,
+ProtocolTranslator46 */
+
+class NAT64 : public BatchElement { public:
+
+    NAT64() CLICK_COLD;
+    ~NAT64() CLICK_COLD;
+
+    const char *class_name() const	{ return "NAT64"; }
+    const char *port_count() const	{ return "2/2-3"; }
+    const char *processing() const	{ return PUSH; }
+
+    int configure(Vector<String> &, ErrorHandler *) CLICK_COLD;
+    int initialize(ErrorHandler *) CLICK_COLD;
+    void cleanup(CleanupStage) CLICK_COLD;
+    void add_handlers() CLICK_COLD;
+
+    void push(int, Packet *);
+#if HAVE_BATCH
+    void push_batch(int, PacketBatch *);
+#endif
+
+  private:
+
+    enum { WHEEL_SIZE = 256 };
+
+    struct Key6 {
+	IP6Address src;
+	IP6Address dst;
+	uint16_t sport;
+	uint16_t dport;
+	uint8_t proto;
+	inline hashcode_t hashcode() const {
+	    return src.hashcode() ^ (dst.hashcode() << 1)
+		^ ((sport << 16) | dport) ^ proto;
+	}
+	inline bool operator==(const Key6 &x) const {
+	    return src == x.src && dst == x.dst && sport == x.sport
+		&& dport == x.dport && proto == x.proto;
+	}
+    };
+
+    struct Key4 {
+	IPFlowID flow;		// as seen by replies
+	uint8_t proto;
+	inline hashcode_t hashcode() const {
+	    return flow.hashcode() ^ proto;
+	}
+	inline bool operator==(const Key4 &x) const {
+	    return flow == x.flow && proto == x.proto;
+	}
+    };
+
+    struct Session {
+	Key6 key6;
+	Key4 key4;
+	Session *wheel_next;
+	Session **wheel_pprev;
+	uint32_t expires;	// seconds
+	uint32_t wheel_time;	// when its wheel slot comes up
+	int block;
+	uint8_t flags;
+    };
+
+    enum { SF_REPLIED = 1, SF_DONE = 2 };
+
+    struct PortBlock {
+	IPAddress addr;
+	uint16_t base;		// first port, host byte order
+	uint16_t size;
+	int owner;		// thread, or -1 if free
+	int used;
+	uint64_t map;		// bit i set if port base + i is taken
+	int prev;		// in the owner's list of blocks with room,
+	int next;		// or the free list
+	bool listed;
+    };
+
+    struct Pool {
+	IPAddress addr;
+	uint32_t first;		// host byte order
+	uint32_t last;
+	int first_block;
+    };
+
+    struct Stats {
+	uint32_t created;
+	uint32_t expired;
+	uint64_t translated64;
+	uint64_t translated46;
+	uint64_t untranslatable;
+	uint64_t no_session;
+	uint64_t exhausted;
+    };
+
+    struct PacketList {
+	Packet *head;
+	Packet *tail;
+	unsigned count;
+	PacketList()
+	    : head(0), tail(0), count(0) {
+	}
+	inline void append(Packet *p) {
+	    p->set_next(0);
+	    if (tail)
+		tail->set_next(p);
+	    else
+		head = p;
+	    tail = p;
+	    ++count;
+	}
+    };
+
+    struct State {
+	Spinlock lock;		// taken by replies from other threads
+	HashTable<Key6, Session *> map6;
+	HashTable<Key4, Session *> map4;
+	Session *pool;
+	Session *free;
+	Session *wheel[WHEEL_SIZE];
+	uint32_t clock;		// seconds; last wheel slot processed
+	int blocks;		// blocks with room, or -1
+	uint16_t ip_id;
+	Stats stats;
+	State()
+	    : pool(0), free(0), clock(0), blocks(-1), ip_id(0) {
+	    memset(wheel, 0, sizeof(wheel));
+	    memset(&stats, 0, sizeof(stats));
+	}
+    };
+
+    per_thread<State> _state;
+    IP64Translator _xlate;
+    Vector<IPRewriterPattern *> _patterns;
+    Vector<Pool> _pools;
+    Vector<PortBlock> _blocks;
+    Spinlock _block_lock;
+    int _free_blocks;
+    uint32_t _max_sessions;
+    uint32_t _thread_sessions;
+    uint32_t _tcp_timeout;
+    uint32_t _tcp_trans_timeout;
+    uint32_t _udp_timeout;
+    uint32_t _icmp_timeout;
+    int _port_block;
+
+    inline State &state();
+    void alloc_state(State &) CLICK_COLD;
+    inline uint32_t packet_time(Packet *);
+    inline uint32_t timeout(const Session *) const;
+    void wheel_link(State &, Session *);
+    inline void wheel_unlink(Session *);
+    inline void touch(State &, Session *, uint32_t);
+    void expire(State &, uint32_t);
+    bool alloc_port(State &, IPAddress &, uint16_t &, int &);
+    void free_port(State &, int, uint16_t);
+    Session *new_session(State &, const Key6 &, IPAddress, uint32_t);
+    void remove_session(State &, Session *);
+    int block_owner(IPAddress, uint16_t) const;
+    inline int translate64(State &, Packet *&, uint32_t);
+    inline int translate46(State &, Packet *&, State *&, uint32_t);
+    void push_list(int, PacketList &);
+
+    static String read_handler(Element *, void *) CLICK_COLD;
+
+};
+
+CLICK_ENDDECLS
+#endif
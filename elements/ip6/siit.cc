@@ -0,0 +1,155 @@
+// -*- c-basic-offset: 4 -*-
+/*
+ * siit.{cc,hh} -- stateless IPv6/IPv4 translator
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Click LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Click LICENSE file; the license in that file is
+ * legally binding.
+ */
+
+#include <click/config.h>
+#include "siit.hh"
+#include <click/args.hh>
+#include <click/error.hh>
+#include <click/straccum.hh>
+#include <clicknet/ip.h>
+#include <clicknet/ip6.h>
+CLICK_DECLS
+
+SIIT::SIIT()
+{
+}
+
+SIIT::~SIIT()
+{
+}
+
+int
+SIIT::configure(Vector<String> &conf, ErrorHandler *errh)
+{
+    IP6Address prefix;
+    int prefix_len = -1;
+    if (Args(conf, this, errh)
+	.read("PREFIX", IP6PrefixArg(), prefix, prefix_len)
+	.complete() < 0)
+	return -1;
+    if (prefix_len >= 0 && _xlate.set_prefix(prefix, prefix_len, errh) < 0)
+	return -1;
+    return 0;
+}
+
+inline int
+SIIT::translate(int port, Packet *&p)
+{
+    State &s = *_state;
+    IP64Translator::Transport t;
+    if (port == 0) {
+	IPAddress src, dst;
+	if (!IP64Translator::inspect6(p, t)
+	    || !_xlate.extract(IP6Address(p->ip6_header()->ip6_src), src)
+	    || !_xlate.extract(IP6Address(p->ip6_header()->ip6_dst), dst)) {
+	    ++s.untranslatable;
+	    return 2;
+	}
+	if (!(p = IP64Translator::translate64(p, src, dst, 0, 0, ++s.ip_id)))
+	    return -1;
+	++s.translated64;
+	return 0;
+    } else {
+	if (!IP64Translator::inspect4(p, t)) {
+	    ++s.untranslatable;
+	    return 2;
+	}
+	const click_ip *iph = p->ip_header();
+	if (!(p = IP64Translator::translate46(p, _xlate.embed(iph->ip_src),
+					      _xlate.embed(iph->ip_dst), 0, 0)))
+	    return -1;
+	++s.translated46;
+	return 1;
+    }
+}
+
+void
+SIIT::push(int port, Packet *p)
+{
+    int o = translate(port, p);
+    if (o >= 0)
+	checked_output_push(o, p);
+}
+
+void
+SIIT::push_list(int port, PacketList &l)
+{
+    if (!l.head)
+	return;
+#if HAVE_BATCH
+    if (port < noutputs())
+	output_push_batch(port, PacketBatch::make_from_simple_list(l.head, l.tail, l.count));
+    else
+	PacketBatch::make_from_simple_list(l.head, l.tail, l.count)->kill();
+#else
+    for (Packet *p = l.head, *next; p; p = next) {
+	next = p->next();
+	p->set_next(0);
+	checked_output_push(port, p);
+    }
+#endif
+}
+
+#if HAVE_BATCH
+void
+SIIT::push_batch(int port, PacketBatch *batch)
+{
+    PacketList out, rejected;
+    FOR_EACH_PACKET_SAFE(batch, p) {
+	Packet *q = p;
+	int o = translate(port, q);
+	if (o == 2)
+	    rejected.append(q);
+	else if (o >= 0)
+	    out.append(q);
+    }
+    push_list(port, out);
+    push_list(2, rejected);
+}
+#endif
+
+String
+SIIT::read_handler(Element *e, void *thunk)
+{
+    SIIT *siit = static_cast<SIIT *>(e);
+    if (thunk)
+	return siit->_xlate.unparse_prefix();
+
+    uint64_t translated64 = 0, translated46 = 0, untranslatable = 0;
+    for (unsigned t = 0; t < siit->_state.weight(); ++t) {
+	const State &s = siit->_state.get_value(t);
+	translated64 += s.translated64;
+	translated46 += s.translated46;
+	untranslatable += s.untranslatable;
+    }
+
+    StringAccum sa;
+    sa << "translated 6to4:     " << translated64 << "\n"
+       << "translated 4to6:     " << translated46 << "\n"
+       << "untranslatable:      " << untranslatable << "\n";
+    return sa.take_string();
+}
+
+void
+SIIT::add_handlers()
+{
+    add_read_handler("stats", read_handler, 0);
+    add_read_handler("prefix", read_handler, 1);
+}
+
+CLICK_ENDDECLS
+ELEMENT_REQUIRES(ip6 IP64Translator)
+EXPORT_ELEMENT(SIIT)
+ELEMENT_MT_SAFE(SIIT)
@@ -0,0 +1,118 @@
+// -*- c-basic-offset: 4 -*-
+#ifndef CLICK_SIIT_HH
+#define CLICK_SIIT_HH
+#include <click/batchelement.hh>
+#include <click/sync.hh>
+#include "ip64translator.hh"
+CLICK_DECLS
+
+/*
+=c
+
+SIIT([I<keywords> PREFIX])
+
+=s ip6
+
+stateless IPv6/IPv4 translator
+
+=d
+
+Translates between IPv6 and IPv4 without state, as in RFC 7915. IPv6 packets
+arrive on input 0, with IPv6 header annotations. Both of their addresses must
+lie in PREFIX; the embedded IPv4 addresses (RFC 6052) become the addresses of
+the IPv4 packet, which leaves on output 0. IPv4 packets arriving on input 1,
+with IP header annotations, get both addresses embedded in PREFIX and leave
+on output 1. Packets that cannot be translated leave on output 2 if it exists
+and are dropped otherwise.
+
+SIIT shares NAT64's header translation: it handles TCP, UDP, and ICMP echo
+messages, rewrites headers in place, and does not translate ICMP error
+messages, fragments, or IPv6 extension headers.
+
+Keyword arguments are:
+
+=over 8
+
+=item PREFIX
+
+IPv6 prefix of translated IPv4 addresses. Its length must be 32, 40, 48, 56,
+64, or 96. Default is 64:ff9b::/96.
+
+=back
+
+=h stats read-only
+
+Returns the number of packets translated in each direction and the number of
+untranslatable packets.
+
+=h prefix read-only
+
+Returns the PREFIX.
+
+=e
+
+  FromDevice(eth1) -> Strip(14) -> CheckIP6Header
+      -> siit :: SIIT(PREFIX 2001:db8:64::/96);
+  FromDevice(eth0) -> Strip(14) -> CheckIPHeader -> [1] siit;
+
+=a NAT64, ProtocolTranslator64, ProtocolTranslator46, AddressTranslator */
+
+class SIIT : public BatchElement { public:
+
+    SIIT() CLICK_COLD;
+    ~SIIT() CLICK_COLD;
+
+    const char *class_name() const	{ return "SIIT"; }
+    const char *port_count() const	{ return "2/2-3"; }
+    const char *processing() const	{ return PUSH; }
+
+    int configure(Vector<String> &, ErrorHandler *) CLICK_COLD;
+    void add_handlers() CLICK_COLD;
+
+    void push(int, Packet *);
+#if HAVE_BATCH
+    void push_batch(int, PacketBatch *);
+#endif
+
+  private:
+
+    struct State {
+	uint64_t translated64;
+	uint64_t translated46;
+	uint64_t untranslatable;
+	uint16_t ip_id;
+	State()
+	    : translated64(0), translated46(0), untranslatable(0), ip_id(0) {
+	}
+    };
+
+    struct PacketList {
+	Packet *head;
+	Packet *tail;
+	unsigned count;
+	PacketList()
+	    : head(0), tail(0), count(0) {
+	}
+	inline void append(Packet *p) {
+	    p->set_next(0);
+	    if (tail)
+		tail->set_next(p);
+	    else
+		head = p;
+	    tail = p;
+	    ++count;
+	}
+    };
+
+    per_thread<State> _state;
+    IP64Translator _xlate;
+
+    inline int translate(int, Packet *&);
+    void push_list(int, PacketList &);
+
+    static String read_handler(Element *, void *) CLICK_COLD;
+
+};
+
+CLICK_ENDDECLS
+#endif
@@ -253,10 +253,10 @@ Classifier::add_handlers()
 void
 Classifier::push_batch(int, PacketBatch * batch)
 {
-	CLASSIFY_EACH_PACKET(	(noutputs() + 1),
+	CLASSIFY_EACH_PACKET_PREFETCH(	(noutputs() + 1),
 							_prog.match,
 							batch,
-							checked_output_push_batch);
+							checked_output_push_batch, batch_prefetch_distance());
 
 }
 
@@ -332,6 +332,8 @@ CounterMP::~CounterMP()
 
 int
 CounterMP::initialize(ErrorHandler *errh) {
+    _packets.initialize(this, "count");
+    _bytes.initialize(this, "byte_count", CLICK_STATS_F_BYTES);
     if (CounterBase::initialize(errh) != 0)
         return -1;
     //If not in simple mode, we only allow one writer so we can sum up the total number of threads
@@ -345,8 +347,8 @@ CounterMP::simple_action(Packet *p)
 {
     if (_atomic > 0)
         _atomic_lock.write_begin();
-    _stats->_count++;
-    _stats->_byte_count += p->length();
+    _packets.inc();
+    _bytes.add(p->length());
     if (unlikely(!_simple))
         check_handlers(CounterMP::count(), CounterMP::byte_count()); //BUG : if not atomic, then handler may be called twice
     if (_atomic > 0)
@@ -370,8 +372,8 @@ CounterMP::simple_action_batch(PacketBatch *batch)
     }
     if (_atomic > 0)
         _atomic_lock.write_begin();
-    _stats->_count += batch->count();
-    _stats->_byte_count += bc;
+    _packets.add(batch->count());
+    _bytes.add(bc);
     if (unlikely(!_simple))
         check_handlers(CounterMP::count(), CounterMP::byte_count());
     if (_atomic > 0)
@@ -385,10 +387,8 @@ CounterMP::reset()
 {
     if (_atomic  > 0)
         _atomic_lock.write_begin();
-    for (unsigned i = 0; i < _stats.weight(); i++) { \
-        _stats.get_value(i)._count = 0;
-        _stats.get_value(i)._byte_count = 0;
-    }
+    _packets.clear();
+    _bytes.clear();
     CounterBase::reset();
     if (_atomic  > 0)
         _atomic_lock.write_end();
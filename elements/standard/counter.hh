@@ -6,6 +6,7 @@
 #include <click/llrpc.h>
 #include <click/sync.hh>
 #include <click/multithread.hh>
+#include <click/statscounter.hh>
 CLICK_DECLS
 class HandlerCall;
 
@@ -55,6 +56,10 @@ and call the handlers if the limit has been reached.
 
 =back
 
+CounterMP keeps a copy of the counts per thread. In a router with a
+StatsExport element, those copies are exported as counters "NAME.count" and
+"NAME.byte_count", where NAME is the element's name.
+
 =h count read-only
 
 Returns the number of packets that have passed through since the last reset.
@@ -112,6 +117,8 @@ Argument is a pointer to a click_llrpc_counts_st structure (see
 count). Stores the corresponding counts in the corresponding C<values>
 components.
 
+=a StatsExport
+
 */
 
 /**
@@ -281,56 +288,46 @@ class CounterMP : public CounterBase { public:
     void reset();
 
     counter_int_type count() {
-        PER_THREAD_MEMBER_SUM(counter_int_type,sum,_stats,_count);
-        return sum;
+        return _packets.value();
     }
 
     counter_int_type byte_count() {
-        PER_THREAD_MEMBER_SUM(counter_int_type,sum,_stats,_byte_count);
-        return sum;
+        return _bytes.value();
     }
 
     stats read() {
-        counter_int_type count = 0;
-        counter_int_type byte_count = 0;
-        for (unsigned i = 0; i < _stats.weight(); i++) { \
-            count += _stats.get_value(i)._count;
-            byte_count += _stats.get_value(i)._byte_count;
-        }
-        return {count,byte_count};
+        return {(counter_int_type) _packets.value(),
+                (counter_int_type) _bytes.value()};
     }
 
     stats atomic_read() {
         if (_atomic > 0)
             _atomic_lock.read_begin();
-        counter_int_type count = 0;
-        counter_int_type byte_count = 0;
-        for (unsigned i = 0; i < _stats.weight(); i++) { \
-            count += _stats.get_value(i)._count;
-            byte_count += _stats.get_value(i)._byte_count;
-        }
+        stats s = CounterMP::read();
         if (_atomic > 0)
             _atomic_lock.read_end();
-        return {count,byte_count};
+        return s;
     }
 
     void add(stats s) override {
-        _stats->_count += s._count;
-        _stats->_byte_count += s._byte_count;
+        _packets.add(s._count);
+        _bytes.add(s._byte_count);
     }
 
     void atomic_add(stats s) override {
         if (_atomic > 0)
             _atomic_lock.write_begin();
-        _stats->_count += s._count;
-        _stats->_byte_count += s._byte_count;
+        _packets.add(s._count);
+        _bytes.add(s._byte_count);
         if (_atomic > 0)
             _atomic_lock.write_end();
     }
 
 protected:
     rXwlock _atomic_lock CLICK_CACHE_ALIGN;
-    per_thread<stats> _stats CLICK_CACHE_ALIGN;
+    // exported as "count" and "byte_count" when the router has a StatsExport
+    StatsCounter _packets;
+    StatsCounter _bytes;
 };
 
 class CounterRxWMP : public CounterMP { public:
@@ -20,6 +20,7 @@
 #include "hashswitch.hh"
 #include <click/error.hh>
 #include <click/args.hh>
+#include <click/batchview.hh>
 CLICK_DECLS
 
 HashSwitch::HashSwitch()
@@ -39,24 +40,59 @@ HashSwitch::configure(Vector<String> &conf, ErrorHandler *errh)
     return 0;
 }
 
-void
-HashSwitch::push(int, Packet *p)
+inline int
+HashSwitch::hash(const Packet *p) const
 {
   const unsigned char *data = p->data();
   int o = _offset, l = _length;
   if ((int)p->length() < o + l)
-    output(0).push(p);
-  else {
-    int d = 0;
-    for (int i = o; i < o + l; i++)
-      d += data[i];
-    int n = noutputs();
-    if (n == 2 || n == 4 || n == 8)
-      output((d ^ (d>>4)) & (n-1)).push(p);
-    else
-      output(d % n).push(p);
+    return -1;
+  int d = 0;
+  for (int i = o; i < o + l; i++)
+    d += data[i];
+  return d;
+}
+
+inline int
+HashSwitch::output_of(int d, int n) const
+{
+  if (d < 0)
+    return 0;
+  else if (n == 2 || n == 4 || n == 8)
+    return (d ^ (d>>4)) & (n-1);
+  else
+    return d % n;
+}
+
+void
+HashSwitch::push(int, Packet *p)
+{
+  output(output_of(hash(p), noutputs())).push(p);
+}
+
+#if HAVE_BATCH
+void
+HashSwitch::push_batch(int, PacketBatch *batch)
+{
+  BatchView v;
+  int n = noutputs();
+  PacketBatch *outs[n];
+  memset(outs, 0, sizeof(outs));
+
+  Packet *next = batch;
+  while (next) {
+    next = v.gather(next, 0);
+    unsigned m = v.size();
+    for (unsigned i = 0; i < m; i++)
+      v.out[i] = hash(v.packet[i]);
+    // separate pass over the sums, which the compiler can vectorize
+    for (unsigned i = 0; i < m; i++)
+      v.out[i] = output_of(v.out[i], n);
+    v.scatter(outs, n);
   }
+  BatchView::push(this, outs, n);
 }
+#endif
 
 CLICK_ENDDECLS
 EXPORT_ELEMENT(HashSwitch)
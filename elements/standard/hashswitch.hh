@@ -1,6 +1,6 @@
 #ifndef CLICK_HASHSWITCH_HH
 #define CLICK_HASHSWITCH_HH
-#include <click/element.hh>
+#include <click/batchelement.hh>
 CLICK_DECLS
 
 /*
@@ -13,6 +13,7 @@ CLICK_DECLS
  * Chooses the output on which to emit each packet based on
  * a hash of the LENGTH bytes starting at OFFSET.
  * Could be used for stochastic fair queuing.
+ * Packets shorter than OFFSET + LENGTH go to output 0.
  * =e
  * This element expects IP packets and chooses the output
  * based on a hash of the IP destination address:
@@ -22,7 +23,7 @@ CLICK_DECLS
  * Switch, RoundRobinSwitch, StrideSwitch, RandomSwitch
  */
 
-class HashSwitch : public Element {
+class HashSwitch : public BatchElement {
 
   int _offset;
   int _length;
@@ -37,7 +38,15 @@ class HashSwitch : public Element {
 
   int configure(Vector<String> &, ErrorHandler *) CLICK_COLD;
 
-  void push(int port, Packet *);
+  void push(int port, Packet *) override;
+#if HAVE_BATCH
+  void push_batch(int port, PacketBatch *) override;
+#endif
+
+ private:
+
+  inline int hash(const Packet *) const;
+  inline int output_of(int hash, int n) const;
 
 };
 
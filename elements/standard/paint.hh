@@ -31,6 +31,7 @@ class Paint : public BatchElement { public:
 
     const char *class_name() const		{ return "Paint"; }
     const char *port_count() const		{ return PORTS_1_1; }
+    const char *flags() const			{ return "F"; }
 
     int configure(Vector<String> &, ErrorHandler *) CLICK_COLD;
     bool can_live_reconfigure() const		{ return true; }
@@ -0,0 +1,493 @@
+// -*- c-basic-offset: 4 -*-
+/*
+ * payloadclassifier.{cc,hh} -- classifies packets by strings in their payloads
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Click LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Click LICENSE file; the license in that file is
+ * legally binding.
+ */
+
+#include <click/config.h>
+#include "payloadclassifier.hh"
+#include <click/args.hh>
+#include <click/confparse.hh>
+#include <click/error.hh>
+#include <click/integers.hh>
+#include <click/straccum.hh>
+#include <clicknet/ip.h>
+#include <clicknet/tcp.h>
+#include <clicknet/udp.h>
+#if PAYLOADCLASSIFIER_X86
+# include <immintrin.h>
+#endif
+CLICK_DECLS
+
+PayloadClassifier::Program::Program()
+    : _match_all(0), _first_floating(0), _prefix(1), _scan(SCAN_SCALAR)
+{
+}
+
+int
+PayloadClassifier::Program::compile(const Vector<Rule> &rules, int scan,
+				    ErrorHandler *errh)
+{
+    int n = rules.size();
+    _rules = rules;
+    _anchored.clear();
+    for (int b = 0; b < NBUCKETS; ++b)
+	_buckets[b].clear();
+    _match_all = _first_floating = n;
+
+    int min_length = MAXPREFIX;
+    for (int i = 0; i < n; ++i)
+	if (rules[i].offset < 0) {
+	    if (_first_floating == n)
+		_first_floating = i;
+	    if (rules[i].pattern.length() < min_length)
+		min_length = rules[i].pattern.length();
+	} else if (!rules[i].pattern && _match_all == n)
+	    _match_all = i;
+	else if (rules[i].pattern)
+	    _anchored.push_back(i);
+    if (min_length == 0)
+	return errh->error("empty pattern");
+    _prefix = min_length;
+
+    // Strings sharing a prefix share a bucket, so they cost one candidate.
+    memset(_lo, 0, sizeof(_lo));
+    memset(_hi, 0, sizeof(_hi));
+    memset(_byte, 0, sizeof(_byte));
+    for (int i = _first_floating; i < n; ++i) {
+	if (rules[i].offset >= 0)
+	    continue;
+	const unsigned char *s = reinterpret_cast<const unsigned char *>(rules[i].pattern.data());
+	uint32_t h = 0;
+	for (int k = 0; k < _prefix; ++k)
+	    h = h * 31 + s[k];
+	int b = (h ^ (h >> 3) ^ (h >> 6)) % NBUCKETS;
+	for (int k = 0; k < _prefix; ++k) {
+	    _lo[k][s[k] & 15] |= 1 << b;
+	    _hi[k][s[k] >> 4] |= 1 << b;
+	    _byte[k][s[k]] |= 1 << b;
+	}
+	_buckets[b].push_back(i);
+    }
+
+    _scan = scan;
+    return 0;
+}
+
+String
+PayloadClassifier::Program::unparse() const
+{
+    StringAccum sa;
+    for (int i = 0; i < _rules.size(); ++i) {
+	const Rule &r = _rules[i];
+	if (r.action < 0)
+	    sa << "drop ";
+	else
+	    sa << r.action << ' ';
+	if (r.offset < 0)
+	    sa << cp_quote(r.pattern);
+	else if (!r.pattern)
+	    sa << '-';
+	else if (r.offset == 0)
+	    sa << '^' << cp_quote(r.pattern);
+	else
+	    sa << '@' << r.offset << ' ' << cp_quote(r.pattern);
+	sa << '\n';
+    }
+    return sa.take_string();
+}
+
+inline int
+PayloadClassifier::Program::verify(const unsigned char *data, int len,
+				   int pos, unsigned buckets, int best) const
+{
+    while (buckets) {
+	int b = ffs_lsb(buckets) - 1;
+	buckets &= buckets - 1;
+	const Vector<int> &bucket = _buckets[b];
+	for (int j = 0; j < bucket.size() && bucket[j] < best; ++j) {
+	    const String &s = _rules[bucket[j]].pattern;
+	    if (pos + s.length() <= len
+		&& memcmp(data + pos, s.data(), s.length()) == 0) {
+		best = bucket[j];
+		break;
+	    }
+	}
+    }
+    return best;
+}
+
+int
+PayloadClassifier::Program::scan_scalar(const unsigned char *data, int len,
+					int pos, int best) const
+{
+    for (int last = len - _prefix; pos <= last; ++pos) {
+	unsigned c = _byte[0][data[pos]];
+	if (_prefix > 1)
+	    c &= _byte[1][data[pos + 1]];
+	if (_prefix > 2)
+	    c &= _byte[2][data[pos + 2]];
+	if (c) {
+	    best = verify(data, len, pos, c, best);
+	    if (best <= _first_floating)
+		break;
+	}
+    }
+    return best;
+}
+
+#if PAYLOADCLASSIFIER_X86
+/* Teddy: each byte's low and high nibbles index two 16-entry tables of
+ * bucket bits; a position is a candidate for a bucket if all _prefix bytes
+ * starting there agree on that bucket. */
+
+__attribute__((target("ssse3"))) static inline __m128i
+teddy_ssse3(const unsigned char *s, const uint8_t *lo, const uint8_t *hi)
+{
+    const __m128i nibble = _mm_set1_epi8(0x0F);
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(s));
+    __m128i l = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(lo)),
+				 _mm_and_si128(v, nibble));
+    __m128i h = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(hi)),
+				 _mm_and_si128(_mm_srli_epi16(v, 4), nibble));
+    return _mm_and_si128(l, h);
+}
+
+__attribute__((target("ssse3"))) int
+PayloadClassifier::Program::scan_ssse3(const unsigned char *data, int len,
+				       int best) const
+{
+    int pos = 0, last = len - _prefix;
+    for (; pos + 15 <= last; pos += 16) {
+	__m128i c = teddy_ssse3(data + pos, _lo[0], _hi[0]);
+	if (_prefix > 1)
+	    c = _mm_and_si128(c, teddy_ssse3(data + pos + 1, _lo[1], _hi[1]));
+	if (_prefix > 2)
+	    c = _mm_and_si128(c, teddy_ssse3(data + pos + 2, _lo[2], _hi[2]));
+	unsigned mask = _mm_movemask_epi8(_mm_cmpeq_epi8(c, _mm_setzero_si128())) ^ 0xFFFF;
+	if (mask) {
+	    uint8_t cand[16];
+	    _mm_storeu_si128(reinterpret_cast<__m128i *>(cand), c);
+	    do {
+		int j = ffs_lsb(mask) - 1;
+		mask &= mask - 1;
+		best = verify(data, len, pos + j, cand[j], best);
+		if (best <= _first_floating)
+		    return best;
+	    } while (mask);
+	}
+    }
+    return scan_scalar(data, len, pos, best);
+}
+
+__attribute__((target("avx2"))) static inline __m256i
+teddy_avx2(const unsigned char *s, const uint8_t *lo, const uint8_t *hi)
+{
+    const __m256i nibble = _mm256_set1_epi8(0x0F);
+    __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(s));
+    __m256i l = _mm256_shuffle_epi8(_mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i *>(lo))),
+				    _mm256_and_si256(v, nibble));
+    __m256i h = _mm256_shuffle_epi8(_mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i *>(hi))),
+				    _mm256_and_si256(_mm256_srli_epi16(v, 4), nibble));
+    return _mm256_and_si256(l, h);
+}
+
+__attribute__((target("avx2"))) int
+PayloadClassifier::Program::scan_avx2(const unsigned char *data, int len,
+				      int best) const
+{
+    int pos = 0, last = len - _prefix;
+    for (; pos + 31 <= last; pos += 32) {
+	__m256i c = teddy_avx2(data + pos, _lo[0], _hi[0]);
+	if (_prefix > 1)
+	    c = _mm256_and_si256(c, teddy_avx2(data + pos + 1, _lo[1], _hi[1]));
+	if (_prefix > 2)
+	    c = _mm256_and_si256(c, teddy_avx2(data + pos + 2, _lo[2], _hi[2]));
+	unsigned mask = ~(unsigned) _mm256_movemask_epi8(_mm256_cmpeq_epi8(c, _mm256_setzero_si256()));
+	if (mask) {
+	    uint8_t cand[32];
+	    _mm256_storeu_si256(reinterpret_cast<__m256i *>(cand), c);
+	    do {
+		int j = ffs_lsb(mask) - 1;
+		mask &= mask - 1;
+		best = verify(data, len, pos + j, cand[j], best);
+		if (best <= _first_floating)
+		    return best;
+	    } while (mask);
+	}
+    }
+    return scan_scalar(data, len, pos, best);
+}
+#endif
+
+inline int
+PayloadClassifier::Program::match(const unsigned char *data, int len) const
+{
+    int best = _match_all;
+    for (int i = 0; i < _anchored.size() && _anchored[i] < best; ++i) {
+	const Rule &r = _rules[_anchored[i]];
+	if (r.offset + r.pattern.length() <= len
+	    && memcmp(data + r.offset, r.pattern.data(), r.pattern.length()) == 0) {
+	    best = _anchored[i];
+	    break;
+	}
+    }
+    if (_first_floating < best && len >= _prefix)
+	switch (_scan) {
+#if PAYLOADCLASSIFIER_X86
+	case SCAN_AVX2:
+	    best = scan_avx2(data, len, best);
+	    break;
+	case SCAN_SSSE3:
+	    best = scan_ssse3(data, len, best);
+	    break;
+#endif
+	default:
+	    best = scan_scalar(data, len, 0, best);
+	    break;
+	}
+    return best < _rules.size() ? best : -1;
+}
+
+
+PayloadClassifier::PayloadClassifier()
+    : _retired(0), _offset(-1), _anno(-1), _simd(true)
+{
+    _program.initialize(0);
+}
+
+PayloadClassifier::~PayloadClassifier()
+{
+}
+
+static int
+best_scan()
+{
+#if PAYLOADCLASSIFIER_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+	return PayloadClassifier::SCAN_AVX2;
+    if (__builtin_cpu_supports("ssse3"))
+	return PayloadClassifier::SCAN_SSSE3;
+#endif
+    return PayloadClassifier::SCAN_SCALAR;
+}
+
+int
+PayloadClassifier::parse_rules(const Vector<String> &conf, Vector<Rule> &rules,
+			       int max_rules, ErrorHandler *errh)
+{
+    int before = errh->nerrors();
+    rules.clear();
+    for (int i = 0; i < conf.size(); ++i) {
+	String s = conf[i];
+	String action = cp_shift_spacevec(s);
+	Rule r;
+	r.offset = -1;
+	if (action == "allow")
+	    r.action = 0;
+	else if (action == "drop" || action == "deny")
+	    r.action = -1;
+	else if (!IntArg().parse(action, r.action) || r.action < 0) {
+	    errh->error("rule %d: bad action %<%s%>", i + 1, action.c_str());
+	    continue;
+	}
+
+	String word = cp_shift_spacevec(s);
+	if (word == "-")
+	    r.offset = 0;
+	else {
+	    if (word.length() > 1 && word[0] == '@') {
+		if (!IntArg().parse(word.substring(1), r.offset) || r.offset < 0) {
+		    errh->error("rule %d: bad offset %<%s%>", i + 1, word.c_str());
+		    continue;
+		}
+		word = cp_shift_spacevec(s);
+	    } else if (word.length() > 1 && word[0] == '^') {
+		r.offset = 0;
+		word = word.substring(1);
+	    }
+	    r.pattern = cp_unquote(word);
+	    if (!r.pattern) {
+		errh->error("rule %d: empty pattern", i + 1);
+		continue;
+	    }
+	}
+	if (s) {
+	    errh->error("rule %d: garbage after pattern", i + 1);
+	    continue;
+	}
+	rules.push_back(r);
+    }
+    if (rules.size() > max_rules)
+	errh->error("too many rules (at most %d)", max_rules);
+    return errh->nerrors() == before ? 0 : -1;
+}
+
+int
+PayloadClassifier::configure(Vector<String> &conf, ErrorHandler *errh)
+{
+    String offset = "PAYLOAD";
+    int anno = -1;
+    bool simd = true;
+    if (Args(this, errh).bind(conf)
+	.read("OFFSET", WordArg(), offset)
+	.read("ANNO", AnnoArg(1), anno)
+	.read("SIMD", simd)
+	.consume() < 0)
+	return -1;
+    if (offset.upper() == "PAYLOAD")
+	_offset = -1;
+    else if (!IntArg().parse(offset, _offset) || _offset < 0)
+	return errh->error("OFFSET should be PAYLOAD or a byte offset");
+    _anno = anno;
+    _simd = simd;
+
+    Vector<Rule> rules;
+    if (parse_rules(conf, rules, anno >= 0 ? 255 : 0x7FFFFFFF, errh) < 0)
+	return -1;
+    for (int i = 0; i < rules.size(); ++i)
+	if (rules[i].action >= noutputs())
+	    return errh->error("rule %d: output %d out of range", i + 1, rules[i].action);
+
+    Program *prog = new Program;
+    if (prog->compile(rules, _simd ? best_scan() : SCAN_SCALAR, errh) < 0) {
+	delete prog;
+	return -1;
+    }
+    _program.initialize(prog);
+    return 0;
+}
+
+void
+PayloadClassifier::cleanup(CleanupStage)
+{
+    delete _program.read();
+    delete _retired;
+    _program.initialize(0);
+    _retired = 0;
+}
+
+inline int
+PayloadClassifier::classify(const Program *prog, Packet *p) const
+{
+    const unsigned char *data = p->data(), *end = p->end_data();
+    if (_offset >= 0)
+	data += _offset;
+    else if (p->has_network_header()) {
+	const click_ip *iph = p->ip_header();
+	data = p->network_header();
+	if (iph->ip_v == 4) {
+	    if (data + ntohs(iph->ip_len) < end)
+		end = data + ntohs(iph->ip_len);
+	    data = p->transport_header();
+	    if (!IP_FIRSTFRAG(iph))
+		/* whole fragment is payload */;
+	    else if (iph->ip_p == IP_PROTO_TCP && data + sizeof(click_tcp) <= end)
+		data += p->tcp_header()->th_off << 2;
+	    else if (iph->ip_p == IP_PROTO_UDP)
+		data += sizeof(click_udp);
+	}
+    }
+    int r = prog->match(data, data < end ? end - data : 0);
+    if (_anno >= 0)
+	p->set_anno_u8(_anno, r + 1);
+    return r >= 0 ? prog->action(r) : -1;
+}
+
+void
+PayloadClassifier::push(int, Packet *p)
+{
+    int flags;
+    const Program *prog = _program.read_begin(flags);
+    int o = classify(prog, p);
+    _program.read_end(flags);
+    checked_output_push(o, p);
+}
+
+#if HAVE_BATCH
+void
+PayloadClassifier::push_batch(int, PacketBatch *batch)
+{
+    int flags;
+    const Program *prog = _program.read_begin(flags);
+    auto fnt = [this, prog](Packet *p) -> int {
+	return classify(prog, p);
+    };
+    CLASSIFY_EACH_PACKET_PREFETCH(noutputs() + 1, fnt, batch, checked_output_push_batch, batch_prefetch_distance());
+    _program.read_end(flags);
+}
+#endif
+
+String
+PayloadClassifier::read_handler(Element *e, void *thunk)
+{
+    PayloadClassifier *pc = static_cast<PayloadClassifier *>(e);
+    int flags;
+    const Program *prog = pc->_program.read_begin(flags);
+    String s;
+    if (thunk)
+	s = prog->scan() == SCAN_AVX2 ? "avx2" : prog->scan() == SCAN_SSSE3 ? "ssse3" : "scalar";
+    else
+	s = prog->unparse();
+    pc->_program.read_end(flags);
+    return s;
+}
+
+int
+PayloadClassifier::write_handler(const String &str, Element *e, void *,
+				 ErrorHandler *errh)
+{
+    PayloadClassifier *pc = static_cast<PayloadClassifier *>(e);
+    Vector<String> args, conf;
+    for (const char *s = str.begin(); s < str.end(); ) {
+	const char *nl = find(s, str.end(), '\n');
+	cp_argvec(str.substring(s, nl), args);
+	s = nl + 1;
+    }
+    for (int i = 0; i < args.size(); ++i)
+	if (args[i])
+	    conf.push_back(args[i]);
+
+    Vector<Rule> rules;
+    if (parse_rules(conf, rules, pc->_anno >= 0 ? 255 : 0x7FFFFFFF, errh) < 0)
+	return -1;
+    for (int i = 0; i < rules.size(); ++i)
+	if (rules[i].action >= pc->noutputs())
+	    return errh->error("rule %d: output %d out of range", i + 1, rules[i].action);
+    Program *prog = new Program;
+    if (prog->compile(rules, pc->_simd ? best_scan() : SCAN_SCALAR, errh) < 0) {
+	delete prog;
+	return -1;
+    }
+
+    // The bucket write_begin() locks held the program retired by the
+    // previous swap, so no reader can still be using that program.
+    Program *&slot = pc->_program.write_begin();
+    delete pc->_retired;
+    pc->_retired = slot;
+    slot = prog;
+    pc->_program.write_commit();
+    return 0;
+}
+
+void
+PayloadClassifier::add_handlers()
+{
+    add_read_handler("patterns", read_handler, 0, Handler::CALM);
+    add_write_handler("patterns", write_handler, 0);
+    add_read_handler("simd", read_handler, 1, Handler::CALM);
+}
+
+CLICK_ENDDECLS
+EXPORT_ELEMENT(PayloadClassifier)
+ELEMENT_MT_SAFE(PayloadClassifier)
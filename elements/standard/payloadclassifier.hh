@@ -0,0 +1,195 @@
+// -*- c-basic-offset: 4 -*-
+#ifndef CLICK_PAYLOADCLASSIFIER_HH
+#define CLICK_PAYLOADCLASSIFIER_HH
+#include <click/batchelement.hh>
+#include <click/multithread.hh>
+#include <click/vector.hh>
+#if CLICK_USERLEVEL && (defined(__x86_64__) || defined(__i386__)) && (__GNUC__ >= 5 || defined(__clang__))
+# define PAYLOADCLASSIFIER_X86 1
+#endif
+CLICK_DECLS
+
+/*
+=c
+
+PayloadClassifier(ACTION_1 PATTERN_1, ..., ACTION_N PATTERN_N [, I<keywords>
+OFFSET, ANNO, SIMD])
+
+=s classification
+
+classifies packets by strings in their payloads
+
+=d
+
+Searches packet payloads for a set of literal strings. Like IPFilter,
+PayloadClassifier has an arbitrary number of rules, which are ACTION-PATTERN
+pairs. Packets are processed according to the ACTION of the first rule whose
+PATTERN matched. Packets that match no rule are dropped.
+
+Each ACTION is either a port number, which sends the packet out on that port;
+'C<allow>', which is equivalent to 'C<0>'; or 'C<drop>' (or 'C<deny>'), which
+drops the packet.
+
+Each PATTERN is one of:
+
+=over 8
+
+=item 'I<STRING>'
+
+Matches if STRING occurs anywhere in the payload.
+
+=item '^I<STRING>'
+
+Matches if the payload starts with STRING.
+
+=item '@I<N> I<STRING>'
+
+Matches if STRING occurs at payload offset N.
+
+=item '-'
+
+Matches every packet.
+
+=back
+
+STRINGs use Click's quoting rules, so "GET " and "\<16 03 01>" are both
+valid. All unanchored STRINGs are searched in one pass over the payload,
+Teddy-style: the first bytes of every string are hashed into eight buckets,
+and a SIMD shuffle over each 16- or 32-byte block of payload finds candidate
+positions, which are then checked against the strings of the matching
+buckets. Where SSSE3 or AVX2 is not available, a scalar loop runs the same
+algorithm one byte at a time.
+
+Keyword arguments are:
+
+=over 8
+
+=item OFFSET
+
+Where the payload starts. Either 'C<PAYLOAD>', the data after the TCP or UDP
+header (or after the IP header for other protocols), limited by the IP
+length; or a byte offset from the start of the packet. Packets without an IP
+header annotation are searched from their first byte. Default is
+'C<PAYLOAD>'.
+
+=item ANNO
+
+Annotation. If set, PayloadClassifier stores the number of the matching rule,
+counting from 1, in this one-byte annotation, or 0 if no rule matched.
+At most 255 rules are allowed. Default is no annotation.
+
+=item SIMD
+
+Boolean. If false, always use the scalar search. Default is true.
+
+=back
+
+=h patterns read/write
+
+Returns or sets the rules, one per line. Writing the handler compiles the new
+rules and swaps them in without stopping the traffic; packets already being
+classified finish with the old rules. The new rules must fit the element's
+outputs.
+
+=h simd read-only
+
+Returns the search implementation in use: 'C<avx2>', 'C<ssse3>', or
+'C<scalar>'.
+
+=e
+
+  PayloadClassifier(drop "/etc/passwd",
+                    1 ^"\<16 03>",
+                    0 -);
+
+=a IPFilter, Classifier, Paint */
+
+class PayloadClassifier : public BatchElement { public:
+
+    PayloadClassifier() CLICK_COLD;
+    ~PayloadClassifier() CLICK_COLD;
+
+    const char *class_name() const		{ return "PayloadClassifier"; }
+    const char *port_count() const		{ return "1/-"; }
+    const char *processing() const		{ return PUSH; }
+
+    int configure(Vector<String> &, ErrorHandler *) CLICK_COLD;
+    void cleanup(CleanupStage) CLICK_COLD;
+    void add_handlers() CLICK_COLD;
+
+    void push(int, Packet *);
+#if HAVE_BATCH
+    void push_batch(int, PacketBatch *);
+#endif
+
+    struct Rule {
+	String pattern;
+	int offset;		// anchor offset, or -1 for anywhere
+	int action;		// output port, or -1 for drop
+    };
+
+    enum { SCAN_SCALAR, SCAN_SSSE3, SCAN_AVX2 };
+
+    class Program { public:
+
+	Program() CLICK_COLD;
+
+	int compile(const Vector<Rule> &, int scan, ErrorHandler *) CLICK_COLD;
+	String unparse() const CLICK_COLD;
+
+	/** @brief Return the index of the first rule matching
+	 * @a data[0, @a len), or -1 if none does. */
+	inline int match(const unsigned char *data, int len) const;
+
+	inline int action(int rule) const {
+	    return _rules[rule].action;
+	}
+	int scan() const {
+	    return _scan;
+	}
+
+      private:
+
+	enum { NBUCKETS = 8, MAXPREFIX = 3 };
+
+	Vector<Rule> _rules;
+	Vector<int> _anchored;		// anchored rules, in order
+	Vector<int> _buckets[NBUCKETS];	// unanchored rules, in order
+	int _match_all;			// first rule matching everything
+	int _first_floating;		// first unanchored rule
+	int _prefix;			// bytes of each string in the filter
+	int _scan;
+
+	uint8_t _lo[MAXPREFIX][16];
+	uint8_t _hi[MAXPREFIX][16];
+	uint8_t _byte[MAXPREFIX][256];
+
+	inline int verify(const unsigned char *, int, int, unsigned, int) const;
+	int scan_scalar(const unsigned char *, int, int, int) const;
+#if PAYLOADCLASSIFIER_X86
+	int scan_ssse3(const unsigned char *, int, int) const;
+	int scan_avx2(const unsigned char *, int, int) const;
+#endif
+
+    };
+
+  private:
+
+    click_rcu<Program *> _program;
+    Program *_retired;
+    int _offset;		// -1 means PAYLOAD
+    int _anno;
+    bool _simd;
+
+    static int parse_rules(const Vector<String> &, Vector<Rule> &, int,
+			   ErrorHandler *) CLICK_COLD;
+    inline int classify(const Program *, Packet *) const;
+
+    static String read_handler(Element *, void *) CLICK_COLD;
+    static int write_handler(const String &, Element *, void *,
+			     ErrorHandler *) CLICK_COLD;
+
+};
+
+CLICK_ENDDECLS
+#endif
@@ -103,7 +103,8 @@ Pipeliner::initialize(ErrorHandler *errh)
     bool fp;
     Bitvector passing = get_passing_threads(false, -1, this, fp);
     storage.compress(passing);
-    stats.compress(passing);
+    _dropped.initialize(this, "dropped");
+    _count.initialize(this, "count");
     _home_thread_id = home_thread_id();
 
     if (_ring_size == -1) {
@@ -159,23 +160,25 @@ void Pipeliner::push_batch(int,PacketBatch* head) {
     int count = head->count();
     retry:
     if (storage->insert(head)) {
-        stats->count += count;
+        _count.add(count);
         if (sleepiness >= _sleep_threshold)
             _task.reschedule();
     } else {
         if (_block) {
             if (!_always_up && sleepiness >= _sleep_threshold)
                 _task.reschedule();
-            stats->dropped++;
-            if (_verbose && stats->dropped < 10 || ((stats->dropped & 0xffffffff) == 1))
+            uint64_t &dropped = _dropped.local();
+            dropped++;
+            if (_verbose && dropped < 10 || ((dropped & 0xffffffff) == 1))
                 click_chatter("%p{element} : congestion", this);
             goto retry;
         }
         int c = head->count();
         head->kill();
-        stats->dropped+=c;
-        if (_verbose && stats->dropped < 10 || ((stats->dropped & 0xffffffff) == 1))
-            click_chatter("%p{element} : Dropped %lu packets : have %u packets in ring", this, stats->dropped, c);
+        uint64_t &dropped = _dropped.local();
+        dropped += c;
+        if (_verbose && dropped < 10 || ((dropped & 0xffffffff) == 1))
+            click_chatter("%p{element} : Dropped %lu packets : have %u packets in ring", this, (unsigned long) dropped, c);
     }
 }
 #endif
@@ -190,22 +193,24 @@ Pipeliner::push(int,Packet* p)
 
 retry:
     if (storage->insert(p)) {
-        stats->count++;
+        _count.inc();
     } else {
         if (_block) {
             if (!_always_up && sleepiness >= _sleep_threshold)
                 _task.reschedule();
 
-            stats->dropped++;
-            if (_verbose && (stats->dropped < 10 || ((stats->dropped & 0xffffffff) == 1)))
+            uint64_t &dropped = _dropped.local();
+            dropped++;
+            if (_verbose && (dropped < 10 || ((dropped & 0xffffffff) == 1)))
                 click_chatter("%p{element} : congestion", this);
 
             goto retry;
         }
         p->kill();
-        stats->dropped++;
-        if (_verbose && (stats->dropped < 10 || ((stats->dropped & 0xffffffff) == 1)))
-            click_chatter("%p{element} : Dropped %lu packets : have %u packets in ring", this, stats->dropped, storage->count());
+        uint64_t &dropped = _dropped.local();
+        dropped++;
+        if (_verbose && (dropped < 10 || ((dropped & 0xffffffff) == 1)))
+            click_chatter("%p{element} : Dropped %lu packets : have %u packets in ring", this, (unsigned long) dropped, storage->count());
     }
 
     if (!_always_up && sleepiness >= _sleep_threshold && _active)
@@ -6,6 +6,7 @@
 #include <click/task.hh>
 #include <click/ring.hh>
 #include <click/multithread.hh>
+#include <click/statscounter.hh>
 
 CLICK_DECLS
 
@@ -18,6 +19,9 @@ Fast version of ThreadSafeQueue->Unqueue, allowing to offload processing
 of packets pushed to this element to another one, without the inherent
 scheduling cost of normal queues. Multiple thread can push packets to
 this queue, and the home thread of this element will push packet out.
+
+In a router with a StatsExport element, the per-thread "count" and "dropped"
+counters are exported as "NAME.count" and "NAME.dropped".
 */
 
 
@@ -55,13 +59,11 @@ public:
     bool run_task(Task *);
 
     unsigned long n_dropped() {
-        PER_THREAD_MEMBER_SUM(unsigned long,total,stats,dropped);
-        return total;
+        return _dropped.value();
     }
 
     unsigned long n_count() {
-        PER_THREAD_MEMBER_SUM(unsigned long,total,stats,count);
-        return total;
+        return _count.value();
     }
 
     static String dropped_handler(Element *e, void *)
@@ -91,14 +93,8 @@ public:
     typedef DynamicRing<Packet*> PacketRing;
 
     per_thread_oread<PacketRing> storage;
-    struct stats {
-        stats() : dropped(0), count(0) {
-
-        }
-        unsigned long dropped;
-        unsigned long count;
-    };
-    per_thread_oread<struct stats> stats;
+    StatsCounter _dropped;
+    StatsCounter _count;
     volatile int sleepiness;
     int _sleep_threshold;
 
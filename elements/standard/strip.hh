@@ -24,6 +24,7 @@ class Strip : public BatchElement { public:
 
     const char *class_name() const		{ return "Strip"; }
     const char *port_count() const		{ return PORTS_1_1; }
+    const char *flags() const			{ return "F"; }
 
     int configure(Vector<String> &, ErrorHandler *) CLICK_COLD;
 
@@ -20,6 +20,13 @@ CLICK_DECLS
  * Tee and PullTee have however many outputs are used in the configuration,
  * but you can say how many outputs you expect with the optional argument
  * N.
+ *
+ * The copies are clones: they share the original packet's data, and only the
+ * last output receives the original packet itself.  An element that writes
+ * to a clone, for instance an encapsulation element that pushes a header,
+ * gets a private copy of the headroom and data, but not of the unused
+ * tailroom; so replication costs grow with the packet length rather than the
+ * buffer size.
  */
 
 class Tee : public BatchElement {
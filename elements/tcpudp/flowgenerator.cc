@@ -0,0 +1,580 @@
+// -*- c-basic-offset: 4 -*-
+/*
+ * flowgenerator.{cc,hh} -- generates UDP flows following traffic distributions
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Click LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Click LICENSE file; the license in that file is
+ * legally binding.
+ */
+
+#include <click/config.h>
+#include "flowgenerator.hh"
+#include <click/args.hh>
+#include <click/error.hh>
+#include <click/etheraddress.hh>
+#include <click/master.hh>
+#include <click/router.hh>
+#include <click/straccum.hh>
+#include <clicknet/ip.h>
+#include <clicknet/udp.h>
+#include <math.h>
+CLICK_DECLS
+
+const uint64_t FlowGenerator::no_limit;
+
+// Zipf sampling by rejection-inversion (Hormann and Derflinger, "Rejection-
+// inversion to generate variates from monotone discrete distributions", 1996):
+// constant expected time and no tables, whatever the number of flows.
+
+static inline double
+zipf_helper1(double x)		// log1p(x) / x
+{
+    if (fabs(x) > 1e-8)
+	return log1p(x) / x;
+    return 1 - x * (0.5 - x * (1.0 / 3 - 0.25 * x));
+}
+
+static inline double
+zipf_helper2(double x)		// expm1(x) / x
+{
+    if (fabs(x) > 1e-8)
+	return expm1(x) / x;
+    return 1 + x * 0.5 * (1 + x * (1.0 / 3) * (1 + 0.25 * x));
+}
+
+inline double
+FlowGenerator::Zipf::h(double x) const
+{
+    return exp(-s * log(x));
+}
+
+inline double
+FlowGenerator::Zipf::h_integral(double x) const
+{
+    double lx = log(x);
+    return zipf_helper2((1 - s) * lx) * lx;
+}
+
+inline double
+FlowGenerator::Zipf::h_integral_inverse(double x) const
+{
+    double t = x * (1 - s);
+    if (t < -1)			// rounding errors
+	t = -1;
+    return exp(zipf_helper1(t) * x);
+}
+
+void
+FlowGenerator::Zipf::initialize(uint32_t n_, double s_)
+{
+    n = n_;
+    s = s_;
+    h_integral_x1 = h_integral(1.5) - 1;
+    h_integral_n = h_integral(n + 0.5);
+    threshold = 2 - h_integral_inverse(h_integral(2.5) - h(2));
+}
+
+template <typename R> inline uint32_t
+FlowGenerator::Zipf::sample(R uniform) const
+{
+    while (1) {
+	double u = h_integral_n + uniform() * (h_integral_x1 - h_integral_n);
+	double x = h_integral_inverse(u);
+	double k = floor(x + 0.5);
+	if (k < 1)
+	    k = 1;
+	else if (k > n)
+	    k = n;
+	if (k - x <= threshold || u >= h_integral(k + 0.5) - h(k))
+	    return (uint32_t) k - 1;
+    }
+}
+
+// Maps flow numbers to 5-tuples (the MurmurHash3 finalizer).
+static inline uint64_t
+flow_mix(uint64_t x)
+{
+    x ^= x >> 33;
+    x *= 0xFF51AFD7ED558CCDULL;
+    x ^= x >> 33;
+    x *= 0xC4CEB9FE1A85EC53ULL;
+    x ^= x >> 33;
+    return x;
+}
+
+FlowGenerator::FlowGenerator()
+    : _dport(-1), _nflows(65536), _zipf_flows(true), _max_size(0), _min_size(0),
+      _arrival(ARRIVAL_CONSTANT), _gap(0), _on(1e7), _off(1e7), _burst(32),
+      _limit(no_limit), _stop(false), _nthreads(1), _seed(0), _pool_size(2048),
+      _cksum(true), _number_offset(-1), _timestamp_offset(-1),
+      _timestamp(false), _active(true), _cksum_len(sizeof(click_udp))
+{
+#if HAVE_BATCH
+    in_batch_mode = BATCH_MODE_YES;
+#endif
+    _reserved = 0;
+    _number = 0;
+}
+
+FlowGenerator::~FlowGenerator()
+{
+}
+
+int
+FlowGenerator::parse_sizes(const String &str, ErrorHandler *errh)
+{
+    String text = cp_unquote(str);
+    if (text == "imix")
+	text = "60:7 590:4 1514:1";
+
+    Vector<String> words;
+    cp_spacevec(text, words);
+    if (!words.size())
+	return errh->error("SIZES is empty");
+    Vector<double> weights;
+    double total = 0;
+    for (int i = 0; i < words.size(); ++i) {
+	uint32_t len;
+	double weight = 1;
+	int colon = words[i].find_left(':');
+	String lenstr = colon < 0 ? words[i] : words[i].substring(0, colon);
+	if (!IntArg().parse(lenstr, len)
+	    || (colon >= 0
+		&& (!DoubleArg().parse(words[i].substring(colon + 1), weight)
+		    || weight < 0)))
+	    return errh->error("SIZES: bad size %<%s%>", words[i].c_str());
+	if (len < 60 || len > 65535 + sizeof(click_ether))
+	    return errh->error("SIZES: length %u out of range", len);
+	_sizes.push_back(len);
+	weights.push_back(weight);
+	total += weight;
+    }
+    if (total <= 0)
+	return errh->error("SIZES: weights are all zero");
+
+    // Vose's alias method: each column holds at most two sizes
+    int n = _sizes.size();
+    _size_prob.assign(n, 0);
+    _size_alias.assign(n, 0);
+    Vector<double> scaled(n, 0);
+    Vector<int> small, large;
+    for (int i = 0; i < n; ++i) {
+	scaled[i] = weights[i] * n / total;
+	(scaled[i] < 1 ? small : large).push_back(i);
+    }
+    while (small.size() && large.size()) {
+	int s = small.back(), l = large.back();
+	small.pop_back();
+	_size_prob[s] = scaled[s];
+	_size_alias[s] = l;
+	scaled[l] -= 1 - scaled[s];
+	if (scaled[l] < 1) {
+	    large.pop_back();
+	    small.push_back(l);
+	}
+    }
+    for (int i = 0; i < small.size(); ++i)
+	_size_prob[small[i]] = 1;
+    for (int i = 0; i < large.size(); ++i)
+	_size_prob[large[i]] = 1;
+
+    _min_size = _max_size = _sizes[0];
+    for (int i = 1; i < n; ++i) {
+	_min_size = _sizes[i] < _min_size ? _sizes[i] : _min_size;
+	_max_size = _sizes[i] > _max_size ? _sizes[i] : _max_size;
+    }
+    return 0;
+}
+
+int
+FlowGenerator::configure(Vector<String> &conf, ErrorHandler *errh)
+{
+    memset(&_ethh, 0, sizeof(_ethh));
+    _srcnet = IPAddress(String("10.0.0.0"));
+    _srcmask = IPAddress::make_prefix(8);
+    _dstnet = IPAddress(String("172.16.0.0"));
+    _dstmask = IPAddress::make_prefix(12);
+    String flow_dist = "zipf", arrival = "constant", sizes = "60";
+    double zipf = 1;
+    uint32_t rate = 0;
+    Timestamp on = Timestamp::make_msec(10), off = Timestamp::make_msec(10);
+    int64_t limit = -1;
+    uint32_t seed = 0;
+    uint16_t dport;
+    bool has_dport;
+
+    if (Args(conf, this, errh)
+	.read("SRCETH", EtherAddressArg(), _ethh.ether_shost)
+	.read("DSTETH", EtherAddressArg(), _ethh.ether_dhost)
+	.read("SRCNET", IPPrefixArg(true), _srcnet, _srcmask)
+	.read("DSTNET", IPPrefixArg(true), _dstnet, _dstmask)
+	.read("DPORT", IPPortArg(IP_PROTO_UDP), dport).read_status(has_dport)
+	.read("FLOWS", _nflows)
+	.read("FLOW_DIST", WordArg(), flow_dist)
+	.read("ZIPF", zipf)
+	.read("SIZES", AnyArg(), sizes)
+	.read("ARRIVAL", WordArg(), arrival)
+	.read("RATE", rate)
+	.read("ON", on)
+	.read("OFF", off)
+	.read("BURST", _burst)
+	.read("LIMIT", limit)
+	.read("STOP", _stop)
+	.read("THREADS", _nthreads)
+	.read("SEED", seed)
+	.read("POOL", _pool_size)
+	.read("CHECKSUM", _cksum)
+	.read("NUMBER_OFFSET", _number_offset)
+	.read("TIMESTAMP_OFFSET", _timestamp_offset)
+	.read("TIMESTAMP", _timestamp)
+	.read("ACTIVE", _active)
+	.complete() < 0)
+	return -1;
+
+    _ethh.ether_type = htons(ETHERTYPE_IP);
+    _dport = has_dport ? dport : -1;
+    _srcnet &= _srcmask;
+    _dstnet &= _dstmask;
+
+    if (_nflows == 0)
+	return errh->error("FLOWS must be positive");
+    if (flow_dist == "zipf")
+	_zipf_flows = true;
+    else if (flow_dist == "uniform")
+	_zipf_flows = false;
+    else
+	return errh->error("FLOW_DIST must be %<zipf%> or %<uniform%>");
+    if (!(zipf > 0))
+	return errh->error("ZIPF must be positive");
+    _zipf.initialize(_nflows, zipf);
+
+    if (parse_sizes(sizes, errh) < 0)
+	return -1;
+
+    if (arrival == "constant")
+	_arrival = ARRIVAL_CONSTANT;
+    else if (arrival == "poisson")
+	_arrival = ARRIVAL_POISSON;
+    else if (arrival == "onoff")
+	_arrival = ARRIVAL_ONOFF;
+    else
+	return errh->error("ARRIVAL must be %<constant%>, %<poisson%>, or %<onoff%>");
+    _gap = rate ? 1e9 / rate : 0;
+    _on = on.doubleval() * 1e9;
+    _off = off.doubleval() * 1e9;
+    if (_arrival == ARRIVAL_ONOFF && !(_on > 0 && _off >= 0))
+	return errh->error("ON must be positive");
+
+    if (_burst == 0)
+	return errh->error("BURST must be positive");
+    _limit = limit >= 0 ? (uint64_t) limit : no_limit;
+    if (_nthreads <= 0 || _nthreads > master()->nthreads())
+	return errh->error("THREADS must be between 1 and %d", master()->nthreads());
+    if (_pool_size == 0)
+	return errh->error("POOL must be positive");
+    _seed = seed ? seed : click_random();
+
+    // Probes live in the UDP payload, and the checksum covers them; the rest
+    // of the payload is zero and does not change the checksum.
+    int payload = sizeof(click_ether) + sizeof(click_ip) + sizeof(click_udp);
+    if (_number_offset >= 0
+	&& (_number_offset < payload || _number_offset + 8 > (int) _min_size))
+	return errh->error("NUMBER_OFFSET must lie in the UDP payload of the smallest packet");
+    if (_timestamp_offset >= 0
+	&& (_timestamp_offset < payload || _timestamp_offset + 8 > (int) _min_size))
+	return errh->error("TIMESTAMP_OFFSET must lie in the UDP payload of the smallest packet");
+    if (_number_offset >= 0 && _timestamp_offset >= 0
+	&& _number_offset < _timestamp_offset + 8 && _timestamp_offset < _number_offset + 8)
+	return errh->error("NUMBER_OFFSET and TIMESTAMP_OFFSET overlap");
+    int probe_end = payload;
+    if (_number_offset >= 0 && _number_offset + 8 > probe_end)
+	probe_end = _number_offset + 8;
+    if (_timestamp_offset >= 0 && _timestamp_offset + 8 > probe_end)
+	probe_end = _timestamp_offset + 8;
+    _cksum_len = probe_end - sizeof(click_ether) - sizeof(click_ip);
+    return 0;
+}
+
+WritablePacket *
+FlowGenerator::make_template()
+{
+    WritablePacket *q = Packet::make(Packet::default_headroom, 0, _max_size, 0);
+    if (!q)
+	return 0;
+    memset(q->data(), 0, _max_size);
+    memcpy(q->data(), &_ethh, sizeof(click_ether));
+    click_ip *ip = reinterpret_cast<click_ip *>(q->data() + sizeof(click_ether));
+    ip->ip_v = 4;
+    ip->ip_hl = sizeof(click_ip) >> 2;
+    ip->ip_ttl = 64;
+    ip->ip_p = IP_PROTO_UDP;
+    q->set_mac_header(q->data(), sizeof(click_ether));
+    q->set_ip_header(ip, sizeof(click_ip));
+    return q;
+}
+
+int
+FlowGenerator::initialize(ErrorHandler *errh)
+{
+    _count.initialize(this, "count");
+    _byte_count.initialize(this, "byte_count", CLICK_STATS_F_BYTES);
+
+    int home = router()->home_thread_id(this);
+    for (int i = 0; i < _nthreads; ++i) {
+	int thread = (home + i) % master()->nthreads();
+	State &s = _state.get_value_for_thread(thread);
+	std::seed_seq seq{(uint32_t) _seed, (uint32_t) (_seed >> 32), (uint32_t) thread};
+	s.rng.seed(seq);
+	s.pool.resize(_pool_size, 0);
+	for (unsigned j = 0; j < _pool_size; ++j)
+	    if (!(s.pool[j] = make_template()))
+		return errh->error("out of memory");
+
+	Task *t = new Task(this);
+	t->initialize(this, false);
+	t->move_thread(thread);
+	if (_active)
+	    t->reschedule();
+	_tasks.push_back(t);
+    }
+    return 0;
+}
+
+void
+FlowGenerator::cleanup(CleanupStage)
+{
+    for (int i = 0; i < _tasks.size(); ++i)
+	delete _tasks[i];
+    _tasks.clear();
+    for (unsigned i = 0; i < _state.weight(); ++i) {
+	State &s = _state.get_value(i);
+	for (int j = 0; j < s.pool.size(); ++j)
+	    if (s.pool[j])
+		s.pool[j]->kill();
+	s.pool.clear();
+    }
+}
+
+bool
+FlowGenerator::get_spawning_threads(Bitvector &b, bool)
+{
+    int home = router()->home_thread_id(this);
+    for (int i = 0; i < _nthreads; ++i)
+	b[(home + i) % master()->nthreads()] = 1;
+    return false;
+}
+
+inline double
+FlowGenerator::uniform(State &s)
+{
+    return (s.rng() >> 11) * (1.0 / 9007199254740992.0);	// [0, 1)
+}
+
+inline void
+FlowGenerator::advance(State &s)
+{
+    if (_arrival == ARRIVAL_CONSTANT)
+	s.next += _gap;
+    else
+	s.next += -log1p(-uniform(s)) * _gap;
+    // An ON period ended: skip the OFF period that follows it.
+    while (_arrival == ARRIVAL_ONOFF && s.next >= s.period_end) {
+	double off = -log1p(-uniform(s)) * _off;
+	double on = -log1p(-uniform(s)) * _on;
+	s.next += off;
+	s.period_end += off + on;
+    }
+}
+
+inline Packet *
+FlowGenerator::make_packet(State &s, uint32_t number, uint64_t now)
+{
+    WritablePacket *&slot = s.pool[s.pool_next];
+    if (++s.pool_next == (unsigned) s.pool.size())
+	s.pool_next = 0;
+    if (slot->shared()) {
+	// a clone of the last use is still downstream
+	WritablePacket *q = make_template();
+	if (!q)
+	    return 0;
+	slot->kill();
+	slot = q;
+    }
+
+    uint32_t flow;
+    if (_zipf_flows)
+	flow = _zipf.sample([&s, this]() { return uniform(s); });
+    else
+	flow = (uint32_t) ((s.rng() >> 32) * _nflows >> 32);
+    uint32_t col = (uint32_t) ((s.rng() >> 32) * _sizes.size() >> 32);
+    uint32_t len = uniform(s) < _size_prob[col] ? _sizes[col] : _sizes[_size_alias[col]];
+
+    uint64_t h1 = flow_mix(_seed ^ ((uint64_t) flow << 1));
+    uint64_t h2 = flow_mix(h1 ^ 0x9E3779B97F4A7C15ULL);
+    click_ip *ip = reinterpret_cast<click_ip *>(slot->data() + sizeof(click_ether));
+    click_udp *udp = reinterpret_cast<click_udp *>(ip + 1);
+    uint32_t ulen = len - sizeof(click_ether) - sizeof(click_ip);
+    ip->ip_len = htons(len - sizeof(click_ether));
+    ip->ip_id = htons(++s.ip_id);
+    ip->ip_src.s_addr = _srcnet.addr() | ((uint32_t) h1 & ~_srcmask.addr());
+    ip->ip_dst.s_addr = _dstnet.addr() | ((uint32_t) h2 & ~_dstmask.addr());
+    ip->ip_sum = 0;
+    ip->ip_sum = click_in_cksum((const unsigned char *) ip, sizeof(click_ip));
+    udp->uh_sport = htons(1024 + (uint32_t) (h1 >> 32) % 64512);
+    udp->uh_dport = htons(_dport >= 0 ? _dport : 1024 + (uint32_t) (h2 >> 32) % 64512);
+    udp->uh_ulen = htons(ulen);
+    if (_number_offset >= 0)
+	*reinterpret_cast<uint64_t *>(slot->data() + _number_offset) = number;
+    if (_timestamp_offset >= 0)
+	*reinterpret_cast<uint64_t *>(slot->data() + _timestamp_offset) = now;
+    udp->uh_sum = 0;
+    if (_cksum) {
+	unsigned csum = click_in_cksum((const unsigned char *) udp, _cksum_len);
+	udp->uh_sum = click_in_cksum_pseudohdr(csum, ip, ulen);
+    }
+
+    Packet *p = slot->clone();
+    if (!p)
+	return 0;
+    if (len < _max_size)
+	p->take(_max_size - len);
+    p->set_dst_ip_anno(ip->ip_dst);
+    if (_timestamp)
+	p->timestamp_anno().assign_now();
+    _byte_count.add(len);
+    return p;
+}
+
+bool
+FlowGenerator::run_task(Task *t)
+{
+    if (!_active)
+	return false;
+    State &s = *_state;
+
+    unsigned n = _burst;
+    if (_gap > 0) {
+	double now = Timestamp::now_steady().nsecval();
+	// Do not try to catch up with more than a millisecond of backlog.
+	if (s.next < now - 1e6) {
+	    s.next = now;
+	    if (s.period_end < now)
+		s.period_end = now - log1p(-uniform(s)) * _on;
+	}
+	for (n = 0; n < _burst && s.next <= now; ++n)
+	    advance(s);
+    }
+
+    bool last = false;
+    if (n && _limit != no_limit) {
+	uint64_t old, want;
+	do {
+	    old = _reserved;
+	    want = old + n < _limit ? old + n : _limit;
+	} while (_reserved.compare_swap(old, want) != old);
+	n = want - old;
+	last = n && want == _limit;
+    }
+
+    if (n) {
+	uint32_t number = _number_offset >= 0 ? _number.fetch_and_add(n) : 0;
+	uint64_t now = _timestamp_offset >= 0 ? Timestamp::now().nsecval() : 0;
+	Packet *head = 0, *tail = 0;
+	unsigned made = 0;
+	for (unsigned i = 0; i < n; ++i) {
+	    Packet *p = make_packet(s, number + i, now);
+	    if (!p)
+		break;
+	    if (tail)
+		tail->set_next(p);
+	    else
+		head = p;
+	    tail = p;
+	    ++made;
+	}
+	if (made) {
+	    tail->set_next(0);
+	    _count.add(made);
+#if HAVE_BATCH
+	    output_push_batch(0, PacketBatch::make_from_simple_list(head, tail, made));
+#else
+	    for (Packet *p = head, *next; p; p = next) {
+		next = p->next();
+		p->set_next(0);
+		output(0).push(p);
+	    }
+#endif
+	}
+    }
+
+    if (last) {
+	if (_stop)
+	    router()->please_stop_driver();
+    } else if (_limit == no_limit || _reserved < _limit)
+	t->fast_reschedule();
+    return n > 0;
+}
+
+enum { h_count, h_byte_count, h_active, h_reset };
+
+String
+FlowGenerator::read_handler(Element *e, void *thunk)
+{
+    FlowGenerator *fg = static_cast<FlowGenerator *>(e);
+    switch ((intptr_t) thunk) {
+    case h_count:
+	return String(fg->_count.value());
+    case h_byte_count:
+	return String(fg->_byte_count.value());
+    case h_active:
+	return String(fg->_active);
+    default:
+	return String();
+    }
+}
+
+int
+FlowGenerator::write_handler(const String &str, Element *e, void *thunk,
+			     ErrorHandler *errh)
+{
+    FlowGenerator *fg = static_cast<FlowGenerator *>(e);
+    switch ((intptr_t) thunk) {
+    case h_active: {
+	bool active;
+	if (!BoolArg().parse(str, active))
+	    return errh->error("syntax error");
+	fg->_active = active;
+	if (active)
+	    for (int i = 0; i < fg->_tasks.size(); ++i)
+		fg->_tasks[i]->reschedule();
+	return 0;
+    }
+    case h_reset:
+	fg->_count.clear();
+	fg->_byte_count.clear();
+	return 0;
+    default:
+	return -1;
+    }
+}
+
+void
+FlowGenerator::add_handlers()
+{
+    add_read_handler("count", read_handler, h_count);
+    add_read_handler("byte_count", read_handler, h_byte_count);
+    add_read_handler("active", read_handler, h_active, Handler::CHECKBOX);
+    add_write_handler("active", write_handler, h_active);
+    add_write_handler("reset", write_handler, h_reset, Handler::BUTTON);
+}
+
+CLICK_ENDDECLS
+ELEMENT_REQUIRES(userlevel)
+EXPORT_ELEMENT(FlowGenerator)
+ELEMENT_MT_SAFE(FlowGenerator)
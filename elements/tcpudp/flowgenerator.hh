@@ -0,0 +1,283 @@
+// -*- c-basic-offset: 4 -*-
+#ifndef CLICK_FLOWGENERATOR_HH
+#define CLICK_FLOWGENERATOR_HH
+#include <click/batchelement.hh>
+#include <click/task.hh>
+#include <click/sync.hh>
+#include <click/atomic.hh>
+#include <click/statscounter.hh>
+#include <click/ipaddress.hh>
+#include <clicknet/ether.h>
+#include <random>
+CLICK_DECLS
+
+/*
+=c
+
+FlowGenerator([I<keywords> SRCETH, DSTETH, SRCNET, DSTNET, DPORT, FLOWS,
+FLOW_DIST, ZIPF, SIZES, ARRIVAL, RATE, ON, OFF, BURST, LIMIT, STOP, THREADS,
+SEED, POOL, CHECKSUM, NUMBER_OFFSET, TIMESTAMP_OFFSET, TIMESTAMP, ACTIVE])
+
+=s udp
+
+generates UDP flows following traffic distributions
+
+=d
+
+FlowGenerator is a benchmark tool. It pushes batches of UDP/IP/Ethernet packets
+whose flows, sizes, and arrival times follow configurable distributions, so
+that lab traffic stresses caches and flow tables the way production traffic
+does.
+
+Each packet belongs to one of FLOWS flows. A flow's addresses and ports are a
+fixed pseudo-random function of its number and SEED, so a flow always maps to
+the same 5-tuple and flow tables see exactly FLOWS distinct flows. Flow
+numbers are drawn from a Zipf distribution with exponent ZIPF, making a few
+flows carry most packets, or uniformly. Packet sizes are drawn from SIZES, and
+departures follow ARRIVAL.
+
+FlowGenerator runs one task on each of THREADS threads, starting with its home
+thread. Each task has its own random number generator, seeded from SEED and
+its thread, and its own pool of POOL preallocated packets. Packets are built
+by patching the headers of a pool packet in place and pushing a clone of it,
+so no packet data is copied or zeroed per packet. A pool packet is reused
+only once the clones of its previous use are gone; if one is still held
+downstream, it is replaced by a fresh packet.
+
+Keyword arguments are:
+
+=over 8
+
+=item SRCETH, DSTETH
+
+Ethernet addresses. Default is 00:00:00:00:00:00.
+
+=item SRCNET, DSTNET
+
+IP prefixes from which flows' source and destination addresses are drawn.
+Defaults are 10.0.0.0/8 and 172.16.0.0/12.
+
+=item DPORT
+
+Destination port of all flows. By default each flow has a pseudo-random
+destination port, like its source port, between 1024 and 65535.
+
+=item FLOWS
+
+Number of distinct flows. Default is 65536.
+
+=item FLOW_DIST
+
+Either C<zipf> or C<uniform>: how packets are spread over flows. Default is
+C<zipf>.
+
+=item ZIPF
+
+Positive real number, the Zipf exponent. With FLOW_DIST C<zipf>, the flow of
+rank I<k> gets a share of packets proportional to 1/I<k>^ZIPF. Default is 1.
+
+=item SIZES
+
+Packet size distribution: C<imix>, a single length, or a space-separated list
+of 'I<LENGTH>:I<WEIGHT>' pairs, such as '60:7 590:4 1514:1'. Lengths include
+the Ethernet header and not the FCS, and must be at least 60. C<imix> is the
+simple IMIX, '60:7 590:4 1514:1'. Default is 60.
+
+=item ARRIVAL
+
+Arrival process: C<constant>, C<poisson>, or C<onoff>. C<constant> spaces
+packets evenly at RATE. C<poisson> draws exponential gaps with mean 1/RATE.
+C<onoff> alternates ON and OFF periods of exponentially distributed lengths,
+sending a Poisson process at RATE during ON periods and nothing during OFF
+periods. Default is C<constant>.
+
+=item RATE
+
+Packets per second, per thread. Zero means as fast as possible; ARRIVAL is
+then ignored. Default is 0.
+
+=item ON, OFF
+
+Mean lengths of ON and OFF periods for ARRIVAL C<onoff>. Defaults are 10ms.
+
+=item BURST
+
+Maximum number of packets per batch. Default is 32.
+
+=item LIMIT
+
+Total number of packets to send, over all threads. Negative means no limit.
+Default is -1.
+
+=item STOP
+
+Boolean. If true, stop the driver once LIMIT packets have been sent. Default
+is false.
+
+=item THREADS
+
+Number of threads to generate packets on. Default is 1.
+
+=item SEED
+
+Unsigned. Seed of the flow-to-5-tuple mapping and of the random number
+generators. Zero means pick one at random. Default is 0.
+
+=item POOL
+
+Number of preallocated packets per thread. Default is 2048.
+
+=item CHECKSUM
+
+Boolean. If true, compute UDP checksums; otherwise leave them zero. Default
+is true.
+
+=item NUMBER_OFFSET
+
+If nonnegative, write a packet number in the packets' data at this offset,
+as NumberPacket does, so that RecordTimestamp and TimestampDiff can measure
+latency downstream. Numbers are unique over all threads. Default is -1.
+
+=item TIMESTAMP_OFFSET
+
+If nonnegative, write the time each packet is generated, as a 64-bit count of
+nanoseconds of the system clock, in the packets' data at this offset. Default
+is -1.
+
+=item TIMESTAMP
+
+Boolean. If true, set each packet's timestamp annotation. Default is false.
+
+=item ACTIVE
+
+Boolean. If false, do not generate packets. Default is true.
+
+=back
+
+Offsets given to NUMBER_OFFSET and TIMESTAMP_OFFSET must lie in the UDP
+payload of the smallest packet.
+
+=h count read-only
+
+Returns the number of packets generated.
+
+=h byte_count read-only
+
+Returns the number of bytes generated.
+
+=h active read/write
+
+Returns or sets ACTIVE.
+
+=h reset write-only
+
+Resets the counts.
+
+=e
+
+  FlowGenerator(SRCETH 0:0:0:0:0:1, DSTETH 0:0:0:0:0:2,
+                FLOWS 1000000, ZIPF 1.1, SIZES imix,
+                ARRIVAL poisson, RATE 2000000, THREADS 4)
+    -> ToDPDKDevice(0);
+
+=a FastUDPFlows, FastTCPFlows, NumberPacket, RecordTimestamp, TimestampDiff */
+
+class FlowGenerator : public BatchElement { public:
+
+    FlowGenerator() CLICK_COLD;
+    ~FlowGenerator() CLICK_COLD;
+
+    const char *class_name() const	{ return "FlowGenerator"; }
+    const char *port_count() const	{ return PORTS_0_1; }
+    const char *processing() const	{ return PUSH; }
+
+    int configure(Vector<String> &, ErrorHandler *) CLICK_COLD;
+    int initialize(ErrorHandler *) CLICK_COLD;
+    void cleanup(CleanupStage) CLICK_COLD;
+    void add_handlers() CLICK_COLD;
+
+    bool get_spawning_threads(Bitvector &, bool) override;
+    bool run_task(Task *);
+
+  private:
+
+    enum { ARRIVAL_CONSTANT, ARRIVAL_POISSON, ARRIVAL_ONOFF };
+
+    struct Zipf {
+	double s;
+	double h_integral_x1;
+	double h_integral_n;
+	double threshold;
+	uint32_t n;
+	void initialize(uint32_t n, double s);
+	inline double h(double x) const;
+	inline double h_integral(double x) const;
+	inline double h_integral_inverse(double x) const;
+	template <typename R> inline uint32_t sample(R uniform) const;
+    };
+
+    struct State {
+	std::mt19937_64 rng;
+	Vector<WritablePacket *> pool;
+	unsigned pool_next;
+	double next;		// next departure, nanoseconds
+	double period_end;	// end of the current ON period, nanoseconds
+	uint16_t ip_id;
+	State()
+	    : pool_next(0), next(0), period_end(0), ip_id(0) {
+	}
+    };
+
+    click_ether _ethh;
+    IPAddress _srcnet;
+    IPAddress _srcmask;
+    IPAddress _dstnet;
+    IPAddress _dstmask;
+    int _dport;
+    uint32_t _nflows;
+    bool _zipf_flows;
+    Zipf _zipf;
+    Vector<uint32_t> _sizes;	// Walker alias table over SIZES
+    Vector<double> _size_prob;
+    Vector<int> _size_alias;
+    uint32_t _max_size;
+    uint32_t _min_size;
+    int _arrival;
+    double _gap;		// nanoseconds
+    double _on;
+    double _off;
+    unsigned _burst;
+    uint64_t _limit;
+    bool _stop;
+    int _nthreads;
+    uint64_t _seed;
+    unsigned _pool_size;
+    bool _cksum;
+    int _number_offset;
+    int _timestamp_offset;
+    bool _timestamp;
+    bool _active;
+    int _cksum_len;		// UDP bytes the checksum must cover
+
+    per_thread<State> _state;
+    Vector<Task *> _tasks;
+    atomic_uint64_t _reserved;
+    atomic_uint32_t _number;
+    StatsCounter _count;
+    StatsCounter _byte_count;
+
+    static const uint64_t no_limit = ~(uint64_t) 0;
+
+    int parse_sizes(const String &, ErrorHandler *) CLICK_COLD;
+    WritablePacket *make_template() CLICK_COLD;
+    inline double uniform(State &);
+    inline void advance(State &);
+    inline Packet *make_packet(State &, uint32_t number, uint64_t now);
+
+    static String read_handler(Element *, void *) CLICK_COLD;
+    static int write_handler(const String &, Element *, void *, ErrorHandler *) CLICK_COLD;
+
+};
+
+CLICK_ENDDECLS
+#endif
@@ -125,6 +125,23 @@ IPRewriter::add_flow(int ip_p, const IPFlowID &flowid,
     return store_flow(flow, input, _state->_udp_map, &reply_udp_map(rwinput));
 }
 
+IPRewriterEntry *
+IPRewriter::take_flow(IPRewriterFlow *flow, int input, unsigned cpu)
+{
+    if (flow->ip_p() == IP_PROTO_TCP)
+	return TCPRewriter::take_flow(flow, input, cpu);
+
+    IPState &state = _state.get_value_for_thread(cpu);
+    void *data = state._udp_allocator.allocate();
+    if (!data)
+	return 0;
+
+    IPRewriterFlow *copy = new(data) IPRewriterFlow(*flow);
+    IPRewriter *reply = static_cast<IPRewriter *>(_input_specs[input].reply_element);
+    return adopt_flow(copy, input, state._udp_map,
+		      &reply->_state.get_value_for_thread(cpu)._udp_map, cpu);
+}
+
 int
 IPRewriter::process(int port, Packet *p_in)
 {
@@ -205,7 +222,7 @@ void
 IPRewriter::push_batch(int port, PacketBatch *batch)
 {
     auto fnt = [this,port](Packet*p){return process(port,p);};
-    CLASSIFY_EACH_PACKET(noutputs() + 1,fnt,batch,checked_output_push_batch);
+    CLASSIFY_EACH_PACKET_PREFETCH(noutputs() + 1,fnt,batch,checked_output_push_batch,batch_prefetch_distance());
 }
 #endif
 
@@ -104,7 +104,11 @@ RoundRobinIPMapper.
 
 =back
 
-IPRewriter has no mappings when first initialized.
+IPRewriter has no mappings when first initialized.  When hot-swapped in, it
+takes over the live mappings of the old IPRewriter with the same name, input
+by input, as long as the input's spec keeps the same kind, output ports, and
+reply element.  The other rewriters (TCPRewriter, UDPRewriter, IPAddrRewriter,
+IPAddrPairRewriter, ICMPPingRewriter) do the same.
 
 Input packets must have their IP header annotations set.  Non-TCP and UDP
 packets, and second and subsequent fragments, are dropped unless they arrive
@@ -255,6 +259,9 @@ class IPRewriter : public TCPRewriter { public:
 
     void add_handlers() CLICK_COLD;
 
+  protected:
+    IPRewriterEntry *take_flow(IPRewriterFlow *flow, int input, unsigned cpu);
+
   private:
     class IPState { public:
         IPState() : _udp_map(0) {
@@ -0,0 +1,406 @@
+// -*- c-basic-offset: 4 -*-
+/*
+ * tcpreassembler.{cc,hh} -- puts TCP segments in stream order
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Click LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Click LICENSE file; the license in that file is
+ * legally binding.
+ */
+
+#include <click/config.h>
+#include "tcpreassembler.hh"
+#include <click/args.hh>
+#include <click/error.hh>
+#include <click/straccum.hh>
+CLICK_DECLS
+
+TCPReassembler::TCPReassembler()
+    : _max_flows(65536), _thread_flows(65536), _max_ooo(64),
+      _himem(16 << 20), _thread_himem(16 << 20), _timeout(300)
+{
+    static_assert(TCP_STREAM_SKIP_ANNO_OFFSET + TCP_STREAM_SKIP_ANNO_SIZE <= Packet::anno_size, "anno too big");
+}
+
+TCPReassembler::~TCPReassembler()
+{
+}
+
+int
+TCPReassembler::configure(Vector<String> &conf, ErrorHandler *errh)
+{
+    uint32_t max_flows = 65536, max_ooo = 64, himem = 16 << 20;
+    uint32_t timeout = 300;
+    if (Args(conf, this, errh)
+	.read("MAX_FLOWS", max_flows)
+	.read("MAX_OOO", max_ooo)
+	.read("HIMEM", himem)
+	.read("TIMEOUT", SecondsArg(), timeout)
+	.complete() < 0)
+	return -1;
+    if (max_flows == 0)
+	return errh->error("MAX_FLOWS must be positive");
+    if (max_ooo > 0xFFFF)
+	return errh->error("MAX_OOO too large");
+    if (timeout == 0 || timeout > 0x7FFFFFFF)
+	return errh->error("TIMEOUT out of range");
+    _max_flows = max_flows;
+    _max_ooo = max_ooo;
+    _himem = himem;
+    _timeout = timeout;
+    return 0;
+}
+
+int
+TCPReassembler::initialize(ErrorHandler *)
+{
+    unsigned nthreads = get_passing_threads().weight();
+    if (nthreads == 0)
+	nthreads = 1;
+    _thread_flows = _max_flows / nthreads;
+    if (_thread_flows == 0)
+	_thread_flows = 1;
+    _thread_himem = _himem / nthreads;
+    return 0;
+}
+
+void
+TCPReassembler::alloc_state(State &s)
+{
+    s.pool = new Stream[_thread_flows];
+    s.free = 0;
+    for (uint32_t i = _thread_flows; i > 0; --i) {
+	s.pool[i - 1].lru_next = s.free;
+	s.free = &s.pool[i - 1];
+    }
+}
+
+void
+TCPReassembler::cleanup(CleanupStage)
+{
+    for (unsigned t = 0; t < _state.weight(); ++t) {
+	State &s = _state.get_value(t);
+	for (Stream *st = s.lru.lru_next; st != &s.lru; st = st->lru_next)
+	    while (Packet *p = st->ooo) {
+		st->ooo = p->next();
+		p->kill();
+	    }
+	s.map.clear();
+	delete[] s.pool;
+	s.pool = s.free = 0;
+	s.lru.lru_prev = s.lru.lru_next = &s.lru;
+	s.held_bytes = 0;
+    }
+}
+
+inline TCPReassembler::State &
+TCPReassembler::state()
+{
+    State &s = *_state;
+    if (unlikely(!s.pool))
+	alloc_state(s);
+    return s;
+}
+
+TCPReassembler::Stream *
+TCPReassembler::new_stream(State &s, const IPFlowID &flow, uint32_t isn,
+			   int now, PacketList &out1)
+{
+    if (!s.free) {
+	remove_stream(s, s.lru.lru_next, out1);
+	++s.stats.evicted;
+    }
+    Stream *st = s.free;
+    s.free = st->lru_next;
+
+    st->flow = flow;
+    st->ooo = 0;
+    st->isn = st->next_seq = isn;
+    st->ooo_bytes = 0;
+    st->ooo_count = 0;
+    st->flags = 0;
+    st->last_seen = now;
+    st->lru_prev = s.lru.lru_prev;
+    st->lru_next = &s.lru;
+    s.lru.lru_prev->lru_next = st;
+    s.lru.lru_prev = st;
+
+    s.map.set(flow, st);
+    ++s.stats.created;
+    return st;
+}
+
+void
+TCPReassembler::remove_stream(State &s, Stream *st, PacketList &out1)
+{
+    s.map.erase(st->flow);
+    st->lru_prev->lru_next = st->lru_next;
+    st->lru_next->lru_prev = st->lru_prev;
+    while (Packet *p = st->ooo) {
+	st->ooo = p->next();
+	out1.append(p);
+    }
+    s.held_bytes -= st->ooo_bytes;
+    st->lru_next = s.free;
+    s.free = st;
+}
+
+void
+TCPReassembler::expire(State &s, int now, PacketList &out1)
+{
+    Stream *st;
+    while ((st = s.lru.lru_next) != &s.lru && now - st->last_seen > _timeout) {
+	remove_stream(s, st, out1);
+	++s.stats.expired;
+    }
+}
+
+void
+TCPReassembler::deliver(State &s, Stream *st, Packet *p, PacketList &out0)
+{
+    uint32_t dstart, len;
+    bool fin;
+    segment(p, dstart, len, fin);
+    uint32_t dend = dstart + len;
+
+    // bytes at the start of the segment that the stream already delivered
+    uint32_t skip = 0;
+    if (SEQ_LT(dstart, st->next_seq))
+	skip = SEQ_LT(dend, st->next_seq) ? len : st->next_seq - dstart;
+    if (len && skip == len)
+	++s.stats.retransmits;
+    SET_TCP_STREAM_OFFSET_ANNO(p, dstart + skip - st->isn);
+    SET_TCP_STREAM_SKIP_ANNO(p, skip);
+
+    if (!SEQ_GT(dstart, st->next_seq) && SEQ_GT(dend, st->next_seq))
+	st->next_seq = dend;
+    if (fin && st->next_seq == dend && !(st->flags & F_CLOSED)) {
+	st->flags |= F_FIN | F_CLOSED;
+	st->next_seq = dend + 1;	// FIN takes one sequence number
+    }
+    out0.append(p);
+}
+
+void
+TCPReassembler::hold(State &s, Stream *st, Packet *p, PacketList &out1)
+{
+    if (st->ooo_count >= _max_ooo
+	|| s.held_bytes + p->length() > _thread_himem) {
+	++s.stats.overflows;
+	out1.append(p);
+	return;
+    }
+
+    uint32_t dstart, len;
+    bool fin;
+    segment(p, dstart, len, fin);
+    Packet **pprev = &st->ooo;
+    for (; *pprev; pprev = &(*pprev)->next()) {
+	uint32_t qstart, qlen;
+	bool qfin;
+	segment(*pprev, qstart, qlen, qfin);
+	if (SEQ_GT(qstart, dstart))
+	    break;
+	if (qstart == dstart && qlen >= len && (qfin || !fin)) {
+	    // the held segment already covers this one
+	    ++s.stats.retransmits;
+	    out1.append(p);
+	    return;
+	}
+    }
+
+    p->set_next(*pprev);
+    *pprev = p;
+    ++st->ooo_count;
+    st->ooo_bytes += p->length();
+    s.held_bytes += p->length();
+    ++s.stats.held;
+}
+
+void
+TCPReassembler::handle(State &s, Packet *p, PacketList &out0, PacketList &out1)
+{
+    if (!p->has_network_header()) {
+	out0.append(p);
+	return;
+    }
+    const click_ip *iph = p->ip_header();
+    if (iph->ip_p != IP_PROTO_TCP || !IP_FIRSTFRAG(iph)) {
+	out0.append(p);
+	return;
+    }
+    if (p->transport_length() < (int) sizeof(click_tcp)
+	|| payload_length(p) < 0) {
+	++s.stats.malformed;
+	out1.append(p);
+	return;
+    }
+
+    int now = p->timestamp_anno().sec();
+    if (!now) {
+	p->timestamp_anno().assign_now();
+	now = p->timestamp_anno().sec();
+    }
+    expire(s, now, out1);
+
+    const click_tcp *th = p->tcp_header();
+    uint32_t dstart, len;
+    bool fin;
+    segment(p, dstart, len, fin);
+    IPFlowID flow(p);
+    Stream *st = s.map.get(flow);
+
+    if (th->th_flags & TH_RST) {
+	Stream *rev = s.map.get(flow.reverse());
+	if (st)
+	    remove_stream(s, st, out1);
+	if (rev)
+	    remove_stream(s, rev, out1);
+	if (st || rev)
+	    ++s.stats.reset;
+	SET_TCP_STREAM_OFFSET_ANNO(p, 0);
+	SET_TCP_STREAM_SKIP_ANNO(p, len);
+	out0.append(p);
+	return;
+    }
+
+    if (st && (th->th_flags & TH_SYN) && (st->flags & F_CLOSED)) {
+	// the connection's ports are being reused
+	remove_stream(s, st, out1);
+	st = 0;
+    }
+
+    if (!st) {
+	if (!(th->th_flags & TH_SYN) && !len && !fin) {
+	    // nothing to track, e.g. an ACK for a connection we did not see
+	    SET_TCP_STREAM_OFFSET_ANNO(p, 0);
+	    SET_TCP_STREAM_SKIP_ANNO(p, 0);
+	    out0.append(p);
+	    return;
+	}
+	st = new_stream(s, flow, dstart, now, out1);
+	if (th->th_flags & TH_SYN)
+	    st->flags |= F_SYN;
+    } else {
+	// move to the LRU tail
+	st->last_seen = now;
+	st->lru_prev->lru_next = st->lru_next;
+	st->lru_next->lru_prev = st->lru_prev;
+	st->lru_prev = s.lru.lru_prev;
+	st->lru_next = &s.lru;
+	s.lru.lru_prev->lru_next = st;
+	s.lru.lru_prev = st;
+    }
+
+    if (SEQ_GT(dstart, st->next_seq) && (len || fin)) {
+	hold(s, st, p, out1);
+	return;
+    }
+
+    deliver(s, st, p, out0);
+    while (Packet *q = st->ooo) {
+	uint32_t qstart, qlen;
+	bool qfin;
+	segment(q, qstart, qlen, qfin);
+	if (SEQ_GT(qstart, st->next_seq))
+	    break;
+	st->ooo = q->next();
+	--st->ooo_count;
+	st->ooo_bytes -= q->length();
+	s.held_bytes -= q->length();
+	deliver(s, st, q, out0);
+    }
+
+    if (st->flags & F_CLOSED) {
+	Stream *rev = s.map.get(flow.reverse());
+	if (rev && (rev->flags & F_CLOSED)) {
+	    remove_stream(s, st, out1);
+	    remove_stream(s, rev, out1);
+	    ++s.stats.closed;
+	}
+    }
+}
+
+void
+TCPReassembler::push(int, Packet *p)
+{
+    PacketList out0, out1;
+    handle(state(), p, out0, out1);
+    for (Packet *q = out0.head, *next; q; q = next) {
+	next = q->next();
+	q->set_next(0);
+	output(0).push(q);
+    }
+    for (Packet *q = out1.head, *next; q; q = next) {
+	next = q->next();
+	q->set_next(0);
+	checked_output_push(1, q);
+    }
+}
+
+#if HAVE_BATCH
+void
+TCPReassembler::push_batch(int, PacketBatch *batch)
+{
+    State &s = state();
+    PacketList out0, out1;
+    FOR_EACH_PACKET_SAFE(batch, p)
+	handle(s, p, out0, out1);
+    if (out0.head)
+	output_push_batch(0, PacketBatch::make_from_simple_list(out0.head, out0.tail, out0.count));
+    if (out1.head)
+	checked_output_push_batch(1, PacketBatch::make_from_simple_list(out1.head, out1.tail, out1.count));
+}
+#endif
+
+String
+TCPReassembler::read_handler(Element *e, void *)
+{
+    TCPReassembler *r = static_cast<TCPReassembler *>(e);
+    Stats st;
+    uint32_t active = 0, held_bytes = 0;
+    memset(&st, 0, sizeof(st));
+    for (unsigned t = 0; t < r->_state.weight(); ++t) {
+	const State &s = r->_state.get_value(t);
+	active += s.map.size();
+	st.created += s.stats.created;
+	st.closed += s.stats.closed;
+	st.reset += s.stats.reset;
+	st.expired += s.stats.expired;
+	st.evicted += s.stats.evicted;
+	st.retransmits += s.stats.retransmits;
+	st.held += s.stats.held;
+	st.overflows += s.stats.overflows;
+	st.malformed += s.stats.malformed;
+	held_bytes += s.held_bytes;
+    }
+
+    StringAccum sa;
+    sa << "active streams:      " << active << "\n"
+       << "streams created:     " << st.created << "\n"
+       << "connections closed:  " << st.closed << "\n"
+       << "connections reset:   " << st.reset << "\n"
+       << "streams expired:     " << st.expired << "\n"
+       << "streams evicted:     " << st.evicted << "\n"
+       << "retransmits:         " << st.retransmits << "\n"
+       << "segments held:       " << st.held << "\n"
+       << "buffer overflows:    " << st.overflows << "\n"
+       << "malformed packets:   " << st.malformed << "\n"
+       << "bytes held:          " << held_bytes << "\n";
+    return sa.take_string();
+}
+
+void
+TCPReassembler::add_handlers()
+{
+    add_read_handler("stats", read_handler, 0);
+}
+
+CLICK_ENDDECLS
+EXPORT_ELEMENT(TCPReassembler)
+ELEMENT_MT_SAFE(TCPReassembler)
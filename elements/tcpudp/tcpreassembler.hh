@@ -0,0 +1,239 @@
+// -*- c-basic-offset: 4 -*-
+#ifndef CLICK_TCPREASSEMBLER_HH
+#define CLICK_TCPREASSEMBLER_HH
+#include <click/batchelement.hh>
+#include <click/hashtable.hh>
+#include <click/ipflowid.hh>
+#include <click/packet_anno.hh>
+#include <clicknet/ip.h>
+#include <clicknet/tcp.h>
+CLICK_DECLS
+
+/*
+=c
+
+TCPReassembler([I<keywords> MAX_FLOWS, MAX_OOO, HIMEM, TIMEOUT])
+
+=s tcp
+
+puts TCP segments in stream order for inspection
+
+=d
+
+Expects TCP/IP packets with IP header annotations as input, for example from
+CheckIPHeader or MarkIPHeader.  Tracks each direction of each TCP connection
+as a stream, keyed by its addresses and ports, and emits segments on output 0
+in stream order.  A segment that arrives ahead of a gap is held until the gap
+is filled; in-order segments are never held or copied.  Other packets pass
+through unchanged.
+
+Every TCP packet emitted on output 0 carries two annotations that locate its
+new stream bytes in place.  TCP_STREAM_OFFSET_ANNO is the stream offset of the
+first new byte, counted from the byte after the SYN (or from the first segment
+seen, for connections picked up midway).  TCP_STREAM_SKIP_ANNO is the number
+of payload bytes at the start of the segment that were already delivered by
+earlier segments.  Downstream elements should use
+TCPReassembler::stream_data() to read the new bytes, which are contiguous with
+those of the previous segment of the stream.  Retransmitted segments are still
+forwarded, with all their payload skipped.
+
+SYN, FIN, and RST are tracked.  A stream starts at a SYN or at the first data
+segment seen.  An RST removes both directions of its connection.  Once both
+directions have delivered their FIN in order, the connection is removed.
+Streams idle for TIMEOUT seconds expire.  When all MAX_FLOWS streams are in
+use, the least recently active stream is evicted.  Segments held by a stream
+that is removed, and out-of-order segments that do not fit in the buffer, are
+emitted on output 1, or dropped if there is no output 1; the sender will
+retransmit them.  So are malformed TCP packets, whose TCP header or IP
+length does not fit in the packet; they are not tracked.
+
+Each thread passing packets through TCPReassembler has its own stream table,
+so both directions of a connection must reach TCPReassembler on the same
+thread, for example by symmetric RSS.  MAX_FLOWS and HIMEM are split evenly
+between those threads.
+
+Keyword arguments are:
+
+=over 8
+
+=item MAX_FLOWS
+
+Maximum number of streams (connection directions) tracked.  Default is 65536.
+
+=item MAX_OOO
+
+Maximum number of out-of-order segments held per stream.  Default is 64.
+
+=item HIMEM
+
+Maximum number of bytes held in out-of-order segments, over all streams.
+Default is 16M.
+
+=item TIMEOUT
+
+Seconds after which an idle stream is removed.  Default is 300.
+
+=back
+
+Times are taken from packet timestamp annotations; packets without one are
+stamped with the current time.
+
+=h stats read-only
+
+Returns counters summed over all threads: active streams, streams created,
+closed, reset, expired, and evicted, retransmitted segments, segments held
+out of order, segments dropped because the buffer was full, malformed
+packets, and bytes currently held.
+
+=a TCPBuffer, CheckTCPHeader, IPReassembler */
+
+class TCPReassembler : public BatchElement { public:
+
+    TCPReassembler() CLICK_COLD;
+    ~TCPReassembler() CLICK_COLD;
+
+    const char *class_name() const	{ return "TCPReassembler"; }
+    const char *port_count() const	{ return PORTS_1_1X2; }
+    const char *processing() const	{ return PUSH; }
+
+    int configure(Vector<String> &, ErrorHandler *) CLICK_COLD;
+    int initialize(ErrorHandler *) CLICK_COLD;
+    void cleanup(CleanupStage) CLICK_COLD;
+    void add_handlers() CLICK_COLD;
+
+    void push(int, Packet *);
+#if HAVE_BATCH
+    void push_batch(int, PacketBatch *);
+#endif
+
+    /** @brief Return the new stream bytes of a TCP packet emitted by
+     * TCPReassembler, setting @a len to their number.
+     *
+     * The bytes are read in place from the packet, starting at stream
+     * offset TCP_STREAM_OFFSET_ANNO(@a p). */
+    static inline const unsigned char *stream_data(const Packet *p, unsigned &len);
+
+  private:
+
+    enum { F_SYN = 1, F_FIN = 2, F_CLOSED = 4 };
+
+    struct Stream {
+	IPFlowID flow;
+	Stream *lru_prev;
+	Stream *lru_next;
+	Packet *ooo;		// held segments in sequence order
+	uint32_t isn;		// sequence number of stream offset 0
+	uint32_t next_seq;	// next sequence number expected
+	uint32_t ooo_bytes;
+	uint16_t ooo_count;
+	uint8_t flags;
+	int last_seen;
+    };
+
+    struct Stats {
+	uint32_t created;
+	uint32_t closed;
+	uint32_t reset;
+	uint32_t expired;
+	uint32_t evicted;
+	uint32_t retransmits;
+	uint32_t held;
+	uint32_t overflows;
+	uint32_t malformed;
+    };
+
+    struct State {
+	HashTable<IPFlowID, Stream *> map;
+	Stream *pool;
+	Stream *free;
+	Stream lru;		// list head; least recently active first
+	uint32_t held_bytes;
+	Stats stats;
+	State()
+	    : pool(0), free(0), held_bytes(0) {
+	    lru.lru_prev = lru.lru_next = &lru;
+	    memset(&stats, 0, sizeof(stats));
+	}
+    };
+
+    struct PacketList {
+	Packet *head;
+	Packet *tail;
+	unsigned count;
+	PacketList()
+	    : head(0), tail(0), count(0) {
+	}
+	inline void append(Packet *p) {
+	    p->set_next(0);
+	    if (tail)
+		tail->set_next(p);
+	    else
+		head = p;
+	    tail = p;
+	    ++count;
+	}
+    };
+
+    per_thread<State> _state;
+    uint32_t _max_flows;
+    uint32_t _thread_flows;
+    uint32_t _max_ooo;
+    uint32_t _himem;
+    uint32_t _thread_himem;
+    int _timeout;
+
+    static inline int payload_length(const Packet *);
+    static inline void segment(const Packet *, uint32_t &, uint32_t &, bool &);
+    inline State &state();
+    void alloc_state(State &) CLICK_COLD;
+    void handle(State &, Packet *, PacketList &, PacketList &);
+    Stream *new_stream(State &, const IPFlowID &, uint32_t, int, PacketList &);
+    void remove_stream(State &, Stream *, PacketList &);
+    void deliver(State &, Stream *, Packet *, PacketList &);
+    void hold(State &, Stream *, Packet *, PacketList &);
+    void expire(State &, int, PacketList &);
+    static String read_handler(Element *, void *) CLICK_COLD;
+
+};
+
+/** @brief Return the TCP payload length of @a p, or -1 if its IP length or
+ * TCP header length do not fit in the packet. */
+inline int
+TCPReassembler::payload_length(const Packet *p)
+{
+    const click_ip *iph = p->ip_header();
+    const click_tcp *th = p->tcp_header();
+    int ip_len = ntohs(iph->ip_len);
+    int hlen = th->th_off << 2;
+    if (th->th_off < 5 || hlen > p->transport_length()
+	|| ip_len > p->network_length()
+	|| ip_len < (int) (iph->ip_hl << 2) + hlen)
+	return -1;
+    return ip_len - (iph->ip_hl << 2) - hlen;
+}
+
+inline void
+TCPReassembler::segment(const Packet *p, uint32_t &dstart, uint32_t &len, bool &fin)
+{
+    const click_tcp *th = p->tcp_header();
+    len = payload_length(p);
+    dstart = ntohl(th->th_seq) + ((th->th_flags & TH_SYN) ? 1 : 0);
+    fin = (th->th_flags & TH_FIN) != 0;
+}
+
+inline const unsigned char *
+TCPReassembler::stream_data(const Packet *p, unsigned &len)
+{
+    const click_tcp *th = p->tcp_header();
+    int plen = payload_length(p);
+    unsigned skip = TCP_STREAM_SKIP_ANNO(p);
+    if (plen < 0 || skip >= (unsigned) plen) {
+	len = 0;
+	return reinterpret_cast<const unsigned char *>(th);
+    }
+    len = plen - skip;
+    return reinterpret_cast<const unsigned char *>(th) + (th->th_off << 2) + skip;
+}
+
+CLICK_ENDDECLS
+#endif
@@ -309,6 +309,19 @@ TCPRewriter::add_flow(int /*ip_p*/, const IPFlowID &flowid,
     return store_flow(flow, input, _map[click_current_cpu_id()]);
 }
 
+IPRewriterEntry *
+TCPRewriter::take_flow(IPRewriterFlow *flow, int input, unsigned cpu)
+{
+    void *data;
+    if (!(data = _allocator.get_value_for_thread(cpu).allocate()))
+	return 0;
+
+    TCPFlow *old = static_cast<TCPFlow *>(flow);
+    TCPFlow *copy = new(data) TCPFlow(*old);
+    copy->take_deltas(old);
+    return adopt_flow(copy, input, _map[cpu], 0, cpu);
+}
+
 int
 TCPRewriter::process(int port, Packet *p_in)
 {
@@ -378,7 +391,7 @@ void
 TCPRewriter::push_batch(int port, PacketBatch *batch)
 {
     auto fnt = [this,port](Packet*p){return process(port,p);};
-    CLASSIFY_EACH_PACKET(noutputs() + 1,fnt,batch,checked_output_push_batch);
+    CLASSIFY_EACH_PACKET_PREFETCH(noutputs() + 1,fnt,batch,checked_output_push_batch,batch_prefetch_distance());
 }
 #endif
 
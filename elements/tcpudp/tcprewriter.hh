@@ -131,6 +131,11 @@ class TCPRewriter : public IPRewriterBase { public:
 
 	void unparse(StringAccum &sa, bool direction, click_jiffies_t now) const;
 
+	void take_deltas(TCPFlow *flow) {
+	    _dt = flow->_dt;
+	    flow->_dt = 0;
+	}
+
       private:
 
 	struct delta_transition {
@@ -180,6 +185,8 @@ class TCPRewriter : public IPRewriterBase { public:
  protected:
     per_thread<SizedHashAllocator<sizeof(TCPFlow)>> _allocator;
 
+    IPRewriterEntry *take_flow(IPRewriterFlow *flow, int input, unsigned cpu);
+
     unsigned _annos;
     uint32_t _tcp_data_timeout;
     uint32_t _tcp_done_timeout;
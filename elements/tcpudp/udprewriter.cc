@@ -142,6 +142,17 @@ UDPRewriter::add_flow(int ip_p, const IPFlowID &flowid,
     return store_flow(flow, input, _map[click_current_cpu_id()]);
 }
 
+IPRewriterEntry *
+UDPRewriter::take_flow(IPRewriterFlow *flow, int input, unsigned cpu)
+{
+    void *data = _allocator.get_value_for_thread(cpu).allocate();
+    if (!data)
+        return 0;
+
+    UDPFlow *copy = new(data) UDPFlow(*static_cast<UDPFlow *>(flow));
+    return adopt_flow(copy, input, _map[cpu], 0, cpu);
+}
+
 int
 UDPRewriter::process(int port, Packet *p_in)
 {
@@ -213,7 +224,7 @@ void
 UDPRewriter::push_batch(int port, PacketBatch *batch)
 {
     auto fnt = [this,port](Packet*p){return process(port,p);};
-    CLASSIFY_EACH_PACKET(noutputs() + 1,fnt,batch,checked_output_push_batch);
+    CLASSIFY_EACH_PACKET_PREFETCH(noutputs() + 1,fnt,batch,checked_output_push_batch,batch_prefetch_distance());
 }
 #endif
 
@@ -112,7 +112,8 @@ RoundRobinIPMapper.
 
 =back
 
-UDPRewriter has no mappings when first initialized.
+UDPRewriter has no mappings when first initialized, unless it is hot-swapped
+in; see IPRewriter.
 
 Input packets must have their IP header annotations set.  Non-TCP and UDP
 packets, and second and subsequent fragments, are dropped unless they arrive
@@ -207,6 +208,9 @@ class UDPRewriter : public IPRewriterBase { public:
 
     void add_handlers() CLICK_COLD;
 
+  protected:
+    IPRewriterEntry *take_flow(IPRewriterFlow *flow, int input, unsigned cpu);
+
   private:
     per_thread<SizedHashAllocator<sizeof(UDPFlow)>> _allocator;
 
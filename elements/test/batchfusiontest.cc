@@ -0,0 +1,59 @@
+// -*- c-basic-offset: 4 -*-
+/*
+ * batchfusiontest.{cc,hh} -- test BatchFusion
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Click LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Click LICENSE file; the license in that file is
+ * legally binding.
+ */
+
+#include <click/config.h>
+#include "batchfusiontest.hh"
+#include <click/batchfusion.hh>
+#include <click/error.hh>
+#include "elements/ip/checkipheader.hh"
+#include "elements/ip/decipttl.hh"
+#include "elements/ethernet/etherencap.hh"
+CLICK_DECLS
+
+typedef BatchFusion<CheckIPHeader, DecIPTTL, EtherEncap> Chain;
+
+BatchFusionTest::BatchFusionTest()
+{
+}
+
+int
+BatchFusionTest::initialize(ErrorHandler *errh)
+{
+    static const char * const chain[] = { "CheckIPHeader", "DecIPTTL", "EtherEncap" };
+    Element *e = this;
+    for (int i = 0; i < 3; ++i) {
+	if (e->output(0).port() != 0
+	    || strcmp(e->output(0).element()->class_name(), chain[i]) != 0)
+	    return errh->error("output must lead to CheckIPHeader -> DecIPTTL -> EtherEncap");
+	e = e->output(0).element();
+    }
+    return 0;
+}
+
+void
+BatchFusionTest::push(int, Packet *p)
+{
+    output(0).push(p);
+}
+
+void
+BatchFusionTest::push_batch(int, PacketBatch *batch)
+{
+    Chain::push_batch(output(0).element(), batch);
+}
+
+CLICK_ENDDECLS
+ELEMENT_REQUIRES(batch CheckIPHeader DecIPTTL EtherEncap)
+EXPORT_ELEMENT(BatchFusionTest)
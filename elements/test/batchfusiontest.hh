@@ -0,0 +1,45 @@
+// -*- c-basic-offset: 4 -*-
+#ifndef CLICK_BATCHFUSIONTEST_HH
+#define CLICK_BATCHFUSIONTEST_HH
+#include <click/batchelement.hh>
+CLICK_DECLS
+
+/*
+=c
+
+BatchFusionTest()
+
+=s test
+
+runs a downstream chain as one fused loop
+
+=d
+
+Pushes each batch it receives through the CheckIPHeader -> DecIPTTL ->
+EtherEncap chain connected to its output, using BatchFusion, so the chain's
+elements see no push_batch calls of their own. Packets leaving the chain
+exit through EtherEncap's output 0. Fails to initialize if the downstream
+chain has another shape.
+
+=a
+
+CheckIPHeader, DecIPTTL, EtherEncap
+*/
+
+class BatchFusionTest : public BatchElement { public:
+
+    BatchFusionTest() CLICK_COLD;
+
+    const char *class_name() const	{ return "BatchFusionTest"; }
+    const char *port_count() const	{ return PORTS_1_1; }
+    const char *processing() const	{ return PUSH; }
+
+    int initialize(ErrorHandler *) CLICK_COLD;
+
+    void push(int, Packet *);
+    void push_batch(int, PacketBatch *);
+
+};
+
+CLICK_ENDDECLS
+#endif
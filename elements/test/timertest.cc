@@ -25,7 +25,7 @@
 CLICK_DECLS
 
 TimerTest::TimerTest()
-    : _timer(this), _benchmark(0)
+    : _timer(this), _benchmark(0), _coarse(false)
 {
 }
 
@@ -38,9 +38,11 @@ TimerTest::configure(Vector<String> &conf, ErrorHandler *errh)
 	.read("BENCHMARK", _benchmark)
 	.read("DELAY", delay)
 	.read("SCHEDULE", schedule)
+	.read("COARSE", _coarse)
 	.complete() < 0)
 	return -1;
     _timer.initialize(this);
+    _timer.set_coarse(_coarse);
     if (schedule || delay)
 	_timer.schedule_after(delay);
     return 0;
@@ -65,10 +67,17 @@ TimerTest::initialize(ErrorHandler *)
 	for (int i = 0; i < _benchmark; ++i) {
 	    ts[i].assign();
 	    ts[i].initialize(this);
+	    ts[i].set_coarse(_coarse);
 	}
 	benchmark_schedules(ts, _benchmark, now);
-	benchmark_changes(ts, _benchmark, now);
-	benchmark_fires(ts, _benchmark, now);
+	if (_coarse) {
+	    benchmark_coarse_changes(ts, _benchmark, now);
+	    for (int i = 0; i < _benchmark; ++i)
+		ts[i].unschedule();
+	} else {
+	    benchmark_changes(ts, _benchmark, now);
+	    benchmark_fires(ts, _benchmark, now);
+	}
 	delete[] ts;
     }
 
@@ -103,6 +112,17 @@ TimerTest::benchmark_changes(Timer *ts, int nts, const Timestamp &now)
     }
 }
 
+void
+TimerTest::benchmark_coarse_changes(Timer *ts, int nts, const Timestamp &now)
+{
+    for (int i = 0; i < 6 * nts; ++i) {
+	Timer *t = &ts[click_random(0, nts - 1)];
+	if (click_random(0, 8) < 3)
+	    t->unschedule();
+	t->schedule_at_steady(now + Timestamp::make_msec(click_random(0, 10000)));
+    }
+}
+
 void
 TimerTest::benchmark_fires(Timer *ts, int, const Timestamp &)
 {
@@ -118,6 +138,8 @@ TimerTest::read_handler(Element *e, void *user_data)
     switch ((uintptr_t) user_data) {
     case h_scheduled:
 	return String(tt->_timer.scheduled());
+    case h_wheel_size:
+	return String(tt->_timer.thread()->timer_set().wheel_size());
     case h_expiry:
     default:
 	return String(tt->_timer.expiry_steady());
@@ -159,6 +181,7 @@ TimerTest::add_handlers()
     add_read_handler("scheduled", read_handler, h_scheduled);
     add_write_handler("scheduled", write_handler, h_scheduled);
     add_read_handler("expiry", read_handler, h_expiry);
+    add_read_handler("wheel_size", read_handler, h_wheel_size);
     add_write_handler("schedule_after", write_handler, h_schedule_after);
     add_write_handler("unschedule", write_handler, h_unschedule);
 }
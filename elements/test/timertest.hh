@@ -41,6 +41,12 @@ Integer.  If set to a positive number, then TimerTest runs a timer
 manipulation benchmark at installation time involving BENCHMARK total
 timers.  Default is 0 (don't benchmark).
 
+=item COARSE
+
+Boolean.  If true, TimerTest's timers (including benchmark timers) use coarse
+precision and live on the thread's timing wheel; see Timer::set_coarse().
+Default is false.
+
 =back
 
 =h scheduled rw
@@ -51,6 +57,10 @@ Boolean. Returns whether the TimerTest's timer is scheduled.
 
 Timestamp. Returns the expiration time for the TimerTest's timer, if any.
 
+=h wheel_size r
+
+Integer. Returns the number of coarse timers on the timer's thread.
+
 =h schedule_after w
 
 Schedule the TimerTest's timer to fire after a given time.
@@ -77,12 +87,14 @@ class TimerTest : public Element { public:
 
     Timer _timer;
     int _benchmark;
+    bool _coarse;
 
     void benchmark_schedules(Timer *ts, int nts, const Timestamp &now);
     void benchmark_changes(Timer *ts, int nts, const Timestamp &now);
+    void benchmark_coarse_changes(Timer *ts, int nts, const Timestamp &now);
     void benchmark_fires(Timer *ts, int nts, const Timestamp &now);
 
-    enum { h_scheduled, h_expiry, h_schedule_after, h_unschedule };
+    enum { h_scheduled, h_expiry, h_wheel_size, h_schedule_after, h_unschedule };
     static String read_handler(Element *e, void *user_data) CLICK_COLD;
     static int write_handler(const String &str, Element *e, void *user_data, ErrorHandler *errh) CLICK_COLD;
 
@@ -0,0 +1,226 @@
+// -*- c-basic-offset: 4 -*-
+/*
+ * adaptivethreadsched.{cc,hh} -- move tasks off overloaded threads
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Click LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Click LICENSE file; the license in that file is
+ * legally binding.
+ */
+
+#include <click/config.h>
+#include "adaptivethreadsched.hh"
+#include <click/task.hh>
+#include <click/routerthread.hh>
+#include <click/router.hh>
+#include <click/master.hh>
+#include <click/args.hh>
+#include <click/straccum.hh>
+#include <click/error.hh>
+CLICK_DECLS
+
+AdaptiveThreadSched::AdaptiveThreadSched()
+    : _timer(this), _round(0), _last_cycles(0), _moves(0)
+{
+}
+
+AdaptiveThreadSched::~AdaptiveThreadSched()
+{
+}
+
+int
+AdaptiveThreadSched::configure(Vector<String> &conf, ErrorHandler *errh)
+{
+    _interval = 500;
+    _high = 90;
+    _low = 60;
+    _active = true;
+    _verbose = false;
+    if (Args(conf, this, errh)
+	.read_p("INTERVAL", _interval)
+	.read_p("HIGH", _high)
+	.read_p("LOW", _low)
+	.read("ACTIVE", _active)
+	.read("VERBOSE", _verbose)
+	.complete() < 0)
+	return -1;
+    if (_interval == 0)
+	return errh->error("INTERVAL must be positive");
+    if (_low < 0 || _high > 100 || _low >= _high)
+	return errh->error("need 0 <= LOW < HIGH <= 100");
+    return 0;
+}
+
+int
+AdaptiveThreadSched::initialize(ErrorHandler *)
+{
+    Master *m = router()->master();
+    _last_busy.assign(m->nthreads(), 0);
+    _load.assign(m->nthreads(), 0);
+    for (int tid = 0; tid < m->nthreads(); ++tid)
+	_last_busy[tid] = m->thread(tid)->busy_cycles();
+    _last_cycles = click_get_cycles();
+    _timer.initialize(this);
+    _timer.schedule_after_msec(_interval);
+    return 0;
+}
+
+bool
+AdaptiveThreadSched::movable(Task *t) const
+{
+    Element *e = t->element();
+    if (e == this || t->home_thread_id() < 0)
+	return false;
+    // device tasks poll the queues of their own thread
+    return !e || !e->cast("QueueDevice");
+}
+
+void
+AdaptiveThreadSched::move(Task *t, int from, int to, int task_load)
+{
+    Element *e = t->element();
+    StringAccum sa;
+    sa << Timestamp::now() << ' ' << (e ? e->name() : String("<task>"))
+       << ' ' << from << " -> " << to << ' '
+       << (task_load / 10) << '.' << (task_load % 10) << '%';
+    if (_verbose)
+	click_chatter("%p{element}: %s", this, sa.c_str());
+    if (_decisions.size() == max_decisions)
+	_decisions.erase(_decisions.begin());
+    _decisions.push_back(sa.take_string());
+    ++_moves;
+    t->move_thread(to);
+}
+
+void
+AdaptiveThreadSched::run_timer(Timer *)
+{
+    Master *m = router()->master();
+    int nthreads = m->nthreads();
+    click_cycles_t now = click_get_cycles();
+    click_cycles_t elapsed = now - _last_cycles;
+    _last_cycles = now;
+    ++_round;
+
+    // thread loads in per-mille of the interval
+    for (int tid = 0; tid < nthreads; ++tid) {
+	click_cycles_t busy = m->thread(tid)->busy_cycles();
+	click_cycles_t delta = busy - _last_busy[tid];
+	_last_busy[tid] = busy;
+	_load[tid] = elapsed ? (int) (delta * 1000 / elapsed) : 0;
+	if (_load[tid] > 1000)
+	    _load[tid] = 1000;
+    }
+
+    // task loads; a task seen for the first time has no load yet
+    Vector<int> task_offset;
+    Vector<Task *> tasks;
+    Vector<int> task_load;
+    for (int tid = 0; tid < nthreads; ++tid) {
+	task_offset.push_back(tasks.size());
+	m->thread(tid)->scheduled_tasks(router(), tasks);
+    }
+    task_offset.push_back(tasks.size());
+    for (int i = 0; i < tasks.size(); ++i) {
+	click_cycles_t busy = tasks[i]->busy_cycles();
+	task_info *ti = _tasks.findp(tasks[i]);
+	int l = 0;
+	if (ti && ti->round + 1 == _round && elapsed)
+	    l = (int) ((busy - ti->busy) * 1000 / elapsed);
+	_tasks.insert(tasks[i], task_info(busy, _round));
+	task_load.push_back(l);
+    }
+    // forget tasks that are gone
+    Vector<Task *> gone;
+    for (HashMap<Task *, task_info>::iterator it = _tasks.begin(); it.live(); ++it)
+	if (it.value().round != _round)
+	    gone.push_back(it.key());
+    for (int i = 0; i < gone.size(); ++i)
+	_tasks.erase(gone[i]);
+
+    Vector<int> load(_load);
+    for (int rounds = 0; _active && rounds < nthreads; ++rounds) {
+	int min_tid = 0, max_tid = 0;
+	for (int tid = 1; tid < nthreads; ++tid)
+	    if (load[tid] < load[min_tid])
+		min_tid = tid;
+	    else if (load[tid] > load[max_tid])
+		max_tid = tid;
+	if (load[max_tid] < _high * 10 || load[min_tid] > _low * 10)
+	    break;
+
+	// busiest task whose move narrows the gap
+	int best = -1;
+	for (int i = task_offset[max_tid]; i < task_offset[max_tid + 1]; ++i)
+	    if (task_load[i] > 0
+		&& 2 * task_load[i] < load[max_tid] - load[min_tid]
+		&& (best < 0 || task_load[i] > task_load[best])
+		&& tasks[i]->home_thread_id() == max_tid
+		&& movable(tasks[i]))
+		best = i;
+	if (best < 0)
+	    break;
+
+	load[max_tid] -= task_load[best];
+	load[min_tid] += task_load[best];
+	move(tasks[best], max_tid, min_tid, task_load[best]);
+	task_load[best] = 0;
+    }
+
+    _timer.schedule_after_msec(_interval);
+}
+
+String
+AdaptiveThreadSched::read_handler(Element *e, void *thunk)
+{
+    AdaptiveThreadSched *ats = static_cast<AdaptiveThreadSched *>(e);
+    StringAccum sa;
+    switch ((intptr_t) thunk) {
+    case h_load:
+	for (int tid = 0; tid < ats->_load.size(); ++tid)
+	    sa << tid << ' ' << (ats->_load[tid] / 10) << '.'
+	       << (ats->_load[tid] % 10) << '\n';
+	break;
+    case h_moves:
+	sa << ats->_moves;
+	break;
+    case h_decisions:
+	for (int i = 0; i < ats->_decisions.size(); ++i)
+	    sa << ats->_decisions[i] << '\n';
+	break;
+    }
+    return sa.take_string();
+}
+
+int
+AdaptiveThreadSched::write_handler(const String &s, Element *e, void *, ErrorHandler *errh)
+{
+    AdaptiveThreadSched *ats = static_cast<AdaptiveThreadSched *>(e);
+    uint32_t interval;
+    if (!IntArg().parse(s, interval) || interval == 0)
+	return errh->error("interval must be positive");
+    ats->_interval = interval;
+    return 0;
+}
+
+void
+AdaptiveThreadSched::add_handlers()
+{
+    add_read_handler("load", read_handler, h_load);
+    add_read_handler("moves", read_handler, h_moves);
+    add_read_handler("decisions", read_handler, h_decisions);
+    add_data_handlers("active", Handler::f_read | Handler::f_write | Handler::f_checkbox, &_active);
+    add_data_handlers("interval", Handler::f_read, &_interval);
+    add_write_handler("interval", write_handler, 0);
+    add_data_handlers("high", Handler::f_read | Handler::f_write, &_high);
+    add_data_handlers("low", Handler::f_read | Handler::f_write, &_low);
+}
+
+CLICK_ENDDECLS
+ELEMENT_REQUIRES(multithread)
+EXPORT_ELEMENT(AdaptiveThreadSched)
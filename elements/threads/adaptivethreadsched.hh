@@ -0,0 +1,136 @@
+// -*- c-basic-offset: 4 -*-
+#ifndef CLICK_ADAPTIVETHREADSCHED_HH
+#define CLICK_ADAPTIVETHREADSCHED_HH
+#include <click/element.hh>
+#include <click/timer.hh>
+#include <click/hashmap.hh>
+CLICK_DECLS
+class Task;
+
+/*
+ * =c
+ * AdaptiveThreadSched([INTERVAL, HIGH, LOW, I<keywords>])
+ * =s threads
+ * moves tasks away from overloaded threads
+ * =d
+ *
+ * Every INTERVAL milliseconds, AdaptiveThreadSched measures how busy each
+ * thread was, as the fraction of the interval spent in task runs that did
+ * work.  While the busiest thread is above HIGH percent and the least busy
+ * one is below LOW percent, it moves a task from the former to the latter,
+ * picking the busiest task whose move shrinks the gap between the two.
+ *
+ * Unlike BalancedThreadSched, which balances Task::cycles() (the average
+ * cost of one run, useful or not), AdaptiveThreadSched only counts runs that
+ * did work, so a thread that mostly polls empty inputs reads as idle.  A
+ * task only runs on one thread at a time and moves between runs, so moving
+ * it does not reorder the packets it handles.
+ *
+ * Tasks of QueueDevice elements such as FromDPDKDevice are never moved: each
+ * of them serves the device queues assigned to its thread.
+ *
+ * Keyword arguments are:
+ *
+ * =over 8
+ *
+ * =item INTERVAL
+ *
+ * Integer.  Milliseconds between measurements.  Default is 500.
+ *
+ * =item HIGH
+ *
+ * Integer.  Percentage above which a thread is overloaded.  Default is 90.
+ *
+ * =item LOW
+ *
+ * Integer.  Percentage below which a thread can take more work.  Default is
+ * 60.
+ *
+ * =item ACTIVE
+ *
+ * Boolean.  If false, only measure; do not move tasks.  Default is true.
+ *
+ * =item VERBOSE
+ *
+ * Boolean.  If true, print a message for each move.  Default is false.
+ *
+ * =back
+ *
+ * =h load read-only
+ *
+ * Returns one line per thread, with the thread ID and its busy percentage
+ * over the last interval.
+ *
+ * =h moves read-only
+ *
+ * Returns the number of tasks moved so far.
+ *
+ * =h decisions read-only
+ *
+ * Returns the most recent moves, one per line: time, element, source and
+ * destination threads, and the task's busy percentage.
+ *
+ * =h active read/write
+ *
+ * Returns or sets the ACTIVE parameter.
+ *
+ * =h interval, high, low read/write
+ *
+ * Return or set the corresponding parameters.  The interval must be
+ * positive.
+ *
+ * =a BalancedThreadSched, StaticThreadSched
+ */
+
+class AdaptiveThreadSched : public Element { public:
+
+    AdaptiveThreadSched() CLICK_COLD;
+    ~AdaptiveThreadSched() CLICK_COLD;
+
+    const char *class_name() const	{ return "AdaptiveThreadSched"; }
+    int configure(Vector<String> &, ErrorHandler *) CLICK_COLD;
+
+    int initialize(ErrorHandler *) CLICK_COLD;
+    void add_handlers() CLICK_COLD;
+    void run_timer(Timer *);
+
+  private:
+
+    struct task_info {
+	click_cycles_t busy;
+	unsigned round;
+	task_info() : busy(0), round(0) {
+	}
+	task_info(click_cycles_t b, unsigned r) : busy(b), round(r) {
+	}
+    };
+
+    enum { max_decisions = 16 };
+
+    Timer _timer;
+    uint32_t _interval;
+    int _high;
+    int _low;
+    bool _active;
+    bool _verbose;
+
+    unsigned _round;
+    click_cycles_t _last_cycles;
+    Vector<click_cycles_t> _last_busy;
+    Vector<int> _load;			// per-mille, by thread
+    HashMap<Task *, task_info> _tasks;
+
+    uint64_t _moves;
+    Vector<String> _decisions;
+
+    bool movable(Task *t) const;
+    void move(Task *t, int from, int to, int task_load);
+
+    enum { h_load, h_moves, h_decisions };
+    static String read_handler(Element *e, void *thunk) CLICK_COLD;
+    static int write_handler(const String &s, Element *e, void *thunk, ErrorHandler *errh) CLICK_COLD;
+
+};
+
+CLICK_ENDDECLS
+#endif
@@ -0,0 +1,33 @@
+// -*- mode: c++; c-basic-offset: 4 -*-
+/*
+ * genevedecap.{cc,hh} -- element removes Geneve encapsulation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Click LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Click LICENSE file; the license in that file is
+ * legally binding.
+ */
+
+#include <click/config.h>
+#include "genevedecap.hh"
+#include <clicknet/geneve.h>
+CLICK_DECLS
+
+GeneveDecap::GeneveDecap()
+{
+    _dport = htons(GENEVE_PORT);
+    // version 0, no critical options, Ethernet payload
+    _check_mask = (GENEVE_VERSION_MASK << 24) | (GENEVE_FLAG_C << 16) | 0xFFFF;
+    _check_value = GENEVE_PTYPE_ETHER;
+    _geneve_options = true;
+}
+
+CLICK_ENDDECLS
+ELEMENT_REQUIRES(UDPTunnelDecap)
+EXPORT_ELEMENT(GeneveDecap)
+ELEMENT_MT_SAFE(GeneveDecap)
@@ -0,0 +1,38 @@
+// -*- mode: c++; c-basic-offset: 4 -*-
+#ifndef CLICK_GENEVEDECAP_HH
+#define CLICK_GENEVEDECAP_HH
+#include "udptunnel.hh"
+CLICK_DECLS
+
+/*
+=c
+
+GeneveDecap(I<keywords> DPORT)
+
+=s tunnel
+
+removes Geneve/UDP/IP headers and sets the VNI in the aggregate annotation
+
+=d
+
+Like VXLANDecap, but for Geneve (RFC 8926).  Options are skipped.  Packets
+with a version other than 0, with the critical-options (C) flag set, or whose
+protocol type is not 0x6558 (Ethernet) are emitted unchanged on output 1, or
+dropped if there is no output 1.  DPORT defaults to 6081.
+
+=h drops read-only
+
+Returns the number of packets that were not acceptable Geneve packets.
+
+=a GeneveEncap, VXLANDecap */
+
+class GeneveDecap : public UDPTunnelDecap { public:
+
+    GeneveDecap() CLICK_COLD;
+
+    const char *class_name() const	{ return "GeneveDecap"; }
+
+};
+
+CLICK_ENDDECLS
+#endif
@@ -0,0 +1,31 @@
+// -*- mode: c++; c-basic-offset: 4 -*-
+/*
+ * geneveencap.{cc,hh} -- element encapsulates Ethernet frames in Geneve
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Click LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Click LICENSE file; the license in that file is
+ * legally binding.
+ */
+
+#include <click/config.h>
+#include "geneveencap.hh"
+#include <clicknet/geneve.h>
+CLICK_DECLS
+
+GeneveEncap::GeneveEncap()
+{
+    click_geneve *gn = reinterpret_cast<click_geneve *>(_thdr);
+    gn->gn_ptype = htons(GENEVE_PTYPE_ETHER);
+    _dport = htons(GENEVE_PORT);
+}
+
+CLICK_ENDDECLS
+ELEMENT_REQUIRES(UDPTunnelEncap)
+EXPORT_ELEMENT(GeneveEncap)
+ELEMENT_MT_SAFE(GeneveEncap)
@@ -0,0 +1,37 @@
+// -*- mode: c++; c-basic-offset: 4 -*-
+#ifndef CLICK_GENEVEENCAP_HH
+#define CLICK_GENEVEENCAP_HH
+#include "udptunnel.hh"
+CLICK_DECLS
+
+/*
+=c
+
+GeneveEncap(SRC, TUNNEL VNI REMOTE..., I<keywords> VNI, DPORT, SPORT_MIN, SPORT_MAX, TTL, CHECKSUM, OFFLOAD)
+
+=s tunnel
+
+encapsulates Ethernet frames in Geneve/UDP/IP headers
+
+=d
+
+Like VXLANEncap, but prepends a Geneve header (RFC 8926) with no options and
+protocol type 0x6558 (Ethernet).  DPORT defaults to 6081.  See VXLANEncap for
+the tunnel table, the flow hash, and the other keyword arguments.
+
+=h tunnels read-only
+
+Returns the tunnel table, one "VNI REMOTE..." line per VNI.
+
+=a GeneveDecap, VXLANEncap */
+
+class GeneveEncap : public UDPTunnelEncap { public:
+
+    GeneveEncap() CLICK_COLD;
+
+    const char *class_name() const	{ return "GeneveEncap"; }
+
+};
+
+CLICK_ENDDECLS
+#endif
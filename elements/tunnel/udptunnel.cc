@@ -0,0 +1,352 @@
+// -*- mode: c++; c-basic-offset: 4 -*-
+/*
+ * udptunnel.{cc,hh} -- shared code for VXLAN and Geneve encap/decap elements
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Click LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Click LICENSE file; the license in that file is
+ * legally binding.
+ */
+
+#include <click/config.h>
+#include "udptunnel.hh"
+#include <click/args.hh>
+#include <click/error.hh>
+#include <click/straccum.hh>
+#include <click/ipflowid.hh>
+#include <clicknet/ether.h>
+#include <clicknet/geneve.h>
+#if CLICK_PACKET_USE_DPDK
+# include <rte_ip.h>
+#endif
+CLICK_DECLS
+
+UDPTunnelEncap::UDPTunnelEncap()
+    : _dport(0), _vni(-1), _sport_min(49152), _sport_range(16384),
+      _ttl(64), _checksum(false), _offload(false), _ip_sum_base(0)
+{
+    memset(_thdr, 0, sizeof(_thdr));
+    _id = 0;
+}
+
+UDPTunnelEncap::~UDPTunnelEncap()
+{
+}
+
+int
+UDPTunnelEncap::configure(Vector<String> &conf, ErrorHandler *errh)
+{
+    IPAddress saddr;
+    Vector<String> tunnels;
+    uint32_t vni = 0;
+    bool vni_set = false;
+    uint16_t dport = ntohs(_dport), sport_min = 49152, sport_max = 65535;
+    uint8_t ttl = 64;
+    bool checksum = false, offload = false;
+
+    if (Args(conf, this, errh)
+	.read_mp("SRC", saddr)
+	.read_all("TUNNEL", AnyArg(), tunnels)
+	.read("VNI", vni).read_status(vni_set)
+	.read("DPORT", IPPortArg(IP_PROTO_UDP), dport)
+	.read("SPORT_MIN", IPPortArg(IP_PROTO_UDP), sport_min)
+	.read("SPORT_MAX", IPPortArg(IP_PROTO_UDP), sport_max)
+	.read("TTL", ttl)
+	.read("CHECKSUM", checksum)
+	.read("OFFLOAD", offload)
+	.complete() < 0)
+	return -1;
+
+    if (vni_set && vni > 0xFFFFFF)
+	return errh->error("VNI out of range");
+    if (sport_max < sport_min)
+	return errh->error("SPORT_MAX less than SPORT_MIN");
+#if !CLICK_PACKET_USE_DPDK
+    if (offload) {
+	errh->warning("OFFLOAD requires DPDK packets, computing checksums in software");
+	offload = false;
+    }
+#endif
+
+    _tunnels.clear();
+    _vni_map.clear();
+    for (int i = 0; i < tunnels.size(); ++i) {
+	Tunnel t;
+	String s = tunnels[i];
+	if (!IntArg().parse(cp_shift_spacevec(s), t.vni) || t.vni > 0xFFFFFF)
+	    return errh->error("TUNNEL %d: bad VNI", i + 1);
+	while (String word = cp_shift_spacevec(s)) {
+	    IPAddress a;
+	    if (!IPAddressArg().parse(word, a, this))
+		return errh->error("TUNNEL %d: bad remote address %<%s%>", i + 1, word.c_str());
+	    t.remotes.push_back(a);
+	}
+	if (!t.remotes.size())
+	    return errh->error("TUNNEL %d: no remote addresses", i + 1);
+	if (_vni_map.get_pointer(t.vni))
+	    return errh->error("TUNNEL %d: VNI %u given twice", i + 1, t.vni);
+	_vni_map.set(t.vni, _tunnels.size());
+	_tunnels.push_back(t);
+    }
+    if (!_tunnels.size())
+	return errh->error("no TUNNEL specified");
+
+    _saddr = saddr;
+    _vni = vni_set ? (int32_t) vni : -1;
+    _dport = htons(dport);
+    _sport_min = sport_min;
+    _sport_range = sport_max - sport_min + 1;
+    _ttl = ttl;
+    _checksum = checksum;
+    _offload = offload;
+
+    // one's complement sum of the outer IP header words that never change
+    uint32_t src = ntohl(_saddr.addr());
+    _ip_sum_base = 0x4500 + ((_ttl << 8) | IP_PROTO_UDP)
+	+ (src >> 16) + (src & 0xFFFF);
+    return 0;
+}
+
+/* Hash the inner frame's flow so that all packets of a flow choose the same
+   remote endpoint and the same outer source port, while different flows
+   spread across ECMP paths and receive-side queues. */
+inline uint32_t
+UDPTunnelEncap::inner_flow_hash(const Packet *p)
+{
+    const unsigned char *data = p->data();
+    unsigned len = p->length();
+    const click_ether *ethh = reinterpret_cast<const click_ether *>(data);
+    const click_ip *iph = reinterpret_cast<const click_ip *>(ethh + 1);
+    uint32_t h;
+
+    if (len >= sizeof(click_ether) + sizeof(click_ip)
+	&& ethh->ether_type == htons(ETHERTYPE_IP)) {
+	unsigned hlen = iph->ip_hl << 2;
+	uint16_t sport = 0, dport = 0;
+	if ((iph->ip_p == IP_PROTO_TCP || iph->ip_p == IP_PROTO_UDP)
+	    && IP_FIRSTFRAG(iph)
+	    && len >= sizeof(click_ether) + hlen + 4) {
+	    const click_udp *udph = reinterpret_cast<const click_udp *>(data + sizeof(click_ether) + hlen);
+	    sport = udph->uh_sport;
+	    dport = udph->uh_dport;
+	}
+	h = IPFlowID(iph->ip_src, sport, iph->ip_dst, dport).hashcode() ^ iph->ip_p;
+    } else if (len >= 12) {
+	const uint16_t *w = reinterpret_cast<const uint16_t *>(data);
+	h = 0;
+	for (int i = 0; i < 6; ++i)
+	    h = h * 31 + w[i];
+    } else
+	return 0;
+
+    h ^= h >> 16;
+    h *= 0x85EBCA6B;
+    h ^= h >> 13;
+    h *= 0xC2B2AE35;
+    return h ^ (h >> 16);
+}
+
+Packet *
+UDPTunnelEncap::simple_action(Packet *p_in)
+{
+    uint32_t vni = _vni >= 0 ? (uint32_t) _vni : AGGREGATE_ANNO(p_in);
+    int *ti = _vni_map.get_pointer(vni);
+    if (!ti) {
+	checked_output_push(1, p_in);
+	return 0;
+    }
+    const Tunnel &t = _tunnels[*ti];
+    uint32_t h = inner_flow_hash(p_in);
+    IPAddress dst = t.remotes[t.remotes.size() == 1 ? 0 : (h >> 16) % t.remotes.size()];
+
+    WritablePacket *p = p_in->push(sizeof(click_ip) + sizeof(click_udp) + tunnel_hlen);
+    if (!p)
+	return 0;
+    click_ip *ip = reinterpret_cast<click_ip *>(p->data());
+    click_udp *udp = reinterpret_cast<click_udp *>(ip + 1);
+    uint8_t *th = reinterpret_cast<uint8_t *>(udp + 1);
+
+    memcpy(th, _thdr, tunnel_hlen);
+    *reinterpret_cast<uint32_t *>(th + 4) = htonl(vni << 8);
+
+    uint16_t len = p->length();
+    uint16_t id = _id.fetch_and_add(1);
+    ip->ip_v = 4;
+    ip->ip_hl = sizeof(click_ip) >> 2;
+    ip->ip_tos = 0;
+    ip->ip_len = htons(len);
+    ip->ip_id = htons(id);
+    ip->ip_off = 0;
+    ip->ip_ttl = _ttl;
+    ip->ip_p = IP_PROTO_UDP;
+    ip->ip_src = _saddr;
+    ip->ip_dst = dst;
+    p->set_ip_header(ip, sizeof(click_ip));
+    p->set_dst_ip_anno(dst);
+
+    udp->uh_sport = htons(_sport_min + (h & 0xFFFF) % _sport_range);
+    udp->uh_dport = _dport;
+    udp->uh_ulen = htons(len - sizeof(click_ip));
+    udp->uh_sum = 0;
+
+#if CLICK_PACKET_USE_DPDK
+    if (_offload) {
+	struct rte_mbuf *mb = p->mb();
+	mb->l2_len = sizeof(click_ether);
+	mb->l3_len = sizeof(click_ip);
+	mb->ol_flags |= PKT_TX_IPV4 | PKT_TX_IP_CKSUM;
+	ip->ip_sum = 0;
+	if (_checksum) {
+	    mb->ol_flags |= PKT_TX_UDP_CKSUM;
+	    udp->uh_sum = rte_ipv4_phdr_cksum(reinterpret_cast<struct ipv4_hdr *>(ip), mb->ol_flags);
+	}
+	return p;
+    }
+#endif
+
+    uint32_t daddr = ntohl(dst.addr());
+    uint32_t sum = _ip_sum_base + len + id + (daddr >> 16) + (daddr & 0xFFFF);
+    sum = (sum & 0xFFFF) + (sum >> 16);
+    sum += sum >> 16;
+    ip->ip_sum = htons(~sum & 0xFFFF);
+
+    if (_checksum) {
+	unsigned ulen = len - sizeof(click_ip);
+	unsigned csum = click_in_cksum(reinterpret_cast<unsigned char *>(udp), ulen);
+	udp->uh_sum = click_in_cksum_pseudohdr(csum, ip, ulen);
+	if (udp->uh_sum == 0)
+	    udp->uh_sum = 0xFFFF;
+    }
+
+    return p;
+}
+
+#if HAVE_BATCH
+PacketBatch *
+UDPTunnelEncap::simple_action_batch(PacketBatch *batch)
+{
+    auto fnt = [this](Packet *p) -> Packet * {
+	return UDPTunnelEncap::simple_action(p);
+    };
+    auto on_drop = [](Packet *) {};
+    EXECUTE_FOR_EACH_PACKET_DROPPABLE(fnt, batch, on_drop);
+    return batch;
+}
+#endif
+
+String
+UDPTunnelEncap::read_handler(Element *e, void *)
+{
+    UDPTunnelEncap *te = static_cast<UDPTunnelEncap *>(e);
+    StringAccum sa;
+    for (int i = 0; i < te->_tunnels.size(); ++i) {
+	const Tunnel &t = te->_tunnels[i];
+	sa << t.vni;
+	for (int j = 0; j < t.remotes.size(); ++j)
+	    sa << ' ' << t.remotes[j];
+	sa << '\n';
+    }
+    return sa.take_string();
+}
+
+void
+UDPTunnelEncap::add_handlers()
+{
+    add_read_handler("tunnels", read_handler, 0);
+}
+
+
+UDPTunnelDecap::UDPTunnelDecap()
+    : _dport(0), _check_mask(0), _check_value(0), _geneve_options(false)
+{
+    _drops = 0;
+}
+
+UDPTunnelDecap::~UDPTunnelDecap()
+{
+}
+
+int
+UDPTunnelDecap::configure(Vector<String> &conf, ErrorHandler *errh)
+{
+    uint16_t dport = ntohs(_dport);
+
+    if (Args(conf, this, errh)
+	.read("DPORT", IPPortArg(IP_PROTO_UDP), dport)
+	.complete() < 0)
+	return -1;
+
+    _dport = htons(dport);
+    return 0;
+}
+
+/* Return @a p with its outer IP, UDP, and tunnel headers removed, or null
+   (leaving @a p untouched) if it is not a well-formed tunnel packet. */
+inline Packet *
+UDPTunnelDecap::smaction(Packet *p)
+{
+    const click_ip *ip = reinterpret_cast<const click_ip *>(p->data());
+    unsigned len = p->length();
+    if (len < sizeof(click_ip) + sizeof(click_udp) + UDPTunnelEncap::tunnel_hlen
+	|| ip->ip_v != 4 || ip->ip_p != IP_PROTO_UDP || !IP_FIRSTFRAG(ip))
+	return 0;
+
+    unsigned hlen = ip->ip_hl << 2;
+    unsigned off = hlen + sizeof(click_udp) + UDPTunnelEncap::tunnel_hlen;
+    if (hlen < sizeof(click_ip) || off > len)
+	return 0;
+    const click_udp *udp = reinterpret_cast<const click_udp *>(p->data() + hlen);
+    if (_dport && udp->uh_dport != _dport)
+	return 0;
+
+    const uint8_t *th = reinterpret_cast<const uint8_t *>(udp + 1);
+    uint32_t w0 = ntohl(*reinterpret_cast<const uint32_t *>(th));
+    if ((w0 & _check_mask) != _check_value)
+	return 0;
+    if (_geneve_options) {
+	off += (th[0] & GENEVE_OPTLEN_MASK) << 2;
+	if (off > len)
+	    return 0;
+    }
+
+    SET_AGGREGATE_ANNO(p, ntohl(*reinterpret_cast<const uint32_t *>(th + 4)) >> 8);
+    p->pull(off);
+    return p;
+}
+
+Packet *
+UDPTunnelDecap::simple_action(Packet *p)
+{
+    if (Packet *q = smaction(p))
+	return q;
+    _drops++;
+    checked_output_push(1, p);
+    return 0;
+}
+
+#if HAVE_BATCH
+PacketBatch *
+UDPTunnelDecap::simple_action_batch(PacketBatch *batch)
+{
+    EXECUTE_FOR_EACH_PACKET_DROP_LIST(smaction, batch, drop_batch);
+    if (drop_batch) {
+	_drops += drop_batch->count();
+	checked_output_push_batch(1, drop_batch);
+    }
+    return batch;
+}
+#endif
+
+void
+UDPTunnelDecap::add_handlers()
+{
+    add_data_handlers("drops", Handler::OP_READ, &_drops);
+}
+
+CLICK_ENDDECLS
+ELEMENT_PROVIDES(UDPTunnelEncap UDPTunnelDecap)
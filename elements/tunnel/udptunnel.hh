@@ -0,0 +1,103 @@
+// -*- mode: c++; c-basic-offset: 4 -*-
+#ifndef CLICK_UDPTUNNEL_HH
+#define CLICK_UDPTUNNEL_HH
+#include <click/batchelement.hh>
+#include <click/atomic.hh>
+#include <click/hashtable.hh>
+#include <click/ipaddress.hh>
+#include <click/vector.hh>
+#include <clicknet/ip.h>
+#include <clicknet/udp.h>
+CLICK_DECLS
+
+/*
+ * UDPTunnelEncap and UDPTunnelDecap implement VXLAN-style tunnels: an
+ * Ethernet frame carried over UDP/IPv4 behind an 8-byte tunnel header whose
+ * last four bytes hold a 24-bit VNI.  Subclasses (VXLANEncap, GeneveEncap,
+ * VXLANDecap, GeneveDecap) only set the header template, the validity check,
+ * and the default UDP port in their constructors, so the per-packet path has
+ * no virtual calls.
+ */
+
+class UDPTunnelEncap : public BatchElement { public:
+
+    UDPTunnelEncap() CLICK_COLD;
+    ~UDPTunnelEncap() CLICK_COLD;
+
+    const char *port_count() const	{ return PORTS_1_1X2; }
+    const char *processing() const	{ return PROCESSING_A_AH; }
+    const char *flags() const		{ return "F"; }
+
+    int configure(Vector<String> &, ErrorHandler *) CLICK_COLD;
+    void add_handlers() CLICK_COLD;
+
+    Packet *simple_action(Packet *);
+#if HAVE_BATCH
+    PacketBatch *simple_action_batch(PacketBatch *);
+#endif
+
+    enum { tunnel_hlen = 8 };
+
+  protected:
+
+    uint8_t _thdr[tunnel_hlen];
+    uint16_t _dport;		// network byte order
+
+  private:
+
+    struct Tunnel {
+	uint32_t vni;
+	Vector<IPAddress> remotes;
+    };
+
+    Vector<Tunnel> _tunnels;
+    HashTable<uint32_t, int> _vni_map;
+
+    IPAddress _saddr;
+    int32_t _vni;
+    uint16_t _sport_min;
+    uint32_t _sport_range;
+    uint8_t _ttl;
+    bool _checksum;
+    bool _offload;
+    uint32_t _ip_sum_base;
+    atomic_uint32_t _id;
+
+    static inline uint32_t inner_flow_hash(const Packet *p);
+    static String read_handler(Element *, void *) CLICK_COLD;
+
+};
+
+class UDPTunnelDecap : public BatchElement { public:
+
+    UDPTunnelDecap() CLICK_COLD;
+    ~UDPTunnelDecap() CLICK_COLD;
+
+    const char *port_count() const	{ return PORTS_1_1X2; }
+    const char *processing() const	{ return PROCESSING_A_AH; }
+    const char *flags() const		{ return "F"; }
+
+    int configure(Vector<String> &, ErrorHandler *) CLICK_COLD;
+    void add_handlers() CLICK_COLD;
+
+    inline Packet *smaction(Packet *);
+    Packet *simple_action(Packet *);
+#if HAVE_BATCH
+    PacketBatch *simple_action_batch(PacketBatch *);
+#endif
+
+  protected:
+
+    uint16_t _dport;		// network byte order, 0 means any
+    uint32_t _check_mask;	// applied to the first tunnel header word
+    uint32_t _check_value;
+    bool _geneve_options;	// header carries a Geneve options length
+
+  private:
+
+    atomic_uint32_t _drops;
+
+};
+
+CLICK_ENDDECLS
+#endif
@@ -0,0 +1,31 @@
+// -*- mode: c++; c-basic-offset: 4 -*-
+/*
+ * vxlandecap.{cc,hh} -- element removes VXLAN encapsulation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Click LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Click LICENSE file; the license in that file is
+ * legally binding.
+ */
+
+#include <click/config.h>
+#include "vxlandecap.hh"
+#include <clicknet/vxlan.h>
+CLICK_DECLS
+
+VXLANDecap::VXLANDecap()
+{
+    _dport = htons(VXLAN_PORT);
+    _check_mask = VXLAN_FLAG_I << 24;
+    _check_value = VXLAN_FLAG_I << 24;
+}
+
+CLICK_ENDDECLS
+ELEMENT_REQUIRES(UDPTunnelDecap)
+EXPORT_ELEMENT(VXLANDecap)
+ELEMENT_MT_SAFE(VXLANDecap)
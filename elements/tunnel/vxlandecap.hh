@@ -0,0 +1,50 @@
+// -*- mode: c++; c-basic-offset: 4 -*-
+#ifndef CLICK_VXLANDECAP_HH
+#define CLICK_VXLANDECAP_HH
+#include "udptunnel.hh"
+CLICK_DECLS
+
+/*
+=c
+
+VXLANDecap(I<keywords> DPORT)
+
+=s tunnel
+
+removes VXLAN/UDP/IP headers and sets the VNI in the aggregate annotation
+
+=d
+
+Expects VXLAN packets starting with the outer IP header, for example after
+Strip(14) and CheckIPHeader.  Removes the IP, UDP, and VXLAN headers, sets the
+aggregate annotation to the VNI, and emits the inner Ethernet frame on output
+0.  Packets that are not VXLAN -- too short, not UDP, a non-initial fragment,
+the wrong UDP destination port, or without the VXLAN I flag -- are emitted
+unchanged on output 1, or dropped if there is no output 1.
+
+Keyword arguments are:
+
+=over 8
+
+=item DPORT
+
+Expected UDP destination port, or 0 to accept any.  Default is 4789.
+
+=back
+
+=h drops read-only
+
+Returns the number of packets that were not VXLAN.
+
+=a VXLANEncap, GeneveDecap */
+
+class VXLANDecap : public UDPTunnelDecap { public:
+
+    VXLANDecap() CLICK_COLD;
+
+    const char *class_name() const	{ return "VXLANDecap"; }
+
+};
+
+CLICK_ENDDECLS
+#endif
@@ -0,0 +1,31 @@
+// -*- mode: c++; c-basic-offset: 4 -*-
+/*
+ * vxlanencap.{cc,hh} -- element encapsulates Ethernet frames in VXLAN
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Click LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Click LICENSE file; the license in that file is
+ * legally binding.
+ */
+
+#include <click/config.h>
+#include "vxlanencap.hh"
+#include <clicknet/vxlan.h>
+CLICK_DECLS
+
+VXLANEncap::VXLANEncap()
+{
+    click_vxlan *vx = reinterpret_cast<click_vxlan *>(_thdr);
+    vx->vx_flags = VXLAN_FLAG_I;
+    _dport = htons(VXLAN_PORT);
+}
+
+CLICK_ENDDECLS
+ELEMENT_REQUIRES(UDPTunnelEncap)
+EXPORT_ELEMENT(VXLANEncap)
+ELEMENT_MT_SAFE(VXLANEncap)
@@ -0,0 +1,94 @@
+// -*- mode: c++; c-basic-offset: 4 -*-
+#ifndef CLICK_VXLANENCAP_HH
+#define CLICK_VXLANENCAP_HH
+#include "udptunnel.hh"
+CLICK_DECLS
+
+/*
+=c
+
+VXLANEncap(SRC, TUNNEL VNI REMOTE..., I<keywords> VNI, DPORT, SPORT_MIN, SPORT_MAX, TTL, CHECKSUM, OFFLOAD)
+
+=s tunnel
+
+encapsulates Ethernet frames in VXLAN/UDP/IP headers
+
+=d
+
+Expects Ethernet frames as input.  Prepends a VXLAN header (RFC 7348) and
+UDP/IP headers with source address SRC, and emits the result on output 0,
+with the destination IP address annotation set to the chosen remote tunnel
+endpoint.  An Ethernet header should be added downstream, for example with
+EtherEncap or ARPQuerier.
+
+Each TUNNEL argument maps a VNI to one or more remote endpoint (VTEP)
+addresses; give TUNNEL once per VNI.  A packet's VNI is the VNI keyword
+argument if given, and its aggregate annotation otherwise.  Packets whose VNI
+has no TUNNEL are emitted on output 1, or dropped if there is no output 1.
+
+The inner frame's flow (its IP addresses, protocol, and TCP or UDP ports, or
+its Ethernet addresses for non-IP frames) is hashed.  The hash picks one of
+the VNI's remote endpoints and the outer UDP source port, so that a flow
+always follows the same path, while flows spread over ECMP links and over the
+receiver's RSS queues.
+
+Keyword arguments are:
+
+=over 8
+
+=item VNI
+
+Integer between 0 and 16777215.  Encapsulate every packet with this VNI.
+Default is to use the aggregate annotation.
+
+=item DPORT
+
+UDP destination port.  Default is 4789.
+
+=item SPORT_MIN, SPORT_MAX
+
+Range of UDP source ports chosen by the flow hash.  Defaults are 49152 and
+65535.
+
+=item TTL
+
+Outer IP time-to-live.  Default is 64.
+
+=item CHECKSUM
+
+Boolean.  If true, compute the outer UDP checksum; otherwise leave it zero, as
+RFC 7348 allows.  The IP header checksum is always set.  Default is false.
+
+=item OFFLOAD
+
+Boolean.  If true, leave the IP header checksum (and the UDP checksum, if
+CHECKSUM is true) to the NIC by setting the DPDK transmit offload flags.
+The flags assume a 14-byte Ethernet header will be added before
+transmission.  Only available when packets are DPDK buffers; otherwise
+checksums are computed in software.  Default is false.
+
+=back
+
+=h tunnels read-only
+
+Returns the tunnel table, one "VNI REMOTE..." line per VNI.
+
+=e
+
+  FromDevice(tap0)
+    -> VXLANEncap(10.0.0.1, TUNNEL 42 10.0.0.2 10.0.0.3, VNI 42)
+    -> EtherEncap(0x0800, 00:00:c0:ae:67:ef, 00:00:c0:4f:71:ef)
+    -> ToDevice(eth0);
+
+=a VXLANDecap, GeneveEncap, UDPIPEncap */
+
+class VXLANEncap : public UDPTunnelEncap { public:
+
+    VXLANEncap() CLICK_COLD;
+
+    const char *class_name() const	{ return "VXLANEncap"; }
+
+};
+
+CLICK_ENDDECLS
+#endif
@@ -351,7 +351,11 @@ FromDump::prepare_times(const Timestamp &ts)
     else if (_last_time_interval)
 	_last_time += _first_time;
     if (_timing)
+#if TIMESTAMP_WARPABLE
+	_timing_offset = Timestamp::warp_trace_offset(ts);
+#else
 	_timing_offset = Timestamp::now_steady() - ts;
+#endif
     _have_any_times = true;
 }
 
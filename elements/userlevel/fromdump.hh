@@ -41,6 +41,9 @@ reading its tcpdump file (or the END time is reached).  Default is false.
 Boolean. If true, then FromDump tries to maintain the timing of the original
 packet stream. The first packet is emitted immediately; thereafter, FromDump
 maintains the delays between packets. Default is false.
+Under the userlevel driver's B<--trace-time> option, timing is kept in
+simulated time, so Timestamp::now() and timers follow the trace while FromDump
+runs as fast as possible.
 
 =item SAMPLE
 
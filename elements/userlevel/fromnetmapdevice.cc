@@ -46,7 +46,7 @@ FromNetmapDevice::cast(const char *n)
 {
     if (strcmp(n, "FromNetmapDevice") == 0)
 	return (Element *)this;
-    return NULL;
+    return RXQueueDevice::cast(n);
 }
 
 int
@@ -0,0 +1,144 @@
+// -*- c-basic-offset: 4; related-file-name: "fromshmring.hh" -*-
+/*
+ * fromshmring.{cc,hh} -- element reads packets sent by another process
+ * through shared memory
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Click LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Click LICENSE file; the license in that file is
+ * legally binding.
+ */
+
+#include <click/config.h>
+#include "fromshmring.hh"
+#include <click/args.hh>
+#include <click/error.hh>
+#include <click/standard/scheduleinfo.hh>
+CLICK_DECLS
+
+FromShmRing::FromShmRing()
+    : _task(this), _channel(0), _burst(32), _pool(0), _ring(0)
+{
+}
+
+FromShmRing::~FromShmRing()
+{
+}
+
+int
+FromShmRing::configure(Vector<String> &conf, ErrorHandler *errh)
+{
+#if CLICK_PACKET_USE_DPDK
+    return errh->error("not available with DPDK packets");
+#endif
+#if !HAVE_MULTITHREAD
+    return errh->error("requires a multithreaded build");
+#endif
+    Args args(conf, this, errh);
+    if (ShmPool::parse(args, _path, _geometry, _channel) < 0)
+	return -1;
+    if (args.read("BURST", _burst).complete() < 0)
+	return -1;
+    if (_burst == 0 || _burst > MAX_BURST)
+	return errh->error("BURST must be between 1 and %d", MAX_BURST);
+    return 0;
+}
+
+int
+FromShmRing::initialize(ErrorHandler *errh)
+{
+    if (!(_pool = ShmPool::open(_path, _geometry, errh)))
+	return -1;
+    _ring = _pool->channel(_channel);
+    _count.initialize(this, "count");
+    _invalid.initialize(this, "invalid");
+    ScheduleInfo::initialize_task(this, &_task, true, errh);
+    return 0;
+}
+
+void
+FromShmRing::cleanup(CleanupStage)
+{
+    if (_pool)
+	_pool->close();
+    _pool = 0;
+}
+
+bool
+FromShmRing::run_task(Task *)
+{
+    ShmPool::Descriptor d[MAX_BURST];
+    unsigned got = _ring->extract(d, _burst, false);
+    _task.fast_reschedule();
+    if (!got)
+	return false;
+
+    // The writer is another process: drop descriptors that point outside
+    // the pool, returning their buffer if it is one of ours.
+    unsigned n = 0;
+    for (unsigned i = 0; i < got; ++i)
+	if (_pool->valid(d[i])) {
+	    __builtin_prefetch(_pool->buffer(d[i].buffer) + d[i].offset);
+	    d[n++] = d[i];
+	} else if (d[i].buffer < _geometry.buffers)
+	    _pool->free(d[i].buffer);
+    if (n != got)
+	_invalid.add(got - n);
+
+#if HAVE_BATCH
+    PacketBatch *head = 0;
+    Packet *last = 0;
+    unsigned count = 0;
+#endif
+    for (unsigned i = 0; i < n; ++i) {
+	WritablePacket *p = _pool->make_packet(d[i]);
+	if (!p) {
+	    _pool->free(d[i].buffer);
+	    continue;
+	}
+#if HAVE_BATCH
+	if (head)
+	    last->set_next(p);
+	else
+	    head = PacketBatch::start_head(p);
+	last = p;
+	++count;
+#else
+	output(0).push(p);
+#endif
+    }
+#if HAVE_BATCH
+    if (head) {
+	head->make_tail(last, count);
+	output_push_batch(0, head);
+    }
+#endif
+    _count.add(n);
+    return true;
+}
+
+String
+FromShmRing::read_handler(Element *e, void *thunk)
+{
+    FromShmRing *f = static_cast<FromShmRing *>(e);
+    if (thunk)
+	return String(f->_invalid.value());
+    return String(f->_count.value());
+}
+
+void
+FromShmRing::add_handlers()
+{
+    add_read_handler("count", read_handler, 0);
+    add_read_handler("invalid", read_handler, 1);
+}
+
+CLICK_ENDDECLS
+ELEMENT_REQUIRES(userlevel ShmPool)
+EXPORT_ELEMENT(FromShmRing)
+ELEMENT_MT_SAFE(FromShmRing)
@@ -0,0 +1,94 @@
+#ifndef CLICK_FROMSHMRING_USERLEVEL_HH
+#define CLICK_FROMSHMRING_USERLEVEL_HH
+#include <click/batchelement.hh>
+#include <click/task.hh>
+#include <click/statscounter.hh>
+#include "shmpool.hh"
+CLICK_DECLS
+
+/*
+=title FromShmRing
+
+=c
+
+FromShmRing(PATH [, I<keywords> CHANNEL, CHANNELS, BUFFERS, BUFFER_SIZE, RING_SIZE, BURST])
+
+=s netdevices
+
+reads packets sent by another Click process through shared memory (user-level)
+
+=d
+
+Reads packets sent by ToShmRing elements, usually in other Click processes on
+the same host, to channel CHANNEL of the shared memory file PATH, and pushes
+them out in batches of up to BURST packets. Packets are not copied: their data
+stays in the shared buffers of PATH, and each buffer returns to the pool when
+its packet is killed, or travels on by reference if the packet is sent to a
+ToShmRing on the same PATH. Annotations are not carried.
+
+Only one FromShmRing may read a channel. See ToShmRing for the layout of PATH
+and the keywords CHANNEL, CHANNELS, BUFFERS, BUFFER_SIZE and RING_SIZE, which
+must match the other elements using PATH. Requires a multithreaded build.
+
+=over 8
+
+=item BURST
+
+Integer. Maximum number of packets read per task run. Default is 32.
+
+=back
+
+=h count read-only
+
+Returns the number of packets read.
+
+=h invalid read-only
+
+Returns the number of descriptors dropped because they pointed outside the
+pool.
+
+=e
+
+  FromShmRing(/dev/shm/chain, CHANNEL 1) -> Queue -> ...
+
+=a ToShmRing, FromDPDKRing */
+
+class FromShmRing : public BatchElement { public:
+
+    FromShmRing() CLICK_COLD;
+    ~FromShmRing() CLICK_COLD;
+
+    const char *class_name() const	{ return "FromShmRing"; }
+    const char *port_count() const	{ return PORTS_0_1; }
+    const char *processing() const	{ return PUSH; }
+    bool can_live_reconfigure() const	{ return false; }
+
+    int configure(Vector<String> &, ErrorHandler *) CLICK_COLD;
+    int initialize(ErrorHandler *) CLICK_COLD;
+    void cleanup(CleanupStage) CLICK_COLD;
+    void add_handlers() CLICK_COLD;
+
+    bool run_task(Task *);
+
+  private:
+
+    enum { MAX_BURST = 256 };
+
+    Task _task;
+    String _path;
+    ShmPool::Geometry _geometry;
+    uint32_t _channel;
+    unsigned _burst;
+
+    ShmPool *_pool;
+    ShmPool::ChannelRing *_ring;
+
+    StatsCounter _count;
+    StatsCounter _invalid;
+
+    static String read_handler(Element *, void *) CLICK_COLD;
+
+};
+
+CLICK_ENDDECLS
+#endif
@@ -0,0 +1,169 @@
+// -*- c-basic-offset: 4 -*-
+/*
+ * packetpoolinfo.{cc,hh} -- configure Click's packet pool
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Click LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Click LICENSE file; the license in that file is
+ * legally binding.
+ */
+
+#include <click/config.h>
+#include "packetpoolinfo.hh"
+#include <click/args.hh>
+#include <click/packet.hh>
+#include <click/straccum.hh>
+#include <click/error.hh>
+CLICK_DECLS
+
+PacketPoolInfo *PacketPoolInfo::instance;
+
+PacketPoolInfo::PacketPoolInfo()
+{
+}
+
+PacketPoolInfo::~PacketPoolInfo()
+{
+    if (instance == this)
+	instance = 0;
+}
+
+#if HAVE_CLICK_PACKET_POOL
+static bool
+parse_slab_size(const String &str, uint32_t &result)
+{
+    if (str.equals("2MB", -1) || str.equals("2M", -1))
+	result = 2U << 20;
+    else if (str.equals("1GB", -1) || str.equals("1G", -1))
+	result = 1U << 30;
+    else if (!IntArg().parse(str, result))
+	return false;
+    return result == (2U << 20) || result == (1U << 30);
+}
+#endif
+
+int
+PacketPoolInfo::configure(Vector<String> &conf, ErrorHandler *errh)
+{
+    // A hotswapped-in configuration replaces the running one's instance.
+    if (instance && instance != this && instance->router() == router())
+	return errh->error("there can be only one PacketPoolInfo");
+    instance = this;
+#if HAVE_CLICK_PACKET_POOL
+    unsigned size = WritablePacket::pool_size();
+    unsigned global_batches = WritablePacket::pool_global_batches();
+    bool adaptive = true, hugepages = true;
+    String slab_str;
+    uint32_t slab_size = 2U << 20;
+    unsigned prealloc = 0;
+    if (Args(conf, this, errh)
+	.read("SIZE", size)
+	.read("GLOBAL_BATCHES", global_batches)
+	.read("ADAPTIVE", adaptive)
+	.read("HUGEPAGES", hugepages)
+	.read("SLAB_SIZE", WordArg(), slab_str)
+	.read("PREALLOC", prealloc)
+	.complete() < 0)
+	return -1;
+    if (size == 0 || global_batches == 0)
+	return errh->error("SIZE and GLOBAL_BATCHES must be positive");
+    if (slab_str && !parse_slab_size(slab_str, slab_size))
+	return errh->error("SLAB_SIZE must be 2MB or 1GB");
+
+    WritablePacket::pool_set_size(size, global_batches, adaptive);
+    int r = WritablePacket::pool_set_arena(hugepages, slab_size);
+    if (r == -EOPNOTSUPP && (slab_str || prealloc))
+	errh->warning("packet pool buffers do not come from slabs in this build");
+    if (prealloc) {
+	for (int node = 0; node < WritablePacket::pool_nodes(); ++node) {
+	    unsigned n = WritablePacket::pool_reserve(node, prealloc);
+	    if (n < prealloc)
+		errh->warning("node %d: could only preallocate %u packets", node, n);
+	}
+    }
+    return 0;
+#else
+    (void) conf;
+    return errh->error("Click's packet pool is not used in this build");
+#endif
+}
+
+#if HAVE_CLICK_PACKET_POOL
+String
+PacketPoolInfo::read_handler(Element *, void *thunk)
+{
+    StringAccum sa;
+    int what = (intptr_t) thunk;
+    switch (what) {
+    case h_adaptations:
+	sa << WritablePacket::pool_adaptations();
+	break;
+    case h_size:
+	sa << WritablePacket::pool_size();
+	break;
+    case h_global_batches:
+	sa << WritablePacket::pool_global_batches();
+	break;
+    default:
+	for (int node = 0; node < WritablePacket::pool_nodes(); ++node) {
+	    PacketPoolStats s;
+	    WritablePacket::pool_node_stats(node, s);
+	    sa << node;
+	    if (what == h_occupancy)
+		sa << ' ' << s.packets << ' ' << s.buffers;
+	    else if (what == h_misses)
+		sa << ' ' << s.misses;
+	    else if (what == h_cross_node)
+		sa << ' ' << s.cross_node;
+	    else
+		sa << ' ' << s.arena_bytes << ' ' << s.hugepage_bytes;
+	    sa << '\n';
+	}
+	break;
+    }
+    return sa.take_string();
+}
+
+int
+PacketPoolInfo::write_handler(const String &str, Element *, void *thunk,
+			      ErrorHandler *errh)
+{
+    unsigned x;
+    if (!IntArg().parse(str, x) || x == 0)
+	return errh->error("expected positive integer");
+    unsigned size = WritablePacket::pool_size();
+    unsigned global_batches = WritablePacket::pool_global_batches();
+    if ((intptr_t) thunk == h_size)
+	size = x;
+    else
+	global_batches = x;
+    // keep the ADAPTIVE setting as configured
+    WritablePacket::pool_set_size(size, global_batches, WritablePacket::pool_adaptive());
+    return 0;
+}
+#endif
+
+void
+PacketPoolInfo::add_handlers()
+{
+#if HAVE_CLICK_PACKET_POOL
+    add_read_handler("occupancy", read_handler, h_occupancy);
+    add_read_handler("misses", read_handler, h_misses);
+    add_read_handler("cross_node", read_handler, h_cross_node);
+    add_read_handler("arena", read_handler, h_arena);
+    add_read_handler("adaptations", read_handler, h_adaptations);
+    add_read_handler("size", read_handler, h_size);
+    add_write_handler("size", write_handler, h_size);
+    add_read_handler("global_batches", read_handler, h_global_batches);
+    add_write_handler("global_batches", write_handler, h_global_batches);
+#endif
+}
+
+CLICK_ENDDECLS
+ELEMENT_REQUIRES(userlevel)
+EXPORT_ELEMENT(PacketPoolInfo)
@@ -0,0 +1,131 @@
+#ifndef CLICK_PACKETPOOLINFO_HH
+#define CLICK_PACKETPOOLINFO_HH
+#include <click/element.hh>
+CLICK_DECLS
+
+/*
+=title PacketPoolInfo
+
+=c
+
+PacketPoolInfo([I<keywords> SIZE, GLOBAL_BATCHES, ADAPTIVE, HUGEPAGES, SLAB_SIZE, PREALLOC])
+
+=s information
+
+configure Click's packet pool
+
+=d
+
+Sets the parameters of Click's own packet pool, used at user level when
+packets are not DPDK or netmap buffers.
+
+Each thread keeps free packets in a private pool.  When the pool holds SIZE
+packets, the thread hands them as one batch to the shared pool of its NUMA
+node, which keeps up to GLOBAL_BATCHES such batches.  Packet buffers come
+from slabs of SLAB_SIZE bytes mapped on their node, so a buffer freed on
+another node is sent back home instead of being reused there.
+
+Keyword arguments are:
+
+=over 8
+
+=item SIZE
+
+Integer.  Free packets, and separately free packets with data buffers, a
+thread keeps before handing them to its node.  Default is 4096.
+
+=item GLOBAL_BATCHES
+
+Integer.  Batches each node keeps before freeing them.  Default is 32.
+
+=item ADAPTIVE
+
+Boolean.  If true, a node that would have to free a batch instead doubles
+GLOBAL_BATCHES, up to 1024.  Default is true.
+
+=item HUGEPAGES
+
+Boolean.  If true, map slabs on hugepages of SLAB_SIZE, falling back to
+transparent hugepages if none are reserved.  Default is true.
+
+=item SLAB_SIZE
+
+Size of the slabs, 2MB (the default) or 1GB.
+
+=item PREALLOC
+
+Integer.  Packets with data buffers to allocate on each node at
+configuration time.  Default is 0.
+
+=back
+
+There can be only one PacketPoolInfo per configuration.  It runs before other
+elements are configured, so preallocated buffers are available to them.
+
+Slabs stay mapped until the process exits: memory the pool grows to is reused
+by later packets, but never returned to the system, even when PacketPoolInfo
+is removed by a hotswap.
+
+=h occupancy read-only
+
+Returns one line per NUMA node: the node, and the numbers of free packets
+and free packets with data buffers it holds, including its threads' pools.
+
+=h misses read-only
+
+Returns one line per node: the node, and the number of times one of its
+threads found both its own pool and the node's empty.
+
+=h cross_node read-only
+
+Returns one line per node: the node, and the number of buffers its threads
+freed that belonged to another node.
+
+=h arena read-only
+
+Returns one line per node: the node, and the bytes of slabs mapped for it,
+and how many of those are on hugepages.
+
+=h adaptations read-only
+
+Returns how many times GLOBAL_BATCHES grew.
+
+=h size read/write
+
+Returns or sets SIZE.
+
+=h global_batches read/write
+
+Returns or sets GLOBAL_BATCHES.
+
+=e
+
+  PacketPoolInfo(SIZE 8192, SLAB_SIZE 1GB, PREALLOC 65536)
+
+=a DPDKInfo, NetmapInfo */
+
+class PacketPoolInfo : public Element { public:
+
+    PacketPoolInfo() CLICK_COLD;
+    ~PacketPoolInfo() CLICK_COLD;
+
+    const char *class_name() const	{ return "PacketPoolInfo"; }
+
+    int configure_phase() const		{ return CONFIGURE_PHASE_FIRST; }
+    int configure(Vector<String> &conf, ErrorHandler *errh) CLICK_COLD;
+    void add_handlers() CLICK_COLD;
+
+    static PacketPoolInfo *instance;
+
+  private:
+
+    enum { h_occupancy, h_misses, h_cross_node, h_arena, h_adaptations,
+	   h_size, h_global_batches };
+    static String read_handler(Element *e, void *thunk) CLICK_COLD;
+    static int write_handler(const String &str, Element *e, void *thunk,
+			     ErrorHandler *errh) CLICK_COLD;
+
+};
+
+CLICK_ENDDECLS
+#endif
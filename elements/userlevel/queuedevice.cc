@@ -32,6 +32,16 @@ QueueDevice::QueueDevice() : _minqueues(0),_maxqueues(128), usable_threads(),
 	_this_node(0){
 	_verbose = 1;
 }
+/* Each task of a QueueDevice serves the queues of the thread it runs on, so
+ * thread schedulers use this cast to leave those tasks in place. */
+void *
+QueueDevice::cast(const char *n)
+{
+    if (strcmp(n, "QueueDevice") == 0)
+        return static_cast<QueueDevice *>(this);
+    return BatchElement::cast(n);
+}
+
 void QueueDevice::static_initialize() {
 #if HAVE_NUMA
     int num_nodes = Numa::get_max_numas();
@@ -24,6 +24,8 @@ public:
 
     static void static_initialize();
 
+    void *cast(const char *n);
+
 private :
     /* Those two are only used during configurations. On runtime, the final
      * n_queues choice is used.*/
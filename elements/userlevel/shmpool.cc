@@ -0,0 +1,254 @@
+// -*- c-basic-offset: 4; related-file-name: "shmpool.hh" -*-
+/*
+ * shmpool.{cc,hh} -- packet buffers and rings shared between processes
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Click LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Click LICENSE file; the license in that file is
+ * legally binding.
+ */
+
+#include <click/config.h>
+#include "shmpool.hh"
+#include <click/args.hh>
+#include <click/error.hh>
+#include <click/vector.hh>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/statfs.h>
+#include <sys/mman.h>
+#include <sys/file.h>
+#include <fcntl.h>
+#include <unistd.h>
+CLICK_DECLS
+
+struct ShmPool::Header {
+    uint32_t magic;
+    uint32_t version;
+    Geometry g;
+    volatile uint32_t users;
+    uint32_t pad;
+    uint64_t size;
+};
+
+enum { SHM_MAGIC = 0x436C6B53, SHM_VERSION = 1 };
+
+Vector<ShmPool *> ShmPool::pools;
+
+static inline size_t
+align(size_t x, size_t a)
+{
+    return (x + a - 1) & ~(a - 1);
+}
+
+static inline uint32_t
+next_pow2(uint32_t x)
+{
+    uint32_t p = 1;
+    while (p < x)
+	p <<= 1;
+    return p;
+}
+
+ShmPool::ShmPool(const String &path, const Geometry &g)
+    : _path(path), _g(g), _fd(-1), _refcount(1), _mem(MAP_FAILED), _size(0),
+      _header(0), _free(0), _channels(0), _buffers(0)
+{
+}
+
+ShmPool::~ShmPool()
+{
+    delete[] _channels;
+}
+
+void
+ShmPool::layout(size_t &free_off, size_t &channels_off, size_t &buffers_off) const
+{
+    free_off = align(sizeof(Header), CLICK_CACHE_LINE_SIZE);
+    channels_off = align(free_off + FreeRing::memory_size(next_pow2(_g.buffers)),
+			 CLICK_CACHE_LINE_SIZE);
+    size_t ring = align(ChannelRing::memory_size(_g.ring_size), CLICK_CACHE_LINE_SIZE);
+    buffers_off = align(channels_off + ring * _g.channels, 4096);
+}
+
+int
+ShmPool::parse(Args &args, String &path, Geometry &g, uint32_t &channel)
+{
+    g.buffers = 8192;
+    g.buffer_size = 2048;
+    g.channels = 4;
+    g.ring_size = 1024;
+    channel = 0;
+    if (args.read_mp("PATH", FilenameArg(), path)
+	.read("CHANNEL", channel)
+	.read("CHANNELS", g.channels)
+	.read("BUFFERS", g.buffers)
+	.read("BUFFER_SIZE", g.buffer_size)
+	.read("RING_SIZE", g.ring_size)
+	.execute() < 0)
+	return -1;
+
+    ErrorHandler *errh = args.errh();
+    if (g.buffers == 0 || g.buffers > (1U << 30))
+	return errh->error("BUFFERS out of range");
+    if (g.buffer_size < Packet::min_buffer_length || g.buffer_size > MAX_BUFFER_SIZE)
+	return errh->error("BUFFER_SIZE out of range");
+    if (g.ring_size == 0 || g.ring_size > (1U << 24))
+	return errh->error("RING_SIZE out of range");
+    if (channel >= g.channels)
+	return errh->error("CHANNEL must be less than CHANNELS");
+    g.buffer_size = align(g.buffer_size, CLICK_CACHE_LINE_SIZE);
+    g.ring_size = next_pow2(g.ring_size);
+    return 0;
+}
+
+ShmPool *
+ShmPool::open(const String &path, const Geometry &g, ErrorHandler *errh)
+{
+    for (int i = 0; i < pools.size(); ++i)
+	if (pools[i]->_path == path) {
+	    const Geometry &pg = pools[i]->_g;
+	    if (pg.buffers != g.buffers || pg.buffer_size != g.buffer_size
+		|| pg.channels != g.channels || pg.ring_size != g.ring_size) {
+		errh->error("%s: geometry differs from another element's", path.c_str());
+		return 0;
+	    }
+	    pools[i]->_refcount++;
+	    return pools[i];
+	}
+
+    ShmPool *pool = new ShmPool(path, g);
+    if (pool->attach(errh) < 0) {
+	pool->close();
+	return 0;
+    }
+    pools.push_back(pool);
+    return pool;
+}
+
+int
+ShmPool::attach(ErrorHandler *errh)
+{
+    size_t free_off, channels_off, buffers_off;
+    layout(free_off, channels_off, buffers_off);
+    size_t size = buffers_off + (size_t) _g.buffers * _g.buffer_size;
+
+    // Another process may unlink the file between our open() and flock();
+    // retry until the locked file is the one at the path.
+    struct stat fst, pst;
+    while (1) {
+	if ((_fd = ::open(_path.c_str(), O_RDWR | O_CREAT, 0600)) < 0)
+	    return errh->error("%s: %s", _path.c_str(), strerror(errno));
+	if (flock(_fd, LOCK_EX) < 0)
+	    return errh->error("%s: flock: %s", _path.c_str(), strerror(errno));
+	if (fstat(_fd, &fst) == 0 && stat(_path.c_str(), &pst) == 0
+	    && fst.st_ino == pst.st_ino && fst.st_dev == pst.st_dev)
+	    break;
+	::close(_fd);
+    }
+
+    // hugetlbfs reports the huge page size as its block size
+    struct statfs sfs;
+    if (fstatfs(_fd, &sfs) == 0 && sfs.f_bsize > 0)
+	size = align(size, sfs.f_bsize);
+
+    bool format = (fst.st_size == 0);
+    if (format && ftruncate(_fd, size) < 0) {
+	errh->error("%s: %s", _path.c_str(), strerror(errno));
+	goto unlock;
+    } else if (!format && (size_t) fst.st_size != size) {
+	errh->error("%s: size %lu does not match geometry (%lu)", _path.c_str(),
+		    (unsigned long) fst.st_size, (unsigned long) size);
+	goto unlock;
+    }
+
+    _mem = mmap(0, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _fd, 0);
+    if (_mem == MAP_FAILED) {
+	errh->error("%s: mmap: %s", _path.c_str(), strerror(errno));
+	goto unlock;
+    }
+    _size = size;
+    _header = reinterpret_cast<Header *>(_mem);
+    _free = reinterpret_cast<FreeRing *>((char *) _mem + free_off);
+    _channels = new ChannelRing *[_g.channels];
+    for (uint32_t i = 0; i < _g.channels; ++i)
+	_channels[i] = reinterpret_cast<ChannelRing *>
+	    ((char *) _mem + channels_off
+	     + i * align(ChannelRing::memory_size(_g.ring_size), CLICK_CACHE_LINE_SIZE));
+    _buffers = (unsigned char *) _mem + buffers_off;
+
+    if (format) {
+	FreeRing::format(_free, next_pow2(_g.buffers));
+	for (uint32_t i = 0; i < _g.channels; ++i)
+	    ChannelRing::format(_channels[i], _g.ring_size);
+	for (uint32_t i = 0; i < _g.buffers; ++i)
+	    _free->insert(&i, 1, false);
+	_header->g = _g;
+	_header->size = size;
+	_header->users = 0;
+	_header->version = SHM_VERSION;
+	_header->magic = SHM_MAGIC;
+    } else if (_header->magic != SHM_MAGIC || _header->version != SHM_VERSION
+	       || memcmp(&_header->g, &_g, sizeof(Geometry)) != 0) {
+	errh->error("%s: not a shared ring file with this geometry", _path.c_str());
+	munmap(_mem, _size);
+	_mem = MAP_FAILED;
+	goto unlock;
+    }
+    _header->users++;
+    flock(_fd, LOCK_UN);
+    return 0;
+
+  unlock:
+    flock(_fd, LOCK_UN);
+    return -1;
+}
+
+void
+ShmPool::close()
+{
+    if (--_refcount > 0)
+	return;
+    for (int i = 0; i < pools.size(); ++i)
+	if (pools[i] == this) {
+	    pools[i] = pools.back();
+	    pools.pop_back();
+	    break;
+	}
+    if (_mem == MAP_FAILED) {
+	if (_fd >= 0)
+	    ::close(_fd);
+	delete this;
+	return;
+    }
+    // Return the buffers cached by each thread, or other processes could
+    // never allocate them again.
+    for (unsigned i = 0; i < _cache.weight(); ++i) {
+	Cache &c = _cache.get_value(i);
+	if (c.n)
+	    _free->insert(c.idx, c.n, true);
+	c.n = 0;
+    }
+    flock(_fd, LOCK_EX);
+    if (--_header->users == 0)
+	unlink(_path.c_str());
+    flock(_fd, LOCK_UN);
+    // Keep the mapping: packets may still hold its buffers, and return them
+    // when they die.
+}
+
+void
+ShmPool::destructor(unsigned char *buf, size_t, void *arg)
+{
+    ShmPool *pool = static_cast<ShmPool *>(arg);
+    pool->free((buf - pool->_buffers) / pool->_g.buffer_size);
+}
+
+CLICK_ENDDECLS
+ELEMENT_REQUIRES(userlevel linux)
+ELEMENT_PROVIDES(ShmPool)
@@ -0,0 +1,145 @@
+// -*- c-basic-offset: 4 -*-
+#ifndef CLICK_SHMPOOL_HH
+#define CLICK_SHMPOOL_HH
+#include <click/packet.hh>
+#include <click/ring.hh>
+#include <click/multithread.hh>
+#include <click/string.hh>
+#include <click/vector.hh>
+CLICK_DECLS
+class ErrorHandler;
+class Args;
+
+/*
+ * ShmPool: a file mapped by several Click processes, holding a pool of packet
+ * buffers, a ring of free buffer indexes, and a number of channel rings of
+ * packet descriptors. Used by ToShmRing and FromShmRing.
+ *
+ * Layout: header, free ring, channel rings, buffers. The first process to
+ * open the file sizes and formats it under an flock(); the others check that
+ * its geometry matches theirs. The last process to close it unlinks it.
+ * Within a process, elements naming the same file share one ShmPool.
+ */
+class ShmPool { public:
+
+    struct Geometry {
+	uint32_t buffers;
+	uint32_t buffer_size;
+	uint32_t channels;
+	uint32_t ring_size;
+    };
+
+    struct Descriptor {
+	uint32_t buffer;
+	uint16_t offset;
+	uint16_t length;
+    };
+
+    typedef SharedRing<uint32_t> FreeRing;
+    typedef SharedRing<Descriptor> ChannelRing;
+
+    enum { MAX_BUFFER_SIZE = 32768, CACHE_SIZE = 32 };
+
+    /** @brief Read PATH and the geometry and channel keywords shared by
+     * ToShmRing and FromShmRing from @a args. */
+    static int parse(Args &args, String &path, Geometry &g, uint32_t &channel);
+
+    static ShmPool *open(const String &path, const Geometry &g, ErrorHandler *errh);
+    void close();
+
+    const String &path() const {
+	return _path;
+    }
+    ChannelRing *channel(uint32_t i) const {
+	return _channels[i];
+    }
+    uint32_t buffer_size() const {
+	return _g.buffer_size;
+    }
+    unsigned char *buffer(uint32_t i) const {
+	return _buffers + (size_t) i * _g.buffer_size;
+    }
+
+    /** @brief Allocate a buffer, returning its index or -1 if none is free. */
+    inline int alloc();
+    /** @brief Return buffer @a i to the free ring. */
+    inline void free(uint32_t i) {
+	_free->insert(&i, 1, true);
+    }
+
+    /** @brief Return the index of the pool buffer of @a p, or -1 if its
+     * buffer is not an unshared buffer of this pool. */
+    inline int buffer_of(Packet *p) const;
+
+    /** @brief Return true if @a d names a pool buffer and its data lies
+     * within that buffer. Descriptors come from other processes. */
+    bool valid(const Descriptor &d) const {
+	return d.buffer < _g.buffers
+	    && (uint32_t) d.offset + d.length <= _g.buffer_size;
+    }
+
+    /** @brief Wrap a received descriptor into a packet that frees its
+     * buffer when killed. @a d must be valid(). */
+    inline WritablePacket *make_packet(const Descriptor &d);
+
+  private:
+
+    struct Header;
+    struct Cache {
+	uint32_t n;
+	uint32_t idx[CACHE_SIZE];
+	Cache()
+	    : n(0) {
+	}
+    };
+
+    String _path;
+    Geometry _g;
+    int _fd;
+    int _refcount;
+    void *_mem;
+    size_t _size;
+    Header *_header;
+    FreeRing *_free;
+    ChannelRing **_channels;
+    unsigned char *_buffers;
+    per_thread<Cache> _cache;
+
+    static Vector<ShmPool *> pools;
+
+    ShmPool(const String &path, const Geometry &g);
+    ~ShmPool();
+    int attach(ErrorHandler *errh);
+    void layout(size_t &free_off, size_t &channels_off, size_t &buffers_off) const;
+    static void destructor(unsigned char *buf, size_t, void *arg);
+
+};
+
+inline int
+ShmPool::alloc()
+{
+    Cache &c = *_cache;
+    if (!c.n && !(c.n = _free->extract(c.idx, CACHE_SIZE, true)))
+	return -1;
+    return c.idx[--c.n];
+}
+
+inline int
+ShmPool::buffer_of(Packet *p) const
+{
+    if (p->buffer_destructor() != destructor || p->destructor_argument() != this
+	|| p->data_packet() || p->shared())
+	return -1;
+    return (p->buffer() - _buffers) / _g.buffer_size;
+}
+
+inline WritablePacket *
+ShmPool::make_packet(const Descriptor &d)
+{
+    unsigned char *buf = buffer(d.buffer);
+    return Packet::make(buf + d.offset, d.length, destructor, this, d.offset,
+			_g.buffer_size - d.offset - d.length);
+}
+
+CLICK_ENDDECLS
+#endif
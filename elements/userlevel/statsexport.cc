@@ -0,0 +1,182 @@
+// -*- c-basic-offset: 4 -*-
+/*
+ * statsexport.{cc,hh} -- exports counters through shared memory
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Click LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Click LICENSE file; the license in that file is
+ * legally binding.
+ */
+
+#include <click/config.h>
+#include "statsexport.hh"
+#include <click/args.hh>
+#include <click/error.hh>
+#include <click/router.hh>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+CLICK_DECLS
+
+StatsExport::StatsExport()
+    : _capacity(1024), _unlink(true), _header(0), _size(0), _dev(0), _ino(0),
+      _full_warned(false)
+{
+}
+
+StatsExport::~StatsExport()
+{
+    // Other elements' counters point into the mapping until they are
+    // destroyed too, so unmap only here.
+    if (_header)
+	munmap(_header, _size);
+}
+
+int
+StatsExport::configure(Vector<String> &conf, ErrorHandler *errh)
+{
+    if (Args(conf, this, errh)
+	.read_mp("FILE", FilenameArg(), _filename)
+	.read("CAPACITY", _capacity)
+	.read("UNLINK", _unlink)
+	.complete() < 0)
+	return -1;
+    if (_capacity == 0)
+	return errh->error("CAPACITY must be positive");
+
+    if (void *other = router()->attachment("StatsRegion"))
+	return errh->error("router already has a StatsExport, %p{element}",
+			   static_cast<StatsExport *>(static_cast<StatsRegion *>(other)));
+    router()->set_attachment("StatsRegion", static_cast<StatsRegion *>(this));
+    return 0;
+}
+
+int
+StatsExport::initialize(ErrorHandler *errh)
+{
+    uint32_t nthreads = click_max_cpu_ids();
+    uint32_t stride = (_capacity * sizeof(uint64_t) + CLICK_CACHE_LINE_SIZE - 1)
+	& ~(CLICK_CACHE_LINE_SIZE - 1);
+    uint64_t desc_offset = (sizeof(click_stats_header) + CLICK_CACHE_LINE_SIZE - 1)
+	& ~(CLICK_CACHE_LINE_SIZE - 1);
+    uint64_t data_offset = desc_offset + (uint64_t) _capacity * sizeof(click_stats_desc);
+    data_offset = (data_offset + CLICK_CACHE_LINE_SIZE - 1) & ~(CLICK_CACHE_LINE_SIZE - 1);
+    _size = data_offset + (uint64_t) nthreads * stride;
+
+    // Build the file under a temporary name, then rename it into place, so
+    // readers only ever see complete headers.
+    String tmpname = _filename + ".tmp" + String(getpid());
+    int fd = open(tmpname.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+	return errh->error("%s: %s", tmpname.c_str(), strerror(errno));
+    void *mem = MAP_FAILED;
+    struct stat st;
+    if (ftruncate(fd, _size) < 0 || fstat(fd, &st) < 0
+	|| (mem = mmap(0, _size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)) == MAP_FAILED) {
+	int e = errno;
+	close(fd);
+	unlink(tmpname.c_str());
+	return errh->error("%s: %s", tmpname.c_str(), strerror(e));
+    }
+    close(fd);
+
+    _header = static_cast<click_stats_header *>(mem);
+    _header->version = CLICK_STATS_VERSION;
+    _header->header_size = sizeof(click_stats_header);
+    _header->desc_size = sizeof(click_stats_desc);
+    _header->capacity = _capacity;
+    _header->nthreads = nthreads;
+    _header->thread_stride = stride;
+    _header->desc_offset = desc_offset;
+    _header->data_offset = data_offset;
+    _header->size = _size;
+    _header->ncounters = 0;
+    _header->closed = 0;
+    _header->pid = getpid();
+    memcpy(_header->magic, CLICK_STATS_MAGIC, sizeof(_header->magic));
+
+    if (rename(tmpname.c_str(), _filename.c_str()) < 0) {
+	int e = errno;
+	unlink(tmpname.c_str());
+	return errh->error("%s: %s", _filename.c_str(), strerror(e));
+    }
+    _dev = st.st_dev;
+    _ino = st.st_ino;
+    return 0;
+}
+
+uint64_t *
+StatsExport::allocate(const String &name, uint32_t flags, unsigned &stride)
+{
+    if (!_header)
+	return 0;
+    _lock.acquire();
+    uint32_t slot = _header->ncounters;
+    if (slot == _capacity) {
+	if (!_full_warned)
+	    click_chatter("%p{element}: CAPACITY reached, %s not exported",
+			  this, name.c_str());
+	_full_warned = true;
+	_lock.release();
+	return 0;
+    }
+
+    char *base = reinterpret_cast<char *>(_header);
+    click_stats_desc *d = reinterpret_cast<click_stats_desc *>
+	(base + _header->desc_offset) + slot;
+    int len = name.length() < CLICK_STATS_NAMELEN ? name.length() : CLICK_STATS_NAMELEN - 1;
+    memcpy(d->name, name.data(), len);
+    d->name[len] = 0;
+    d->slot = slot;
+    d->flags = flags;
+    click_write_fence();
+    _header->ncounters = slot + 1;
+    _lock.release();
+
+    stride = _header->thread_stride / sizeof(uint64_t);
+    return reinterpret_cast<uint64_t *>(base + _header->data_offset) + slot;
+}
+
+void
+StatsExport::cleanup(CleanupStage)
+{
+    if (router()->attachment("StatsRegion") == static_cast<StatsRegion *>(this))
+	router()->set_attachment("StatsRegion", 0);
+    if (!_header)
+	return;
+    _header->closed = 1;
+    // Remove the file only if a newer router has not replaced it.
+    struct stat st;
+    if (_unlink && stat(_filename.c_str(), &st) == 0
+	&& st.st_dev == _dev && st.st_ino == _ino)
+	unlink(_filename.c_str());
+}
+
+String
+StatsExport::read_handler(Element *e, void *thunk)
+{
+    StatsExport *se = static_cast<StatsExport *>(e);
+    if (thunk)
+	return String(se->_header ? se->_header->ncounters : 0);
+    return se->_filename;
+}
+
+void
+StatsExport::add_handlers()
+{
+    add_read_handler("file", read_handler, 0);
+    add_read_handler("counters", read_handler, 1);
+}
+
+CLICK_ENDDECLS
+ELEMENT_REQUIRES(userlevel)
+EXPORT_ELEMENT(StatsExport)
+ELEMENT_MT_SAFE(StatsExport)
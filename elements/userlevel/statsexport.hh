@@ -0,0 +1,107 @@
+// -*- c-basic-offset: 4 -*-
+#ifndef CLICK_STATSEXPORT_HH
+#define CLICK_STATSEXPORT_HH
+#include <click/element.hh>
+#include <click/statscounter.hh>
+#include <click/sync.hh>
+#include <sys/types.h>
+CLICK_DECLS
+
+/*
+=c
+
+StatsExport(FILE [, I<keywords> CAPACITY, UNLINK])
+
+=s counters
+
+exports counters through shared memory
+
+=d
+
+Maps FILE into memory and lends its space to the per-thread counters of the
+other elements in the router, so that other processes can read the counters
+without system calls or handler calls. The click-stats tool prints them.
+
+Elements that keep their counters in StatsCounter objects, such as CounterMP
+and Pipeliner, register them with StatsExport when they initialize. Each
+counter is named after its element, as in "c.count" for the "count" counter
+of element "c". Every thread writes its own copy of each counter and readers
+add the copies up, so exporting a counter costs the router nothing beyond the
+memory. The file layout is described in <click/statsregion.h>.
+
+FILE is created when the router initializes, or replaced if it exists: the new
+file is written under a temporary name and renamed into place, so a reader
+never sees a half-built file. When the router goes away, StatsExport marks the
+file closed, and removes it unless UNLINK is false. Readers that find the file
+closed should open FILE again, since a new router may have replaced it.
+
+Only one StatsExport may appear in a router.
+
+Keyword arguments are:
+
+=over 8
+
+=item CAPACITY
+
+Unsigned. Maximum number of counters. Counters beyond CAPACITY stay private
+to the router. Default is 1024.
+
+=item UNLINK
+
+Boolean. If true, remove FILE when the router goes away. Default is true.
+
+=back
+
+=h file read-only
+
+Returns FILE.
+
+=h counters read-only
+
+Returns the number of counters registered so far.
+
+=e
+
+  StatsExport(/dev/shm/click-stats);
+  FromDevice(eth0) -> c :: CounterMP -> Discard;
+
+Then, from a shell:
+
+  click-stats /dev/shm/click-stats
+
+=a click-stats(1), CounterMP, Pipeliner */
+
+class StatsExport : public Element, public StatsRegion { public:
+
+    StatsExport() CLICK_COLD;
+    ~StatsExport() CLICK_COLD;
+
+    const char *class_name() const	{ return "StatsExport"; }
+    int configure_phase() const		{ return CONFIGURE_PHASE_FIRST; }
+
+    int configure(Vector<String> &, ErrorHandler *) CLICK_COLD;
+    int initialize(ErrorHandler *) CLICK_COLD;
+    void cleanup(CleanupStage) CLICK_COLD;
+    void add_handlers() CLICK_COLD;
+
+    uint64_t *allocate(const String &, uint32_t, unsigned &);
+
+  private:
+
+    String _filename;
+    uint32_t _capacity;
+    bool _unlink;
+
+    Spinlock _lock;
+    click_stats_header *_header;
+    size_t _size;
+    dev_t _dev;
+    ino_t _ino;
+    bool _full_warned;
+
+    static String read_handler(Element *, void *) CLICK_COLD;
+
+};
+
+CLICK_ENDDECLS
+#endif
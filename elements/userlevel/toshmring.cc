@@ -0,0 +1,185 @@
+// -*- c-basic-offset: 4; related-file-name: "toshmring.hh" -*-
+/*
+ * toshmring.{cc,hh} -- element sends packets to another process through
+ * shared memory
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Click LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Click LICENSE file; the license in that file is
+ * legally binding.
+ */
+
+#include <click/config.h>
+#include "toshmring.hh"
+#include <click/args.hh>
+#include <click/error.hh>
+CLICK_DECLS
+
+ToShmRing::ToShmRing()
+    : _channel(0), _blocking(false), _pool(0), _ring(0)
+{
+}
+
+ToShmRing::~ToShmRing()
+{
+}
+
+int
+ToShmRing::configure(Vector<String> &conf, ErrorHandler *errh)
+{
+#if CLICK_PACKET_USE_DPDK
+    return errh->error("not available with DPDK packets");
+#endif
+#if !HAVE_MULTITHREAD
+    return errh->error("requires a multithreaded build");
+#endif
+    Args args(conf, this, errh);
+    if (ShmPool::parse(args, _path, _geometry, _channel) < 0)
+	return -1;
+    if (args.read("BLOCKING", _blocking).complete() < 0)
+	return -1;
+    return 0;
+}
+
+int
+ToShmRing::initialize(ErrorHandler *errh)
+{
+    if (!(_pool = ShmPool::open(_path, _geometry, errh)))
+	return -1;
+    _ring = _pool->channel(_channel);
+    _count.initialize(this, "count");
+    _zero_copy.initialize(this, "zero_copy");
+    _dropped.initialize(this, "dropped");
+    return 0;
+}
+
+void
+ToShmRing::cleanup(CleanupStage)
+{
+    if (_pool)
+	_pool->close();
+    _pool = 0;
+}
+
+// Fill in @a d for @a p, referencing its buffer if it is a pool buffer and
+// copying it into a free one otherwise. Returns false if @a p must be
+// dropped.
+inline bool
+ToShmRing::describe(Packet *p, ShmPool::Descriptor &d)
+{
+    int b = _pool->buffer_of(p);
+    if (b >= 0) {
+	d.buffer = b;
+	d.offset = p->data() - p->buffer();
+	d.length = p->length();
+	return true;
+    }
+
+    uint32_t offset = Packet::default_headroom;
+    if (offset + p->length() > _pool->buffer_size())
+	return false;
+    while ((b = _pool->alloc()) < 0 && _blocking)
+	click_relax_fence();
+    if (b < 0)
+	return false;
+    memcpy(_pool->buffer(b) + offset, p->data(), p->length());
+    d.buffer = b;
+    d.offset = offset;
+    d.length = p->length();
+    return true;
+}
+
+void
+ToShmRing::send(Packet **p, unsigned n)
+{
+    ShmPool::Descriptor d[BURST];
+    Packet *q[BURST];
+    unsigned k = 0;
+    for (unsigned i = 0; i < n; ++i)
+	if (describe(p[i], d[k]))
+	    q[k++] = p[i];
+	else {
+	    p[i]->kill();
+	    _dropped.inc();
+	}
+
+    unsigned sent = _ring->insert(d, k, true);
+    while (_blocking && sent < k) {
+	click_relax_fence();
+	sent += _ring->insert(d + sent, k - sent, true);
+    }
+
+    // The ring now owns the buffers of sent packets.
+    unsigned zero_copy = 0;
+    for (unsigned i = 0; i < sent; ++i) {
+	if (_pool->buffer_of(q[i]) >= 0) {
+	    q[i]->set_buffer_destructor(Packet::empty_destructor);
+	    ++zero_copy;
+	}
+	q[i]->kill();
+    }
+    for (unsigned i = sent; i < k; ++i) {
+	if (_pool->buffer_of(q[i]) < 0)
+	    _pool->free(d[i].buffer);
+	q[i]->kill();
+    }
+    _count.add(sent);
+    _zero_copy.add(zero_copy);
+    _dropped.add(k - sent);
+}
+
+void
+ToShmRing::push(int, Packet *p)
+{
+    send(&p, 1);
+}
+
+#if HAVE_BATCH
+void
+ToShmRing::push_batch(int, PacketBatch *batch)
+{
+    Packet *p[BURST];
+    unsigned n = 0;
+    FOR_EACH_PACKET_SAFE(batch, q) {
+	p[n++] = q;
+	if (n == BURST) {
+	    send(p, n);
+	    n = 0;
+	}
+    }
+    if (n)
+	send(p, n);
+}
+#endif
+
+String
+ToShmRing::read_handler(Element *e, void *thunk)
+{
+    ToShmRing *t = static_cast<ToShmRing *>(e);
+    switch ((intptr_t) thunk) {
+    case 0:
+	return String(t->_count.value());
+    case 1:
+	return String(t->_zero_copy.value());
+    default:
+	return String(t->_dropped.value());
+    }
+}
+
+void
+ToShmRing::add_handlers()
+{
+    add_read_handler("count", read_handler, 0);
+    add_read_handler("zero_copy", read_handler, 1);
+    add_read_handler("dropped", read_handler, 2);
+}
+
+CLICK_ENDDECLS
+ELEMENT_REQUIRES(userlevel ShmPool)
+EXPORT_ELEMENT(ToShmRing)
+ELEMENT_MT_SAFE(ToShmRing)
@@ -0,0 +1,142 @@
+#ifndef CLICK_TOSHMRING_USERLEVEL_HH
+#define CLICK_TOSHMRING_USERLEVEL_HH
+#include <click/batchelement.hh>
+#include <click/statscounter.hh>
+#include "shmpool.hh"
+CLICK_DECLS
+
+/*
+=title ToShmRing
+
+=c
+
+ToShmRing(PATH [, I<keywords> CHANNEL, CHANNELS, BUFFERS, BUFFER_SIZE, RING_SIZE, BLOCKING])
+
+=s netdevices
+
+sends packets to another Click process through shared memory (user-level)
+
+=d
+
+Sends packets to the FromShmRing element, usually in another Click process on
+the same host, that reads channel CHANNEL of the shared memory file PATH. No
+DPDK is needed, but Click must be built with multithreading.
+
+PATH holds a pool of BUFFERS packet buffers of BUFFER_SIZE bytes each, a ring
+of free buffers, and CHANNELS rings of RING_SIZE packet descriptors. Every
+process chaining network functions through PATH maps the same pool, so packets
+move from one to the next by reference: a packet that a FromShmRing read from
+PATH, and that was not cloned or reallocated since, is sent without copying
+its data, and its buffer returns to the free ring when the last process to use
+it kills it. Other packets are copied once into a free buffer. Annotations are
+not carried.
+
+Any number of ToShmRing elements and threads, in any processes, may send to
+the same channel. A batch is placed on the ring with one atomic reservation.
+
+PATH is created by the first process to open it, and removed when the last
+process closes it. For huge pages, place it on a hugetlbfs mount.
+
+Keyword arguments are:
+
+=over 8
+
+=item CHANNEL
+
+Integer. The channel to send to. Default is 0.
+
+=item CHANNELS
+
+Integer. Number of channels of PATH. Default is 4.
+
+=item BUFFERS
+
+Integer. Number of packet buffers of PATH. Default is 8192.
+
+=item BUFFER_SIZE
+
+Integer. Size of each buffer, at most 32768. Default is 2048.
+
+=item RING_SIZE
+
+Integer. Number of descriptors of each channel ring, rounded up to a power of
+two. Default is 1024.
+
+=item BLOCKING
+
+Boolean. If true, wait for room in the channel ring and for free buffers
+instead of dropping packets. Default is false.
+
+=back
+
+CHANNELS, BUFFERS, BUFFER_SIZE and RING_SIZE must be the same in every
+element and process using PATH.
+
+=h count read-only
+
+Returns the number of packets sent.
+
+=h zero_copy read-only
+
+Returns the number of packets sent by reference.
+
+=h dropped read-only
+
+Returns the number of packets dropped because the ring was full, no buffer
+was free, or they were too long.
+
+=e
+
+  // process 1
+  FromDPDKDevice(0) -> ... -> ToShmRing(/dev/hugepages/chain, CHANNEL 0);
+  // process 2
+  FromShmRing(/dev/hugepages/chain, CHANNEL 0) -> ...
+      -> ToShmRing(/dev/hugepages/chain, CHANNEL 1);
+
+=a FromShmRing, ToDPDKRing */
+
+class ToShmRing : public BatchElement { public:
+
+    ToShmRing() CLICK_COLD;
+    ~ToShmRing() CLICK_COLD;
+
+    const char *class_name() const	{ return "ToShmRing"; }
+    const char *port_count() const	{ return PORTS_1_0; }
+    const char *processing() const	{ return PUSH; }
+    bool can_live_reconfigure() const	{ return false; }
+
+    int configure(Vector<String> &, ErrorHandler *) CLICK_COLD;
+    int initialize(ErrorHandler *) CLICK_COLD;
+    void cleanup(CleanupStage) CLICK_COLD;
+    void add_handlers() CLICK_COLD;
+
+    void push(int, Packet *);
+#if HAVE_BATCH
+    void push_batch(int, PacketBatch *);
+#endif
+
+  private:
+
+    enum { BURST = 32 };
+
+    String _path;
+    ShmPool::Geometry _geometry;
+    uint32_t _channel;
+    bool _blocking;
+
+    ShmPool *_pool;
+    ShmPool::ChannelRing *_ring;
+
+    StatsCounter _count;
+    StatsCounter _zero_copy;
+    StatsCounter _dropped;
+
+    inline bool describe(Packet *p, ShmPool::Descriptor &d);
+    void send(Packet **p, unsigned n);
+
+    static String read_handler(Element *, void *) CLICK_COLD;
+
+};
+
+CLICK_ENDDECLS
+#endif
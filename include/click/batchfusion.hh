@@ -0,0 +1,78 @@
+// -*- c-basic-offset: 4 -*-
+#ifndef CLICK_BATCHFUSION_HH
+#define CLICK_BATCHFUSION_HH
+#include <click/batchelement.hh>
+#include <click/packetbatch.hh>
+CLICK_DECLS
+
+#if HAVE_BATCH
+
+/** @class BatchFusion
+ * @brief Run a linear chain of batch elements as one per-packet loop.
+ *
+ * BatchFusion<E1, E2, ..., En> describes a chain of elements where the
+ * element of class E1 has output 0 connected to input 0 of an element of
+ * class E2, and so on.  Every class must have the <tt>F</tt> flag (see
+ * Element::flags()): its simple_action() handles a packet in batch mode
+ * exactly as its batch path would.
+ *
+ * Normally a batch crossing the chain costs a virtual push_batch() call and
+ * a batch rebuild per element.  BatchFusion<...>::push_batch(e, batch) walks
+ * the batch once, calls each class's simple_action() non-virtually on each
+ * packet, then pushes the surviving batch out of En's output 0.  Packets
+ * an element consumes (drops or sends to another output) simply leave the
+ * batch.
+ *
+ * Types are fixed at compile time, so the chain must match the router
+ * configuration.  click-devirtualize --fuse-batch generates such chains for
+ * a given configuration; hand-written elements may also use BatchFusion to
+ * drive a known sequence of elements.
+ */
+template <typename... Es> class BatchFusion;
+
+/** @cond never */
+template <> class BatchFusion<> { public:
+    static inline Packet *action(Element *, Packet *p) {
+        return p;
+    }
+    static inline const Element::Port &exit(Element *prev) {
+        return prev->output(0);
+    }
+};
+/** @endcond never */
+
+template <typename E, typename... Es> class BatchFusion<E, Es...> { public:
+
+    /** @brief Pass @a p through the chain starting at @a e.
+     * @return the packet leaving the chain, or null if an element
+     * consumed it */
+    static inline Packet *action(Element *e, Packet *p) {
+        if (!(p = static_cast<E *>(e)->E::simple_action(p)))
+            return 0;
+        return BatchFusion<Es...>::action(e->output(0).element(), p);
+    }
+
+    /** @brief Return the output port that leaves the chain following
+     * @a prev, whose output 0 leads to the chain. */
+    static inline const Element::Port &exit(Element *prev) {
+        return BatchFusion<Es...>::exit(prev->output(0).element());
+    }
+
+    /** @brief Process @a batch through the chain starting at @a e and push
+     * what remains out of the last element's output 0. */
+    static inline void push_batch(Element *e, PacketBatch *batch) {
+        auto fnt = [e](Packet *p) -> Packet * {
+            return action(e, p);
+        };
+        auto on_drop = [](Packet *) {};
+        EXECUTE_FOR_EACH_PACKET_DROPPABLE(fnt, batch, on_drop);
+        if (batch)
+            BatchFusion<Es...>::exit(e).push_batch(batch);
+    }
+
+};
+
+#endif
+
+CLICK_ENDDECLS
+#endif
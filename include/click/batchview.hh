@@ -0,0 +1,190 @@
+// -*- c-basic-offset: 4 -*-
+#ifndef CLICK_BATCHVIEW_HH
+#define CLICK_BATCHVIEW_HH
+#include <click/packetbatch.hh>
+#include <click/batchelement.hh>
+#include <clicknet/ip.h>
+CLICK_DECLS
+
+/** @file <click/batchview.hh>
+ * @brief Columnar view of the headers of a packet batch.
+ */
+
+/** @class BatchView
+ * @brief Structure-of-arrays view of up to CAPACITY packets of a batch.
+ *
+ * A BatchView gathers chosen header fields and annotations of a run of
+ * packets into plain arrays, one array per field, so that an element can
+ * compute over a whole run in tight loops the compiler can vectorize, then
+ * scatter the packets to outputs according to the result column out[].
+ *
+ * @code
+ * BatchView v;
+ * Packet *next = batch;
+ * PacketBatch *outs[2] = {0, 0};
+ * while (next) {
+ *     next = v.gather(next, BatchView::F_DST_ANNO);
+ *     for (unsigned i = 0; i < v.size(); ++i)
+ *         v.out[i] = v.dst_anno[i] == htonl(0x0A000001);
+ *     v.scatter(outs, 2);
+ * }
+ * BatchView::push(this, outs, 2);
+ * @endcode
+ *
+ * gather() reads the next pointers of the packets it takes before returning,
+ * so scatter() may relink them, and output batches keep growing across
+ * views until they are pushed. The view lives on the stack; nothing is
+ * allocated. */
+class BatchView { public:
+
+    enum { CAPACITY = 64 };
+
+    /** @brief Fields gathered by gather(). */
+    enum {
+	F_LENGTH = 1,		///< length[]: packet length
+	F_DST_ANNO = 2,		///< dst_anno[]: destination address annotation
+	F_IP_ADDRS = 4,		///< ip_src[] and ip_dst[], from the IP header
+	F_IP_PROTO = 8,		///< ip_proto[], from the IP header
+	F_PORTS = 16,		///< ports[]: first transport header word
+	F_IP_TUPLE = F_IP_ADDRS | F_IP_PROTO | F_PORTS,
+	F_PREFETCH = 32		///< only prefetch network headers
+    };
+
+    BatchView()
+	: _n(0) {
+    }
+
+    /** @brief Return the number of packets in the view. */
+    unsigned size() const {
+	return _n;
+    }
+
+    /** @brief Gather up to CAPACITY packets starting at @a p.
+     * @param p first packet, part of a linked list
+     * @param fields F_* flags of the columns to fill
+     * @return the first packet not gathered, or null
+     *
+     * Fills packet[] and the requested columns, and resets out[] to 0. The
+     * network headers are prefetched if IP columns or F_PREFETCH are asked. IP
+     * columns come from the IP header annotation; packets without one read
+     * as zeros. ports[] holds the source port in its high half and the
+     * destination port in its low half, in host order, for TCP, UDP, and
+     * SCTP first fragments, and is zero otherwise. */
+    inline Packet *gather(Packet *p, unsigned fields);
+
+    /** @brief Append the packets to @a outs by out[].
+     * @param outs output batches, initially null
+     * @param nouts number of elements of @a outs
+     *
+     * Packet i is appended to outs[out[i]], or killed if out[i] is out of
+     * range. Null packet[] entries, which the caller took over, are skipped.
+     * The batches in @a outs are finished by push() or finish(). */
+    inline void scatter(PacketBatch **outs, unsigned nouts);
+
+    /** @brief Terminate the batches in @a outs. */
+    static inline void finish(PacketBatch **outs, unsigned nouts);
+
+    /** @brief Finish the batches in @a outs and push them out of @a e,
+     * resetting @a outs. Batches for missing ports are killed. */
+    static inline void push(BatchElement *e, PacketBatch **outs, unsigned nouts);
+
+    Packet *packet[CAPACITY];
+    uint32_t length[CAPACITY] CLICK_ALIGNED(CLICK_CACHE_LINE_SIZE);
+    uint32_t dst_anno[CAPACITY] CLICK_ALIGNED(CLICK_CACHE_LINE_SIZE);
+    uint32_t ip_src[CAPACITY] CLICK_ALIGNED(CLICK_CACHE_LINE_SIZE);
+    uint32_t ip_dst[CAPACITY] CLICK_ALIGNED(CLICK_CACHE_LINE_SIZE);
+    uint32_t ports[CAPACITY] CLICK_ALIGNED(CLICK_CACHE_LINE_SIZE);
+    uint8_t ip_proto[CAPACITY] CLICK_ALIGNED(CLICK_CACHE_LINE_SIZE);
+    int out[CAPACITY] CLICK_ALIGNED(CLICK_CACHE_LINE_SIZE);
+
+  private:
+
+    unsigned _n;
+
+};
+
+inline Packet *
+BatchView::gather(Packet *p, unsigned fields)
+{
+    unsigned n = 0;
+    while (p && n < CAPACITY) {
+	packet[n] = p;
+	if (fields & (F_IP_TUPLE | F_PREFETCH))
+	    __builtin_prefetch(p->network_header());
+	p = p->next();
+	++n;
+    }
+    _n = n;
+
+    for (unsigned i = 0; i < n; ++i)
+	out[i] = 0;
+    if (fields & F_LENGTH)
+	for (unsigned i = 0; i < n; ++i)
+	    length[i] = packet[i]->length();
+    if (fields & F_DST_ANNO)
+	for (unsigned i = 0; i < n; ++i)
+	    dst_anno[i] = packet[i]->dst_ip_anno().addr();
+    if (fields & F_IP_TUPLE)
+	for (unsigned i = 0; i < n; ++i) {
+	    Packet *q = packet[i];
+	    const click_ip *iph = q->has_network_header() ? q->ip_header() : 0;
+	    if (fields & F_IP_ADDRS) {
+		ip_src[i] = iph ? iph->ip_src.s_addr : 0;
+		ip_dst[i] = iph ? iph->ip_dst.s_addr : 0;
+	    }
+	    if (fields & F_IP_PROTO)
+		ip_proto[i] = iph ? iph->ip_p : 0;
+	    if (fields & F_PORTS) {
+		ports[i] = 0;
+		if (iph && (iph->ip_p == IP_PROTO_TCP || iph->ip_p == IP_PROTO_UDP
+			    || iph->ip_p == IP_PROTO_SCTP)
+		    && IP_FIRSTFRAG(iph) && q->transport_length() >= 4) {
+		    const uint16_t *th = reinterpret_cast<const uint16_t *>(q->transport_header());
+		    ports[i] = (ntohs(th[0]) << 16) | ntohs(th[1]);
+		}
+	    }
+	}
+    return p;
+}
+
+inline void
+BatchView::scatter(PacketBatch **outs, unsigned nouts)
+{
+    for (unsigned i = 0; i < _n; ++i) {
+	Packet *p = packet[i];
+	if (!p)
+	    continue;
+	unsigned o = out[i];
+	if (o >= nouts)
+	    p->kill();
+	else if (outs[o])
+	    outs[o]->append_packet(p);
+	else {
+	    outs[o] = PacketBatch::start_head(p);
+	    outs[o]->set_count(1);
+	    outs[o]->set_tail(p);
+	}
+    }
+}
+
+inline void
+BatchView::finish(PacketBatch **outs, unsigned nouts)
+{
+    for (unsigned o = 0; o < nouts; ++o)
+	if (outs[o])
+	    outs[o]->tail()->set_next(0);
+}
+
+inline void
+BatchView::push(BatchElement *e, PacketBatch **outs, unsigned nouts)
+{
+    finish(outs, nouts);
+    for (unsigned o = 0; o < nouts; ++o)
+	if (outs[o]) {
+	    e->checked_output_push_batch(o, outs[o]);
+	    outs[o] = 0;
+	}
+}
+
+CLICK_ENDDECLS
+#endif
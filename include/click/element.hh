@@ -8,6 +8,10 @@
 #include <click/packetbatch.hh>
 #include <click/handler.hh>
 #include <click/multithread.hh>
+#if CLICK_STATS >= 2
+# include <click/integers.hh>
+# include <click/perfevents.hh>
+#endif
 CLICK_DECLS
 class Router;
 class Master;
@@ -23,6 +27,7 @@ class EtherAddress;
 class BatchElement;
 
 #define BATCH_MAX_PULL 256
+#define BATCH_PREFETCH_DEFAULT 4
 
 /** @file <click/element.hh>
  * @brief Click's Element class.
@@ -56,6 +61,9 @@ class Element { public:
 #endif
 
     inline bool is_fullpush() const;
+#if HAVE_BATCH
+    inline unsigned batch_prefetch_distance() const;
+#endif
     enum batch_mode {BATCH_MODE_NO, BATCH_MODE_IFPOSSIBLE, BATCH_MODE_NEEDED, BATCH_MODE_YES};
 
     inline void checked_output_push(int port, Packet *p) const;
@@ -238,6 +246,34 @@ class Element { public:
     virtual int llrpc(unsigned command, void* arg);
     int local_llrpc(unsigned command, void* arg);
 
+#if CLICK_STATS >= 2
+    // STATISTICS
+    struct stats_type {
+        uint64_t xfer_calls;            // Push and pull calls into this element.
+        uint64_t xfer_batches;          // Batches moved by those calls.
+        uint64_t xfer_packets;          // Packets moved by those calls.
+        click_cycles_t xfer_own_cycles; // Cycles spent in self from push and pull.
+        click_cycles_t child_cycles;    // Cycles spent in children.
+
+        uint64_t task_calls;            // Calls to tasks owned by this element.
+        click_cycles_t task_own_cycles; // Cycles spent in self from tasks.
+
+        uint64_t timer_calls;           // Calls to timers owned by this element.
+        click_cycles_t timer_own_cycles; // Cycles spent in self from timers.
+
+# if HAVE_PERF_EVENTS
+        uint64_t xfer_own_events[PerfEvents::max_events]; // PerfEvents in self.
+        uint64_t child_events[PerfEvents::max_events];    // PerfEvents in children.
+# endif
+    };
+    void sum_stats(stats_type &s) const;
+    static inline uint64_t stats_divide(uint64_t a, uint64_t b) {
+        while (b > 0xFFFFFFFFU)
+            a >>= 1, b >>= 1;
+        return int_divide(a, (uint32_t) (b ? b : 1));
+    }
+#endif
+
     class Port { public:
 
         inline bool active() const;
@@ -322,26 +358,37 @@ class Element { public:
 #if HAVE_FULLPUSH_NONATOMIC
     bool _is_fullpush;
 #endif
+#if HAVE_BATCH
+    unsigned _batch_prefetch;
+#endif
 
 #if CLICK_STATS >= 2
-    // STATISTICS
-    unsigned _xfer_calls;       // Push and pull calls into this element.
-    click_cycles_t _xfer_own_cycles;    // Cycles spent in self from push and pull.
-    click_cycles_t _child_cycles;       // Cycles spent in children.
+    // STATISTICS, kept per thread
+    per_thread<stats_type> _stats;
 
-    unsigned _task_calls;       // Calls to tasks owned by this element.
-    click_cycles_t _task_own_cycles;    // Cycles spent in self from tasks.
-
-    unsigned _timer_calls;      // Calls to timers owned by this element.
-    click_cycles_t _timer_own_cycles;   // Cycles spent in self from timers.
+    // Measures one push or pull call into an element.
+    class xfer_probe { public:
+        inline xfer_probe(Element *e);
+        inline void finish(Element *caller, unsigned batches, unsigned packets);
+      private:
+        stats_type &_s;
+        click_cycles_t _start_cycles;
+        click_cycles_t _start_child_cycles;
+# if HAVE_PERF_EVENTS
+        int _nevents;
+        uint64_t _start_events[PerfEvents::max_events];
+        uint64_t _start_child_events[PerfEvents::max_events];
+# endif
+    };
 
-    inline void reset_cycles() {
-        _xfer_calls = _task_calls = _timer_calls = 0;
-        _xfer_own_cycles = _task_own_cycles = _timer_own_cycles = _child_cycles = 0;
-    }
+    void reset_cycles();
     static String read_cycles_handler(Element *, void *);
     static int write_cycles_handler(const String &, Element *, void *, ErrorHandler *);
 #endif
+#if HAVE_BATCH
+    static String read_batch_prefetch_handler(Element *, void *);
+    static int write_batch_prefetch_handler(const String &, Element *, void *, ErrorHandler *);
+#endif
 
     Element(const Element &);
     Element &operator=(const Element &);
@@ -651,6 +698,48 @@ Element::Port::port() const
     return _port;
 }
 
+#if CLICK_STATS >= 2
+inline
+Element::xfer_probe::xfer_probe(Element *e)
+    : _s(*e->_stats)
+{
+# if HAVE_PERF_EVENTS
+    _nevents = 0;
+    if (unlikely(PerfEvents::enabled())) {
+        for (int i = 0; i < PerfEvents::max_events; ++i)
+            _start_child_events[i] = _s.child_events[i];
+        _nevents = PerfEvents::read(_start_events);
+    }
+# endif
+    _start_child_cycles = _s.child_cycles;
+    _start_cycles = click_get_cycles();
+}
+
+inline void
+Element::xfer_probe::finish(Element *caller, unsigned batches, unsigned packets)
+{
+    click_cycles_t all_delta = click_get_cycles() - _start_cycles,
+        own_delta = all_delta - (_s.child_cycles - _start_child_cycles);
+    stats_type &cs = *caller->_stats;
+    _s.xfer_calls += 1;
+    _s.xfer_batches += batches;
+    _s.xfer_packets += packets;
+    _s.xfer_own_cycles += own_delta;
+    cs.child_cycles += all_delta;
+# if HAVE_PERF_EVENTS
+    // the event set may have changed since the start of the transfer
+    uint64_t end_events[PerfEvents::max_events];
+    if (unlikely(_nevents) && PerfEvents::read(end_events) == _nevents) {
+        for (int i = 0; i < _nevents; ++i) {
+            uint64_t all = end_events[i] - _start_events[i];
+            _s.xfer_own_events[i] += all - (_s.child_events[i] - _start_child_events[i]);
+            cs.child_events[i] += all;
+        }
+    }
+# endif
+}
+#endif
+
 /** @brief Push packet @a p over this port.
  *
  * Pushes packet @a p downstream through the router configuration by passing
@@ -697,26 +786,21 @@ Element::Port::push(Packet* p) const
 #endif
 #if CLICK_STATS >= 2
     ++_e->input(_port)._packets;
-    click_cycles_t start_cycles = click_get_cycles(),
-        start_child_cycles = _e->_child_cycles;
+    xfer_probe probe(_e);
 # if HAVE_BOUND_PORT_TRANSFER
     _bound.push(_e, _port, p);
 # else
     _e->push(_port, p);
 # endif
-    click_cycles_t all_delta = click_get_cycles() - start_cycles,
-        own_delta = all_delta - (_e->_child_cycles - start_child_cycles);
-    _e->_xfer_calls += 1;
-    _e->_xfer_own_cycles += own_delta;
-    _owner->_child_cycles += all_delta;
+    probe.finish(_owner, 0, 1);
 #else
 # if HAVE_BOUND_PORT_TRANSFER
     _bound.push(_e, _port, p);
 # else
     _e->push(_port, p);
 # endif
-    }
 #endif
+    }
 }
 
 /** @brief Pull a packet over this port and return it.
@@ -740,8 +824,7 @@ Element::Port::pull() const
 {
     assert(_e);
 #if CLICK_STATS >= 2
-    click_cycles_t start_cycles = click_get_cycles(),
-        old_child_cycles = _e->_child_cycles;
+    xfer_probe probe(_e);
 # if HAVE_BOUND_PORT_TRANSFER
     Packet *p = _bound.pull(_e, _port);
 # else
@@ -749,11 +832,7 @@ Element::Port::pull() const
 # endif
     if (p)
         _e->output(_port)._packets += 1;
-    click_cycles_t all_delta = click_get_cycles() - start_cycles,
-        own_delta = all_delta - (_e->_child_cycles - old_child_cycles);
-    _e->_xfer_calls += 1;
-    _e->_xfer_own_cycles += own_delta;
-    _owner->_child_cycles += all_delta;
+    probe.finish(_owner, 0, p ? 1 : 0);
 #else
 # if HAVE_BOUND_PORT_TRANSFER
     Packet *p = _bound.pull(_e, _port);
@@ -777,11 +856,22 @@ Element::Port::push_batch(PacketBatch* batch) const {
 #if BATCH_DEBUG
     click_chatter("Pushing batch of %d packets to %p{element}",batch->count(),_e);
 #endif
+#if CLICK_STATS >= 1
+    unsigned count = batch->count();
+    _packets += count;
+#endif
+#if CLICK_STATS >= 2
+    _e->input(_port)._packets += count;
+    xfer_probe probe(_e);
+#endif
 #if HAVE_BOUND_PORT_TRANSFER
     _bound_batch.push_batch(_e,_port,batch);
 #else
     _e->push_batch(_port,batch);
 #endif
+#if CLICK_STATS >= 2
+    probe.finish(_owner, 1, count);
+#endif
 }
 
 #ifdef HAVE_AUTO_BATCH
@@ -866,10 +956,21 @@ Element::Port::end_batch() {
 PacketBatch*
 Element::Port::pull_batch(unsigned max) const {
     PacketBatch* batch = NULL;
+#if CLICK_STATS >= 2
+    xfer_probe probe(_e);
+#endif
 #if HAVE_BOUND_PORT_TRANSFER
     batch = _bound_batch.pull_batch(_e,_port, max);
 #else
     batch = _e->pull_batch(_port, max);
+#endif
+#if CLICK_STATS >= 1
+    unsigned count = batch ? batch->count() : 0;
+    _packets += count;
+#endif
+#if CLICK_STATS >= 2
+    _e->output(_port)._packets += count;
+    probe.finish(_owner, batch ? 1 : 0, count);
 #endif
     return batch;
 }
@@ -898,6 +999,17 @@ inline bool Element::is_fullpush() const {
 #endif
 }
 
+#if HAVE_BATCH
+/** @brief Return how many packets ahead this element's batch loops prefetch.
+ *
+ * Pass it to the _PREFETCH iteration macros of <click/packetbatch.hh>. It
+ * defaults to BATCH_PREFETCH_DEFAULT and is set per element with the
+ * batch_prefetch handler; 0 disables prefetching. */
+inline unsigned Element::batch_prefetch_distance() const {
+    return _batch_prefetch;
+}
+#endif
+
 
 /** @brief Push packet @a p to output @a port, or kill it if @a port is out of
  * range.
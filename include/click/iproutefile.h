@@ -0,0 +1,32 @@
+/* -*- mode: c; c-basic-offset: 4 -*- */
+#ifndef CLICK_IPROUTEFILE_H
+#define CLICK_IPROUTEFILE_H
+
+/*
+ * <click/iproutefile.h> -- binary IPv4 route table files
+ *
+ * A route file is a header followed by `count' fixed-size entries.  All
+ * fields are in network byte order.  Files are written by click-mkroutes and
+ * loaded by the IPRouteTable elements' FILE keyword and `load' handler.
+ */
+
+#define CLICK_IPROUTE_FILE_MAGIC	0x436C5254U	/* "ClRT" */
+#define CLICK_IPROUTE_FILE_VERSION	1
+
+struct click_iproute_file_header {
+    uint32_t	magic;		/* CLICK_IPROUTE_FILE_MAGIC */
+    uint16_t	version;	/* CLICK_IPROUTE_FILE_VERSION */
+    uint16_t	entry_size;	/* sizeof(struct click_iproute_file_entry) */
+    uint32_t	count;		/* number of entries */
+    uint32_t	reserved;	/* 0 */
+};
+
+struct click_iproute_file_entry {
+    uint32_t	addr;		/* destination, host bits zero */
+    uint32_t	gw;		/* gateway, or 0 for none */
+    uint16_t	port;		/* output port */
+    uint8_t	prefix_len;	/* 0-32 */
+    uint8_t	flags;		/* 0 */
+};
+
+#endif
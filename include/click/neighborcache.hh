@@ -0,0 +1,221 @@
+// -*- c-basic-offset: 4 -*-
+#ifndef CLICK_NEIGHBORCACHE_HH
+#define CLICK_NEIGHBORCACHE_HH
+#include <click/glue.hh>
+#include <click/machine.hh>
+#include <click/etheraddress.hh>
+#include <click/hashcode.hh>
+CLICK_DECLS
+
+/** @file <click/neighborcache.hh>
+ *  @brief  A lock-free cache of neighbor Ethernet addresses.
+ */
+
+/** @class NeighborCache include/click/neighborcache.hh <click/neighborcache.hh>
+ *  @brief  A lock-free cache mapping network addresses to Ethernet addresses.
+ *
+ *  NeighborCache mirrors part of a neighbor table, such as ARPTable's or
+ *  IP6NDSolicitor's, so that lookups need not take the table's lock.  It is
+ *  an array of cache-line-sized sets of W entries, each guarded by a sequence
+ *  counter (a seqlock).  Writers change a set with its counter odd; lookups
+ *  read a set and retry if its counter changed meanwhile, so they never write
+ *  shared memory.
+ *
+ *  The writers, set(), erase() and clear(), must exclude each other, usually
+ *  by holding the table's write lock.  lookup() may run concurrently with
+ *  them.  Each entry carries a 32-bit stamp, typically the jiffies of the
+ *  neighbor's last reply; set() evicts the entry with the oldest stamp when
+ *  a set is full.
+ *
+ *  K is the key type, such as IPAddress or IP6Address.  It must have a
+ *  hashcode() method and an equality operator. */
+template <typename K, int W>
+class NeighborCache { public:
+
+    NeighborCache()
+	: _lines(0), _mem(0), _mask(0) {
+    }
+    ~NeighborCache() {
+	delete[] _mem;
+    }
+
+    /** @brief Allocate room for at least @a capacity entries.
+     *  @return 0 on success, -ENOMEM if out of memory.
+     *
+     *  The capacity is rounded up to a power of two times W.  A zero
+     *  capacity leaves the cache disabled. */
+    int initialize(uint32_t capacity);
+
+    /** @brief Return true iff the cache was allocated. */
+    bool enabled() const {
+	return _lines;
+    }
+
+    /** @brief Prefetch the set holding @a key. */
+    inline void prefetch(const K &key) const {
+	__builtin_prefetch(line(key));
+    }
+
+    /** @brief Look up @a key.
+     *  @param[out] eth the cached Ethernet address
+     *  @param[out] stamp the cached stamp
+     *  @return true iff @a key is cached
+     *
+     *  Returns false if the cache is not enabled. */
+    inline bool lookup(const K &key, EtherAddress *eth, uint32_t *stamp) const;
+
+    /** @brief Cache @a eth and @a stamp for @a key. */
+    void set(const K &key, const EtherAddress &eth, uint32_t stamp);
+
+    /** @brief Remove @a key from the cache, if present. */
+    void erase(const K &key);
+
+    /** @brief Remove every entry. */
+    void clear();
+
+  private:
+
+    struct Slot {
+	K key;
+	uint8_t eth[6];
+	uint8_t used;
+	uint32_t stamp;
+    };
+
+    // One cache line. seq is odd while a writer changes the slots.
+    struct Line {
+	uint32_t seq;
+	Slot slot[W];
+    };
+
+    Line *_lines;		// cache-aligned inside _mem
+    char *_mem;
+    uint32_t _mask;
+
+    inline Line *line(const K &key) const {
+	uint32_t h = key.hashcode() * 0x9E3779B1U;
+	return &_lines[(h ^ (h >> 16)) & _mask];
+    }
+
+    NeighborCache(const NeighborCache<K, W> &);
+    NeighborCache<K, W> &operator=(const NeighborCache<K, W> &);
+
+};
+
+template <typename K, int W>
+int
+NeighborCache<K, W>::initialize(uint32_t capacity)
+{
+    static_assert(sizeof(Line) <= CLICK_CACHE_LINE_SIZE,
+		  "NeighborCache sets must fit in a cache line");
+    if (capacity == 0 || _lines)
+	return 0;
+    uint32_t nlines = 1;
+    while (nlines * W < capacity && nlines < (1U << 24))
+	nlines *= 2;
+    if (!(_mem = new char[nlines * sizeof(Line) + CLICK_CACHE_LINE_SIZE]))
+	return -ENOMEM;
+    uintptr_t x = (uintptr_t) _mem;
+    x = (x + CLICK_CACHE_LINE_SIZE - 1) & ~(uintptr_t) (CLICK_CACHE_LINE_SIZE - 1);
+    _lines = (Line *) x;
+    for (uint32_t i = 0; i < nlines; ++i)
+	new((void *) &_lines[i]) Line();
+    _mask = nlines - 1;
+    return 0;
+}
+
+template <typename K, int W>
+inline bool
+NeighborCache<K, W>::lookup(const K &key, EtherAddress *eth, uint32_t *stamp) const
+{
+    if (!_lines)
+	return false;
+    const Line *l = line(key);
+    const volatile uint32_t *seqp = &l->seq;
+    while (1) {
+	uint32_t seq = *seqp;
+	click_read_fence();
+	if (seq & 1) {
+	    click_relax_fence();
+	    continue;
+	}
+	int w;
+	for (w = 0; w < W; ++w)
+	    if (l->slot[w].used && l->slot[w].key == key)
+		break;
+	if (w == W)
+	    return false;
+	memcpy(eth->data(), l->slot[w].eth, 6);
+	*stamp = l->slot[w].stamp;
+	click_read_fence();
+	if (*seqp == seq)
+	    return true;
+    }
+}
+
+template <typename K, int W>
+void
+NeighborCache<K, W>::set(const K &key, const EtherAddress &eth, uint32_t stamp)
+{
+    if (!_lines)
+	return;
+    Line *l = line(key);
+    int w, oldest = 0;
+    for (w = 0; w < W; ++w)
+	if (l->slot[w].used && l->slot[w].key == key)
+	    break;
+    if (w == W)
+	for (w = 0; w < W; ++w) {
+	    if (!l->slot[w].used)
+		break;
+	    if ((int32_t) (l->slot[w].stamp - l->slot[oldest].stamp) < 0)
+		oldest = w;
+	}
+    if (w == W)
+	w = oldest;
+
+    Slot &s = l->slot[w];
+    ++l->seq;
+    click_write_fence();
+    s.key = key;
+    memcpy(s.eth, eth.data(), 6);
+    s.used = 1;
+    s.stamp = stamp;
+    click_write_fence();
+    ++l->seq;
+}
+
+template <typename K, int W>
+void
+NeighborCache<K, W>::erase(const K &key)
+{
+    if (!_lines)
+	return;
+    Line *l = line(key);
+    for (int w = 0; w < W; ++w)
+	if (l->slot[w].used && l->slot[w].key == key) {
+	    ++l->seq;
+	    click_write_fence();
+	    l->slot[w].used = 0;
+	    click_write_fence();
+	    ++l->seq;
+	}
+}
+
+template <typename K, int W>
+void
+NeighborCache<K, W>::clear()
+{
+    for (uint32_t i = 0; _lines && i <= _mask; ++i) {
+	Line *l = &_lines[i];
+	++l->seq;
+	click_write_fence();
+	for (int w = 0; w < W; ++w)
+	    l->slot[w].used = 0;
+	click_write_fence();
+	++l->seq;
+    }
+}
+
+CLICK_ENDDECLS
+#endif
@@ -114,6 +114,11 @@ public:
 		return numa_num_configured_nodes();
 	}
 
+	static int get_cpu_node(int cpu) {
+		int node = numa_node_of_cpu(cpu);
+		return node < 0 ? 0 : node;
+	}
+
 	static int get_device_node(const char* device) {
 
 		char path[100];
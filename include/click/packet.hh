@@ -153,6 +153,11 @@ class Packet { public:
 	_destructor = 0;
     }
 #endif
+#if !CLICK_PACKET_USE_DPDK
+    inline void prefetch_anno() {
+	__builtin_prefetch(xanno());
+    }
+#endif
 
 
     /** @brief Add space for a header before the packet.
@@ -868,15 +873,33 @@ private:
 };
 
 #if HAVE_CLICK_PACKET_POOL
+# define CLICK_PACKET_POOL_MAX_NODES 8
     struct PacketPool {
         WritablePacket* p;          // free packets, linked by p->next()
         unsigned pcount;            // # packets in `p` list
         WritablePacket* pd;             // free data buffers, linked by pd->next
         unsigned pdcount;           // # buffers in `pd` list
+        uint64_t nalloc;            // # packets and buffers allocated on misses
+        uint64_t nmiss;             // # allocations that found all pools empty
     #  if HAVE_MULTITHREAD
         PacketPool* thread_pool_next; // link to next per-thread pool
+        int node;                   // NUMA node of the owning thread
+        uint64_t ncross;            // # buffers freed here from another node
+        WritablePacket* remote[CLICK_PACKET_POOL_MAX_NODES]; // buffers to send
+        unsigned nremote[CLICK_PACKET_POOL_MAX_NODES];       //   back home
     #  endif
     };
+
+    /** @brief Packet pool statistics for one NUMA node.
+     * @sa WritablePacket::pool_node_stats() */
+    struct PacketPoolStats {
+        uint64_t packets;           // free packets without data
+        uint64_t buffers;           // free packets with data buffers
+        uint64_t misses;            // allocations that found the pools empty
+        uint64_t cross_node;        // buffers freed on this node from another
+        uint64_t arena_bytes;       // memory mapped for the node's buffers
+        uint64_t hugepage_bytes;    //   of which backed by hugepages
+    };
 #endif
 
 class WritablePacket : public Packet { public:
@@ -899,6 +922,17 @@ class WritablePacket : public Packet { public:
 
 # if HAVE_CLICK_PACKET_POOL
     static PacketPool* make_local_packet_pool();
+    static uint64_t pool_allocations();
+
+    static int pool_nodes();
+    static void pool_node_stats(int node, PacketPoolStats &stats);
+    static unsigned pool_size();
+    static unsigned pool_global_batches();
+    static unsigned pool_adaptations();
+    static bool pool_adaptive();
+    static void pool_set_size(unsigned size, unsigned global_batches, bool adaptive);
+    static int pool_set_arena(bool hugepages, uint32_t slab_size);
+    static unsigned pool_reserve(int node, unsigned count);
 # endif
 
     static void pool_transfer(int from, int to);
@@ -954,6 +988,9 @@ class WritablePacket : public Packet { public:
     static bool is_from_data_pool(WritablePacket *p);
     static void recycle(WritablePacket *p);
     static WritablePacket *pool_batch_allocate(uint16_t count);
+    static WritablePacket *pool_carve(int node, bool data, unsigned &count);
+    static void pool_refill(PacketPool &packet_pool, bool data);
+    static void recycle_remote(PacketPool &packet_pool, WritablePacket *p, int node);
     static void recycle_packet_batch(WritablePacket *head, Packet* tail, unsigned count);
     static void recycle_data_batch(WritablePacket *head, Packet* tail, unsigned count);
 #endif
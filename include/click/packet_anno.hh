@@ -136,6 +136,17 @@
 # define SET_IPSEC_SA_DATA_REFERENCE_ANNO(p, v) ((p)->set_anno_u32(IPSEC_SA_DATA_REFERENCE_ANNO_OFFSET, (v)))
 #endif
 
+// bytes 40-45
+#define TCP_STREAM_OFFSET_ANNO_OFFSET	40
+#define TCP_STREAM_OFFSET_ANNO_SIZE	4
+#define TCP_STREAM_OFFSET_ANNO(p)	((p)->anno_u32(TCP_STREAM_OFFSET_ANNO_OFFSET))
+#define SET_TCP_STREAM_OFFSET_ANNO(p, v) ((p)->set_anno_u32(TCP_STREAM_OFFSET_ANNO_OFFSET, (v)))
+
+#define TCP_STREAM_SKIP_ANNO_OFFSET	44
+#define TCP_STREAM_SKIP_ANNO_SIZE	2
+#define TCP_STREAM_SKIP_ANNO(p)		((p)->anno_u16(TCP_STREAM_SKIP_ANNO_OFFSET))
+#define SET_TCP_STREAM_SKIP_ANNO(p, v)	((p)->set_anno_u16(TCP_STREAM_SKIP_ANNO_OFFSET, (v)))
+
 #if HAVE_INT64_TYPES
 // bytes 40-47
 # define PERFCTR_ANNO_OFFSET		40
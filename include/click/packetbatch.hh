@@ -7,12 +7,57 @@
 #include <click/packet.hh>
 CLICK_DECLS
 
+/**
+ * Software prefetch pipeline for a walk over a batch. It runs k packets ahead
+ *  of the walk, prefetching the annotations and the first data cache line of
+ *  each packet, so that they are cached by the time the walk reaches it.
+ *  Call advance() once per packet walked. A distance of 0 disables it.
+ *
+ * The _PREFETCH iteration macros below take the distance as last argument,
+ *  usually Element::batch_prefetch_distance(). Packets after the current one
+ *  must not be unlinked while iterating.
+ */
+class BatchPrefetcher { public:
+    inline BatchPrefetcher(Packet* head, unsigned k) : _ahead(0) {
+        if (k && head) {
+            _ahead = head->next();
+            for (unsigned i = 0; i < k && _ahead; i++) {
+                prefetch(_ahead);
+                _ahead = _ahead->next();
+            }
+        }
+    }
+
+    inline void advance() {
+        if (_ahead) {
+            prefetch(_ahead);
+            _ahead = _ahead->next();
+        }
+    }
+
+    static inline void prefetch(Packet* p) {
+        p->prefetch_anno();
+        __builtin_prefetch(p->data());
+    }
+
+  private:
+    Packet* _ahead;
+};
+
 /**
  * Iterate over all packets of a batch. The batch cannot be modified during
  *   iteration. Use _SAFE version if you want to modify it on the fly.
  */
 #define FOR_EACH_PACKET(batch,p) for(Packet* p = batch;p != NULL;p=p->next())
 
+/**
+ * FOR_EACH_PACKET, prefetching k packets ahead. Expands to a single
+ *  statement; the outer loop only scopes the prefetcher and runs once.
+ */
+#define FOR_EACH_PACKET_PREFETCH(batch,p,k) \
+                for(BatchPrefetcher fepp_prefetch((batch),(k)), *fepp_once = &fepp_prefetch;fepp_once;fepp_once = 0) \
+                for(Packet* p = batch;p != NULL;p=p->next(),fepp_prefetch.advance())
+
 /**
  * Iterate over all packets of a batch. The current packet can be modified
  *  during iteration as the "next" pointer is read before going in the core of
@@ -23,16 +68,32 @@ CLICK_DECLS
                 Packet* p = batch;\
                 for (;p != NULL;p=fep_next,fep_next=(p==0?0:p->next()))
 
+/**
+ * FOR_EACH_PACKET_SAFE, prefetching k packets ahead. Unlike
+ *  FOR_EACH_PACKET_SAFE, expands to a single statement, like
+ *  FOR_EACH_PACKET_PREFETCH.
+ */
+#define FOR_EACH_PACKET_SAFE_PREFETCH(batch,p,k) \
+                for(BatchPrefetcher fepp_prefetch((batch),(k)), *fepp_once = &fepp_prefetch;fepp_once;fepp_once = 0) \
+                for(Packet* p = batch, *fep_next = ((batch != NULL)? batch->next() : NULL );p != NULL;p=fep_next,fep_next=(p==0?0:p->next()),fepp_prefetch.advance())
+
 /**
  * Execute a function on each packets of a batch. The function may return
  * another packet to replace the current one. This version cannot drop !
  * Use _DROPPABLE version if the function could return null.
  */
 #define EXECUTE_FOR_EACH_PACKET(fnt,batch) \
+                EXECUTE_FOR_EACH_PACKET_PREFETCH(fnt,batch,0)
+
+/**
+ * EXECUTE_FOR_EACH_PACKET, prefetching k packets ahead.
+ */
+#define EXECUTE_FOR_EACH_PACKET_PREFETCH(fnt,batch,k) \
+                BatchPrefetcher efep_prefetch((batch),(k));\
                 Packet* efep_next = ((batch != NULL)? batch->next() : NULL );\
                 Packet* p = batch;\
                 Packet* last = NULL;\
-                for (;p != NULL;p=efep_next,efep_next=(p==0?0:p->next())) {\
+                for (;p != NULL;p=efep_next,efep_next=(p==0?0:p->next()),efep_prefetch.advance()) {\
             Packet* q = fnt(p);\
                     if (q != p) {\
                         if (last) {\
@@ -50,12 +111,19 @@ CLICK_DECLS
  * another packet and which case the packet of the batch will be replaced by
  * that one, or null if the packet is to be dropped.
  */
-#define EXECUTE_FOR_EACH_PACKET_DROPPABLE(fnt,batch,on_drop) {\
+#define EXECUTE_FOR_EACH_PACKET_DROPPABLE(fnt,batch,on_drop) \
+                EXECUTE_FOR_EACH_PACKET_DROPPABLE_PREFETCH(fnt,batch,on_drop,0)
+
+/**
+ * EXECUTE_FOR_EACH_PACKET_DROPPABLE, prefetching k packets ahead.
+ */
+#define EXECUTE_FOR_EACH_PACKET_DROPPABLE_PREFETCH(fnt,batch,on_drop,k) {\
+                BatchPrefetcher efepd_prefetch((batch),(k));\
                 Packet* efepd_next = ((batch != NULL)? batch->next() : NULL );\
                 Packet* p = batch;\
                 Packet* last = NULL;\
                 int count = batch->count();\
-                for (;p != NULL;p=efepd_next,efepd_next=(p==0?0:p->next())) {\
+                for (;p != NULL;p=efepd_next,efepd_next=(p==0?0:p->next()),efepd_prefetch.advance()) {\
             Packet* q = fnt(p);\
             if (q == 0) {\
                 on_drop(p);\
@@ -87,6 +155,12 @@ CLICK_DECLS
  * instead of calling a function
  */
 #define EXECUTE_FOR_EACH_PACKET_DROP_LIST(fnt,batch,drop_list) \
+        EXECUTE_FOR_EACH_PACKET_DROP_LIST_PREFETCH(fnt,batch,drop_list,0)
+
+/**
+ * EXECUTE_FOR_EACH_PACKET_DROP_LIST, prefetching k packets ahead.
+ */
+#define EXECUTE_FOR_EACH_PACKET_DROP_LIST_PREFETCH(fnt,batch,drop_list,k) \
         PacketBatch* drop_list = 0;\
         auto on_drop = [&drop_list](Packet* p) {\
             if (drop_list == 0) {\
@@ -95,7 +169,7 @@ CLICK_DECLS
                 drop_list->append_packet(p);\
             }\
         };\
-        EXECUTE_FOR_EACH_PACKET_DROPPABLE(fnt,batch,on_drop);
+        EXECUTE_FOR_EACH_PACKET_DROPPABLE_PREFETCH(fnt,batch,on_drop,k);
 
 
 /**
@@ -108,12 +182,19 @@ CLICK_DECLS
  * as null after flushing.
  * On_flush is always called on the batch after the last packet.
  */
-#define EXECUTE_FOR_EACH_PACKET_SPLITTABLE(fnt,batch,on_drop,on_flush) {\
+#define EXECUTE_FOR_EACH_PACKET_SPLITTABLE(fnt,batch,on_drop,on_flush) \
+            EXECUTE_FOR_EACH_PACKET_SPLITTABLE_PREFETCH(fnt,batch,on_drop,on_flush,0)
+
+/**
+ * EXECUTE_FOR_EACH_PACKET_SPLITTABLE, prefetching k packets ahead.
+ */
+#define EXECUTE_FOR_EACH_PACKET_SPLITTABLE_PREFETCH(fnt,batch,on_drop,on_flush,k) {\
+            BatchPrefetcher efeps_prefetch((batch),(k));\
             Packet* next = ((batch != NULL)? batch->next() : NULL );\
             Packet* p = batch;\
             Packet* last = NULL;\
             int count = 0;\
-            for (;p != NULL;p=next,next=(p==0?0:p->next())) {\
+            for (;p != NULL;p=next,next=(p==0?0:p->next()),efeps_prefetch.advance()) {\
                 Packet* q = (fnt(p));\
                 if (q == 0) {\
                     if (last) {\
@@ -163,15 +244,22 @@ CLICK_DECLS
  *  checked_output_push_batch.
  */
 #define CLASSIFY_EACH_PACKET(nbatches,fnt,cep_batch,on_finish)\
+    CLASSIFY_EACH_PACKET_PREFETCH(nbatches,fnt,cep_batch,on_finish,0)
+
+/**
+ * CLASSIFY_EACH_PACKET, prefetching k packets ahead.
+ */
+#define CLASSIFY_EACH_PACKET_PREFETCH(nbatches,fnt,cep_batch,on_finish,k)\
     {\
         PacketBatch* out[(nbatches)];\
         bzero(out,sizeof(PacketBatch*)*(nbatches));\
+        BatchPrefetcher cep_prefetch((cep_batch),(k));\
         PacketBatch* cep_next = ((cep_batch != NULL)? static_cast<PacketBatch*>(cep_batch->next()) : NULL );\
         PacketBatch* p = cep_batch;\
         PacketBatch* last = NULL;\
         int last_o = -1;\
         int passed = 0;\
-        for (;p != NULL;p=cep_next,cep_next=(p==0?0:static_cast<PacketBatch*>(p->next()))) {\
+        for (;p != NULL;p=cep_next,cep_next=(p==0?0:static_cast<PacketBatch*>(p->next())),cep_prefetch.advance()) {\
             int o = (fnt(p));\
             if (o < 0 || o>=(nbatches)) o = (nbatches - 1);\
             if (o == last_o) {\
@@ -0,0 +1,148 @@
+// -*- c-basic-offset: 4; related-file-name: "../../lib/perfevents.cc" -*-
+#ifndef CLICK_PERFEVENTS_HH
+#define CLICK_PERFEVENTS_HH
+#include <click/glue.hh>
+#include <click/machine.hh>
+#include <click/string.hh>
+#if CLICK_USERLEVEL && defined(__linux__)
+# define HAVE_PERF_EVENTS 1
+#endif
+CLICK_DECLS
+class ErrorHandler;
+
+/** @file <click/perfevents.hh>
+ * @brief Per-thread hardware performance counters.
+ */
+
+/** @class PerfEvents
+ * @brief Hardware performance counters read from the packet path.
+ *
+ * PerfEvents opens up to max_events Linux perf_event_open() counters, such
+ * as cache misses or retired instructions, in each thread that reads them.
+ * Where the kernel allows it, counters are read with the rdpmc instruction
+ * from a mapped page, so reading costs a few tens of cycles and no system
+ * call.
+ *
+ * The event set is global: set_events() selects it for all threads, and each
+ * thread opens its own counters lazily on its next read().  With
+ * CLICK_STATS >= 2, Element port transfers accumulate the counted events
+ * per element and per thread next to their cycle counts. */
+class PerfEvents { public:
+
+    enum { max_events = 2 };
+
+    /** @brief Return true iff any event is being counted. */
+    static inline bool enabled() {
+	return _nevents != 0;
+    }
+
+    /** @brief Return the number of events being counted. */
+    static inline int nevents() {
+	return _nevents;
+    }
+
+    /** @brief Return the name of event @a i. */
+    static const char *event_name(int i);
+
+    /** @brief Return the space-separated names of the counted events. */
+    static String unparse();
+
+    /** @brief Select the counted events.
+     * @param str space-separated event names, empty to stop counting
+     * @param errh error handler
+     *
+     * Known names are "cycles", "instructions", "cache-references",
+     * "cache-misses", "branches", "branch-misses", "l1d-misses" and
+     * "llc-misses". */
+    static int set_events(const String &str, ErrorHandler *errh);
+
+    /** @brief Read the current thread's counters into @a values.
+     * @return the number of values read
+     *
+     * Reads nevents() values, sampling nevents() once, so a measurement
+     * should keep the count returned by its first read and discard itself if
+     * a later read returns another count.  A counter that could not be
+     * opened reads as 0. */
+    static inline int read(uint64_t *values);
+
+  private:
+
+    struct thread_state {
+	int generation;
+	int fd[max_events];
+	void *page[max_events];
+    };
+
+    static volatile int _nevents;
+    static int _generation;
+    static int _event_ids[max_events];
+    static thread_state *_threads;
+    static unsigned _nthreads;
+
+    static void open_thread(thread_state &ts);
+    static void close_thread(thread_state &ts);
+    static uint64_t read_slow(const thread_state &ts, int i);
+    static inline uint64_t read_one(const thread_state &ts, int i);
+
+};
+
+inline int
+PerfEvents::read(uint64_t *values)
+{
+#if HAVE_PERF_EVENTS
+    int n = _nevents;
+    unsigned tid = click_current_cpu_id();
+    if (unlikely(tid >= _nthreads)) {
+	for (int i = 0; i < n; ++i)
+	    values[i] = 0;
+	return n;
+    }
+    thread_state &ts = _threads[tid];
+    if (unlikely(ts.generation != _generation))
+	open_thread(ts);
+    for (int i = 0; i < n; ++i)
+	values[i] = read_one(ts, i);
+    return n;
+#else
+    (void) values;
+    return 0;
+#endif
+}
+
+CLICK_ENDDECLS
+#if HAVE_PERF_EVENTS
+# include <linux/perf_event.h>
+CLICK_DECLS
+
+inline uint64_t
+PerfEvents::read_one(const thread_state &ts, int i)
+{
+# if defined(__x86_64__) || defined(__i386__)
+    const struct perf_event_mmap_page *pc = (const struct perf_event_mmap_page *) ts.page[i];
+    if (pc) {
+	uint32_t seq, idx;
+	uint64_t count;
+	do {
+	    seq = pc->lock;
+	    click_compiler_fence();
+	    idx = pc->index;
+	    count = pc->offset;
+	    if (pc->cap_user_rdpmc && idx) {
+		uint32_t lo, hi;
+		__asm__ __volatile__ ("rdpmc" : "=a" (lo), "=d" (hi) : "c" (idx - 1));
+		int64_t pmc = lo | ((uint64_t) hi << 32);
+		int shift = 64 - pc->pmc_width;
+		count += (pmc << shift) >> shift;
+	    }
+	    click_compiler_fence();
+	} while (pc->lock != seq);
+	if (idx)
+	    return count;
+    }
+# endif
+    return read_slow(ts, i);
+}
+
+CLICK_ENDDECLS
+#endif
+#endif
@@ -398,5 +398,108 @@ public:
     }
 };
 
+/**
+ * Ring laid out in caller-provided memory, such as a region shared between
+ * processes. It holds no pointers, so each process may map it anywhere.
+ * Insertions and extractions move many values at once; with mp (resp. mc)
+ * set, any number of threads or processes may insert (resp. extract)
+ * concurrently: they reserve slots with a compare-and-swap on the head, and
+ * publish them in reservation order. Capacity must be a power of two.
+ * Sharing a ring between processes requires a multithreaded build, so that
+ * atomic operations are locked.
+ */
+template <typename T> class SharedRing {
+
+    struct Cursor {
+	volatile uint32_t head;
+	volatile uint32_t tail;
+    } CLICK_CACHE_ALIGN;
+
+    uint32_t _mask;
+    Cursor _prod;
+    Cursor _cons;
+
+    inline T *slots() {
+	return reinterpret_cast<T *>(this + 1);
+    }
+
+    inline unsigned reserve(Cursor &c, unsigned n, bool multi, uint32_t &head, bool producer) {
+	uint32_t next;
+	do {
+	    head = c.head;
+	    click_read_fence();
+	    uint32_t avail = producer ? _mask + 1 + _cons.tail - head : _prod.tail - head;
+	    if (n > avail)
+		n = avail;
+	    if (!n)
+		return 0;
+	    next = head + n;
+	    if (!multi) {
+		c.head = next;
+		break;
+	    }
+	} while (atomic_uint32_t::compare_swap(c.head, head, next) != head);
+	return n;
+    }
+
+    inline void publish(Cursor &c, uint32_t head, unsigned n, bool multi) {
+	if (multi)
+	    while (c.tail != head)
+		click_relax_fence();
+	c.tail = head + n;
+    }
+
+public:
+
+    /** @brief Return the bytes needed for a ring of @a capacity values. */
+    static size_t memory_size(uint32_t capacity) {
+	return sizeof(SharedRing<T>) + capacity * sizeof(T);
+    }
+
+    /** @brief Initialize an empty ring of @a capacity values in @a mem. */
+    static SharedRing<T> *format(void *mem, uint32_t capacity) {
+	SharedRing<T> *r = reinterpret_cast<SharedRing<T> *>(mem);
+	r->_mask = capacity - 1;
+	r->_prod.head = r->_prod.tail = 0;
+	r->_cons.head = r->_cons.tail = 0;
+	return r;
+    }
+
+    /** @brief Insert up to @a n values, returning how many were inserted. */
+    inline unsigned insert(const T *v, unsigned n, bool mp) {
+	uint32_t head;
+	if (!(n = reserve(_prod, n, mp, head, true)))
+	    return 0;
+	T *s = slots();
+	for (unsigned i = 0; i < n; ++i)
+	    s[(head + i) & _mask] = v[i];
+	click_write_fence();
+	publish(_prod, head, n, mp);
+	return n;
+    }
+
+    /** @brief Extract up to @a n values, returning how many were extracted. */
+    inline unsigned extract(T *v, unsigned n, bool mc) {
+	uint32_t head;
+	if (!(n = reserve(_cons, n, mc, head, false)))
+	    return 0;
+	click_read_fence();
+	T *s = slots();
+	for (unsigned i = 0; i < n; ++i)
+	    v[i] = s[(head + i) & _mask];
+	click_fence();
+	publish(_cons, head, n, mc);
+	return n;
+    }
+
+    inline unsigned int count() const {
+	return _prod.tail - _cons.tail;
+    }
+
+    inline uint32_t capacity() const {
+	return _mask + 1;
+    }
+};
+
 CLICK_ENDDECLS
 #endif
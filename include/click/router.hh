@@ -132,6 +132,7 @@ class Router { public:
 
     inline Router* hotswap_router() const;
     void set_hotswap_router(Router* router);
+    inline bool hotswap_unchanged(const Element* e) const;
 
     int initialize(ErrorHandler* errh);
     void activate(bool foreground, ErrorHandler* errh);
@@ -293,6 +294,7 @@ class Router { public:
     notifier_signals_t *_notifier_signals;
     HashMap_ArenaFactory* _arena_factory;
     Router* _hotswap_router;
+    Vector<bool> _hotswap_unchanged;
     ThreadSched* _thread_sched;
     bool _is_fullpush;
     mutable NameInfo* _name_info;
@@ -333,6 +335,8 @@ class Router { public:
 
     int element_lerror(ErrorHandler*, Element*, const char*, ...) const;
 
+    void hotswap_signatures(Vector<String>& sig) const;
+
     // private handler methods
     void initialize_handlers(bool, bool);
     inline Handler* xhandler(int) const;
@@ -634,6 +638,23 @@ Router::hotswap_router() const
     return _hotswap_router;
 }
 
+/** @brief Test whether @a e is unchanged from the router it replaces.
+ *
+ * When this router hotswaps out another, an element is unchanged if the
+ * replaced router has an element with the same name, class, configuration
+ * string, and connections.  take_state() implementations can use this to
+ * take over all of an unchanged element's state, including state configured
+ * at run time, rather than just its flows.  The answer remains available
+ * after activation; it is false for all elements of a router that was not
+ * hotswapped in.
+ */
+inline bool
+Router::hotswap_unchanged(const Element* e) const
+{
+    int i = e->eindex();
+    return i >= 0 && i < _hotswap_unchanged.size() && _hotswap_unchanged[i];
+}
+
 inline
 Handler::Handler(const String &name)
     : _name(name), _read_user_data(0), _write_user_data(0), _flags(0),
@@ -45,6 +45,9 @@ class RouterThread { public:
     inline Task *task_next(Task *task) const;
     inline Task *task_end() const;
     void scheduled_tasks(Router *router, Vector<Task *> &x);
+#if HAVE_MULTITHREAD
+    inline click_cycles_t busy_cycles() const;
+#endif
 
     inline void lock_tasks();
     inline void unlock_tasks();
@@ -118,6 +121,9 @@ class RouterThread { public:
     // LOCAL STATE GROUP
     TaskLink _task_link;
     volatile bool _stop_flag;
+#if HAVE_MULTITHREAD
+    click_cycles_t _busy_cycles;
+#endif
 #if HAVE_TASK_HEAP
     Vector<task_heap_element> _task_heap;
 #endif
@@ -480,6 +486,20 @@ RouterThread::stop_flag() const
     return _stop_flag;
 }
 
+#if HAVE_MULTITHREAD
+/** @brief Return an estimate of the cycles this thread spent in tasks that
+ * did work.
+ *
+ * This is the sum of Task::busy_cycles() over the tasks that ran here.  The
+ * value only grows; divide its change over an interval by the cycles
+ * elapsed to get the thread's busy ratio. */
+inline click_cycles_t
+RouterThread::busy_cycles() const
+{
+    return _busy_cycles;
+}
+#endif
+
 inline void
 RouterThread::set_thread_state(int state)
 {
@@ -0,0 +1,140 @@
+// -*- c-basic-offset: 4 -*-
+#ifndef CLICK_STATSCOUNTER_HH
+#define CLICK_STATSCOUNTER_HH
+#include <click/element.hh>
+#include <click/router.hh>
+#include <click/string.hh>
+#include <click/statsregion.h>
+CLICK_DECLS
+
+/** @file <click/statscounter.hh>
+ * @brief Per-thread counters that can live in a shared-memory region.
+ */
+
+/** @class StatsRegion
+ * @brief Router-wide provider of counter slots.
+ *
+ * A StatsRegion hands out per-thread counter slots to the elements of its
+ * router. It registers itself as the router attachment named "StatsRegion",
+ * normally during configuration, so elements can find it from their
+ * initialize() methods. StatsExport is the only implementation; it places the
+ * slots in a memory-mapped file described in <click/statsregion.h>. */
+class StatsRegion { public:
+
+    virtual ~StatsRegion() {
+    }
+
+    /** @brief Allocate a counter slot named @a name.
+     * @param name full counter name, such as "c.count"
+     * @param flags CLICK_STATS_F_* flags
+     * @param[out] stride distance between threads' copies, in counters
+     * @return pointer to thread 0's copy, or null if the region is full
+     *
+     * Thread T's copy of the counter is at the returned pointer plus T *
+     * @a stride. The copies start at zero and stay valid until the region's
+     * element is destroyed. */
+    virtual uint64_t *allocate(const String &name, uint32_t flags,
+			       unsigned &stride) = 0;
+
+    /** @brief Return @a router's StatsRegion, if any. */
+    static StatsRegion *find(Router *router) {
+	return static_cast<StatsRegion *>(router->attachment("StatsRegion"));
+    }
+
+};
+
+/** @class StatsCounter
+ * @brief A 64-bit counter with one copy per thread.
+ *
+ * Each thread adds to its own copy, and readers sum the copies. Until
+ * initialize() is called a StatsCounter reads as zero and must not be
+ * written. If the router has a StatsRegion, initialize() places the copies
+ * there, under the name "<element name>.<counter name>", so that other
+ * processes can read them; otherwise it allocates them locally, one cache
+ * line per thread. Either way, writing a counter costs one add to memory no
+ * other thread writes. */
+class StatsCounter { public:
+
+    StatsCounter()
+	: _base(0), _stride(0), _local(0) {
+    }
+
+    ~StatsCounter() {
+	delete[] _local;
+    }
+
+    /** @brief Allocate the counter for @a owner under @a name.
+     * @param flags CLICK_STATS_F_* flags, if the counter is exported
+     *
+     * Call from @a owner's initialize() method or later. Calling it again
+     * has no effect. */
+    void initialize(Element *owner, const char *name, uint32_t flags = 0) {
+	if (_base)
+	    return;
+	if (StatsRegion *region = StatsRegion::find(owner->router()))
+	    _base = region->allocate(owner->name() + "." + name, flags, _stride);
+	if (!_base) {
+	    // one extra line so the copies can start on a line boundary
+	    unsigned n = (click_max_cpu_ids() + 1) * line_words;
+	    _local = new uint64_t[n];
+	    memset(_local, 0, n * sizeof(uint64_t));
+	    uintptr_t x = reinterpret_cast<uintptr_t>(_local);
+	    x = (x + CLICK_CACHE_LINE_SIZE - 1) & ~(uintptr_t) (CLICK_CACHE_LINE_SIZE - 1);
+	    _base = reinterpret_cast<uint64_t *>(x);
+	    _stride = line_words;
+	}
+    }
+
+    /** @brief Test whether initialize() has been called. */
+    bool initialized() const {
+	return _base;
+    }
+
+    /** @brief Return the current thread's copy. */
+    inline uint64_t &local() const {
+	return _base[click_current_cpu_id() * _stride];
+    }
+
+    /** @brief Add @a x to the current thread's copy. */
+    inline void add(uint64_t x) const {
+	local() += x;
+    }
+
+    /** @brief Increment the current thread's copy. */
+    inline void inc() const {
+	++local();
+    }
+
+    /** @brief Return the sum of all threads' copies. */
+    uint64_t value() const {
+	uint64_t sum = 0;
+	if (_base)
+	    for (unsigned i = 0; i < click_max_cpu_ids(); ++i)
+		sum += _base[i * _stride];
+	return sum;
+    }
+
+    /** @brief Set all threads' copies to zero.
+     *
+     * Racy if other threads write the counter concurrently. */
+    void clear() const {
+	if (_base)
+	    for (unsigned i = 0; i < click_max_cpu_ids(); ++i)
+		_base[i * _stride] = 0;
+    }
+
+  private:
+
+    enum { line_words = CLICK_CACHE_LINE_SIZE / sizeof(uint64_t) };
+
+    uint64_t *_base;
+    unsigned _stride;
+    uint64_t *_local;
+
+    StatsCounter(const StatsCounter &);
+    StatsCounter &operator=(const StatsCounter &);
+
+};
+
+CLICK_ENDDECLS
+#endif
@@ -0,0 +1,58 @@
+#ifndef CLICK_STATSREGION_H
+#define CLICK_STATSREGION_H
+#if !CLICK_LINUXMODULE && !CLICK_BSDMODULE
+# include <stdint.h>
+#endif
+
+/* Click shared-memory statistics region
+
+   A StatsExport element maps a file laid out as below and lends its counter
+   slots to elements in the router. Other processes on the host can map the
+   file read-only and read counters with plain loads: no system calls, no
+   handler calls, and no coordination with the router threads.
+
+   The file starts with a click_stats_header, followed by an array of
+   'capacity' click_stats_desc descriptors at 'desc_offset', followed by
+   'nthreads' counter blocks starting at 'data_offset'. Each block is
+   'thread_stride' bytes long (a multiple of the cache line size) and holds
+   one 64-bit counter per slot. Thread T writes only its own block; the value
+   of the counter described by descriptor D is the sum over all T of the
+   uint64_t at
+
+       data_offset + T * thread_stride + D.slot * 8.
+
+   Descriptors are filled in before 'ncounters' is increased to cover them,
+   so a reader that loads 'ncounters' first never sees a partial descriptor.
+   'closed' becomes nonzero when the router that owns the region goes away;
+   a newer router may have replaced the file by then. */
+
+#define CLICK_STATS_MAGIC	"ClkStat1"
+#define CLICK_STATS_VERSION	1
+#define CLICK_STATS_NAMELEN	120
+
+struct click_stats_header {
+    char magic[8];			/* CLICK_STATS_MAGIC, no terminator */
+    uint32_t version;			/* CLICK_STATS_VERSION */
+    uint32_t header_size;		/* sizeof(struct click_stats_header) */
+    uint32_t desc_size;			/* sizeof(struct click_stats_desc) */
+    uint32_t capacity;			/* number of descriptors and slots */
+    uint32_t nthreads;			/* number of counter blocks */
+    uint32_t thread_stride;		/* bytes between counter blocks */
+    uint64_t desc_offset;
+    uint64_t data_offset;
+    uint64_t size;			/* total file size */
+    volatile uint32_t ncounters;	/* published descriptors */
+    volatile uint32_t closed;		/* nonzero once the router is gone */
+    int32_t pid;			/* process that created the region */
+    uint32_t reserved;
+};
+
+#define CLICK_STATS_F_BYTES	1	/* counter counts bytes, not events */
+
+struct click_stats_desc {
+    char name[CLICK_STATS_NAMELEN];	/* "element.counter", NUL-terminated */
+    uint32_t slot;
+    uint32_t flags;			/* CLICK_STATS_F_* */
+};
+
+#endif
@@ -293,6 +293,7 @@ class Task : private TaskLink { public:
     inline int cycles() const;
     inline unsigned cycle_runs() const;
     inline void update_cycles(unsigned c);
+    inline click_cycles_t busy_cycles() const;
 #endif
 
     /** @cond never */
@@ -330,6 +331,7 @@ class Task : private TaskLink { public:
 #if HAVE_MULTITHREAD
     DirectEWMA _cycles;
     unsigned _cycle_runs;
+    click_cycles_t _busy_cycles;
 #endif
 
     RouterThread *_thread;
@@ -391,7 +393,7 @@ Task::Task(TaskCallback f, void *user_data)
       _runs(0), _work_done(0),
 #endif
 #if HAVE_MULTITHREAD
-      _cycle_runs(0),
+      _cycle_runs(0), _busy_cycles(0),
 #endif
       _thread(0), _owner(0)
 {
@@ -414,7 +416,7 @@ Task::Task(Element* e)
       _runs(0), _work_done(0),
 #endif
 #if HAVE_MULTITHREAD
-      _cycle_runs(0),
+      _cycle_runs(0), _busy_cycles(0),
 #endif
       _thread(0), _owner(0)
 {
@@ -573,8 +575,9 @@ inline bool
 Task::fire()
 {
 #if CLICK_STATS >= 2
+    Element::stats_type &stats = *_owner->_stats;
     click_cycles_t start_cycles = click_get_cycles(),
-        start_child_cycles = _owner->_child_cycles;
+        start_child_cycles = stats.child_cycles;
 #endif
 #if HAVE_MULTITHREAD
     _cycle_runs++;
@@ -590,9 +593,9 @@ Task::fire()
 #endif
 #if CLICK_STATS >= 2
     click_cycles_t all_delta = click_get_cycles() - start_cycles,
-        own_delta = all_delta - (_owner->_child_cycles - start_child_cycles);
-    _owner->_task_calls += 1;
-    _owner->_task_own_cycles += own_delta;
+        own_delta = all_delta - (stats.child_cycles - start_child_cycles);
+    stats.task_calls += 1;
+    stats.task_own_cycles += own_delta;
 #endif
     return work_done;
 }
@@ -642,6 +645,17 @@ Task::update_cycles(unsigned c)
     _cycles.update(c);
     _cycle_runs = 0;
 }
+
+/** @brief Return an estimate of the cycles this task spent doing work.
+ *
+ * The estimate is sampled along with cycles(): runs that returned false do
+ * not count.  The value only grows, so callers measure it over an
+ * interval. */
+inline click_cycles_t
+Task::busy_cycles() const
+{
+    return _busy_cycles;
+}
 #endif
 
 CLICK_ENDDECLS
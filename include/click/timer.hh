@@ -104,6 +104,29 @@ class Timer { public:
 	return _schedpos1 != 0;
     }
 
+    /** @brief Return true iff the Timer uses coarse precision.
+     *
+     * @sa set_coarse() */
+    inline bool coarse() const {
+	return _coarse;
+    }
+
+    /** @brief Set whether the Timer uses coarse precision.
+     * @param coarse true for coarse precision
+     *
+     * Coarse timers are kept on their thread's hashed hierarchical timing
+     * wheel instead of the timer heap.  Scheduling and unscheduling a coarse
+     * timer take constant time, and all coarse timers expiring in the same
+     * wheel tick are fired together.  The price is precision: a coarse timer
+     * fires up to TimerSet::wheel_tick_msec milliseconds after its nominal
+     * expiry.  This suits garbage collection and flow timeouts, where many
+     * timers are rescheduled far more often than they fire.
+     *
+     * The change takes effect at the next schedule operation. */
+    inline void set_coarse(bool coarse = true) {
+	_coarse = coarse;
+    }
+
 
     /** @brief Return the Timer's steady-clock expiration time.
      *
@@ -342,6 +365,7 @@ class Timer { public:
   private:
 
     int _schedpos1;
+    bool _coarse;
     Timestamp _expiry_s;
     union {
 	TimerCallback callback;
@@ -349,6 +373,8 @@ class Timer { public:
     void *_thunk;
     Element *_owner;
     RouterThread *_thread;
+    Timer *_wheel_next;
+    Timer **_wheel_pprev;
 
     Timer &operator=(const Timer &x);
 
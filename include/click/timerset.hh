@@ -25,6 +25,11 @@ class TimerSet { public:
     unsigned timer_stride() const		{ return _timer_stride; }
     void set_max_timer_stride(unsigned timer_stride);
 
+    /** @brief Return the number of timers on the timing wheel. */
+    unsigned wheel_size() const			{ return _wheel_count; }
+
+    enum { wheel_tick_msec = 1 };
+
     void kill_router(Router *router);
 
     void run_timers(RouterThread *thread, Master *master);
@@ -71,6 +76,24 @@ class TimerSet { public:
     Timestamp _timer_check;
     uint32_t _timer_check_reports;
 
+    // Hashed hierarchical timing wheel holding coarse timers.  Level 0 has
+    // one slot per tick; each higher level covers the whole range of the
+    // level below per slot, and its slots are cascaded down as time passes.
+    enum {
+	wheel_schedpos = 0x7FFFFFFF,
+	wheel_levels = 4,
+	wheel_bits0 = 8, wheel_slots0 = 1 << wheel_bits0,
+	wheel_bitsn = 6, wheel_slotsn = 1 << wheel_bitsn
+    };
+    Timer *_wheel0[wheel_slots0];
+    Timer *_wheeln[wheel_levels - 1][wheel_slotsn];
+    uint64_t _wheel0_bits[wheel_slots0 / 64];
+    uint64_t _wheeln_bits[wheel_levels - 1];
+    uint64_t _wheel_now;		// first tick not yet processed
+    unsigned _wheel_count;
+    Timer *_wheel_runlist;
+    Timestamp _wheel_expiry;
+
     inline void run_one_timer(Timer *);
 
     void set_timer_expiry() {
@@ -78,8 +101,31 @@ class TimerSet { public:
 	    _timer_expiry = _timer_heap.unchecked_at(0).expiry_s;
 	else
 	    _timer_expiry = Timestamp();
+	if (_wheel_expiry && (!_timer_expiry || _wheel_expiry < _timer_expiry))
+	    _timer_expiry = _wheel_expiry;
     }
     void check_timer_expiry(Timer *t);
+    void heap_remove(Timer *t);
+
+    static inline uint64_t wheel_tick(const Timestamp &ts) {
+	return ts.msecval() / wheel_tick_msec;
+    }
+    static inline Timestamp wheel_tick_expiry(uint64_t tick) {
+	return Timestamp::make_msec((tick + 1) * wheel_tick_msec);
+    }
+    inline void wheel_push(Timer **slot, Timer *t);
+    inline void wheel_unlink(Timer *t);
+    void wheel_clear_bits() {
+	memset(_wheel0_bits, 0, sizeof(_wheel0_bits));
+	memset(_wheeln_bits, 0, sizeof(_wheeln_bits));
+    }
+    void wheel_insert(Timer *t);
+    void wheel_place(Timer *t);
+    void wheel_remove(Timer *t);
+    void wheel_cascade(int level, unsigned i);
+    void wheel_advance(uint64_t now_tick);
+    Timestamp wheel_next_expiry() const;
+    void run_wheel_timers(RouterThread *thread);
 
     inline void lock_timers();
     inline bool attempt_lock_timers();
@@ -142,6 +188,24 @@ TimerSet::unlock_timers()
 #endif
 }
 
+inline void
+TimerSet::wheel_push(Timer **slot, Timer *t)
+{
+    if ((t->_wheel_next = *slot))
+	t->_wheel_next->_wheel_pprev = &t->_wheel_next;
+    t->_wheel_pprev = slot;
+    *slot = t;
+}
+
+inline void
+TimerSet::wheel_unlink(Timer *t)
+{
+    if ((*t->_wheel_pprev = t->_wheel_next))
+	t->_wheel_next->_wheel_pprev = t->_wheel_pprev;
+    t->_wheel_next = 0;
+    t->_wheel_pprev = 0;
+}
+
 inline void
 TimerSet::fence()
 {
@@ -640,6 +640,29 @@ class Timestamp { public:
      * Only usable when warp_class() is not #warp_none. */
     static void warp_set_now(const Timestamp &t_system, const Timestamp &t_steady);
 
+    /** @brief Set whether trace sources drive Click time.
+     *
+     * In trace mode, the first trace source that replays packets at their
+     * recorded times resets the system clock to its first packet timestamp,
+     * and every such source shares one offset between trace time and
+     * steady-clock time (see warp_trace_offset()).  Combined with
+     * #warp_simulation, Timestamp::now() and timers then follow the trace,
+     * while the driver runs as fast as it can. */
+    static void warp_set_trace(bool trace);
+
+    /** @brief Return true iff trace sources drive Click time. */
+    static inline bool warp_trace();
+
+    /** @brief Return the steady-clock offset for replaying a trace.
+     * @param t timestamp of the first packet to replay
+     *
+     * A trace source replaying packets at their recorded times holds each
+     * packet until Timestamp::now_steady() reaches its timestamp plus this
+     * offset.  Normally the offset maps @a t to the present.  If warp_trace()
+     * is true, the first call also sets the system clock to @a t, and later
+     * calls return the same offset, so that several traces stay aligned. */
+    static Timestamp warp_trace_offset(const Timestamp &t);
+
 
     /** @brief Return the wall-clock time corresponding to a delay. */
     inline Timestamp warp_real_delay() const;
@@ -755,6 +778,9 @@ class TimestampWarp {
     static double speed;
     static Timestamp flat_offset[2];
     static double offset[2];
+    static bool trace;
+    static bool trace_started;
+    static Timestamp trace_offset;
     friend class Timestamp;
 };
 /** @endcond never */
@@ -767,6 +793,10 @@ inline double Timestamp::warp_speed() {
     return TimestampWarp::speed;
 }
 
+inline bool Timestamp::warp_trace() {
+    return TimestampWarp::trace;
+}
+
 inline bool Timestamp::warp_jumping() {
     return TimestampWarp::kind >= warp_nowait;
 }
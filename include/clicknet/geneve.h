@@ -0,0 +1,30 @@
+/* -*- mode: c; c-basic-offset: 4 -*- */
+#ifndef CLICKNET_GENEVE_H
+#define CLICKNET_GENEVE_H
+
+/*
+ * <clicknet/geneve.h> -- Geneve header definitions
+ *
+ * Relevant RFCs include:
+ *   RFC8926	Geneve: Generic Network Virtualization Encapsulation
+ *
+ * The fixed header is followed by (gn_vo & GENEVE_OPTLEN_MASK) * 4 bytes of
+ * options.
+ */
+
+struct click_geneve {
+    uint8_t	gn_vo;			/* 0     version, options length     */
+#define GENEVE_VERSION_MASK	0xC0
+#define GENEVE_OPTLEN_MASK	0x3F	/*       in 4-byte words	     */
+    uint8_t	gn_flags;		/* 1     flags			     */
+#define GENEVE_FLAG_O		0x80	/*       control packet		     */
+#define GENEVE_FLAG_C		0x40	/*       critical options present    */
+    uint16_t	gn_ptype;		/* 2-3   inner protocol type	     */
+#define GENEVE_PTYPE_ETHER	0x6558	/*       transparent Ethernet bridging */
+    uint32_t	gn_vni;			/* 4-7   VNI (high 24 bits),
+					         reserved (low 8 bits)	     */
+};
+
+#define GENEVE_PORT		6081	/* IANA-assigned UDP port	     */
+
+#endif
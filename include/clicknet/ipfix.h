@@ -0,0 +1,61 @@
+/* -*- mode: c; c-basic-offset: 4 -*- */
+#ifndef CLICKNET_IPFIX_H
+#define CLICKNET_IPFIX_H
+
+/*
+ * <clicknet/ipfix.h> -- IPFIX and NetFlow v9 message definitions
+ *
+ * Relevant RFCs include:
+ *   RFC3954	Cisco Systems NetFlow Services Export Version 9
+ *   RFC7011	Specification of the IP Flow Information Export (IPFIX)
+ *		Protocol for the Exchange of Flow Information
+ *   RFC7012	Information Model for IP Flow Information Export (IPFIX)
+ */
+
+struct click_ipfix_header {
+    uint16_t	ipfix_version;		/* 0-1   version == 10		     */
+    uint16_t	ipfix_length;		/* 2-3   message length in bytes     */
+    uint32_t	ipfix_export_time;	/* 4-7   export time, UNIX seconds   */
+    uint32_t	ipfix_seq;		/* 8-11  data records sent before    */
+    uint32_t	ipfix_domain;		/* 12-15 observation domain ID	     */
+};
+
+struct click_nfv9_header {
+    uint16_t	nfv9_version;		/* 0-1   version == 9		     */
+    uint16_t	nfv9_count;		/* 2-3   records in this packet	     */
+    uint32_t	nfv9_uptime;		/* 4-7   exporter uptime, ms	     */
+    uint32_t	nfv9_unix_secs;		/* 8-11  export time, UNIX seconds   */
+    uint32_t	nfv9_seq;		/* 12-15 packets sent before	     */
+    uint32_t	nfv9_source_id;		/* 16-19 source ID		     */
+};
+
+/* IPFIX sets and NetFlow v9 flowsets share this header; data sets use the
+   template ID as set ID */
+struct click_ipfix_set {
+    uint16_t	set_id;			/* 0-1   set ID			     */
+    uint16_t	set_length;		/* 2-3   set length, with header     */
+};
+
+#define IPFIX_VERSION		10
+#define NFV9_VERSION		9
+#define IPFIX_SET_TEMPLATE	2
+#define NFV9_SET_TEMPLATE	0
+#define IPFIX_TEMPLATE_ID_MIN	256
+
+/* information elements; NetFlow v9 uses the same numbers */
+#define IPFIX_IE_OCTET_DELTA_COUNT		1
+#define IPFIX_IE_PACKET_DELTA_COUNT		2
+#define IPFIX_IE_PROTOCOL_IDENTIFIER		4
+#define IPFIX_IE_TCP_CONTROL_BITS		6
+#define IPFIX_IE_SOURCE_TRANSPORT_PORT		7
+#define IPFIX_IE_SOURCE_IPV4_ADDRESS		8
+#define IPFIX_IE_DESTINATION_TRANSPORT_PORT	11
+#define IPFIX_IE_DESTINATION_IPV4_ADDRESS	12
+#define IPFIX_IE_FLOW_END_SYS_UP_TIME		21
+#define IPFIX_IE_FLOW_START_SYS_UP_TIME		22
+#define IPFIX_IE_FLOW_START_MILLISECONDS	152
+#define IPFIX_IE_FLOW_END_MILLISECONDS		153
+
+#define IPFIX_PORT		4739	/* IANA-assigned UDP port	     */
+
+#endif
@@ -0,0 +1,23 @@
+/* -*- mode: c; c-basic-offset: 4 -*- */
+#ifndef CLICKNET_VXLAN_H
+#define CLICKNET_VXLAN_H
+
+/*
+ * <clicknet/vxlan.h> -- VXLAN header definitions
+ *
+ * Relevant RFCs include:
+ *   RFC7348	Virtual eXtensible Local Area Network (VXLAN)
+ */
+
+struct click_vxlan {
+    uint8_t	vx_flags;		/* 0     flags			     */
+#define VXLAN_FLAG_I		0x08	/*       VNI is valid		     */
+    uint8_t	vx_reserved[3];		/* 1-3   reserved		     */
+    uint32_t	vx_vni;			/* 4-7   VNI (high 24 bits),
+					         reserved (low 8 bits)	     */
+};
+
+#define VXLAN_PORT		4789	/* IANA-assigned UDP port	     */
+#define VXLAN_VNI_MAX		0xFFFFFF
+
+#endif
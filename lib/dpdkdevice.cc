@@ -356,8 +356,16 @@ int DPDKDevice::add_queue(DPDKDevice::Dir dir,
                            ErrorHandler *errh)
 {
     if (_is_initialized) {
-        return errh->error(
-            "Trying to configure DPDK device after initialization");
+        // A hotswapped configuration takes over the running queues as long
+        // as it asks for queues the device already has, set up the same way.
+        const Vector<bool> &queues = (dir == RX ? info.rx_queues : info.tx_queues);
+        unsigned n_descs = (dir == RX ? info.n_rx_descs : info.n_tx_descs);
+        if (queue_id < 0 || queue_id >= queues.size() || !queues[queue_id]
+            || (n_desc > 0 && n_desc != n_descs)
+            || (dir == RX && promisc != info.promisc))
+            return errh->error(
+                "Trying to configure DPDK device after initialization");
+        return 0;
     }
 
     if (dir == RX) {
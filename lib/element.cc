@@ -427,10 +427,13 @@ Element::Element()
     in_batch_mode(BATCH_MODE_NO),
 #endif
     receives_batch(false),
+    _router(0), _eindex(-1)
 #if HAVE_FULLPUSH_NONATOMIC
-    _is_fullpush(false),
+    , _is_fullpush(false)
+#endif
+#if HAVE_BATCH
+    , _batch_prefetch(BATCH_PREFETCH_DEFAULT)
 #endif
-    _router(0), _eindex(-1)
 {
     nelements_allocated++;
     _ports[0] = _ports[1] = &_inline_ports[0];
@@ -1227,6 +1230,13 @@ Element::processing_vector(int* in_v, int* out_v, ErrorHandler* errh) const
  * RoundRobinSched has 0 inputs, are idle rather than busy, and waste no
  * CPU time.</dd>
  *
+ * <dt><tt>F</tt></dt> <dd>This element's simple_action() processes a packet
+ * exactly as its batch path (push_batch() or simple_action_batch()) would,
+ * including in batch mode, and emits surviving packets on output 0.  Linear
+ * chains of <tt>F</tt>-flagged elements may therefore be fused into a single
+ * per-packet loop; see BatchFusion and click-devirtualize's
+ * <tt>--fuse-batch</tt> option.</dd>
+ *
  * </dl>
  */
 const char*
@@ -2162,6 +2172,24 @@ read_threads_handler(Element *e, void * thunk)
     return "";
 }
 
+#if HAVE_BATCH
+String
+Element::read_batch_prefetch_handler(Element *e, void *)
+{
+    return String(e->_batch_prefetch);
+}
+
+int
+Element::write_batch_prefetch_handler(const String &str, Element *e, void *, ErrorHandler *errh)
+{
+    unsigned k;
+    if (!IntArg().parse(str, k) || k > MAX_BATCH_SIZE)
+	return errh->error("expected prefetch distance");
+    e->_batch_prefetch = k;
+    return 0;
+}
+#endif
+
 String
 Element::read_handlers_handler(Element *e, void *)
 {
@@ -2228,16 +2256,77 @@ read_ocounts_handler(Element *f, void *)
 #endif /* CLICK_STATS >= 1 */
 
 #if CLICK_STATS >= 2
+void
+Element::reset_cycles()
+{
+    for (unsigned i = 0; i < _stats.weight(); ++i)
+	memset(&_stats.get_value(i), 0, sizeof(stats_type));
+}
+
+/** @brief Sum this element's statistics over all threads into @a s. */
+void
+Element::sum_stats(stats_type &s) const
+{
+    memset(&s, 0, sizeof(stats_type));
+    for (unsigned i = 0; i < _stats.weight(); ++i) {
+	const stats_type &t = _stats.get_value(i);
+	s.xfer_calls += t.xfer_calls;
+	s.xfer_batches += t.xfer_batches;
+	s.xfer_packets += t.xfer_packets;
+	s.xfer_own_cycles += t.xfer_own_cycles;
+	s.child_cycles += t.child_cycles;
+	s.task_calls += t.task_calls;
+	s.task_own_cycles += t.task_own_cycles;
+	s.timer_calls += t.timer_calls;
+	s.timer_own_cycles += t.timer_own_cycles;
+# if HAVE_PERF_EVENTS
+	for (int j = 0; j < PerfEvents::max_events; ++j) {
+	    s.xfer_own_events[j] += t.xfer_own_events[j];
+	    s.child_events[j] += t.child_events[j];
+	}
+# endif
+    }
+}
+
 String
-Element::read_cycles_handler(Element *e, void *)
+Element::read_cycles_handler(Element *e, void *thunk)
 {
     StringAccum sa;
-    if (e->_task_calls)
-	sa << "tasks " << e->_task_calls << ' ' << e->_task_own_cycles << '\n';
-    if (e->_timer_calls)
-	sa << "timers " << e->_timer_calls << ' ' << e->_timer_own_cycles << '\n';
-    if (e->_xfer_calls)
-	sa << "xfer " << e->_xfer_calls << ' ' << e->_xfer_own_cycles << '\n';
+    if (thunk) {
+	// one line per thread that ran this element
+	for (unsigned i = 0; i < e->_stats.weight(); ++i) {
+	    const stats_type &s = e->_stats.get_value(i);
+	    if (!s.xfer_calls && !s.task_calls && !s.timer_calls)
+		continue;
+	    sa << i << ' ' << s.xfer_calls << ' ' << s.xfer_batches << ' '
+	       << s.xfer_packets << ' ' << s.xfer_own_cycles << ' '
+	       << stats_divide(s.xfer_own_cycles, s.xfer_packets)
+	       << ' ' << s.task_calls << ' ' << s.task_own_cycles
+	       << ' ' << s.timer_calls << ' ' << s.timer_own_cycles;
+# if HAVE_PERF_EVENTS
+	    for (int j = 0; j < PerfEvents::nevents(); ++j)
+		sa << ' ' << s.xfer_own_events[j];
+# endif
+	    sa << '\n';
+	}
+	return sa.take_string();
+    }
+
+    stats_type s;
+    e->sum_stats(s);
+    if (s.task_calls)
+	sa << "tasks " << s.task_calls << ' ' << s.task_own_cycles << '\n';
+    if (s.timer_calls)
+	sa << "timers " << s.timer_calls << ' ' << s.timer_own_cycles << '\n';
+    if (s.xfer_calls)
+	sa << "xfer " << s.xfer_calls << ' ' << s.xfer_own_cycles << '\n';
+    if (s.xfer_packets)
+	sa << "packets " << s.xfer_packets << ' ' << s.xfer_batches << ' '
+	   << stats_divide(s.xfer_own_cycles, s.xfer_packets) << '\n';
+# if HAVE_PERF_EVENTS
+    for (int j = 0; j < PerfEvents::nevents(); ++j)
+	sa << PerfEvents::event_name(j) << ' ' << s.xfer_own_events[j] << '\n';
+# endif
     return sa.take_string();
 }
 
@@ -2264,12 +2353,17 @@ Element::add_default_handlers(bool allow_write_config)
   add_read_handler("home_thread", read_threads_handler, 2, Handler::f_calm);
   add_read_handler("mt_safe", read_threads_handler, 3, Handler::f_calm);
   add_read_handler("is_fullpush", read_threads_handler, 4, Handler::f_calm);
+#if HAVE_BATCH
+  add_read_handler("batch_prefetch", read_batch_prefetch_handler, 0, Handler::f_calm);
+  add_write_handler("batch_prefetch", write_batch_prefetch_handler, 0);
+#endif
 #if CLICK_STATS >= 1
   add_read_handler("icounts", read_icounts_handler, 0);
   add_read_handler("ocounts", read_ocounts_handler, 0);
 # if CLICK_STATS >= 2
   add_read_handler("cycles", read_cycles_handler, 0);
   add_write_handler("cycles", write_cycles_handler, 0);
+  add_read_handler("thread_cycles", read_cycles_handler, 1);
 # endif
 #endif
 }
@@ -3092,7 +3186,7 @@ void Element::push_batch(int port, PacketBatch* batch) {
     for each e in list
         e->start_batch();
 #endif
-    FOR_EACH_PACKET_SAFE(batch,p) {
+    FOR_EACH_PACKET_SAFE_PREFETCH(batch,p,_batch_prefetch) {
         push(port,p);
     }
 #if HAVE_AUTO_BATCH == AUTO_BATCH_PORT || HAVE_AUTO_BATCH == AUTO_BATCH_JUMP
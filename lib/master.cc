@@ -179,6 +179,10 @@ Master::run_router(Router *router, bool foreground)
     router->_running = (foreground ? Router::RUNNING_ACTIVE : Router::RUNNING_BACKGROUND);
     unlock_master();
     unpause();
+    // A hotswapped-in router may have dropped its runcount during
+    // initialization, when verify_stop() still ignored it.
+    if (router->runcount() <= 0)
+        request_stop();
 }
 
 void
@@ -30,6 +30,14 @@
 #if CLICK_USERLEVEL || CLICK_MINIOS
 # include <unistd.h>
 #endif
+#if CLICK_USERLEVEL
+# include <sys/mman.h>
+# include <sched.h>
+# include <errno.h>
+#endif
+#if CLICK_USERLEVEL && HAVE_NUMA
+# include <click/numa.hh>
+#endif
 #if HAVE_DPDK
 # include <click/dpdkdevice.hh>
 #endif
@@ -190,6 +198,41 @@ CLICK_DECLS
  * Avoid writing buggy code like this!  Use WritablePacket selectively, and
  * try to avoid calling WritablePacket::clone() when possible. */
 
+#if HAVE_CLICK_PACKET_POOL && CLICK_USERLEVEL && !HAVE_DPDK_PACKET_POOL && !HAVE_NETMAP_PACKET_POOL
+# define HAVE_PACKET_ARENA 1
+// The packet arena holds the memory of pool packets and their buffers.  It
+// is one reserved address range split into a span per NUMA node, and each
+// span is mapped in large slabs, on hugepages where possible, bound to the
+// node.  A buffer's address thus tells its home node.  Arena memory is never
+// returned to the system; it only cycles through the packet pools.
+static struct PacketArena {
+    unsigned char *base;
+    int node_shift;             // log2 of the address span of a node
+    int nnodes;                 // 0 until the address range is reserved
+    size_t slab_size;
+    bool hugepages;
+    bool hugetlb_failed;
+    bool disabled;
+} packet_arena = { 0, 0, 0, (size_t) 2 << 20, true, false, false };
+
+/** @brief Return the NUMA node of arena memory @a x, or -1 if @a x is not
+    in the arena. */
+static inline int
+arena_node(const void *x)
+{
+    uintptr_t off = (uintptr_t) x - (uintptr_t) packet_arena.base;
+    if (off < ((uintptr_t) packet_arena.nnodes << packet_arena.node_shift))
+	return off >> packet_arena.node_shift;
+    return -1;
+}
+#else
+static inline int
+arena_node(const void *)
+{
+    return -1;
+}
+#endif
+
 Packet::~Packet()
 {
     // This is a convenient place to put static assertions.
@@ -232,7 +275,7 @@ Packet::~Packet()
         NetmapBufQ::local_pool()->insert_p(_head);
     } else
 #  endif
-    if (_head) {
+    if (_head && arena_node(_head) < 0) {
             delete[] _head;
     }
 # elif CLICK_BSDMODULE
@@ -252,7 +295,11 @@ Packet::~Packet()
 // important to do so quickly. This specialized packet allocator saves
 // pre-initialized Packet objects, either with or without data, for fast
 // reuse. It can support multithreaded deployments: each thread has its own
-// pool, with a global pool to even out imbalance.
+// pool, with a shared pool per NUMA node to even out imbalance.
+//
+// At user level, pool packets and buffers are carved from the packet arena
+// (see above) instead of the heap.  A thread keeps a freed buffer only if it
+// belongs to the thread's node; other buffers are batched and sent home.
 
 #if HAVE_DPDK_PACKET_POOL
 #  define CLICK_PACKET_POOL_BUFSIZ		DPDKDevice::MBUF_DATA_SIZE
@@ -261,16 +308,37 @@ Packet::~Packet()
 #endif
 #  define CLICK_PACKET_POOL_SIZE		4096 // see LIMIT in packetpool-01.testie
 #  define CLICK_GLOBAL_PACKET_POOL_COUNT	32
+#  define CLICK_GLOBAL_PACKET_POOL_MAX		1024
+#  define CLICK_PACKET_POOL_CARVE		256
+#  define CLICK_PACKET_POOL_REMOTE_BATCH	64
+
+static unsigned packet_pool_size = CLICK_PACKET_POOL_SIZE;
+static unsigned packet_pool_global_batches = CLICK_GLOBAL_PACKET_POOL_COUNT;
+static unsigned packet_pool_adaptations;
+static bool packet_pool_adaptive = true;
+
+struct NodePacketPool {
+    SimpleSpinlock lock;
+    WritablePacket *pbatch;     // batches of free packets, linked by p->prev()
+                                //   p->anno_u32(0) is # packets in batch
+    WritablePacket *pdbatch;    // batches of packet with data buffers
+    unsigned npbatch;           // # batches in `pbatch`
+    unsigned npdbatch;          // # batches in `pdbatch`
+    uint64_t npackets;          // # packets in `pbatch`
+    uint64_t nbuffers;          // # packets in `pdbatch`
+#  if HAVE_PACKET_ARENA
+    unsigned char *arena_next;  // free part of the current slab
+    unsigned char *arena_end;
+    size_t arena_mapped;        // bytes of the node's span in use
+    size_t arena_huge;          // bytes of those on hugepages
+#  endif
+};
 
 #  if HAVE_MULTITHREAD
 static __thread PacketPool *thread_packet_pool;
 
-typedef MPMCRing<WritablePacket*,CLICK_GLOBAL_PACKET_POOL_COUNT> BatchRing;
-
 struct GlobalPacketPool {
-    BatchRing pbatch;     // batches of free packets, linked by p->prev()
-                                //   p->anno_u32(0) is # packets in batch
-    BatchRing pdbatch;        // batches of packet with data buffers
+    NodePacketPool nodes[CLICK_PACKET_POOL_MAX_NODES];
 
     PacketPool* thread_pools;   // all thread packet pools
 
@@ -278,8 +346,231 @@ struct GlobalPacketPool {
 };
 static GlobalPacketPool global_packet_pool;
 #else
-static PacketPool global_packet_pool = {0,0,0,0};
+static PacketPool global_packet_pool = {0,0,0,0,0,0};
+static NodePacketPool global_node_pool;
+#  endif
+
+static inline NodePacketPool& node_packet_pool(int node) {
+#  if HAVE_MULTITHREAD
+    return global_packet_pool.nodes[node];
+#  else
+    (void) node;
+    return global_node_pool;
+#  endif
+}
+
+static inline int pool_node(const PacketPool &packet_pool) {
+#  if HAVE_MULTITHREAD
+    return packet_pool.node;
+#  else
+    (void) packet_pool;
+    return 0;
+#  endif
+}
+
+static inline void lock_thread_pools() {
+#  if HAVE_MULTITHREAD
+    while (atomic_uint32_t::swap(global_packet_pool.lock, 1) == 1)
+	/* do nothing */;
 #  endif
+}
+
+static inline void unlock_thread_pools() {
+#  if HAVE_MULTITHREAD
+    click_compiler_fence();
+    global_packet_pool.lock = 0;
+#  endif
+}
+
+#  if HAVE_PACKET_ARENA
+/** @brief Reserve the arena's address space, if not done yet.
+    @return true if the arena can be used */
+static bool
+arena_initialize()
+{
+    if (packet_arena.nnodes || packet_arena.disabled)
+	return packet_arena.nnodes;
+    int nnodes = 1;
+#   if HAVE_NUMA
+    if (numa_available() >= 0)
+	nnodes = Numa::get_max_numas();
+#   endif
+    if (nnodes < 1)
+	nnodes = 1;
+    else if (nnodes > CLICK_PACKET_POOL_MAX_NODES)
+	nnodes = CLICK_PACKET_POOL_MAX_NODES;
+
+    // Only address space is reserved; slabs are mapped as needed.  Align
+    // the spans to the largest slab size.
+    int shift = (sizeof(void *) == 8 ? 36 : 27);
+    size_t align = (sizeof(void *) == 8 ? (size_t) 1 << 30 : (size_t) 2 << 20);
+    size_t len = ((size_t) nnodes << shift) + align;
+    void *m = mmap(0, len, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (m == MAP_FAILED) {
+	packet_arena.disabled = true;
+	return false;
+    }
+    packet_arena.base = (unsigned char *) (((uintptr_t) m + align - 1) & ~(uintptr_t) (align - 1));
+    packet_arena.node_shift = shift;
+    // arena_node() is lock-free: publish the node count last
+    click_compiler_fence();
+    packet_arena.nnodes = nnodes;
+    return true;
+}
+
+/** @brief Map a new slab for @a node.
+    @pre The node pool's lock is held. */
+static bool
+arena_grow(NodePacketPool &np, int node)
+{
+    size_t slab = packet_arena.slab_size;
+    size_t off = (np.arena_mapped + slab - 1) & ~(slab - 1);
+    if (!packet_arena.nnodes || off + slab > ((size_t) 1 << packet_arena.node_shift))
+	return false;
+    unsigned char *addr = packet_arena.base + ((size_t) node << packet_arena.node_shift) + off;
+
+    void *m = MAP_FAILED;
+    bool huge = false;
+#   ifdef MAP_HUGETLB
+    if (packet_arena.hugepages && !packet_arena.hugetlb_failed) {
+	int flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED | MAP_HUGETLB;
+#    ifdef MAP_HUGE_SHIFT
+	flags |= (slab >= ((size_t) 1 << 30) ? 30 : 21) << MAP_HUGE_SHIFT;
+#    endif
+	m = mmap(addr, slab, PROT_READ | PROT_WRITE, flags, -1, 0);
+	if (m == MAP_FAILED)
+	    packet_arena.hugetlb_failed = true;
+	else
+	    huge = true;
+    }
+#   endif
+    if (m == MAP_FAILED) {
+	m = mmap(addr, slab, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0);
+	if (m == MAP_FAILED)
+	    return false;
+#   ifdef MADV_HUGEPAGE
+	// fall back to transparent hugepages
+	if (packet_arena.hugepages)
+	    madvise(m, slab, MADV_HUGEPAGE);
+#   endif
+    }
+#   if HAVE_NUMA
+    // bind before the first touch places the pages
+    if (packet_arena.nnodes > 1)
+	numa_tonode_memory(m, slab, node);
+#   endif
+
+    np.arena_next = addr;
+    np.arena_end = addr + slab;
+    np.arena_mapped = off + slab;
+    if (huge)
+	np.arena_huge += slab;
+    return true;
+}
+
+/** @brief Return the NUMA node of the calling thread. */
+static int
+current_numa_node()
+{
+#   if HAVE_NUMA
+    if (packet_arena.nnodes > 1) {
+	int cpu = sched_getcpu();
+	if (cpu >= 0)
+	    return Numa::get_cpu_node(cpu) % packet_arena.nnodes;
+    }
+#   endif
+    return 0;
+}
+#  endif /* HAVE_PACKET_ARENA */
+
+/** @brief Give a batch of @a count free packets, linked by next(), to the
+ * shared pool of @a node.
+ *
+ * Fails if the node already holds pool_global_batches() batches of that
+ * kind, unless @a force is true or the pool is adaptive, in which case the
+ * limit doubles up to CLICK_GLOBAL_PACKET_POOL_MAX. */
+static bool
+node_pool_insert(int node, bool data, WritablePacket *head, unsigned count, bool force)
+{
+    NodePacketPool &np = node_packet_pool(node);
+    np.lock.acquire();
+    unsigned &nbatch = (data ? np.npdbatch : np.npbatch);
+    if (nbatch >= packet_pool_global_batches && !force) {
+	if (!packet_pool_adaptive
+	    || packet_pool_global_batches >= CLICK_GLOBAL_PACKET_POOL_MAX) {
+	    np.lock.release();
+	    return false;
+	}
+	// The node frees more packets than it reuses soon: keeping them is
+	// cheaper than freeing them and allocating them again later.
+	packet_pool_global_batches = min(packet_pool_global_batches * 2,
+					 (unsigned) CLICK_GLOBAL_PACKET_POOL_MAX);
+	++packet_pool_adaptations;
+    }
+    WritablePacket *&list = (data ? np.pdbatch : np.pbatch);
+    head->set_anno_u32(0, count);
+    head->set_prev(list);
+    list = head;
+    ++nbatch;
+    (data ? np.nbuffers : np.npackets) += count;
+    np.lock.release();
+    return true;
+}
+
+/** @brief Take a batch of free packets from the shared pool of @a node.
+ * @return the batch, linked by next(), with its length in @a count */
+static WritablePacket *
+node_pool_extract(int node, bool data, unsigned &count)
+{
+    NodePacketPool &np = node_packet_pool(node);
+    WritablePacket *&list = (data ? np.pdbatch : np.pbatch);
+    if (!list)                  // racy, but saves the lock when empty
+	return 0;
+    np.lock.acquire();
+    WritablePacket *head = list;
+    if (head) {
+	list = static_cast<WritablePacket *>(head->prev());
+	count = head->anno_u32(0);
+	--(data ? np.npdbatch : np.npbatch);
+	(data ? np.nbuffers : np.npackets) -= count;
+    }
+    np.lock.release();
+    return head;
+}
+
+/** @brief Free a list of pool packets linked by next().
+ *
+ * Arena packets cannot be freed: they are returned as a new list, with its
+ * length in @a count. */
+static WritablePacket *
+free_pool_list(WritablePacket *head, bool data, unsigned &count)
+{
+    WritablePacket *kept = 0;
+    count = 0;
+    while (WritablePacket *p = head) {
+	head = static_cast<WritablePacket *>(p->next());
+	if (arena_node(p) >= 0 || (data && arena_node(p->buffer()) >= 0)) {
+	    p->set_next(kept);
+	    kept = p;
+	    ++count;
+	    continue;
+	}
+	if (data) {
+#if HAVE_DPDK_PACKET_POOL
+	    rte_pktmbuf_free((struct rte_mbuf*)p->destructor_argument());
+#else
+# if HAVE_NETMAP_PACKET_POOL
+	    if (NetmapBufQ::is_valid_netmap_packet(p))
+		NetmapBufQ::local_pool()->insert_p(p->buffer());
+	    else
+# endif
+		::operator delete[]((unsigned char *) p->buffer());
+#endif
+	}
+	::operator delete((void *) p);
+    }
+    return kept;
+}
 
 /** @brief Return the local packet pool for this thread.
     @pre make_local_packet_pool() has succeeded on this thread. */
@@ -298,20 +589,96 @@ PacketPool* WritablePacket::make_local_packet_pool() {
     PacketPool *pp = thread_packet_pool;
     if (unlikely(!pp && (pp = new PacketPool))) {
 	memset(pp, 0, sizeof(PacketPool));
-	while (atomic_uint32_t::swap(global_packet_pool.lock, 1) == 1)
-	    /* do nothing */;
+	lock_thread_pools();
+#   if HAVE_PACKET_ARENA
+	arena_initialize();
+	pp->node = current_numa_node();
+#   endif
 	pp->thread_pool_next = global_packet_pool.thread_pools;
 	global_packet_pool.thread_pools = pp;
 	thread_packet_pool = pp;
-	click_compiler_fence();
-	global_packet_pool.lock = 0;
+	unlock_thread_pools();
     }
     return pp;
 #  else
+#   if HAVE_PACKET_ARENA
+    if (unlikely(!packet_arena.nnodes))
+	arena_initialize();
+#   endif
     return &global_packet_pool;
 #  endif
 }
 
+/**
+ * Carve up to CLICK_PACKET_POOL_CARVE packets, with data buffers if @a data,
+ * from the arena of @a node.  Returns them linked by next(), with their
+ * number in @a count, or null if the arena cannot grow.
+ */
+WritablePacket *
+WritablePacket::pool_carve(int node, bool data, unsigned &count)
+{
+    count = 0;
+#  if HAVE_PACKET_ARENA
+    const size_t hsize = (sizeof(WritablePacket) + 63) & ~(size_t) 63;
+    const size_t esize = hsize + (data ? CLICK_PACKET_POOL_BUFSIZ : 0);
+    NodePacketPool &np = node_packet_pool(node);
+    np.lock.acquire();
+    if ((size_t) (np.arena_end - np.arena_next) < esize
+	&& !arena_grow(np, node)) {
+	np.lock.release();
+	return 0;
+    }
+    unsigned n = min((size_t) CLICK_PACKET_POOL_CARVE,
+		     (size_t) (np.arena_end - np.arena_next) / esize);
+    unsigned char *x = np.arena_next;
+    np.arena_next += n * esize;
+    np.lock.release();
+
+    WritablePacket *head = 0;
+    for (unsigned i = n; i-- > 0; ) {
+	unsigned char *e = x + i * esize;
+	WritablePacket *p = new(reinterpret_cast<void *>(e)) WritablePacket;
+	if (data) {
+	    p->_head = p->_data = e + hsize;
+	    p->_tail = p->_end = p->_head + CLICK_PACKET_POOL_BUFSIZ;
+	    p->_destructor = 0;
+	    p->_data_packet = 0;
+	}
+	p->set_next(head);
+	head = p;
+    }
+    count = n;
+    return head;
+#  else
+    (void) node, (void) data;
+    return 0;
+#  endif
+}
+
+/**
+ * Refill an empty local pool from the shared pool of its node, or else
+ * from the arena
+ */
+void
+WritablePacket::pool_refill(PacketPool &packet_pool, bool data)
+{
+    int node = pool_node(packet_pool);
+    unsigned count = 0;
+    WritablePacket *head = node_pool_extract(node, data, count);
+    if (!head) {
+	++packet_pool.nmiss;
+	head = pool_carve(node, data, count);
+	packet_pool.nalloc += count;
+    }
+    if (data) {
+	packet_pool.pd = head;
+	packet_pool.pdcount = count;
+    } else {
+	packet_pool.p = head;
+	packet_pool.pcount = count;
+    }
+}
+
 /**
  * Allocate a batch of packets without buffer
  * The returned list is a simple linked list, not a standard PacketBatch
@@ -352,26 +719,18 @@ WritablePacket::pool_allocate()
 {
     PacketPool& packet_pool = *make_local_packet_pool();
 
-#  if HAVE_MULTITHREAD
-    if (!packet_pool.p) {
-        WritablePacket *pp = global_packet_pool.pbatch.extract();
-        if (pp) {
-            packet_pool.p = pp;
-            packet_pool.pcount = pp->anno_u32(0);
-        }
+    if (unlikely(!packet_pool.p))
+        pool_refill(packet_pool, false);
 
-    }
-#  endif /* HAVE_MULTITHREAD */
-
-        WritablePacket *p = packet_pool.p;
-        if (p) {
+    WritablePacket *p = packet_pool.p;
+    if (p) {
         packet_pool.p = static_cast<WritablePacket*>(p->next());
         --packet_pool.pcount;
-        } else {
+    } else {
         p = new WritablePacket;
-        }
-        return p;
-
+        ++packet_pool.nalloc;
+    }
+    return p;
 }
 
 /**
@@ -382,15 +741,8 @@ WritablePacket::pool_data_allocate()
 {
     PacketPool& packet_pool = *make_local_packet_pool();
 
-#  if HAVE_MULTITHREAD
-    if (unlikely(!packet_pool.pd)) {
-        WritablePacket *pd = global_packet_pool.pdbatch.extract();
-        if (pd) {
-            packet_pool.pd = pd;
-            packet_pool.pdcount = pd->anno_u32(0);
-        }
-	}
-#  endif /* HAVE_MULTITHREAD */
+    if (unlikely(!packet_pool.pd))
+        pool_refill(packet_pool, true);
 
     WritablePacket *pd = packet_pool.pd;
     if (pd) {
@@ -399,6 +751,7 @@ WritablePacket::pool_data_allocate()
     } else {
         pd = pool_allocate();
         pd->alloc_data(0,CLICK_PACKET_POOL_BUFSIZ,0);
+        ++packet_pool.nalloc;
     }
     return pd;
 
@@ -430,11 +783,172 @@ WritablePacket::pool_allocate(uint32_t headroom, uint32_t length,
         p = pool_allocate();
         p->alloc_data(headroom,length,tailroom);
         p->initialize();
+        ++local_packet_pool().nalloc;
     }
 
 	return p;
 }
 
+/**
+ * Return the number of packets and data buffers the packet pools had to
+ * allocate because they were empty, summed over all threads
+ */
+uint64_t
+WritablePacket::pool_allocations()
+{
+    uint64_t n = 0;
+#  if HAVE_MULTITHREAD
+    lock_thread_pools();
+    for (PacketPool *pp = global_packet_pool.thread_pools; pp; pp = pp->thread_pool_next)
+        n += pp->nalloc;
+    unlock_thread_pools();
+#  else
+    n = global_packet_pool.nalloc;
+#  endif
+    return n;
+}
+
+/**
+ * Return the number of NUMA nodes the packet pools are split into
+ */
+int
+WritablePacket::pool_nodes()
+{
+#  if HAVE_PACKET_ARENA
+    lock_thread_pools();
+    arena_initialize();
+    unlock_thread_pools();
+    if (packet_arena.nnodes)
+        return packet_arena.nnodes;
+#  endif
+    return 1;
+}
+
+/**
+ * Collect the packet pool statistics of NUMA node @a node.  Free packets
+ * include those in thread pools of the node.
+ */
+void
+WritablePacket::pool_node_stats(int node, PacketPoolStats &s)
+{
+    memset(&s, 0, sizeof(s));
+    if (node < 0 || node >= pool_nodes())
+        return;
+    NodePacketPool &np = node_packet_pool(node);
+    np.lock.acquire();
+    s.packets = np.npackets;
+    s.buffers = np.nbuffers;
+#  if HAVE_PACKET_ARENA
+    s.arena_bytes = np.arena_mapped;
+    s.hugepage_bytes = np.arena_huge;
+#  endif
+    np.lock.release();
+#  if HAVE_MULTITHREAD
+    lock_thread_pools();
+    for (PacketPool *pp = global_packet_pool.thread_pools; pp; pp = pp->thread_pool_next) {
+        if (pp->node == node) {
+            s.packets += pp->pcount;
+            s.buffers += pp->pdcount;
+            s.misses += pp->nmiss;
+            s.cross_node += pp->ncross;
+        }
+        s.buffers += pp->nremote[node];
+    }
+    unlock_thread_pools();
+#  else
+    s.packets += global_packet_pool.pcount;
+    s.buffers += global_packet_pool.pdcount;
+    s.misses += global_packet_pool.nmiss;
+#  endif
+}
+
+unsigned
+WritablePacket::pool_size()
+{
+    return packet_pool_size;
+}
+
+unsigned
+WritablePacket::pool_global_batches()
+{
+    return packet_pool_global_batches;
+}
+
+bool
+WritablePacket::pool_adaptive()
+{
+    return packet_pool_adaptive;
+}
+
+/**
+ * Return how many times the shared pools grew their batch limit
+ */
+unsigned
+WritablePacket::pool_adaptations()
+{
+    return packet_pool_adaptations;
+}
+
+/**
+ * Set the number of free packets, and of free data packets, a thread pool
+ * keeps before giving a batch to its node's shared pool, and the number of
+ * such batches a shared pool keeps before freeing them.  If @a adaptive,
+ * the latter grows when packets would be freed.
+ */
+void
+WritablePacket::pool_set_size(unsigned size, unsigned global_batches, bool adaptive)
+{
+    packet_pool_size = max(size, 1U);
+    packet_pool_global_batches = min(max(global_batches, 1U), (unsigned) CLICK_GLOBAL_PACKET_POOL_MAX);
+    packet_pool_adaptive = adaptive;
+}
+
+/**
+ * Select how the arena maps memory from now on: in slabs of @a slab_size
+ * bytes, a power of two between 2 MB and 1 GB, using hugepages of that size
+ * if @a hugepages.  Returns -EINVAL on a bad size and -EOPNOTSUPP if
+ * pools do not use the arena.
+ */
+int
+WritablePacket::pool_set_arena(bool hugepages, uint32_t slab_size)
+{
+#  if HAVE_PACKET_ARENA
+    if (slab_size < (2U << 20) || slab_size > (1U << 30)
+        || (slab_size & (slab_size - 1)))
+        return -EINVAL;
+    lock_thread_pools();
+    packet_arena.hugepages = hugepages;
+    packet_arena.hugetlb_failed = false;
+    packet_arena.slab_size = slab_size;
+    unlock_thread_pools();
+    return 0;
+#  else
+    (void) hugepages, (void) slab_size;
+    return -EOPNOTSUPP;
+#  endif
+}
+
+/**
+ * Preallocate up to @a count packets with data buffers on NUMA node @a node
+ * and return how many were allocated
+ */
+unsigned
+WritablePacket::pool_reserve(int node, unsigned count)
+{
+    if (node < 0 || node >= pool_nodes())
+        return 0;
+    unsigned done = 0;
+    while (done < count) {
+        unsigned n;
+        WritablePacket *head = pool_carve(node, true, n);
+        if (!head)
+            break;
+        node_pool_insert(node, true, head, n, true);
+        done += n;
+    }
+    return done;
+}
+
 /**
  * Give a hint that some packets from one thread will switch to another thread
  */
@@ -445,63 +959,30 @@ void WritablePacket::pool_transfer(int from, int to) {
 
 inline void
 WritablePacket::check_packet_pool_size(PacketPool &packet_pool) {
-#  if HAVE_MULTITHREAD
-    if (unlikely(packet_pool.p && packet_pool.pcount >= CLICK_PACKET_POOL_SIZE)) {
-        packet_pool.p->set_anno_u32(0, packet_pool.pcount);
-        if (!global_packet_pool.pbatch.insert(packet_pool.p)) { //Si le nombre de batch est au max -> delete
-            while (WritablePacket *p = packet_pool.p) { //On supprime le batch
-                packet_pool.p = static_cast<WritablePacket *>(p->next());
-                ::operator delete((void *) p);
-            }
+    if (unlikely(packet_pool.p && packet_pool.pcount >= packet_pool_size)) {
+        int node = pool_node(packet_pool);
+        if (!node_pool_insert(node, false, packet_pool.p, packet_pool.pcount, false)) {
+            unsigned kept;
+            if (WritablePacket *p = free_pool_list(packet_pool.p, false, kept))
+                node_pool_insert(node, false, p, kept, true);
         }
         packet_pool.p = 0;
         packet_pool.pcount = 0;
     }
-#  else /* !HAVE_MULTITHREAD */
-    if (packet_pool.pcount == CLICK_PACKET_POOL_SIZE) {
-        WritablePacket* tmp = (WritablePacket*)packet_pool.p->next();
-        ::operator delete((void *) packet_pool.p);
-        packet_pool.p = tmp;
-        packet_pool.pcount--;
-    }
-#  endif /* HAVE_MULTITHREAD */
 }
 
 inline void
 WritablePacket::check_data_pool_size(PacketPool &packet_pool) {
-#  if HAVE_MULTITHREAD
-    if (unlikely(packet_pool.pd && packet_pool.pdcount >= CLICK_PACKET_POOL_SIZE)) {
-        packet_pool.pd->set_anno_u32(0, packet_pool.pdcount);
-        if (!global_packet_pool.pdbatch.insert(packet_pool.pd)) {
-            while (WritablePacket *pd = packet_pool.pd) {
-                packet_pool.pd = static_cast<WritablePacket *>(pd->next());
-#if HAVE_DPDK_PACKET_POOL
-                rte_pktmbuf_free((struct rte_mbuf*)pd->destructor_argument());
-#else
-# if HAVE_NETMAP_PACKET_POOL
-                if (NetmapBufQ::is_valid_netmap_packet(pd))
-                    NetmapBufQ::local_pool()->insert_p(pd->buffer());
-                else
-# endif
-                {
-                    ::operator delete[]((unsigned char *) pd->buffer());
-                }
-#endif
-                ::operator delete((void *) pd);
-            }
+    if (unlikely(packet_pool.pd && packet_pool.pdcount >= packet_pool_size)) {
+        int node = pool_node(packet_pool);
+        if (!node_pool_insert(node, true, packet_pool.pd, packet_pool.pdcount, false)) {
+            unsigned kept;
+            if (WritablePacket *pd = free_pool_list(packet_pool.pd, true, kept))
+                node_pool_insert(node, true, pd, kept, true);
         }
         packet_pool.pd = 0;
         packet_pool.pdcount = 0;
     }
-
-#  else /* !HAVE_MULTITHREAD */
-    if (packet_pool.pdcount == CLICK_PACKET_POOL_SIZE) {
-        WritablePacket* tmp = (WritablePacket*)packet_pool.pd->next();
-        ::operator delete((void *) packet_pool.pd);
-        packet_pool.pd = tmp;
-        packet_pool.pdcount--;
-    }
-#  endif /* HAVE_MULTITHREAD */
 }
 
 inline bool WritablePacket::is_from_data_pool(WritablePacket *p) {
@@ -525,6 +1006,27 @@ inline bool WritablePacket::is_from_data_pool(WritablePacket *p) {
 
 }
 
+/**
+ * Keep a data packet whose buffer belongs to NUMA node @a node, which is
+ * not this thread's, and send it home with others once there are enough
+ */
+void
+WritablePacket::recycle_remote(PacketPool &packet_pool, WritablePacket *p, int node)
+{
+#  if HAVE_MULTITHREAD
+    ++packet_pool.ncross;
+    p->set_next(packet_pool.remote[node]);
+    packet_pool.remote[node] = p;
+    if (++packet_pool.nremote[node] >= CLICK_PACKET_POOL_REMOTE_BATCH) {
+        node_pool_insert(node, true, packet_pool.remote[node], packet_pool.nremote[node], true);
+        packet_pool.remote[node] = 0;
+        packet_pool.nremote[node] = 0;
+    }
+#  else
+    (void) packet_pool, (void) p, (void) node;
+#  endif
+}
+
 /**
  * @Precond _use_count == 1
  */
@@ -535,12 +1037,19 @@ WritablePacket::recycle(WritablePacket *p)
     bool data = is_from_data_pool(p);
 
     if (likely(data)) {
+#  if HAVE_MULTITHREAD
+        int node = arena_node(p->buffer());
+        if (unlikely(node >= 0 && node != packet_pool.node)) {
+            recycle_remote(packet_pool, p, node);
+            return;
+        }
+#  endif
         check_data_pool_size(packet_pool);
         ++packet_pool.pdcount;
         p->set_next(packet_pool.pd);
         packet_pool.pd = p;
 #if !HAVE_BATCH_RECYCLE
-        assert(packet_pool.pdcount <= CLICK_PACKET_POOL_SIZE);
+        assert(packet_pool.pdcount <= packet_pool_size);
 #endif
     } else {
         p->~WritablePacket();
@@ -549,7 +1058,7 @@ WritablePacket::recycle(WritablePacket *p)
         p->set_next(packet_pool.p);
         packet_pool.p = p;
 #if !HAVE_BATCH_RECYCLE
-        assert(packet_pool.pcount <= CLICK_PACKET_POOL_SIZE);
+        assert(packet_pool.pcount <= packet_pool_size);
 #endif
     }
 
@@ -581,6 +1090,34 @@ void
 WritablePacket::recycle_data_batch(WritablePacket *head, Packet* tail, unsigned count)
 {
     PacketPool& packet_pool = *make_local_packet_pool();
+#  if HAVE_MULTITHREAD
+    // Any buffer of the batch may come from another node: check them all
+    // before splicing the batch into the local pool.
+    bool remote = false;
+    WritablePacket *p = head;
+    for (unsigned n = count; n > 0 && !remote; --n) {
+        int node = arena_node(p->buffer());
+        remote = node >= 0 && node != packet_pool.node;
+        p = static_cast<WritablePacket*>(p->next());
+    }
+    if (unlikely(remote)) {
+        p = head;
+        for (; count > 0; --count) {
+            WritablePacket *next = static_cast<WritablePacket*>(p->next());
+            int node = arena_node(p->buffer());
+            if (node >= 0 && node != packet_pool.node)
+                recycle_remote(packet_pool, p, node);
+            else {
+                check_data_pool_size(packet_pool);
+                ++packet_pool.pdcount;
+                p->set_next(packet_pool.pd);
+                packet_pool.pd = p;
+            }
+            p = next;
+        }
+        return;
+    }
+#  endif
     check_data_pool_size(packet_pool);
     packet_pool.pdcount += count;
     tail->set_next(packet_pool.pd);
@@ -981,7 +1518,7 @@ Packet::expensive_uniqueify(int32_t extra_headroom, int32_t extra_tailroom,
         return 0;
     }
 
-    uint8_t *old_head = _head, *old_end = _end;
+    uint8_t *old_head = _head, *old_tail = _tail, *old_end = _end;
     int headroom = this->headroom();
     int length = this->length();
     uint8_t* new_head = p->_head;
@@ -990,6 +1527,7 @@ Packet::expensive_uniqueify(int32_t extra_headroom, int32_t extra_tailroom,
         buffer_destructor_type desc = p->_destructor;
         void* arg = p->_destructor_argument;
 #endif
+    WritablePacket* spare = 0;
     if (_use_count > 1) {
         memcpy(p, this, sizeof(Packet));
 
@@ -999,9 +1537,7 @@ Packet::expensive_uniqueify(int32_t extra_headroom, int32_t extra_tailroom,
             p->_m = m;
         # endif
     } else {
-        p->_head = NULL;
-        p->_data_packet = NULL; //packet from pool_data_allocate can be dirty
-        WritablePacket::recycle(p);
+        spare = p;
         p = (WritablePacket*)this;
     }
 
@@ -1014,23 +1550,46 @@ Packet::expensive_uniqueify(int32_t extra_headroom, int32_t extra_tailroom,
 		struct mbuf *old_m = _m;
 	# endif
 
+    // Copy the headroom, which may hold stripped headers, and the data, but
+    // not the tailroom: that keeps the cost of writing to a clone
+    // proportional to the packet, not to the buffer. A negative
+    // extra_tailroom shrinks the new buffer, so never copy past its end.
     unsigned char *start_copy = old_head + (extra_headroom >= 0 ? 0 : -extra_headroom);
-    unsigned char *end_copy = old_end + (extra_tailroom >= 0 ? 0 : extra_tailroom);
+    unsigned char *end_copy = old_end + extra_tailroom;
+    if (end_copy > old_tail)
+        end_copy = old_tail;
     memcpy(p->_head + (extra_headroom >= 0 ? extra_headroom : 0), start_copy, end_copy - start_copy);
 
     // free old data
-    if (_data_packet)
+    unsigned char *free_head = 0;
+    if (!spare)
+      kill(); // clones still use the old data: just drop our reference
+    else if (_data_packet)
       _data_packet->kill();
 # if CLICK_USERLEVEL || CLICK_MINIOS
     else if (_destructor) {
       _destructor(old_head, old_end - old_head, _destructor_argument);
     } else
-      delete[] old_head;
+      free_head = old_head;
+    if (spare) {
+        // A pool buffer goes back to the pool with the spare packet.
+        if (free_head && old_end - free_head == CLICK_PACKET_POOL_BUFSIZ) {
+            spare->_head = spare->_data = free_head;
+            spare->_tail = spare->_end = old_end;
+            spare->_destructor = 0;
+        } else {
+            if (free_head && arena_node(free_head) < 0)
+                delete[] free_head;
+            spare->_head = NULL;
+        }
+        spare->_data_packet = NULL; //packet from pool_data_allocate can be dirty
+        WritablePacket::recycle(spare);
+    }
 # if HAVE_DPDK_PACKET_POOL
       p->_destructor = desc;
       p->_destructor_argument = arg;
 #  else
-      _destructor = 0;
+      p->_destructor = 0;
 # endif
 
 # elif CLICK_BSDMODULE
@@ -1227,30 +1786,26 @@ Packet::shift_data(int offset, bool free_on_failure)
 }
 
 #if HAVE_CLICK_PACKET_POOL
+static unsigned
+list_length(WritablePacket *p)
+{
+    unsigned n = 0;
+    for (; p; p = static_cast<WritablePacket *>(p->next()))
+	++n;
+    return n;
+}
+
 static void
 cleanup_pool(PacketPool *pp, int global)
 {
-    unsigned pcount = 0, pdcount = 0;
-    while (WritablePacket *p = pp->p) {
-	++pcount;
-	pp->p = static_cast<WritablePacket *>(p->next());
-	::operator delete((void *) p);
-    }
-    while (WritablePacket *pd = pp->pd) {
-    ++pdcount;
-    pp->pd = static_cast<WritablePacket *>(pd->next());
-#if HAVE_DPDK_PACKET_POOL
-    rte_pktmbuf_free((struct rte_mbuf*)pd->destructor_argument());
-#elif HAVE_NETMAP_PACKET_POOL
-    NetmapBufQ::local_pool()->insert_p(pd->buffer());
-#else
-	delete[] reinterpret_cast<unsigned char *>(pd->buffer());
-#endif
-    ::operator delete((void *) pd);
-    }
+    unsigned pcount = list_length(pp->p), pdcount = list_length(pp->pd);
+    unsigned kept;
+    free_pool_list(pp->p, false, kept);
+    free_pool_list(pp->pd, true, kept);
+    pp->p = pp->pd = 0;
 #if !HAVE_BATCH_RECYCLE
-    assert(pcount <= CLICK_PACKET_POOL_SIZE);
-    assert(pdcount <= CLICK_PACKET_POOL_SIZE);
+    assert(global || pcount <= packet_pool_size);
+    assert(global || pdcount <= packet_pool_size);
 #endif
     assert(global || (pcount == pp->pcount && pdcount == pp->pdcount));
 }
@@ -1264,19 +1819,29 @@ Packet::static_cleanup()
 		while (PacketPool* pp = global_packet_pool.thread_pools) {
 		global_packet_pool.thread_pools = pp->thread_pool_next;
 		cleanup_pool(pp, 0);
+		for (int n = 0; n < CLICK_PACKET_POOL_MAX_NODES; ++n) {
+			unsigned kept;
+			free_pool_list(pp->remote[n], true, kept);
+		}
 		delete pp;
 		}
-
-		PacketPool fake_pool;
-		do {
-			fake_pool.p = global_packet_pool.pbatch.extract();
-			fake_pool.pd = global_packet_pool.pdbatch.extract();
-			if (!fake_pool.p && !fake_pool.pd) break;
-			cleanup_pool(&fake_pool, 1);
-		} while(true);
 	# else
 		cleanup_pool(&global_packet_pool, 0);
 	# endif
+
+		// arena packets stay mapped until exit
+		PacketPool fake_pool;
+		memset(&fake_pool, 0, sizeof(fake_pool));
+		for (int n = 0; n < CLICK_PACKET_POOL_MAX_NODES; ++n) {
+			unsigned count;
+			while ((fake_pool.p = node_pool_extract(n, false, count)))
+				cleanup_pool(&fake_pool, 1);
+			while ((fake_pool.pd = node_pool_extract(n, true, count)))
+				cleanup_pool(&fake_pool, 1);
+#  if !HAVE_MULTITHREAD
+			break;
+#  endif
+		}
 #endif
 }
 
@@ -0,0 +1,197 @@
+// -*- c-basic-offset: 4; related-file-name: "../include/click/perfevents.hh" -*-
+/*
+ * perfevents.{cc,hh} -- per-thread hardware performance counters
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Click LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Click LICENSE file; the license in that file is
+ * legally binding.
+ */
+
+#include <click/config.h>
+#include <click/perfevents.hh>
+#include <click/straccum.hh>
+#include <click/confparse.hh>
+#include <click/error.hh>
+#if HAVE_PERF_EVENTS
+# include <sys/syscall.h>
+# include <sys/mman.h>
+# include <unistd.h>
+# include <errno.h>
+#endif
+CLICK_DECLS
+
+volatile int PerfEvents::_nevents;
+int PerfEvents::_generation;
+int PerfEvents::_event_ids[max_events];
+PerfEvents::thread_state *PerfEvents::_threads;
+unsigned PerfEvents::_nthreads;
+
+#if HAVE_PERF_EVENTS
+static const struct {
+    const char *name;
+    uint32_t type;
+    uint64_t config;
+} event_types[] = {
+    { "cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+    { "instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+    { "cache-references", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_REFERENCES },
+    { "cache-misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+    { "branches", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_INSTRUCTIONS },
+    { "branch-misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+    { "l1d-misses", PERF_TYPE_HW_CACHE,
+      PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+      | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+    { "llc-misses", PERF_TYPE_HW_CACHE,
+      PERF_COUNT_HW_CACHE_LL | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+      | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) }
+};
+#endif
+
+const char *
+PerfEvents::event_name(int i)
+{
+#if HAVE_PERF_EVENTS
+    if (i >= 0 && i < _nevents)
+	return event_types[_event_ids[i]].name;
+#else
+    (void) i;
+#endif
+    return "";
+}
+
+String
+PerfEvents::unparse()
+{
+    StringAccum sa;
+    for (int i = 0; i < _nevents; ++i)
+	sa << (i ? " " : "") << event_name(i);
+    return sa.take_string();
+}
+
+int
+PerfEvents::set_events(const String &str, ErrorHandler *errh)
+{
+#if HAVE_PERF_EVENTS
+    Vector<String> words;
+    cp_spacevec(str, words);
+    if (words.size() > max_events)
+	return errh->error("at most %d events can be counted", (int) max_events);
+    int ids[max_events];
+    for (int i = 0; i < words.size(); ++i) {
+	ids[i] = -1;
+	for (int j = 0; j < (int) (sizeof(event_types) / sizeof(event_types[0])); ++j)
+	    if (words[i] == event_types[j].name)
+		ids[i] = j;
+	if (ids[i] < 0)
+	    return errh->error("unknown event %<%s%>", words[i].c_str());
+    }
+
+    if (!_threads) {
+	_nthreads = click_max_cpu_ids();
+	_threads = new thread_state[_nthreads];
+	for (unsigned t = 0; t < _nthreads; ++t) {
+	    _threads[t].generation = 0;
+	    for (int i = 0; i < max_events; ++i) {
+		_threads[t].fd[i] = -1;
+		_threads[t].page[i] = 0;
+	    }
+	}
+    }
+
+    // threads reopen their counters once they see the new generation
+    _nevents = 0;
+    click_compiler_fence();
+    for (int i = 0; i < words.size(); ++i)
+	_event_ids[i] = ids[i];
+    ++_generation;
+    click_compiler_fence();
+    _nevents = words.size();
+
+    // check that this thread at least can count
+    unsigned tid = click_current_cpu_id();
+    if (_nevents && tid < _nthreads) {
+	open_thread(_threads[tid]);
+	for (int i = 0; i < _nevents; ++i)
+	    if (_threads[tid].fd[i] < 0) {
+		int err = -_threads[tid].fd[i];
+		_nevents = 0;
+		++_generation;
+		close_thread(_threads[tid]);
+		return errh->error("cannot count %<%s%>: %s", words[i].c_str(), strerror(err));
+	    }
+    }
+    return 0;
+#else
+    if (str)
+	return errh->error("hardware performance counters not supported");
+    return 0;
+#endif
+}
+
+void
+PerfEvents::close_thread(thread_state &ts)
+{
+#if HAVE_PERF_EVENTS
+    for (int i = 0; i < max_events; ++i) {
+	if (ts.page[i])
+	    munmap(ts.page[i], sysconf(_SC_PAGESIZE));
+	if (ts.fd[i] >= 0)
+	    close(ts.fd[i]);
+	ts.page[i] = 0;
+	ts.fd[i] = -1;
+    }
+#else
+    (void) ts;
+#endif
+}
+
+void
+PerfEvents::open_thread(thread_state &ts)
+{
+#if HAVE_PERF_EVENTS
+    close_thread(ts);
+    ts.generation = _generation;
+    for (int i = 0; i < _nevents; ++i) {
+	struct perf_event_attr attr;
+	memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.type = event_types[_event_ids[i]].type;
+	attr.config = event_types[_event_ids[i]].config;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	// count this thread only, on whatever CPU it runs
+	int fd = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+	if (fd < 0) {
+	    ts.fd[i] = -errno;
+	    continue;
+	}
+	ts.fd[i] = fd;
+	void *page = mmap(0, sysconf(_SC_PAGESIZE), PROT_READ, MAP_SHARED, fd, 0);
+	if (page != MAP_FAILED)
+	    ts.page[i] = page;
+    }
+#else
+    (void) ts;
+#endif
+}
+
+uint64_t
+PerfEvents::read_slow(const thread_state &ts, int i)
+{
+#if HAVE_PERF_EVENTS
+    uint64_t value;
+    if (ts.fd[i] >= 0 && ::read(ts.fd[i], &value, sizeof(value)) == sizeof(value))
+	return value;
+#else
+    (void) ts, (void) i;
+#endif
+    return 0;
+}
+
+CLICK_ENDDECLS
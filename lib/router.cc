@@ -1309,7 +1309,16 @@ Router::activate(bool foreground, ErrorHandler *errh)
         return;
 
     // Take state if appropriate
-    if (_hotswap_router && _hotswap_router->_state == ROUTER_LIVE) {
+    bool hotswap = _hotswap_router && _hotswap_router->_state == ROUTER_LIVE;
+#if HAVE_MULTITHREAD
+    // The old router's threads must not add or expire state while this
+    // router takes it, nor between then and the switch to this router.
+    // Block them until this router runs.  (Hotswap callers never run on a
+    // Click thread.)
+    if (hotswap)
+        master()->block_all();
+#endif
+    if (hotswap) {
         // Unschedule tasks and timers
         master()->kill_router(_hotswap_router);
 
@@ -1329,18 +1338,57 @@ Router::activate(bool foreground, ErrorHandler *errh)
     // Activate router
     master()->run_router(this, foreground);
     // sets _running to RUNNING_BACKGROUND or RUNNING_ACTIVE
+#if HAVE_MULTITHREAD
+    if (hotswap)
+        master()->unblock_all();
+#endif
 }
 
 
 // steal state
 
+void
+Router::hotswap_signatures(Vector<String> &sig) const
+{
+    Vector<Vector<String> > conns(nelements(), Vector<String>());
+    for (const Connection *it = _conn.begin(); it != _conn.end(); ++it) {
+        const Port &to = (*it)[0], &from = (*it)[1];
+        conns[from.idx].push_back("[" + String(from.port) + "] -> " + _element_names[to.idx] + " [" + String(to.port) + "]");
+        conns[to.idx].push_back("[" + String(to.port) + "] <- " + _element_names[from.idx] + " [" + String(from.port) + "]");
+    }
+
+    sig.assign(nelements(), String());
+    for (int i = 0; i < nelements(); ++i) {
+        StringAccum sa;
+        sa << _elements[i]->class_name() << '\n' << _element_configurations[i] << '\n';
+        if (conns[i].size())
+            click_qsort(conns[i].begin(), conns[i].size());
+        for (int j = 0; j < conns[i].size(); ++j)
+            sa << conns[i][j] << '\n';
+        sig[i] = sa.take_string();
+    }
+}
+
+/** @brief Set the router this router will replace when activated.
+ *
+ * Also compares the two configurations; see hotswap_unchanged(). */
 void
 Router::set_hotswap_router(Router *r)
 {
     assert(_state == ROUTER_NEW && !_hotswap_router && (!r || r->initialized()));
     _hotswap_router = r;
-    if (_hotswap_router)
+    _hotswap_unchanged.clear();
+    if (_hotswap_router) {
         _hotswap_router->use();
+
+        Vector<String> sig, old_sig;
+        hotswap_signatures(sig);
+        r->hotswap_signatures(old_sig);
+        _hotswap_unchanged.assign(nelements(), false);
+        for (int i = 0; i < nelements(); ++i)
+            if (Element *e = r->find(_element_names[i]))
+                _hotswap_unchanged[i] = (sig[i] == old_sig[e->eindex()]);
+    }
 }
 
 
@@ -2253,13 +2301,124 @@ Router::configuration_string() const
 enum { GH_VERSION, GH_CONFIG, GH_FLATCONFIG, GH_LIST, GH_REQUIREMENTS,
        GH_DRIVER, GH_ACTIVE_PORTS, GH_ACTIVE_PORT_STATS, GH_STRING_PROFILE,
        GH_STRING_PROFILE_LONG, GH_SCHEDULING_PROFILE, GH_STOP,
-       GH_ELEMENT_CYCLES, GH_CLASS_CYCLES, GH_RESET_CYCLES };
+       GH_ELEMENT_CYCLES, GH_CLASS_CYCLES, GH_RESET_CYCLES,
+       GH_THREAD_CYCLES, GH_FLAMEGRAPH, GH_PROFILE_EVENTS,
+       GH_PACKET_ALLOCATIONS, GH_HOTSWAP_UNCHANGED };
 
 #if CLICK_STATS >= 2
 struct stats_info {
     click_cycles_t task_own_cycles, timer_own_cycles, xfer_own_cycles;
-    uint32_t task_calls, timer_calls, xfer_calls, nelements;
+    uint64_t task_calls, timer_calls, xfer_calls, nelements;
+    uint64_t xfer_batches, xfer_packets;
 };
+
+static void
+unparse_stats_columns(StringAccum &sa, uint64_t task_calls, click_cycles_t task_cycles,
+                      uint64_t timer_calls, click_cycles_t timer_cycles,
+                      uint64_t xfer_calls, click_cycles_t xfer_cycles,
+                      uint64_t xfer_batches, uint64_t xfer_packets)
+{
+    sa << task_calls << ','
+       << task_cycles << ','
+       << Element::stats_divide(task_cycles, task_calls) << ','
+       << timer_calls << ','
+       << timer_cycles << ','
+       << Element::stats_divide(timer_cycles, timer_calls) << ','
+       << xfer_calls << ','
+       << xfer_cycles << ','
+       << Element::stats_divide(xfer_cycles, xfer_calls) << ',';
+    click_cycles_t any_cycles = task_cycles + timer_cycles + xfer_cycles;
+    uint64_t any_calls = task_calls + timer_calls + xfer_calls;
+    sa << any_cycles << ','
+       << Element::stats_divide(any_cycles, any_calls) << ','
+       << xfer_batches << ','
+       << xfer_packets << ','
+       << Element::stats_divide(xfer_cycles, xfer_packets);
+}
+
+static const char stats_columns[] = "task_calls,task_cycles,cycles_per_task,timer_calls,timer_cycles,cycles_per_timer,xfer_calls,xfer_cycles,cycles_per_xfer,any_cycles,cycles_per_any,xfer_batches,xfer_packets,cycles_per_packet";
+
+struct flamegraph_state {
+    Router *r;
+    Vector<Element::stats_type> stats;
+    Vector<uint64_t> in_weight;
+    Vector<Vector<Pair<int, uint64_t> > > calls;
+    Vector<int> path;
+    StringAccum sa;
+
+    void emit(double cycles) {
+        if (cycles < 1)
+            return;
+        for (int i = 0; i < path.size(); ++i)
+            sa << (i ? ";" : "") << r->ename(path[i]);
+        sa << ' ' << (uint64_t) cycles << '\n';
+    }
+    void walk(int ei, double factor) {
+        const Vector<Pair<int, uint64_t> > &c = calls[ei];
+        for (int i = 0; i < c.size(); ++i) {
+            int callee = c[i].first;
+            // task elements run their output in their own context, and
+            // cycles in the graph are cut
+            if (path.size() >= 64 || find(path.begin(), path.end(), callee) != path.end())
+                continue;
+            double f = factor * c[i].second / in_weight[callee];
+            path.push_back(callee);
+            emit(stats[callee].xfer_own_cycles * f);
+            if (!stats[callee].task_calls && f * stats[callee].child_cycles >= 1)
+                walk(callee, f);
+            path.pop_back();
+        }
+    }
+};
+
+// Produce folded stacks for flame graph tools.  Each element's own transfer
+// cycles are split among the call paths reaching it, in proportion to the
+// packets sent over each connection; tasks, timers, and elements never
+// called by others are the roots.
+static String
+unparse_flamegraph(Router *r)
+{
+    flamegraph_state fs;
+    fs.r = r;
+    int n = r->nelements();
+    fs.stats.resize(n);
+    fs.in_weight.resize(n, 0);
+    fs.calls.resize(n);
+    for (int ei = 0; ei < n; ++ei)
+        r->element(ei)->sum_stats(fs.stats[ei]);
+
+    for (int ei = 0; ei < n; ++ei) {
+        Element *e = r->element(ei);
+        for (int o = 0; o < e->noutputs(); ++o)
+            if (e->output_is_push(o) && e->output(o).npackets()) {
+                int callee = e->output(o).element()->eindex();
+                fs.calls[ei].push_back(make_pair(callee, (uint64_t) e->output(o).npackets()));
+                fs.in_weight[callee] += e->output(o).npackets();
+            }
+        for (int i = 0; i < e->ninputs(); ++i)
+            if (e->input_is_pull(i) && e->input(i).npackets()) {
+                int callee = e->input(i).element()->eindex();
+                fs.calls[ei].push_back(make_pair(callee, (uint64_t) e->input(i).npackets()));
+                fs.in_weight[callee] += e->input(i).npackets();
+            }
+    }
+
+    for (int ei = 0; ei < n; ++ei) {
+        const Element::stats_type &s = fs.stats[ei];
+        bool root = s.task_calls || !fs.in_weight[ei];
+        double own = s.task_own_cycles + s.timer_own_cycles;
+        if (!fs.in_weight[ei])
+            own += s.xfer_own_cycles;
+        if (!root && !s.timer_calls)
+            continue;
+        fs.path.push_back(ei);
+        fs.emit(own);
+        if (root)
+            fs.walk(ei, 1);
+        fs.path.pop_back();
+    }
+    return fs.sa.take_string();
+}
 #endif
 
 String
@@ -2290,6 +2449,13 @@ Router::router_read_handler(Element *e, void *thunk)
         }
         break;
 
+      case GH_HOTSWAP_UNCHANGED:
+        if (r)
+            for (int i = 0; i < r->_hotswap_unchanged.size(); i++)
+                if (r->_hotswap_unchanged[i])
+                    sa << r->_element_names[i] << "\n";
+        break;
+
       case GH_REQUIREMENTS:
         if (r)
             for (int i = 0; i < r->_requirements.size(); i++)
@@ -2360,26 +2526,56 @@ Router::router_read_handler(Element *e, void *thunk)
     case GH_ELEMENT_CYCLES:
         if (!r)
             break;
-        sa << "name,class,task_calls,task_cycles,cycles_per_task,timer_calls,timer_cycles,cycles_per_timer,xfer_calls,xfer_cycles,cycles_per_xfer,any_cycles,cycles_per_any\n";
+        sa << "name,class," << stats_columns;
+        for (int j = 0; j < PerfEvents::nevents(); ++j)
+            sa << ',' << PerfEvents::event_name(j);
+        sa << '\n';
         for (int ei = 0; ei < r->nelements(); ++ei) {
             Element *e = r->element(ei);
-            if (!(e->_task_own_cycles || e->_timer_own_cycles || e->_xfer_own_cycles))
+            Element::stats_type st;
+            e->sum_stats(st);
+            if (!(st.task_own_cycles || st.timer_own_cycles || st.xfer_own_cycles))
                 continue;
             sa << r->_element_names[ei] << ','
-               << e->class_name() << ','
-               << e->_task_calls << ','
-               << e->_task_own_cycles << ','
-               << int_divide(e->_task_own_cycles, e->_task_calls ? e->_task_calls : 1) << ','
-               << e->_timer_calls << ','
-               << e->_timer_own_cycles << ','
-               << int_divide(e->_timer_own_cycles, e->_timer_calls ? e->_timer_calls : 1) << ','
-               << e->_xfer_calls << ','
-               << e->_xfer_own_cycles << ','
-               << int_divide(e->_xfer_own_cycles, e->_xfer_calls ? e->_xfer_calls : 1) << ',';
-            click_cycles_t any_cycles = e->_task_own_cycles + e->_timer_own_cycles + e->_xfer_own_cycles;
-            uint32_t any_calls = e->_task_calls + e->_timer_calls + e->_xfer_calls;
-            sa << any_cycles << ','
-               << int_divide(any_cycles, any_calls ? any_calls : 1) << '\n';
+               << e->class_name() << ',';
+            unparse_stats_columns(sa, st.task_calls, st.task_own_cycles,
+                                  st.timer_calls, st.timer_own_cycles,
+                                  st.xfer_calls, st.xfer_own_cycles,
+                                  st.xfer_batches, st.xfer_packets);
+# if HAVE_PERF_EVENTS
+            for (int j = 0; j < PerfEvents::nevents(); ++j)
+                sa << ',' << st.xfer_own_events[j];
+# endif
+            sa << '\n';
+        }
+        break;
+
+    case GH_THREAD_CYCLES:
+        if (!r)
+            break;
+        sa << "name,class,thread," << stats_columns;
+        for (int j = 0; j < PerfEvents::nevents(); ++j)
+            sa << ',' << PerfEvents::event_name(j);
+        sa << '\n';
+        for (int ei = 0; ei < r->nelements(); ++ei) {
+            Element *e = r->element(ei);
+            for (unsigned t = 0; t < e->_stats.weight(); ++t) {
+                const Element::stats_type &st = e->_stats.get_value(t);
+                if (!(st.task_own_cycles || st.timer_own_cycles || st.xfer_own_cycles))
+                    continue;
+                sa << r->_element_names[ei] << ','
+                   << e->class_name() << ','
+                   << t << ',';
+                unparse_stats_columns(sa, st.task_calls, st.task_own_cycles,
+                                      st.timer_calls, st.timer_own_cycles,
+                                      st.xfer_calls, st.xfer_own_cycles,
+                                      st.xfer_batches, st.xfer_packets);
+# if HAVE_PERF_EVENTS
+                for (int j = 0; j < PerfEvents::nevents(); ++j)
+                    sa << ',' << st.xfer_own_events[j];
+# endif
+                sa << '\n';
+            }
         }
         break;
 
@@ -2388,9 +2584,12 @@ Router::router_read_handler(Element *e, void *thunk)
             break;
         HashTable<String, int> class_map(-1);
         int nclasses = 0;
+        Vector<Element::stats_type> est(r->nelements(), Element::stats_type());
         for (int ei = 0; ei < r->nelements(); ++ei) {
             Element *e = r->element(ei);
-            if (!(e->_task_own_cycles || e->_timer_own_cycles || e->_xfer_own_cycles))
+            Element::stats_type &st = est[ei];
+            e->sum_stats(st);
+            if (!(st.task_own_cycles || st.timer_own_cycles || st.xfer_own_cycles))
                 continue;
             int &x = class_map[e->class_name()];
             if (x < 0)
@@ -2401,43 +2600,52 @@ Router::router_read_handler(Element *e, void *thunk)
         memset(si, 0, sizeof(stats_info) * nclasses);
         for (int ei = 0; ei < r->nelements(); ++ei) {
             Element *e = r->element(ei);
+            Element::stats_type &st = est[ei];
             int x = class_map.get(e->class_name());
-            if (!(e->_task_own_cycles || e->_timer_own_cycles || e->_xfer_own_cycles) || x < 0)
+            if (!(st.task_own_cycles || st.timer_own_cycles || st.xfer_own_cycles) || x < 0)
                 continue;
             stats_info &sii = si[x];
-            sii.task_own_cycles += e->_task_own_cycles;
-            sii.task_calls += e->_task_calls;
-            sii.timer_own_cycles += e->_timer_own_cycles;
-            sii.timer_calls += e->_timer_calls;
-            sii.xfer_own_cycles += e->_xfer_own_cycles;
-            sii.xfer_calls += e->_xfer_calls;
+            sii.task_own_cycles += st.task_own_cycles;
+            sii.task_calls += st.task_calls;
+            sii.timer_own_cycles += st.timer_own_cycles;
+            sii.timer_calls += st.timer_calls;
+            sii.xfer_own_cycles += st.xfer_own_cycles;
+            sii.xfer_calls += st.xfer_calls;
+            sii.xfer_batches += st.xfer_batches;
+            sii.xfer_packets += st.xfer_packets;
             sii.nelements += 1;
         }
 
-        sa << "class,nelements,task_calls,task_cycles,cycles_per_task,timer_calls,timer_cycles,cycles_per_timer,xfer_calls,xfer_cycles,cycles_per_xfer,any_cycles,cycles_per_any\n";
+        sa << "class,nelements," << stats_columns << '\n';
         for (HashTable<String, int>::iterator it = class_map.begin();
              it != class_map.end(); ++it) {
             stats_info &sii = si[it.value()];
             sa << it.key() << ','
-               << sii.nelements << ','
-               << sii.task_calls << ','
-               << sii.task_own_cycles << ','
-               << int_divide(sii.task_own_cycles, sii.task_calls ? sii.task_calls : 1) << ','
-               << sii.timer_calls << ','
-               << sii.timer_own_cycles << ','
-               << int_divide(sii.timer_own_cycles, sii.timer_calls ? sii.timer_calls : 1) << ','
-               << sii.xfer_calls << ','
-               << sii.xfer_own_cycles << ','
-               << int_divide(sii.xfer_own_cycles, sii.xfer_calls ? sii.xfer_calls : 1) << ',';
-            click_cycles_t any_cycles = sii.task_own_cycles + sii.timer_own_cycles + sii.xfer_own_cycles;
-            uint32_t any_calls = sii.task_calls + sii.timer_calls + sii.xfer_calls;
-            sa << any_cycles << ','
-               << int_divide(any_cycles, any_calls ? any_calls : 1) << '\n';
+               << sii.nelements << ',';
+            unparse_stats_columns(sa, sii.task_calls, sii.task_own_cycles,
+                                  sii.timer_calls, sii.timer_own_cycles,
+                                  sii.xfer_calls, sii.xfer_own_cycles,
+                                  sii.xfer_batches, sii.xfer_packets);
+            sa << '\n';
         }
 
         delete[] si;
         break;
     }
+
+    case GH_FLAMEGRAPH:
+        if (r)
+            return unparse_flamegraph(r);
+        break;
+
+    case GH_PROFILE_EVENTS:
+        return PerfEvents::unparse();
+#endif
+
+#if HAVE_CLICK_PACKET_POOL
+    case GH_PACKET_ALLOCATIONS:
+        sa << WritablePacket::pool_allocations();
+        break;
 #endif
 
     }
@@ -2465,6 +2673,13 @@ Router::router_write_handler(const String &s, Element *e, void *thunk, ErrorHand
         for (int i = 0; i < (r ? r->nelements() : 0); i++)
             r->_elements[i]->reset_cycles();
         break;
+    case GH_PROFILE_EVENTS:
+        // restart the counts so that event totals are comparable
+        if (PerfEvents::set_events(s, errh) < 0)
+            return -1;
+        for (int i = 0; i < (r ? r->nelements() : 0); i++)
+            r->_elements[i]->reset_cycles();
+        break;
 #endif
     default:
         break;
@@ -2484,6 +2699,7 @@ Router::static_initialize()
         add_read_handler(0, "requirements", router_read_handler, (void *)GH_REQUIREMENTS);
         add_read_handler(0, "handlers", Element::read_handlers_handler, 0);
         add_read_handler(0, "list", router_read_handler, (void *)GH_LIST);
+        add_read_handler(0, "hotswap_unchanged", router_read_handler, (void *)GH_HOTSWAP_UNCHANGED);
         add_write_handler(0, "stop", router_write_handler, (void *)GH_STOP);
 #if CLICK_STATS >= 1
         add_read_handler(0, "active_ports", router_read_handler, (void *)GH_ACTIVE_PORTS);
@@ -2502,6 +2718,13 @@ Router::static_initialize()
         add_read_handler(0, "element_cycles.csv", router_read_handler, (void *)GH_ELEMENT_CYCLES);
         add_read_handler(0, "class_cycles.csv", router_read_handler, (void *)GH_CLASS_CYCLES);
         add_write_handler(0, "reset_cycles", router_write_handler, (void *)GH_RESET_CYCLES);
+        add_read_handler(0, "thread_cycles.csv", router_read_handler, (void *)GH_THREAD_CYCLES);
+        add_read_handler(0, "flamegraph", router_read_handler, (void *)GH_FLAMEGRAPH);
+        add_read_handler(0, "profile_events", router_read_handler, (void *)GH_PROFILE_EVENTS);
+        add_write_handler(0, "profile_events", router_write_handler, (void *)GH_PROFILE_EVENTS);
+#endif
+#if HAVE_CLICK_PACKET_POOL
+        add_read_handler(0, "packet_allocations", router_read_handler, (void *)GH_PACKET_ALLOCATIONS);
 #endif
     }
 }
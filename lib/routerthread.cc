@@ -80,6 +80,9 @@ RouterThread::RouterThread(Master *master, int id)
 #elif CLICK_USERLEVEL && HAVE_MULTITHREAD
     _running_processor = click_invalid_processor();
 #endif
+#if HAVE_MULTITHREAD
+    _busy_cycles = 0;
+#endif
 
     _task_blocker = 0;
     _task_blocker_waiting = 0;
@@ -395,6 +398,12 @@ RouterThread::run_tasks(int ntasks)
         if (runs > PROFILE_ELEMENT) {
             unsigned delta = click_get_cycles() - cycles;
             t->update_cycles(delta/32 + (t->cycles()*31)/32);
+            if (work_done) {
+                // this sample stands for the runs + 1 runs since the last one
+                click_cycles_t busy = (click_cycles_t) delta * (runs + 1);
+                t->_busy_cycles += busy;
+                _busy_cycles += busy;
+            }
         }
 #endif
 
@@ -193,38 +193,44 @@ Timer::task_hook(Timer *, void *thunk)
 
 
 Timer::Timer()
-    : _schedpos1(0), _thunk(0), _owner(0), _thread(0)
+    : _schedpos1(0), _coarse(false), _thunk(0), _owner(0), _thread(0),
+      _wheel_next(0), _wheel_pprev(0)
 {
     static_assert(sizeof(TimerSet::heap_element) == 16, "size_element should be 16 bytes long.");
     _hook.callback = do_nothing_hook;
 }
 
 Timer::Timer(const do_nothing_t &)
-    : _schedpos1(0), _thunk((void *) 1), _owner(0), _thread(0)
+    : _schedpos1(0), _coarse(false), _thunk((void *) 1), _owner(0), _thread(0),
+      _wheel_next(0), _wheel_pprev(0)
 {
     _hook.callback = do_nothing_hook;
 }
 
 Timer::Timer(TimerCallback f, void *user_data)
-    : _schedpos1(0), _thunk(user_data), _owner(0), _thread(0)
+    : _schedpos1(0), _coarse(false), _thunk(user_data), _owner(0), _thread(0),
+      _wheel_next(0), _wheel_pprev(0)
 {
     _hook.callback = f;
 }
 
 Timer::Timer(Element* element)
-    : _schedpos1(0), _thunk(element), _owner(0), _thread(0)
+    : _schedpos1(0), _coarse(false), _thunk(element), _owner(0), _thread(0),
+      _wheel_next(0), _wheel_pprev(0)
 {
     _hook.callback = element_hook;
 }
 
 Timer::Timer(Task* task)
-    : _schedpos1(0), _thunk(task), _owner(0), _thread(0)
+    : _schedpos1(0), _coarse(false), _thunk(task), _owner(0), _thread(0),
+      _wheel_next(0), _wheel_pprev(0)
 {
     _hook.callback = task_hook;
 }
 
 Timer::Timer(const Timer &x)
-    : _schedpos1(0), _hook(x._hook), _thunk(x._thunk), _owner(0), _thread(0)
+    : _schedpos1(0), _coarse(x._coarse), _hook(x._hook), _thunk(x._thunk),
+      _owner(0), _thread(0), _wheel_next(0), _wheel_pprev(0)
 {
 }
 
@@ -281,6 +287,22 @@ Timer::schedule_at_steady(const Timestamp &when)
     _expiry_s = when ? when : Timestamp::epsilon();
     ts.check_timer_expiry(this);
 
+    // coarse timers go on the timing wheel
+    if (_coarse) {
+	Timestamp old_expiry = ts._timer_expiry;
+	if (_schedpos1 == TimerSet::wheel_schedpos)
+	    ts.wheel_remove(this);
+	else
+	    ts.heap_remove(this);
+	ts.wheel_insert(this);
+	ts.set_timer_expiry();
+	if (!old_expiry || ts._timer_expiry < old_expiry)
+	    _thread->wake();
+	ts.unlock_timers();
+	return;
+    } else if (_schedpos1 == TimerSet::wheel_schedpos)
+	ts.wheel_remove(this);
+
     // manipulate list; this is essentially a "decrease-key" operation
     // any reschedule removes a timer from the runchunk (XXX -- even backwards
     // reschedulings)
@@ -319,17 +341,10 @@ Timer::unschedule()
 	return;
     TimerSet &ts = _thread->timer_set();
     ts.lock_timers();
-    int old_schedpos1 = _schedpos1;
-    if (_schedpos1 > 0) {
-	remove_heap<4>(ts._timer_heap.begin(), ts._timer_heap.end(),
-		       ts._timer_heap.begin() + _schedpos1 - 1,
-		       TimerSet::heap_less(), TimerSet::heap_place());
-	ts._timer_heap.pop_back();
-	if (old_schedpos1 == 1)
-	    ts.set_timer_expiry();
-    } else if (_schedpos1 < 0)
-	ts._timer_runchunk[-_schedpos1 - 1] = 0;
-    _schedpos1 = 0;
+    if (_schedpos1 == TimerSet::wheel_schedpos)
+	ts.wheel_remove(this);
+    else
+	ts.heap_remove(this);
     ts.unlock_timers();
 }
 
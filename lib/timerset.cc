@@ -24,6 +24,7 @@
 #include <click/routerthread.hh>
 #include <click/heap.hh>
 #include <click/master.hh>
+#include <click/integers.hh>
 CLICK_DECLS
 
 TimerSet::TimerSet()
@@ -48,6 +49,13 @@ TimerSet::TimerSet()
 #endif
     _timer_check = Timestamp::now_steady();
     _timer_check_reports = 0;
+
+    memset(_wheel0, 0, sizeof(_wheel0));
+    memset(_wheeln, 0, sizeof(_wheeln));
+    wheel_clear_bits();
+    _wheel_now = wheel_tick(_timer_check);
+    _wheel_count = 0;
+    _wheel_runlist = 0;
 }
 
 void
@@ -66,6 +74,18 @@ TimerSet::kill_router(Router *router)
 	    t->_schedpos1 = 0;
 	}
     }
+    for (int l = -1; l < wheel_levels; ++l) {
+	Timer **slot = (l < 0 ? &_wheel_runlist : l == 0 ? _wheel0 : _wheeln[l - 1]);
+	int nslots = (l < 0 ? 1 : l == 0 ? (int) wheel_slots0 : (int) wheel_slotsn);
+	for (int i = 0; i < nslots; ++i)
+	    for (Timer *t = slot[i], *next; t; t = next) {
+		next = t->_wheel_next;
+		if (t->router() == router) {
+		    wheel_remove(t);
+		    t->_owner = 0;
+		}
+	    }
+    }
     set_timer_expiry();
     unlock_timers();
 }
@@ -91,31 +111,238 @@ TimerSet::check_timer_expiry(Timer *t)
     }
 }
 
+void
+TimerSet::heap_remove(Timer *t)
+{
+    if (t->_schedpos1 > 0) {
+	int old_schedpos1 = t->_schedpos1;
+	remove_heap<4>(_timer_heap.begin(), _timer_heap.end(),
+		       _timer_heap.begin() + t->_schedpos1 - 1,
+		       heap_less(), heap_place());
+	_timer_heap.pop_back();
+	if (old_schedpos1 == 1)
+	    set_timer_expiry();
+    } else if (t->_schedpos1 < 0)
+	_timer_runchunk[-t->_schedpos1 - 1] = 0;
+    t->_schedpos1 = 0;
+}
+
+void
+TimerSet::wheel_insert(Timer *t)
+{
+    if (!_wheel_count) {
+	_wheel_now = wheel_tick(Timestamp::recent_steady());
+	wheel_clear_bits();
+    }
+    wheel_place(t);
+    ++_wheel_count;
+    t->_schedpos1 = wheel_schedpos;
+}
+
+void
+TimerSet::wheel_place(Timer *t)
+{
+    uint64_t when = wheel_tick(t->_expiry_s);
+    if (when < _wheel_now)
+	when = _wheel_now;
+    uint64_t delta = when - _wheel_now;
+
+    // The wheel must be looked at again when the timer's level-0 slot
+    // expires, or when the higher-level slot holding it is cascaded.
+    uint64_t wake_tick;
+    if (delta < wheel_slots0) {
+	unsigned i = when & (wheel_slots0 - 1);
+	wheel_push(&_wheel0[i], t);
+	_wheel0_bits[i / 64] |= (uint64_t) 1 << (i % 64);
+	wake_tick = when;
+    } else {
+	int level = 0, shift = wheel_bits0;
+	while (level < wheel_levels - 2
+	       && delta >= ((uint64_t) 1 << (shift + wheel_bitsn))) {
+	    ++level;
+	    shift += wheel_bitsn;
+	}
+	// timers beyond the wheel's range wait in the last slot and are
+	// reinserted when it cascades
+	if (delta >= ((uint64_t) 1 << (shift + wheel_bitsn)))
+	    when = _wheel_now + ((uint64_t) 1 << (shift + wheel_bitsn)) - 1;
+	unsigned i = (when >> shift) & (wheel_slotsn - 1);
+	wheel_push(&_wheeln[level][i], t);
+	_wheeln_bits[level] |= (uint64_t) 1 << i;
+	wake_tick = (when >> shift) << shift;
+    }
+
+    Timestamp expiry = wheel_tick_expiry(wake_tick);
+    if (!_wheel_expiry || expiry < _wheel_expiry)
+	_wheel_expiry = expiry;
+}
+
+void
+TimerSet::wheel_remove(Timer *t)
+{
+    Timer **slot = t->_wheel_pprev;
+    wheel_unlink(t);
+    t->_schedpos1 = 0;
+    // clear the occupancy bit of a slot left empty, so that wheel_advance
+    // and wheel_next_expiry do not rescan it
+    if (!*slot) {
+	if (slot >= _wheel0 && slot < _wheel0 + wheel_slots0) {
+	    unsigned i = slot - _wheel0;
+	    _wheel0_bits[i / 64] &= ~((uint64_t) 1 << (i % 64));
+	} else if (slot >= _wheeln[0] && slot < _wheeln[0] + (wheel_levels - 1) * wheel_slotsn) {
+	    unsigned i = slot - _wheeln[0];
+	    _wheeln_bits[i / wheel_slotsn] &= ~((uint64_t) 1 << (i % wheel_slotsn));
+	}
+    }
+    if (--_wheel_count == 0) {
+	_wheel_expiry = Timestamp();
+	set_timer_expiry();
+    }
+}
+
+void
+TimerSet::wheel_cascade(int level, unsigned i)
+{
+    Timer *t = _wheeln[level][i];
+    _wheeln[level][i] = 0;
+    _wheeln_bits[level] &= ~((uint64_t) 1 << i);
+    while (t) {
+	Timer *next = t->_wheel_next;
+	wheel_place(t);
+	t = next;
+    }
+}
+
+void
+TimerSet::wheel_advance(uint64_t now_tick)
+{
+    while (_wheel_now < now_tick && _wheel_count) {
+	unsigned i = _wheel_now & (wheel_slots0 - 1);
+
+	// at the start of each level-0 round, pull down the higher-level
+	// slots that cover it
+	if (i == 0)
+	    for (int level = 0, shift = wheel_bits0; level < wheel_levels - 1;
+		 ++level, shift += wheel_bitsn) {
+		unsigned idx = (_wheel_now >> shift) & (wheel_slotsn - 1);
+		wheel_cascade(level, idx);
+		if (idx != 0)
+		    break;
+	    }
+
+	// move every timer of this tick to the run list at once
+	for (Timer *t = _wheel0[i], *next; t; t = next) {
+	    next = t->_wheel_next;
+	    wheel_push(&_wheel_runlist, t);
+	}
+	_wheel0[i] = 0;
+	_wheel0_bits[i / 64] &= ~((uint64_t) 1 << (i % 64));
+	++_wheel_now;
+
+	// skip empty ticks up to the end of this round
+	unsigned j = i + 1, w;
+	uint64_t bits = 0;
+	for (w = j / 64; j < wheel_slots0; j = ++w * 64)
+	    if ((bits = _wheel0_bits[w] & (~(uint64_t) 0 << (j % 64))))
+		break;
+	j = bits ? w * 64 + ffs_lsb(bits) - 1 : (unsigned) wheel_slots0;
+	uint64_t next_tick = (_wheel_now - i - 1) + j;
+	_wheel_now = next_tick < now_tick ? next_tick : now_tick;
+    }
+    if (!_wheel_count)
+	_wheel_now = now_tick;
+}
+
+Timestamp
+TimerSet::wheel_next_expiry() const
+{
+    if (_wheel_runlist)
+	return _timer_check;
+    if (!_wheel_count)
+	return Timestamp();
+
+    // first nonempty level-0 slot, in tick order starting from now
+    uint64_t best = ~(uint64_t) 0;
+    unsigned i = _wheel_now & (wheel_slots0 - 1);
+    for (unsigned k = 0; k <= wheel_slots0 / 64; ++k) {
+	unsigned w = (i / 64 + k) % (wheel_slots0 / 64);
+	uint64_t bits = _wheel0_bits[w];
+	if (k == 0)
+	    bits &= ~(uint64_t) 0 << (i % 64);
+	else if (k == wheel_slots0 / 64)
+	    bits &= ~(~(uint64_t) 0 << (i % 64));
+	if (bits) {
+	    unsigned j = w * 64 + ffs_lsb(bits) - 1;
+	    best = (_wheel_now - i) + j + (j < i ? wheel_slots0 : 0);
+	    break;
+	}
+    }
+
+    // first pending cascade on each higher level
+    for (int level = 0, shift = wheel_bits0; level < wheel_levels - 1;
+	 ++level, shift += wheel_bitsn)
+	if (uint64_t bits = _wheeln_bits[level]) {
+	    uint64_t round = _wheel_now >> shift;
+	    if ((round << shift) != _wheel_now)
+		++round;	// the current slot was already cascaded
+	    unsigned idx = round & (wheel_slotsn - 1);
+	    uint64_t rot = idx ? (bits >> idx) | (bits << (64 - idx)) : bits;
+	    uint64_t tick = (round + ffs_lsb(rot) - 1) << shift;
+	    if (tick < best)
+		best = tick;
+	}
+
+    return best == ~(uint64_t) 0 ? Timestamp() : wheel_tick_expiry(best);
+}
+
 inline void
 TimerSet::run_one_timer(Timer *t)
 {
 #if CLICK_STATS >= 2
-    Element *owner = t->_owner;
+    Element::stats_type &stats = *t->_owner->_stats;
     click_cycles_t start_cycles = click_get_cycles(),
-	start_child_cycles = owner->_child_cycles;
+	start_child_cycles = stats.child_cycles;
 #endif
 
     t->_hook.callback(t, t->_thunk);
 
 #if CLICK_STATS >= 2
     click_cycles_t all_delta = click_get_cycles() - start_cycles,
-	own_delta = all_delta - (owner->_child_cycles - start_child_cycles);
-    owner->_timer_calls += 1;
-    owner->_timer_own_cycles += own_delta;
+	own_delta = all_delta - (stats.child_cycles - start_child_cycles);
+    stats.timer_calls += 1;
+    stats.timer_own_cycles += own_delta;
 #endif
 }
 
+void
+TimerSet::run_wheel_timers(RouterThread *thread)
+{
+    uint64_t now_tick = wheel_tick(_timer_check);
+    if (_wheel_now < now_tick)
+	wheel_advance(now_tick);
+
+    while (Timer *t = _wheel_runlist) {
+	if (thread->stop_flag())
+	    break;
+	wheel_unlink(t);
+	--_wheel_count;
+	t->_schedpos1 = 0;
+	run_one_timer(t);
+    }
+
+    if (!_wheel_count)
+	wheel_clear_bits();
+    _wheel_expiry = wheel_next_expiry();
+    set_timer_expiry();
+}
+
 void
 TimerSet::run_timers(RouterThread *thread, Master *master)
 {
     if (!_timer_lock.attempt())
 	return;
-    if (!master->paused() && _timer_heap.size() > 0 && !thread->stop_flag()) {
+    if (!master->paused() && (_timer_heap.size() > 0 || _wheel_count)
+	&& !thread->stop_flag()) {
 	thread->set_thread_state(RouterThread::S_RUNTIMER);
 #if CLICK_LINUXMODULE
 	_timer_task = current;
@@ -123,9 +350,14 @@ TimerSet::run_timers(RouterThread *thread, Master *master)
 	_timer_processor = click_current_processor();
 #endif
 	_timer_check = Timestamp::now_steady();
+
+	// Wheel callbacks may schedule heap timers and so reallocate
+	// _timer_heap: look at the heap only after they have run.
+	if (_wheel_expiry && _wheel_expiry <= _timer_check)
+	    run_wheel_timers(thread);
 	heap_element *th = _timer_heap.begin();
 
-	if (th->expiry_s <= _timer_check) {
+	if (_timer_heap.size() > 0 && th->expiry_s <= _timer_check) {
 	    // potentially adjust timer stride
 	    Timestamp adj_expiry = th->expiry_s + Timer::adjustment();
 	    if (adj_expiry <= _timer_check) {
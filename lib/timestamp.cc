@@ -61,6 +61,9 @@ Timestamp::warp_class_type TimestampWarp::kind = Timestamp::warp_none;
 double TimestampWarp::speed = 1.0;
 Timestamp TimestampWarp::flat_offset[2];
 double TimestampWarp::offset[2] = { 0.0, 0.0 };
+bool TimestampWarp::trace = false;
+bool TimestampWarp::trace_started = false;
+Timestamp TimestampWarp::trace_offset;
 
 void
 Timestamp::warp(bool steady, bool from_now)
@@ -125,6 +128,27 @@ Timestamp::warp_set_now(const Timestamp &t_system, const Timestamp &t_steady)
     warp_adjust(true, now_steady_raw, t_steady);
 }
 
+void
+Timestamp::warp_set_trace(bool trace)
+{
+    TimestampWarp::trace = trace;
+    TimestampWarp::trace_started = false;
+}
+
+Timestamp
+Timestamp::warp_trace_offset(const Timestamp &t)
+{
+    if (!TimestampWarp::trace)
+        return Timestamp::now_steady() - t;
+    if (!TimestampWarp::trace_started) {
+        Timestamp now_steady = Timestamp::now_steady();
+        warp_set_now(t, now_steady);
+        TimestampWarp::trace_offset = now_steady - t;
+        TimestampWarp::trace_started = true;
+    }
+    return TimestampWarp::trace_offset;
+}
+
 void
 Timestamp::warp_jump_steady(const Timestamp &expiry)
 {
@@ -53,6 +53,7 @@
 #define DEVIRTUALIZE_OPT	311
 #define INSTRS_OPT		312
 #define REVERSE_OPT		313
+#define FUSE_BATCH_OPT		314
 
 static const Clp_Option options[] = {
   { "clickpath", 'C', CLICKPATH_OPT, Clp_ValString, 0 },
@@ -60,6 +61,7 @@ static const Clp_Option options[] = {
   { "devirtualize", 0, DEVIRTUALIZE_OPT, Clp_ValString, Clp_Negate },
   { "expression", 'e', EXPRESSION_OPT, Clp_ValString, 0 },
   { "file", 'f', ROUTER_OPT, Clp_ValString, 0 },
+  { "fuse-batch", 0, FUSE_BATCH_OPT, 0, Clp_Negate },
   { "help", 0, HELP_OPT, 0, 0 },
   { 0, 'n', NO_DEVIRTUALIZE_OPT, Clp_ValString, 0 },
   { "kernel", 'k', KERNEL_OPT, 0, Clp_Negate }, // DEPRECATED
@@ -212,6 +214,8 @@ Options:\n\
   -r, --reverse                Reverse devirtualization.\n\
   -n, --no-devirtualize CLASS  Don't devirtualize element class CLASS.\n\
   -i, --instructions FILE      Read devirtualization instructions from FILE.\n\
+      --fuse-batch             Fuse linear chains of F-flagged batch elements\n\
+                               into single per-packet loops.\n\
   -C, --clickpath PATH         Use PATH for CLICKPATH.\n\
       --help                   Print this message and exit.\n\
   -v, --version                Print version number and exit.\n\
@@ -241,6 +245,7 @@ main(int argc, char **argv)
   int compile_kernel = 0;
   int compile_user = 0;
   int reverse = 0;
+  int fuse_batch = 0;
   Vector<const char *> instruction_files;
   HashTable<String, int> specializing;
 
@@ -324,6 +329,10 @@ particular purpose.\n");
       reverse = !clp->negated;
       break;
 
+     case FUSE_BATCH_OPT:
+      fuse_batch = !clp->negated;
+      break;
+
      bad_option:
      case Clp_BadOption:
       short_usage();
@@ -420,6 +429,7 @@ particular purpose.\n");
   // initialize specializer
   Specializer specializer(router, full_elementmap);
   specializer.specialize(sigs, errh);
+  int nfused = (fuse_batch ? specializer.fuse_batch_chains() : 0);
 
   // quit early if nothing was done
   if (specializer.nspecials() == 0) {
@@ -450,6 +460,8 @@ particular purpose.\n");
   header << "#ifndef CLICK_" << package_name << "_HH\n"
 	 << "#define CLICK_" << package_name << "_HH\n"
 	 << "#include <click/package.hh>\n#include <click/element.hh>\n";
+  if (nfused)
+    header << "#include <click/batchfusion.hh>\n";
 
   specializer.output_package(package_name, suffix, source, errh);
   specializer.output(header, source);
@@ -25,6 +25,7 @@
 #include "toolutils.hh"
 #include "elementmap.hh"
 #include <click/straccum.hh>
+#include <click/algorithm.hh>
 #include "signature.hh"
 #include <ctype.h>
 
@@ -44,6 +45,7 @@ Specializer::Specializer(RouterT *router, const ElementMap &em)
   for (ElementMap::TraitsIterator x = em.begin_elements(); x; x++) {
     const Traits &e = x.value();
     add_type_info(e.name, e.cxx, e.header_file, em.source_directory(e));
+    _etinfo.back().batch_fusable = (e.flag_value("F") > 0);
   }
 }
 
@@ -439,6 +441,71 @@ Specializer::specialize(const Signatures &sigs, ErrorHandler *errh)
       create_connector_methods(_specials[s]);
 }
 
+bool
+Specializer::batch_fusable(int eindex) const
+{
+  // the F flag promises that simple_action() matches the batch path
+  const SpecializedClass &spc = _specials[_specialize[eindex]];
+  return spc.special() && spc.cxxc->find("smaction")
+    && etype_info(eindex).batch_fusable;
+}
+
+int
+Specializer::fuse_batch_chains()
+{
+  // link each fusable element to the fusable element on its output 0
+  Vector<int> next(_nelements, -1);
+  for (int i = 0; i < _nelements; i++)
+    if (_noutputs[i] > 0 && batch_fusable(i)) {
+      RouterT::conn_iterator it = _router->find_connections_from(PortT(_router->element(i), 0));
+      if (it.is_back() && it->to_port() == 0 && batch_fusable(it->to_eindex()))
+	next[i] = it->to_eindex();
+    }
+
+  // give every chain member a push_batch() that runs the rest of the chain.
+  // Elements sharing a specialized class have isomorphic neighborhoods, so
+  // one chain per class suffices.
+  Vector<int> done(_specials.size(), 0);
+  int nfused = 0;
+  for (int i = 0; i < _nelements; i++) {
+    int sp = _specialize[i];
+    if (next[i] < 0 || done[sp])
+      continue;
+    done[sp] = 1;
+
+    Vector<int> chain;
+    chain.push_back(i);
+    for (int j = next[i]; j >= 0; j = next[j]) {
+      if (find(chain.begin(), chain.end(), j) != chain.end())
+	break;
+      chain.push_back(j);
+    }
+
+    StringAccum sa;
+    sa << "\n#if HAVE_BATCH\n  BatchFusion<";
+    for (int k = 0; k < chain.size(); k++) {
+      int csp = _specialize[chain[k]];
+      CxxClass *cxxc = _specials[csp].cxxc;
+      CxxFunction *sa_fn = cxxc->find("simple_action");
+      if (!sa_fn || !sa_fn->alive())
+	cxxc->defun
+	  (CxxFunction("simple_action", false, "inline Packet *", "(Packet *p)",
+		       "\n  return smaction(p);\n", ""));
+      sa << (k ? ", " : "") << _specials[csp].cxx_name;
+    }
+    sa << " >::push_batch(this, batch);\n#else\n  (void) batch;\n#endif\n";
+
+    CxxClass *cxxc = _specials[sp].cxxc;
+    if (CxxFunction *pb = cxxc->find("push_batch"))
+      pb->kill();
+    cxxc->defun
+      (CxxFunction("push_batch", false, "void", "(int, PacketBatch *batch)",
+		   sa.take_string(), ""));
+    nfused++;
+  }
+  return nfused;
+}
+
 void
 Specializer::fix_elements()
 {
@@ -19,6 +19,7 @@ struct ElementTypeInfo {
   String includes;
   bool read_source;
   bool wrote_includes;
+  bool batch_fusable;
 
   ElementTypeInfo();
   void locate_header_file(RouterT *, ErrorHandler *);
@@ -47,6 +48,7 @@ class Specializer { public:
 		     const String &header_file, const String &source_dir);
 
   void specialize(const Signatures &, ErrorHandler *);
+  int fuse_batch_chains();
   void fix_elements();
 
   int nspecials() const				{ return _specials.size(); }
@@ -84,6 +86,7 @@ class Specializer { public:
   bool create_class(SpecializedClass &);
   void do_simple_action(SpecializedClass &);
   void create_connector_methods(SpecializedClass &);
+  bool batch_fusable(int) const;
 
   void output_includes(ElementTypeInfo &, StringAccum &);
 
@@ -91,7 +94,7 @@ class Specializer { public:
 
 inline
 ElementTypeInfo::ElementTypeInfo()
-  : read_source(false), wrote_includes(false)
+  : read_source(false), wrote_includes(false), batch_fusable(false)
 {
 }
 
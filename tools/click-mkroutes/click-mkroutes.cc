@@ -0,0 +1,263 @@
+/*
+ * click-mkroutes.cc -- convert IPv4 route tables to binary route files
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Click LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Click LICENSE file; the license in that file is
+ * legally binding.
+ */
+
+#include <click/config.h>
+#include <click/error.hh>
+#include <click/driver.hh>
+#include <click/confparse.hh>
+#include <click/args.hh>
+#include <click/ipaddress.hh>
+#include <click/straccum.hh>
+#include <click/userutils.hh>
+#include <click/iproutefile.h>
+#include <click/clp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#define HELP_OPT		300
+#define VERSION_OPT		301
+#define OUTPUT_OPT		302
+#define DUMP_OPT		303
+
+static const Clp_Option options[] = {
+  { "dump", 'd', DUMP_OPT, 0, 0 },
+  { "help", 0, HELP_OPT, 0, 0 },
+  { "output", 'o', OUTPUT_OPT, Clp_ValString, 0 },
+  { "version", 'v', VERSION_OPT, 0, 0 },
+};
+
+static const char *program_name;
+
+void
+short_usage()
+{
+  fprintf(stderr, "Usage: %s [OPTION]... [FILE]...\n\
+Try '%s --help' for more information.\n",
+	  program_name, program_name);
+}
+
+void
+usage()
+{
+  printf("\
+'Click-mkroutes' reads IPv4 routes in text form and writes them as a binary\n\
+route file, which DirectIPLookup, RangeIPLookup, and RadixIPLookup can load\n\
+with their FILE keyword or 'load' handler.\n\
+\n\
+Each route is 'ADDR/MASK [GW] OUT', as in an IPRouteTable configuration.\n\
+Routes are separated by newlines or commas; '#' and '//' start comments.\n\
+The output of an IPRouteTable 'table' handler is valid input.\n\
+\n\
+Usage: %s [OPTION]... [FILE]...\n\
+\n\
+Options:\n\
+  -o, --output FILE         Write output to FILE.\n\
+  -d, --dump                Read binary route files and print them as text.\n\
+      --help                Print this message and exit.\n\
+  -v, --version             Print version number and exit.\n\
+\n\
+Report bugs to <click@librelist.com>.\n", program_name);
+}
+
+static bool
+parse_route(String s, click_iproute_file_entry &e)
+{
+  IPAddress addr, mask, gw;
+  int32_t port;
+  if (!IPPrefixArg(true).parse(cp_shift_spacevec(s), addr, mask))
+    return false;
+  String word = cp_shift_spacevec(s);
+  if (word == "-")
+    /* null gateway */;
+  else if (IPAddressArg().parse(word, gw))
+    /* do nothing */;
+  else
+    goto two_words;
+  word = cp_shift_spacevec(s);
+ two_words:
+  if (!IntArg().parse(word, port) || port < 0 || port > 0xFFFF
+      || cp_shift_spacevec(s))
+    return false;
+  e.addr = (addr & mask).addr();
+  e.gw = gw.addr();
+  e.port = htons(port);
+  e.prefix_len = mask.mask_to_prefix_len();
+  e.flags = 0;
+  return true;
+}
+
+static void
+read_routes(const String &filename, const String &text,
+	    Vector<click_iproute_file_entry> &entries, ErrorHandler *errh)
+{
+  const char *s = text.begin(), *end = text.end();
+  for (int lineno = 1; s < end; ++lineno) {
+    const char *nl = find(s, end, '\n');
+    String line = text.substring(s, nl);
+    s = nl + 1;
+    if (line.find_left('#') >= 0)
+      line = line.substring(0, line.find_left('#'));
+    line = cp_uncomment(line);
+    Vector<String> words;
+    cp_argvec(line, words);
+    for (int i = 0; i < words.size(); ++i) {
+      click_iproute_file_entry e;
+      if (!words[i])
+	continue;
+      else if (!parse_route(words[i], e))
+	errh->lerror(filename + ":" + String(lineno), "bad route %<%s%>", words[i].c_str());
+      else
+	entries.push_back(e);
+    }
+  }
+}
+
+static void
+write_routes(const Vector<click_iproute_file_entry> &entries, FILE *out)
+{
+  click_iproute_file_header h;
+  h.magic = htonl(CLICK_IPROUTE_FILE_MAGIC);
+  h.version = htons(CLICK_IPROUTE_FILE_VERSION);
+  h.entry_size = htons(sizeof(click_iproute_file_entry));
+  h.count = htonl(entries.size());
+  h.reserved = 0;
+  ignore_result(fwrite(&h, sizeof(h), 1, out));
+  if (entries.size())
+    ignore_result(fwrite(entries.begin(), sizeof(click_iproute_file_entry), entries.size(), out));
+}
+
+static int
+dump_routes(const String &filename, const String &data, FILE *out, ErrorHandler *errh)
+{
+  const click_iproute_file_header *h = reinterpret_cast<const click_iproute_file_header *>(data.data());
+  if (data.length() < (int) sizeof(*h) || ntohl(h->magic) != CLICK_IPROUTE_FILE_MAGIC)
+    return errh->error("%s: not a route file", filename.c_str());
+  if (ntohs(h->version) != CLICK_IPROUTE_FILE_VERSION
+      || ntohs(h->entry_size) != sizeof(click_iproute_file_entry))
+    return errh->error("%s: unsupported route file version %d", filename.c_str(), ntohs(h->version));
+  uint32_t count = ntohl(h->count);
+  if ((data.length() - sizeof(*h)) / sizeof(click_iproute_file_entry) < count)
+    return errh->error("%s: truncated route file", filename.c_str());
+
+  const click_iproute_file_entry *e = reinterpret_cast<const click_iproute_file_entry *>(h + 1);
+  StringAccum sa;
+  for (uint32_t i = 0; i < count; ++i, ++e) {
+    sa << IPAddress(e->addr).unparse_with_mask(IPAddress::make_prefix(e->prefix_len)) << ' ';
+    if (e->gw)
+      sa << IPAddress(e->gw) << ' ';
+    sa << ntohs(e->port) << '\n';
+    if (sa.length() > 65536) {
+      ignore_result(fwrite(sa.data(), 1, sa.length(), out));
+      sa.clear();
+    }
+  }
+  ignore_result(fwrite(sa.data(), 1, sa.length(), out));
+  return 0;
+}
+
+int
+main(int argc, char **argv)
+{
+  click_static_initialize();
+  ErrorHandler *errh = ErrorHandler::default_handler();
+  ErrorHandler *p_errh = new PrefixErrorHandler(errh, "click-mkroutes: ");
+
+  // read command line arguments
+  Clp_Parser *clp =
+    Clp_NewParser(argc, argv, sizeof(options) / sizeof(options[0]), options);
+  program_name = Clp_ProgramName(clp);
+
+  Vector<String> files;
+  const char *output_file = 0;
+  bool dump = false;
+
+  while (1) {
+    int opt = Clp_Next(clp);
+    switch (opt) {
+
+     case HELP_OPT:
+      usage();
+      exit(0);
+      break;
+
+     case VERSION_OPT:
+      printf("click-mkroutes (Click) %s\n", CLICK_VERSION);
+      printf("This is free software; see the source for copying conditions.\n\
+There is NO warranty, not even for merchantability or fitness for a\n\
+particular purpose.\n");
+      exit(0);
+      break;
+
+     case OUTPUT_OPT:
+      if (output_file) {
+	p_errh->error("--output file specified twice");
+	goto bad_option;
+      }
+      output_file = clp->vstr;
+      break;
+
+     case DUMP_OPT:
+      dump = true;
+      break;
+
+     case Clp_NotOption:
+      files.push_back(clp->vstr);
+      break;
+
+     case Clp_BadOption:
+     bad_option:
+      short_usage();
+      exit(1);
+      break;
+
+     case Clp_Done:
+      goto done;
+
+    }
+  }
+
+ done:
+  if (!files.size())
+    files.push_back("-");
+
+  FILE *out;
+  if (!output_file || strcmp(output_file, "-") == 0)
+    out = stdout;
+  else if (!(out = fopen(output_file, "wb"))) {
+    p_errh->error("%s: %s", output_file, strerror(errno));
+    exit(1);
+  }
+
+  Vector<click_iproute_file_entry> entries;
+  for (int i = 0; i < files.size(); ++i) {
+    String name = (files[i] == "-" ? String("<stdin>") : files[i]);
+    String text = file_string(files[i], p_errh);
+    if (p_errh->nerrors())
+      break;
+    if (dump)
+      dump_routes(name, text, out, p_errh);
+    else
+      read_routes(name, text, entries, p_errh);
+  }
+  if (p_errh->nerrors())
+    exit(1);
+
+  if (!dump)
+    write_routes(entries, out);
+  if (out != stdout)
+    fclose(out);
+  return 0;
+}
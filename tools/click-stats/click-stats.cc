@@ -0,0 +1,349 @@
+/*
+ * click-stats.cc -- print counters exported by StatsExport
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Click LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Click LICENSE file; the license in that file is
+ * legally binding.
+ */
+
+#include <click/config.h>
+#include <click/error.hh>
+#include <click/straccum.hh>
+#include <click/vector.hh>
+#include <click/driver.hh>
+#include <click/clp.h>
+#include <click/statsregion.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <fnmatch.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define HELP_OPT		300
+#define VERSION_OPT		301
+#define INTERVAL_OPT		302
+#define COUNT_OPT		303
+#define RATE_OPT		304
+#define THREADS_OPT		305
+
+static const Clp_Option options[] = {
+  { "count", 'n', COUNT_OPT, Clp_ValUnsigned, 0 },
+  { "help", 0, HELP_OPT, 0, 0 },
+  { "interval", 'i', INTERVAL_OPT, Clp_ValDouble, 0 },
+  { "rate", 'r', RATE_OPT, 0, Clp_Negate },
+  { "threads", 't', THREADS_OPT, 0, Clp_Negate },
+  { "version", 'v', VERSION_OPT, 0, 0 },
+};
+
+static const char *program_name;
+
+void
+short_usage()
+{
+  fprintf(stderr, "Usage: %s [OPTION]... FILE [PATTERN...]\n\
+Try '%s --help' for more information.\n",
+	  program_name, program_name);
+}
+
+void
+usage()
+{
+  printf("\
+'Click-stats' prints the counters a Click router exports through a StatsExport\n\
+element. It reads them straight from the shared-memory FILE, without\n\
+disturbing the router. Only counters whose names match one of the shell\n\
+PATTERNs are printed, if any PATTERNs are given.\n\
+\n\
+Usage: %s [OPTION]... FILE [PATTERN...]\n\
+\n\
+Options:\n\
+  -i, --interval SEC            Print counters every SEC seconds.\n\
+  -n, --count N                 Print counters N times, then exit.\n\
+  -r, --rate                    Print rates per second instead of values.\n\
+  -t, --threads                 Also print each thread's share.\n\
+      --help                    Print this message and exit.\n\
+  -v, --version                 Print version number and exit.\n\
+\n\
+Report bugs to <click@librelist.com>.\n", program_name);
+}
+
+
+struct Region {
+  void *mem;
+  size_t size;
+  const click_stats_header *h;
+  Region() : mem(0), size(0), h(0) { }
+};
+
+struct Sample {
+  Vector<String> names;
+  Vector<uint64_t> values;	// names.size() * (nthreads + 1): sum first
+  unsigned nthreads;
+};
+
+static void
+close_region(Region &r)
+{
+  if (r.mem)
+    munmap(r.mem, r.size);
+  r = Region();
+}
+
+static int
+open_region(const char *filename, Region &r, ErrorHandler *errh)
+{
+  close_region(r);
+  int fd = open(filename, O_RDONLY);
+  if (fd < 0)
+    return errh->error("%s: %s", filename, strerror(errno));
+  struct stat st;
+  if (fstat(fd, &st) < 0) {
+    close(fd);
+    return errh->error("%s: %s", filename, strerror(errno));
+  }
+  if ((size_t) st.st_size < sizeof(click_stats_header)) {
+    close(fd);
+    return errh->error("%s: not a Click statistics file", filename);
+  }
+  r.size = st.st_size;
+  r.mem = mmap(0, r.size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (r.mem == MAP_FAILED) {
+    r.mem = 0;
+    return errh->error("%s: %s", filename, strerror(errno));
+  }
+
+  const click_stats_header *h = static_cast<const click_stats_header *>(r.mem);
+  if (memcmp(h->magic, CLICK_STATS_MAGIC, sizeof(h->magic)) != 0) {
+    close_region(r);
+    return errh->error("%s: not a Click statistics file", filename);
+  }
+  if (h->version != CLICK_STATS_VERSION
+      || h->header_size != sizeof(click_stats_header)
+      || h->desc_size != sizeof(click_stats_desc)) {
+    close_region(r);
+    return errh->error("%s: unsupported statistics file version", filename);
+  }
+  if (h->size > r.size
+      || h->desc_offset + (uint64_t) h->capacity * h->desc_size > h->data_offset
+      || h->data_offset + (uint64_t) h->nthreads * h->thread_stride > h->size
+      || (uint64_t) h->capacity * sizeof(uint64_t) > h->thread_stride) {
+    close_region(r);
+    return errh->error("%s: corrupt statistics file", filename);
+  }
+  r.h = h;
+  return 0;
+}
+
+static bool
+matches(const char *name, const Vector<const char *> &patterns)
+{
+  if (!patterns.size())
+    return true;
+  for (int i = 0; i < patterns.size(); ++i)
+    if (fnmatch(patterns[i], name, 0) == 0)
+      return true;
+  return false;
+}
+
+static void
+take_sample(const Region &r, const Vector<const char *> &patterns, Sample &s)
+{
+  const click_stats_header *h = r.h;
+  const char *base = static_cast<const char *>(r.mem);
+  // load ncounters before the descriptors it covers
+  uint32_t n = h->ncounters;
+  __sync_synchronize();
+  if (n > h->capacity)
+    n = h->capacity;
+
+  s.names.clear();
+  s.values.clear();
+  s.nthreads = h->nthreads;
+  const click_stats_desc *desc =
+    reinterpret_cast<const click_stats_desc *>(base + h->desc_offset);
+  for (uint32_t i = 0; i < n; ++i) {
+    const click_stats_desc &d = desc[i];
+    String name(d.name, strnlen(d.name, CLICK_STATS_NAMELEN));
+    if (d.slot >= h->capacity || !matches(name.c_str(), patterns))
+      continue;
+    s.names.push_back(name);
+    int pos = s.values.size();
+    s.values.push_back(0);
+    for (uint32_t t = 0; t < h->nthreads; ++t) {
+      uint64_t v = *reinterpret_cast<const volatile uint64_t *>
+	(base + h->data_offset + (uint64_t) t * h->thread_stride
+	 + (uint64_t) d.slot * sizeof(uint64_t));
+      s.values[pos] += v;
+      s.values.push_back(v);
+    }
+  }
+}
+
+static void
+print_sample(const Sample &s, const Sample *prev, double interval, bool threads)
+{
+  StringAccum sa;
+  unsigned width = s.nthreads + 1;
+  for (int i = 0; i < s.names.size(); ++i) {
+    sa << s.names[i];
+    // counters registered since the previous sample have no rate yet
+    bool has_prev = prev && i < prev->names.size()
+      && prev->names[i] == s.names[i] && prev->nthreads == s.nthreads;
+    for (unsigned t = 0; t < (threads ? width : 1); ++t) {
+      uint64_t v = s.values[i * width + t];
+      if (prev && !has_prev)
+	sa << " -";
+      else if (prev) {
+	uint64_t p = prev->values[i * width + t];
+	char buf[40];
+	snprintf(buf, sizeof(buf), "%.1f", (v >= p ? v - p : 0) / interval);
+	sa << ' ' << buf;
+      } else
+	sa << ' ' << v;
+    }
+    sa << '\n';
+  }
+  fwrite(sa.data(), 1, sa.length(), stdout);
+  fflush(stdout);
+}
+
+int
+main(int argc, char **argv)
+{
+  click_static_initialize();
+  ErrorHandler *default_errh = ErrorHandler::default_handler();
+  ErrorHandler *errh = new PrefixErrorHandler(default_errh, "click-stats: ");
+
+  // read command line arguments
+  Clp_Parser *clp =
+    Clp_NewParser(argc, argv, sizeof(options) / sizeof(options[0]), options);
+  Clp_SetOptionChar(clp, '+', Clp_ShortNegated);
+  program_name = Clp_ProgramName(clp);
+
+  const char *filename = 0;
+  Vector<const char *> patterns;
+  double interval = 0;
+  unsigned count = 0;
+  bool rate = false;
+  bool threads = false;
+
+  while (1) {
+    int opt = Clp_Next(clp);
+    switch (opt) {
+
+     case HELP_OPT:
+      usage();
+      exit(0);
+      break;
+
+     case VERSION_OPT:
+      printf("click-stats (Click) %s\n", CLICK_VERSION);
+      printf("This is free software; see the source for copying conditions.\n\
+There is NO warranty, not even for merchantability or fitness for a\n\
+particular purpose.\n");
+      exit(0);
+      break;
+
+     case INTERVAL_OPT:
+      if (clp->val.d <= 0) {
+	errh->error("interval must be positive");
+	goto bad_option;
+      }
+      interval = clp->val.d;
+      break;
+
+     case COUNT_OPT:
+      count = clp->val.u;
+      break;
+
+     case RATE_OPT:
+      rate = !clp->negated;
+      break;
+
+     case THREADS_OPT:
+      threads = !clp->negated;
+      break;
+
+     case Clp_NotOption:
+      if (!filename)
+	filename = clp->vstr;
+      else
+	patterns.push_back(clp->vstr);
+      break;
+
+     bad_option:
+     case Clp_BadOption:
+      short_usage();
+      exit(1);
+      break;
+
+     case Clp_Done:
+      goto done;
+
+    }
+  }
+
+ done:
+  if (!filename) {
+    errh->error("no statistics file specified");
+    short_usage();
+    exit(1);
+  }
+  if (rate && interval <= 0)
+    errh->fatal("'--rate' requires '--interval'");
+  if (interval <= 0 && count == 0)
+    count = 1;
+
+  Region r;
+  if (open_region(filename, r, errh) < 0)
+    exit(1);
+
+  // With '--rate', the first sample is only a baseline.
+  Sample cur, prev;
+  bool have_prev = false;
+  unsigned printed = 0;
+  while (1) {
+    take_sample(r, patterns, cur);
+    if (!rate || have_prev) {
+      if (printed > 0)
+	fputc('\n', stdout);
+      print_sample(cur, rate ? &prev : 0, interval, threads);
+      ++printed;
+    }
+    if (count && printed >= count)
+      break;
+
+    usleep((useconds_t) (interval * 1000000));
+    prev.names.swap(cur.names);
+    prev.values.swap(cur.values);
+    prev.nthreads = cur.nthreads;
+    have_prev = true;
+
+    // A closed region belongs to a router that went away; a new router
+    // may have replaced the file since.
+    if (r.h->closed) {
+      Region nr;
+      if (open_region(filename, nr, ErrorHandler::silent_handler()) == 0
+	  && !nr.h->closed) {
+	close_region(r);
+	r = nr;
+	have_prev = false;
+      } else
+	close_region(nr);
+    }
+  }
+
+  close_region(r);
+  exit(0);
+}
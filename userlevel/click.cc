@@ -82,6 +82,7 @@ CLICK_USING_DECLS
 #define SOCKET_OPT              318
 #define THREADS_AFF_OPT         319
 #define DPDK_OPT                320
+#define TRACE_TIME_OPT          321
 
 static const Clp_Option options[] = {
     { "allow-reconfigure", 'R', ALLOW_RECONFIG_OPT, 0, Clp_Negate },
@@ -98,6 +99,7 @@ static const Clp_Option options[] = {
     { "simtime", 0, SIMTIME_OPT, Clp_ValDouble, Clp_Optional },
     { "simulation-time", 0, SIMTIME_OPT, Clp_ValDouble, Clp_Optional },
     { "threads", 'j', THREADS_OPT, Clp_ValInt, 0 },
+    { "trace-time", 0, TRACE_TIME_OPT, 0, 0 },
     { "cpu", 0, THREADS_AFF_OPT, Clp_ValInt, Clp_Optional | Clp_Negate },
     { "affinity", 'a', THREADS_AFF_OPT, Clp_ValInt, Clp_Optional | Clp_Negate },
     { "time", 't', TIME_OPT, 0, 0 },
@@ -153,6 +155,8 @@ Options:\n\
   -t, --time                    Print information on how long driver took.\n\
   -w, --no-warnings             Do not print warnings.\n\
       --simtime                 Run in simulation time.\n\
+      --trace-time              Run in simulation time driven by the packet\n\
+                                timestamps of TIMING trace sources.\n\
   -C, --clickpath PATH          Use PATH for CLICKPATH.\n\
       --help                    Print this message and exit.\n\
   -v, --version                 Print version number and exit.\n\
@@ -668,6 +672,14 @@ main(int argc, char **argv)
         break;
     }
 
+    case TRACE_TIME_OPT: {
+        Timestamp::warp_set_class(Timestamp::warp_simulation);
+        Timestamp simbegin(1000000000);
+        Timestamp::warp_set_now(simbegin, simbegin);
+        Timestamp::warp_set_trace(true);
+        break;
+    }
+
      case CLICKPATH_OPT:
       set_clickpath(clp->vstr);
       break;